@@ -1,10 +1,12 @@
 #include <stddef.h>
 #include <sogl.h>
+#define SOGL_APITRACE_SHIM
+#include <sogl_apitrace.h>
 #include <sogl_math.h>
 
 
 const GLchar* const vs_src =
-"#version 130\n"
+"#version 150\n"
 "in vec3 pos;\n"
 "in vec3 rgb;\n"
 "out vec4 frag_color;\n"
@@ -16,7 +18,7 @@ const GLchar* const vs_src =
 
 
 const GLchar* const fs_src =
-"#version 130\n"
+"#version 150\n"
 "in vec4 frag_color;\n"
 "out vec4 outcolor;\n"
 "void main()\n"
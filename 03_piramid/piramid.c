@@ -1,10 +1,13 @@
 #include <stddef.h>
 #include <sogl.h>
+#include <sogl_mesh.h>
 #include <sogl_math.h>
+#define SOGL_RES_SHIM
+#include <sogl_res.h>
 
 
 const GLchar* const vs_src =
-"#version 130\n"
+"#version 150\n"
 "in vec3 pos;\n"
 "in vec3 rgb;\n"
 "out vec4 frag_color;\n"
@@ -16,7 +19,7 @@ const GLchar* const vs_src =
 
 
 const GLchar* const fs_src =
-"#version 130\n"
+"#version 150\n"
 "in vec4 frag_color;\n"
 "out vec4 outcolor;\n"
 "void main()\n"
@@ -73,6 +76,17 @@ int main(void)
 
 	};
 
+	/* weld the shared vertices into an indexed mesh
+	 * */
+	struct sogl_mesh mesh;
+	if (!sogl_mesh_build(verts, sizeof(verts)/sizeof(verts[0]),
+	                     sizeof(struct vertex_data),
+	                     offsetof(struct vertex_data, pos), &mesh))
+		goto Lmesh_build_failed;
+
+	sogl_mesh_upload(&mesh, GL_STREAM_DRAW);
+	struct vertex_data* const mesh_verts = mesh.verts;
+
 	/* Our rotation matrix is set to rotate 1 degree
 	 * */
 	struct mat4 rotation_matrix = SOGL_MAT4_IDENTITY;
@@ -90,15 +104,18 @@ int main(void)
 		 * transformation to all vertices/vectors of the object
 		 * this will rotate the triangle 1 degree per frame
 		 * */
-		for (int i = 0; i < (sizeof(verts)/sizeof(verts[0])); ++i)
-			sogl_mul_mat4_vec3(&rotation_matrix, &verts[i].pos, &verts[i].pos);
+		for (long i = 0; i < mesh.nverts; ++i)
+			sogl_mul_mat4_vec3(&rotation_matrix, &mesh_verts[i].pos, &mesh_verts[i].pos);
 		
-		glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STREAM_DRAW);
-		glDrawArrays(GL_TRIANGLES, 0, sizeof(verts)/sizeof(verts[0]));
+		glBufferData(GL_ARRAY_BUFFER, mesh.nverts * mesh.vertex_size,
+		             mesh.verts, GL_STREAM_DRAW);
+		sogl_mesh_draw(&mesh);
 
 		sogl_end_frame();
 	}
 
+	sogl_mesh_free(&mesh);
+Lmesh_build_failed:
 	sogl_term();
 	return 0;
 }
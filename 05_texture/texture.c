@@ -1,12 +1,13 @@
 #include <stddef.h>
 #include <cglm/cglm.h>
 #include <sogl.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include <sogl_texstream.h>
+#define SOGL_RES_SHIM
+#include <sogl_res.h>
 
 
 const GLchar* const vs_src =
-"#version 130\n"
+"#version 150\n"
 "in vec3 pos;\n"
 "in vec3 rgb;\n"
 "in vec2 uv;\n"
@@ -20,7 +21,7 @@ const GLchar* const vs_src =
 "}\n";
 
 const GLchar* const fs_src =
-"#version 130\n"
+"#version 150\n"
 "in vec4 frag_color;\n"
 "in vec2 frag_uv;\n"
 "out vec4 outcolor;\n"
@@ -38,45 +39,33 @@ struct vertex_data {
 };
 
 
-static bool load_texture(void)
-{
-	stbi_set_flip_vertically_on_load(true);
-
-	int tex_width, tex_height, tex_channels;
-	unsigned char* const tex_data = stbi_load("tex.png", &tex_width, &tex_height, &tex_channels, 0);
-	if (tex_data == NULL) {
-		fprintf(stderr, "Couldn't load texture image\n");
-		return false;
-	}
-
-	GLuint gl_tex_id;
-
-	glGenTextures(1, &gl_tex_id);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gl_tex_id);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tex_width, tex_height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex_data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	stbi_image_free(tex_data);
-
-	return true;
-}
-
-
 int main(void)
 {
 	if (!sogl_init("TEXTURE", 800, 600, vs_src, fs_src))
 		return EXIT_FAILURE;
 
-	if (!load_texture())
+	/* tex.png is loaded by the streaming thread,
+	 * a placeholder is drawn until it's resident
+	 * */
+	if (!sogl_texstream_init(SOGL_TEXSTREAM_FRAME_BUDGET))
 		goto Lload_texture_failed;
 
+	glActiveTexture(GL_TEXTURE0);
+	const int tex_handle = sogl_texstream_request("tex.png");
+
+	/* a fixed frame time asks for a reproducible run (tools/golden.sh),
+	 * the placeholder would show for a host dependent number of frames,
+	 * so the texture is waited for before the first one
+	 * */
+	if (sogl_fixed_dt() != 0) {
+		while (!sogl_texstream_resident(tex_handle) &&
+		       !sogl_texstream_failed(tex_handle)) {
+			sogl_texstream_update();
+			glFlush();
+			SDL_Delay(1);
+		}
+	}
+
 	sogl_vattrp("pos", 3, GL_FLOAT, GL_TRUE, sizeof(struct vertex_data), NULL);
 	
 	sogl_vattrp("rgb", 3, GL_FLOAT, GL_TRUE, sizeof(struct vertex_data),
@@ -102,11 +91,15 @@ int main(void)
 		glClearColor(0, 0, 0, 0xFF);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		glDrawArrays(GL_QUADS, 0, sizeof(verts)/sizeof(verts[0]));
+		sogl_texstream_update();
+		sogl_texstream_bind(tex_handle);
+
+		sogl_draw_quads(0, sizeof(verts)/sizeof(verts[0]));
 
 		sogl_end_frame();
 	}
 
+	sogl_texstream_term();
 Lload_texture_failed:
 	sogl_term();
 	return 0;
@@ -1,12 +1,15 @@
 #include <stddef.h>
 #include <cglm/cglm.h>
 #include <sogl.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include <sogl_mesh.h>
+#include <sogl_texture.h>
+#include <sogl_startup.h>
+#define SOGL_RES_SHIM
+#include <sogl_res.h>
 
 
 const GLchar* const vs_src =
-"#version 130\n"
+"#version 150\n"
 "in vec3 pos;\n"
 "in vec3 rgb;\n"
 "in vec2 uv;\n"
@@ -20,7 +23,7 @@ const GLchar* const vs_src =
 "}\n";
 
 const GLchar* const fs_src =
-"#version 130\n"
+"#version 150\n"
 "in vec4 frag_color;\n"
 "in vec2 frag_uv;\n"
 "out vec4 outcolor;\n"
@@ -38,42 +41,19 @@ struct vertex_data {
 };
 
 
-static bool load_texture(void)
-{
-	int tex_width, tex_height, tex_channels;
-	stbi_set_flip_vertically_on_load(true);
-	unsigned char* const tex_data = stbi_load("tex.png", &tex_width, &tex_height, &tex_channels, 0);
-
-	if (tex_data == NULL) {
-		fprintf(stderr, "Couldn't load texture image\n");
-		return false;
-	}
-
-	GLuint gl_tex_id;
-
-	glGenTextures(1, &gl_tex_id);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gl_tex_id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tex_width, tex_height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex_data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	stbi_image_free(tex_data);
-
-	return true;
-}
-
-
 int main(void)
 {
 	if (!sogl_init("CUBE TEXTURE", 1280, 720, vs_src, fs_src))
 		return EXIT_FAILURE;
 
-	if (!load_texture())
+	/* tex.png is decoded and mipmapped once into tex.png.stex,
+	 * later runs only map the cache and upload it
+	 * */
+	glActiveTexture(GL_TEXTURE0);
+	const GLuint gl_tex_id = sogl_texture_load("tex.png");
+	if (gl_tex_id == 0)
 		goto Lload_texture_failed;
+	sogl_startup_phase("TEXTURE");
 
 	sogl_vattrp("pos", 3, GL_FLOAT, GL_TRUE, sizeof(struct vertex_data), NULL);
 	
@@ -122,6 +102,17 @@ int main(void)
 		{{ -0.5, -0.5, -0.5 }, {0, 1, 1}, {0, 1}},
 	};
 
+	/* weld the shared vertices into an indexed mesh
+	 * */
+	struct sogl_mesh mesh;
+	if (!sogl_mesh_build_quads(verts, sizeof(verts)/sizeof(verts[0]),
+	                           sizeof(struct vertex_data),
+	                           offsetof(struct vertex_data, pos), &mesh))
+		goto Lmesh_build_failed;
+
+	sogl_mesh_upload(&mesh, GL_STREAM_DRAW);
+	struct vertex_data* const mesh_verts = mesh.verts;
+
 	/* Our rotation matrix is set to rotate 1 degree
 	 * */
 	mat4 rotation_matrix = GLM_MAT4_IDENTITY_INIT;
@@ -137,15 +128,19 @@ int main(void)
 		 * transformation to all vertices/vectors of the object
 		 * this will rotate the triangle 1 degree per frame
 		 * */
-		for (int i = 0; i < (sizeof(verts)/sizeof(verts[0])); ++i)
-			glm_vec_rotate_m4(rotation_matrix, verts[i].pos, verts[i].pos);
+		for (long i = 0; i < mesh.nverts; ++i)
+			glm_vec_rotate_m4(rotation_matrix, mesh_verts[i].pos, mesh_verts[i].pos);
 
-		glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STREAM_DRAW);
-		glDrawArrays(GL_QUADS, 0, sizeof(verts)/sizeof(verts[0]));
+		glBufferData(GL_ARRAY_BUFFER, mesh.nverts * mesh.vertex_size,
+		             mesh.verts, GL_STREAM_DRAW);
+		sogl_mesh_draw(&mesh);
 
 		sogl_end_frame();
 	}
 
+	sogl_mesh_free(&mesh);
+Lmesh_build_failed:
+	glDeleteTextures(1, &gl_tex_id);
 Lload_texture_failed:
 	sogl_term();
 	return 0;
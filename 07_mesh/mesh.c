@@ -0,0 +1,116 @@
+#include <stddef.h>
+#include <sogl.h>
+#include <sogl_math.h>
+#include <sogl_meshfile.h>
+#include <sogl_startup.h>
+
+
+const GLchar* const vs_src =
+"#version 150\n"
+"in vec3 pos;\n"
+"in vec3 normal;\n"
+"uniform mat4 model;\n"
+"out vec4 frag_color;\n"
+"void main()\n"
+"{\n"
+"	gl_Position = model * vec4(pos, 1.0);\n"
+"	frag_color = vec4(abs(normal) * 0.8 + 0.2, 1.0);\n"
+"}\n";
+
+
+const GLchar* const fs_src =
+"#version 150\n"
+"in vec4 frag_color;\n"
+"out vec4 outcolor;\n"
+"void main()\n"
+"{\n"
+"	outcolor = frag_color;\n"
+"}\n";
+
+
+/* fits the mesh bounds into the view and rotates it
+ * */
+static void make_model_matrix(const struct sogl_meshfile_header* const header,
+                              const GLfloat angle,
+                              struct mat4* const model)
+{
+	GLfloat center[3];
+	GLfloat extent = 0;
+	for (int k = 0; k < 3; ++k) {
+		center[k] = (header->bounds_min[k] + header->bounds_max[k]) * 0.5f;
+		if (header->bounds_max[k] - header->bounds_min[k] > extent)
+			extent = header->bounds_max[k] - header->bounds_min[k];
+	}
+
+	const GLfloat scale = extent > 0 ? 1.0f / extent : 1.0f;
+
+	struct mat4 rot = SOGL_MAT4_IDENTITY;
+	sogl_mat4_rotate(angle, &(struct vec3){0.4, 0.8, 0}, &rot, &rot);
+
+	*model = rot;
+	for (int c = 0; c < 3; ++c) {
+		model->vecs[c].x *= scale;
+		model->vecs[c].y *= scale;
+		model->vecs[c].z *= scale;
+	}
+
+	model->vecs[3].x = -(rot.vecs[0].x * center[0] + rot.vecs[1].x * center[1] + rot.vecs[2].x * center[2]) * scale;
+	model->vecs[3].y = -(rot.vecs[0].y * center[0] + rot.vecs[1].y * center[1] + rot.vecs[2].y * center[2]) * scale;
+	model->vecs[3].z = -(rot.vecs[0].z * center[0] + rot.vecs[1].z * center[1] + rot.vecs[2].z * center[2]) * scale;
+	model->vecs[3].w = 1;
+}
+
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s mesh.smesh\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* map the file first so the kernel starts reading
+	 * while the window and context are created
+	 * */
+	struct sogl_meshfile mf;
+	if (!sogl_meshfile_open(argv[1], &mf))
+		return EXIT_FAILURE;
+
+	if (!sogl_init("MESH", 800, 600, vs_src, fs_src)) {
+		sogl_meshfile_close(&mf);
+		return EXIT_FAILURE;
+	}
+
+	const Uint32 upload_clk = SDL_GetTicks();
+	sogl_meshfile_upload(&mf);
+	glFinish();
+	sogl_startup_phase("MESH UPLOAD");
+	printf("MESH UPLOADED: %llu VERTICES, %llu INDICES IN %u MS\n",
+	       (unsigned long long)mf.header->nverts,
+	       (unsigned long long)mf.header->nindices,
+	       SDL_GetTicks() - upload_clk);
+
+	GLfloat angle = 0;
+	struct mat4 model;
+
+	while (sogl_handle_events()) {
+		sogl_begin_frame();
+
+		glClearColor(0, 0, 0, 0xFF);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		/* the vertices stay untouched in GPU RAM,
+		 * the rotation is done by the vertex shader
+		 * */
+		make_model_matrix(mf.header, angle, &model);
+		sogl_set_uniform("model", &model);
+		sogl_meshfile_draw(&mf);
+
+		angle += sogl_radians(1);
+
+		sogl_end_frame();
+	}
+
+	sogl_meshfile_close(&mf);
+	sogl_term();
+	return 0;
+}
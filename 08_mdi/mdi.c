@@ -0,0 +1,388 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <sogl.h>
+#include <sogl_mesh.h>
+#include <sogl_mdi.h>
+#include <sogl_bvh.h>
+#include <sogl_lod.h>
+#include <sogl_math.h>
+#define SOGL_RES_SHIM
+#include <sogl_res.h>
+
+#define WIN_WIDTH       (800)
+#define WIN_HEIGHT      (600)
+#define DEFAULT_OBJECTS (10000)
+#define SPACING         (2.0f)
+#define RADIUS          (0.87f)  // bounds of a unit cube rotating in place
+#define BOB_HEIGHT      (0.5f)
+#define SPHERE_STACKS   (24)
+#define SPHERE_SLICES   (48)
+#define SPHERE_PIXELS   (64.0f)  // spheres smaller than this use simplified levels
+
+
+const GLchar* const vs_src =
+"#version 150\n"
+"in vec3 pos;\n"
+"in vec3 rgb;\n"
+"in int draw_id;\n"
+"uniform samplerBuffer transforms;\n"
+"uniform mat4 viewproj;\n"
+"out vec4 frag_color;\n"
+"void main()\n"
+"{\n"
+"	mat4 model = mat4(texelFetch(transforms, draw_id * 4),\n"
+"	                  texelFetch(transforms, draw_id * 4 + 1),\n"
+"	                  texelFetch(transforms, draw_id * 4 + 2),\n"
+"	                  texelFetch(transforms, draw_id * 4 + 3));\n"
+"	gl_Position = viewproj * model * vec4(pos, 1.0);\n"
+"	frag_color = vec4(rgb, 1.0);\n"
+"}\n";
+
+
+const GLchar* const fs_src =
+"#version 150\n"
+"in vec4 frag_color;\n"
+"out vec4 outcolor;\n"
+"void main()\n"
+"{\n"
+"	outcolor = frag_color;\n"
+"}\n";
+
+
+struct vertex_data {
+	struct vec3 pos;
+	struct vec3 rgb;
+};
+
+struct object {
+	struct vec3 pos;
+	struct vec3 axis;
+	GLfloat speed;
+	bool sphere;
+};
+
+
+static const struct vertex_data cube_verts[] = {
+	/* FRONT */
+	{{ -0.5, -0.5, -0.5 }, {1, 0, 0}},
+	{{  0.5, -0.5, -0.5 }, {1, 0, 0}},
+	{{  0.5,  0.5, -0.5 }, {1, 0, 0}},
+	{{ -0.5,  0.5, -0.5 }, {1, 0, 0}},
+
+	/* BACK */
+	{{ -0.5, -0.5,  0.5 }, {0, 1, 0}},
+	{{  0.5, -0.5,  0.5 }, {0, 1, 0}},
+	{{  0.5,  0.5,  0.5 }, {0, 1, 0}},
+	{{ -0.5,  0.5,  0.5 }, {0, 1, 0}},
+
+	/* RIGHT */
+	{{  0.5, -0.5,  0.5 }, {0, 0, 1}},
+	{{  0.5, -0.5, -0.5 }, {0, 0, 1}},
+	{{  0.5,  0.5, -0.5 }, {0, 0, 1}},
+	{{  0.5,  0.5,  0.5 }, {0, 0, 1}},
+
+	/* LEFT */
+	{{ -0.5, -0.5,  0.5 }, {1, 0, 1}},
+	{{ -0.5, -0.5, -0.5 }, {1, 0, 1}},
+	{{ -0.5,  0.5, -0.5 }, {1, 0, 1}},
+	{{ -0.5,  0.5,  0.5 }, {1, 0, 1}},
+
+	/* UP */
+	{{ -0.5,  0.5,  0.5 }, {1, 1, 1}},
+	{{  0.5,  0.5,  0.5 }, {1, 1, 1}},
+	{{  0.5,  0.5, -0.5 }, {1, 1, 1}},
+	{{ -0.5,  0.5, -0.5 }, {1, 1, 1}},
+
+	/* DOWN */
+	{{ -0.5, -0.5,  0.5 }, {0, 1, 1}},
+	{{  0.5, -0.5,  0.5 }, {0, 1, 1}},
+	{{  0.5, -0.5, -0.5 }, {0, 1, 1}},
+	{{ -0.5, -0.5, -0.5 }, {0, 1, 1}},
+};
+
+static const struct vertex_data piramid_verts[] = {
+	/* FRONT */
+	{{ -0.5, -0.5, -0.5 }, {1, 0, 0}},
+	{{  0.5, -0.5, -0.5 }, {1, 0, 0}},
+	{{  0.0,  0.5,  0.0 }, {1, 0, 0}},
+
+	/* BACK */
+	{{ -0.5, -0.5,  0.5 }, {0, 1, 0}},
+	{{  0.5, -0.5,  0.5 }, {0, 1, 0}},
+	{{  0.0,  0.5,  0.0 }, {0, 1, 0}},
+
+	/* RIGHT */
+	{{  0.5, -0.5,  0.5 }, {0, 0, 1}},
+	{{  0.5, -0.5, -0.5 }, {0, 0, 1}},
+	{{  0.0,  0.5,  0.0 }, {0, 0, 1}},
+
+	/* LEFT */
+	{{ -0.5, -0.5,  0.5 }, {1, 0, 1}},
+	{{ -0.5, -0.5, -0.5 }, {1, 0, 1}},
+	{{  0.0,  0.5,  0.0 }, {1, 0, 1}},
+
+	// BOTTOM
+	{{ -0.5, -0.5, -0.5 }, {1, 1, 0}},
+	{{  0.5, -0.5, -0.5 }, {1, 1, 0}},
+	{{  0.5, -0.5,  0.5 }, {1, 1, 0}},
+	{{  0.5, -0.5,  0.5 }, {1, 1, 0}},
+	{{ -0.5, -0.5,  0.5 }, {1, 1, 0}},
+	{{ -0.5, -0.5, -0.5 }, {1, 1, 0}},
+};
+
+
+static GLfloat randf(const GLfloat min, const GLfloat max)
+{
+	return 1.0f * rand() / RAND_MAX * (max - min) + min;
+}
+
+static void sphere_vertex(const int stack, const int slice, struct vertex_data* const v)
+{
+	const GLfloat theta = (GLfloat)M_PI * stack / SPHERE_STACKS;
+	const GLfloat phi = 2.0f * (GLfloat)M_PI * slice / SPHERE_SLICES;
+	const struct vec3 n = { sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi) };
+	v->pos = (struct vec3){ n.x * 0.5f, n.y * 0.5f, n.z * 0.5f };
+	v->rgb = (struct vec3){ fabsf(n.x) * 0.8f + 0.2f, fabsf(n.y) * 0.8f + 0.2f, fabsf(n.z) * 0.8f + 0.2f };
+}
+
+/* unit diameter sphere as an unindexed triangle list,
+ * dense enough for its simplified levels to matter
+ * */
+static long make_sphere_verts(struct vertex_data* const verts)
+{
+	long n = 0;
+	for (int st = 0; st < SPHERE_STACKS; ++st) {
+		for (int sl = 0; sl < SPHERE_SLICES; ++sl) {
+			sphere_vertex(st, sl, &verts[n++]);
+			sphere_vertex(st + 1, sl, &verts[n++]);
+			sphere_vertex(st + 1, sl + 1, &verts[n++]);
+			sphere_vertex(st, sl, &verts[n++]);
+			sphere_vertex(st + 1, sl + 1, &verts[n++]);
+			sphere_vertex(st, sl + 1, &verts[n++]);
+		}
+	}
+	return n;
+}
+
+/* objects are laid out in a cube grid centered on the origin,
+ * the camera circles around it from the inside of the grid
+ * */
+static bool make_objects(const int count, const int cube, const int piramid,
+                         const int sphere,
+                         struct object* const objects, GLfloat* const extent)
+{
+	int side = 1;
+	while (side * side * side < count)
+		++side;
+	*extent = side * SPACING;
+
+	for (int i = 0; i < count; ++i) {
+		struct object* const obj = &objects[i];
+		obj->pos.x = ((i % side) - side * 0.5f) * SPACING;
+		obj->pos.y = (((i / side) % side) - side * 0.5f) * SPACING;
+		obj->pos.z = ((i / (side * side)) - side * 0.5f) * SPACING;
+		obj->axis = (struct vec3){ randf(0, 1), randf(0, 1), randf(0, 1) };
+		obj->speed = randf(0.2f, 2.0f);
+		obj->sphere = i % 3 == 2;
+
+		const int mesh = obj->sphere ? sphere : i % 3 == 1 ? piramid : cube;
+		if (sogl_mdi_add_object(mesh) < 0)
+			return false;
+	}
+
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	const int count = argc > 1 ? atoi(argv[1]) : DEFAULT_OBJECTS;
+	if (count <= 0) {
+		fprintf(stderr, "usage: %s [objects]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const GLchar* const dummy_vs_src =
+	"#version 150\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4(0.0);\n"
+	"}\n";
+
+	const GLchar* const dummy_fs_src =
+	"#version 150\n"
+	"out vec4 outcolor;\n"
+	"void main()\n"
+	"{\n"
+	"	outcolor = vec4(1.0);\n"
+	"}\n";
+
+	if (!sogl_init("MDI", WIN_WIDTH, WIN_HEIGHT, dummy_vs_src, dummy_fs_src))
+		return EXIT_FAILURE;
+
+	int retval = EXIT_FAILURE;
+	struct sogl_mesh cube_mesh, piramid_mesh, sphere_mesh;
+	struct sogl_lod_chain sphere_chain;
+	int sphere_levels[SOGL_LOD_MAX_LEVELS];
+	struct vertex_data* sphere_verts = NULL;
+	struct object* objects = NULL;
+	struct sogl_aabb* boxes = NULL;
+	int* visible = NULL;
+	struct sogl_bvh bvh = { 0 };
+
+	const GLuint program = sogl_create_program(vs_src, fs_src);
+	if (program == 0)
+		goto Lprogram_failed;
+
+	if (!sogl_mdi_init(program, sizeof(struct vertex_data)))
+		goto Lmdi_init_failed;
+
+	sogl_mdi_vattrp("pos", 3, GL_FLOAT, GL_FALSE, offsetof(struct vertex_data, pos));
+	sogl_mdi_vattrp("rgb", 3, GL_FLOAT, GL_FALSE, offsetof(struct vertex_data, rgb));
+
+	if (!sogl_mesh_build_quads(cube_verts, sizeof(cube_verts) / sizeof(cube_verts[0]),
+	                           sizeof(struct vertex_data),
+	                           offsetof(struct vertex_data, pos), &cube_mesh))
+		goto Lcube_build_failed;
+
+	if (!sogl_mesh_build(piramid_verts, sizeof(piramid_verts) / sizeof(piramid_verts[0]),
+	                     sizeof(struct vertex_data),
+	                     offsetof(struct vertex_data, pos), &piramid_mesh))
+		goto Lpiramid_build_failed;
+
+	sphere_verts = malloc(sizeof(struct vertex_data) * SPHERE_STACKS * SPHERE_SLICES * 6);
+	if (sphere_verts == NULL ||
+	    !sogl_mesh_build(sphere_verts, make_sphere_verts(sphere_verts),
+	                     sizeof(struct vertex_data),
+	                     offsetof(struct vertex_data, pos), &sphere_mesh))
+		goto Lsphere_build_failed;
+
+	// every level is a mesh of its own in the arena
+	sogl_lod_chain_build(&sphere_mesh, offsetof(struct vertex_data, pos),
+	                     SPHERE_PIXELS, &sphere_chain);
+
+	const int cube = sogl_mdi_add_mesh(&cube_mesh);
+	const int piramid = sogl_mdi_add_mesh(&piramid_mesh);
+	if (cube < 0 || piramid < 0)
+		goto Lobjects_failed;
+
+	for (int l = 0; l < sphere_chain.nlevels; ++l) {
+		sphere_levels[l] = sogl_mdi_add_mesh(&sphere_chain.levels[l]);
+		if (sphere_levels[l] < 0)
+			goto Lobjects_failed;
+	}
+
+	GLfloat extent;
+	objects = malloc(sizeof(struct object) * count);
+	boxes = malloc(sizeof(struct sogl_aabb) * count);
+	visible = malloc(sizeof(int) * count);
+	if (objects == NULL || boxes == NULL || visible == NULL ||
+	    !make_objects(count, cube, piramid, sphere_levels[0], objects, &extent))
+		goto Lobjects_failed;
+
+	for (int i = 0; i < count; ++i) {
+		const struct vec3* const p = &objects[i].pos;
+		boxes[i].min = (struct vec3){ p->x - RADIUS, p->y - RADIUS, p->z - RADIUS };
+		boxes[i].max = (struct vec3){ p->x + RADIUS, p->y + RADIUS, p->z + RADIUS };
+	}
+
+	if (!sogl_bvh_build(boxes, count, &bvh))
+		goto Lobjects_failed;
+
+	struct mat4 proj;
+	sogl_mat4_perspective(sogl_radians(60), (GLfloat)WIN_WIDTH / WIN_HEIGHT,
+	                      0.1f, extent * 2.0f, &proj);
+	const GLint viewproj_loc = glGetUniformLocation(program, "viewproj");
+
+	SDL_GL_SetSwapInterval(0);
+	GLfloat angle = 0;
+
+	while (sogl_handle_events()) {
+		sogl_begin_frame();
+
+		glClearColor(0, 0, 0, 0xFF);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		struct mat4 view = SOGL_MAT4_IDENTITY, viewproj;
+		sogl_mat4_rotate(angle * 0.25f, &(struct vec3){ 0, 1, 0 }, &view, &view);
+		view.z3 = -extent * 0.25f;
+		sogl_mat4_mul(&proj, &view, &viewproj);
+
+		glUseProgram(program);
+		glUniformMatrix4fv(viewproj_loc, 1, GL_FALSE, &viewproj.x0);
+		sogl_bind();
+
+		/* the meshes never change, only the transforms are
+		 * written, the objects bob up and down so the
+		 * hierarchy is refit every frame
+		 * */
+		for (int i = 0; i < count; ++i) {
+			const struct object* const obj = &objects[i];
+			const GLfloat y = obj->pos.y + sinf(angle * obj->speed) * BOB_HEIGHT;
+			boxes[i].min.y = y - RADIUS;
+			boxes[i].max.y = y + RADIUS;
+		}
+		sogl_bvh_refit(&bvh, boxes);
+
+		struct sogl_frustum frustum;
+		sogl_frustum_from_mat4(&viewproj, &frustum);
+		const int nvisible = sogl_bvh_cull(&bvh, &frustum, visible);
+
+		/* only the visible objects get a transform and an instance,
+		 * spheres pick the level matching their size on screen
+		 * */
+		int lod_counts[SOGL_LOD_MAX_LEVELS] = { 0 };
+		for (int v = 0; v < nvisible; ++v) {
+			const int i = visible[v];
+			const struct object* const obj = &objects[i];
+			const struct vec3 center = {
+				obj->pos.x, (boxes[i].min.y + boxes[i].max.y) * 0.5f, obj->pos.z
+			};
+
+			struct mat4 model = SOGL_MAT4_IDENTITY;
+			sogl_mat4_rotate(angle * obj->speed, &obj->axis, &model, &model);
+			model.vecs[3] = (struct vec4){ center.x, center.y, center.z, 1 };
+			sogl_mdi_set_transform(i, &model);
+
+			if (obj->sphere) {
+				const GLfloat pixels = sogl_lod_projected_pixels(&viewproj, &center,
+				                                                 0.5f, WIN_HEIGHT);
+				const int l = sogl_lod_chain_level(&sphere_chain, pixels);
+				sogl_mdi_set_mesh(i, sphere_levels[l]);
+				++lod_counts[l];
+			}
+		}
+
+		sogl_mdi_draw(visible, nvisible);
+
+		angle += sogl_radians(1);
+
+		const Uint32 frame_time = sogl_end_frame();
+		printf("OBJECTS: %d VISIBLE: %d DRAW CALLS: %d SPHERE LODS: %d %d %d %d FRAME: %u MS\n",
+		       sogl_mdi_objects(), nvisible, sogl_mdi_draw_calls(),
+		       lod_counts[0], lod_counts[1], lod_counts[2], lod_counts[3], frame_time);
+	}
+
+	retval = EXIT_SUCCESS;
+
+Lobjects_failed:
+	sogl_bvh_free(&bvh);
+	free(visible);
+	free(boxes);
+	free(objects);
+	sogl_lod_chain_free(&sphere_chain);
+	sogl_mesh_free(&sphere_mesh);
+Lsphere_build_failed:
+	free(sphere_verts);
+	sogl_mesh_free(&piramid_mesh);
+Lpiramid_build_failed:
+	sogl_mesh_free(&cube_mesh);
+Lcube_build_failed:
+	sogl_mdi_term();
+Lmdi_init_failed:
+	glDeleteProgram(program);
+Lprogram_failed:
+	sogl_term();
+	return retval;
+}
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <SDL2/SDL.h>
+#include <sogl_jobs.h>
+#include <sogl_texture.h>
+#include <sogl_swr.h>
+#include <sogl_math.h>
+
+#define WIN_WIDTH      (1280)
+#define WIN_HEIGHT     (720)
+#define DEFAULT_FRAMES (100)
+#define CUBES_SIDE     (8)
+#define NCUBES         (CUBES_SIDE * CUBES_SIDE)
+#define CHECKER_SIZE   (256)
+
+
+/* the textured cube of 06_cube_texture in a grid, rendered without
+ * a GL context. every frame is a function of its number only, so the
+ * final checksum is the same on every host and thread count
+ * */
+struct vertex_data {
+	struct vec3 pos;
+	struct vec3 rgb;
+	struct vec2 uv;
+};
+
+struct uniforms {
+	struct mat4 mvp;
+	const struct sogl_swr_texture* tex;
+};
+
+
+static const struct vertex_data verts[] = {
+	/* FRONT */
+	{{ -0.5, -0.5, -0.5 }, {1, 1, 1}, {0, 0}},
+	{{  0.5, -0.5, -0.5 }, {1, 1, 1}, {1, 0}},
+	{{  0.5,  0.5, -0.5 }, {1, 1, 1}, {1, 1}},
+	{{ -0.5,  0.5, -0.5 }, {1, 1, 1}, {0, 1}},
+
+	/* BACK */
+	{{ -0.5, -0.5,  0.5 }, {1, 0, 0}, {0, 0}},
+	{{  0.5, -0.5,  0.5 }, {1, 0, 0}, {1, 0}},
+	{{  0.5,  0.5,  0.5 }, {1, 0, 0}, {1, 1}},
+	{{ -0.5,  0.5,  0.5 }, {1, 0, 0}, {0, 1}},
+
+	/* RIGHT */
+	{{ -0.5, -0.5,  0.5 }, {0, 1, 0}, {0, 0}},
+	{{ -0.5, -0.5, -0.5 }, {0, 1, 0}, {1, 0}},
+	{{ -0.5,  0.5, -0.5 }, {0, 1, 0}, {1, 1}},
+	{{ -0.5,  0.5,  0.5 }, {0, 1, 0}, {0, 1}},
+
+	/* LEFT */
+	{{  0.5, -0.5,  0.5 }, {0, 0, 1}, {0, 0}},
+	{{  0.5, -0.5, -0.5 }, {0, 0, 1}, {1, 0}},
+	{{  0.5,  0.5, -0.5 }, {0, 0, 1}, {1, 1}},
+	{{  0.5,  0.5,  0.5 }, {0, 0, 1}, {0, 1}},
+
+	/* UP */
+	{{ -0.5,  0.5,  0.5 }, {1, 0, 1}, {0, 0}},
+	{{  0.5,  0.5,  0.5 }, {1, 0, 1}, {1, 0}},
+	{{  0.5,  0.5, -0.5 }, {1, 0, 1}, {1, 1}},
+	{{ -0.5,  0.5, -0.5 }, {1, 0, 1}, {0, 1}},
+
+	/* DOWN */
+	{{ -0.5, -0.5,  0.5 }, {0, 1, 1}, {0, 0}},
+	{{  0.5, -0.5,  0.5 }, {0, 1, 1}, {1, 0}},
+	{{  0.5, -0.5, -0.5 }, {0, 1, 1}, {1, 1}},
+	{{ -0.5, -0.5, -0.5 }, {0, 1, 1}, {0, 1}},
+};
+
+static const GLushort indices[] = {
+	0, 1, 2, 0, 2, 3,
+	4, 5, 6, 4, 6, 7,
+	8, 9, 10, 8, 10, 11,
+	12, 13, 14, 12, 14, 15,
+	16, 17, 18, 16, 18, 19,
+	20, 21, 22, 20, 22, 23
+};
+
+
+static void cube_vertex(const void* const uniforms, const void* const vertex,
+                        struct vec4* const clip, GLfloat* const varyings)
+{
+	const struct mat4* const m = &((const struct uniforms*)uniforms)->mvp;
+	const struct vertex_data* const v = vertex;
+
+	clip->x = m->x0 * v->pos.x + m->x1 * v->pos.y + m->x2 * v->pos.z + m->x3;
+	clip->y = m->y0 * v->pos.x + m->y1 * v->pos.y + m->y2 * v->pos.z + m->y3;
+	clip->z = m->z0 * v->pos.x + m->z1 * v->pos.y + m->z2 * v->pos.z + m->z3;
+	clip->w = m->w0 * v->pos.x + m->w1 * v->pos.y + m->w2 * v->pos.z + m->w3;
+
+	varyings[0] = v->rgb.x;
+	varyings[1] = v->rgb.y;
+	varyings[2] = v->rgb.z;
+	varyings[3] = v->uv.x;
+	varyings[4] = v->uv.y;
+}
+
+static uint32_t cube_fragment(const void* const uniforms, const GLfloat* const varyings)
+{
+	GLfloat rgba[4];
+	sogl_swr_sample(((const struct uniforms*)uniforms)->tex, varyings[3], varyings[4], rgba);
+	rgba[0] *= varyings[0];
+	rgba[1] *= varyings[1];
+	rgba[2] *= varyings[2];
+	return sogl_swr_pack(rgba);
+}
+
+static void make_checker(uint32_t* const texels)
+{
+	for (int y = 0; y < CHECKER_SIZE; ++y) {
+		for (int x = 0; x < CHECKER_SIZE; ++x)
+			texels[y * CHECKER_SIZE + x] = ((x / 32 + y / 32) & 1) ? 0xFFFFFFFFu : 0xFF404040u;
+	}
+}
+
+static void make_mvp(const struct mat4* const proj, const int cube,
+                     const GLfloat angle, struct mat4* const mvp)
+{
+	struct mat4 model = SOGL_MAT4_IDENTITY;
+	sogl_mat4_rotate(angle * (1 + cube % 3), &(struct vec3){ 0.35f, 1, 0 }, &model, &model);
+	model.vecs[3] = (struct vec4){
+		((cube % CUBES_SIDE) - (CUBES_SIDE - 1) * 0.5f) * 1.5f,
+		((cube / CUBES_SIDE) - (CUBES_SIDE - 1) * 0.5f) * 1.5f,
+		-12.0f,
+		1
+	};
+	sogl_mat4_mul(proj, &model, mvp);
+}
+
+
+int main(int argc, char** argv)
+{
+	const int frames = argc > 1 ? atoi(argv[1]) : DEFAULT_FRAMES;
+	if (frames <= 0) {
+		fprintf(stderr, "usage: %s [frames] [texture]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int retval = EXIT_FAILURE;
+	struct sogl_texcache tc;
+	struct sogl_swr_texture tex;
+	uint32_t* checker = NULL;
+
+	if (SDL_Init(0) != 0) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return EXIT_FAILURE;
+	}
+
+	if (!sogl_jobs_init(0))
+		goto Ljobs_failed;
+
+	if (!sogl_swr_init(WIN_WIDTH, WIN_HEIGHT))
+		goto Lswr_failed;
+
+	// a texture through the cache like the GL demos, or a generated one
+	if (argc > 2) {
+		if (!sogl_texcache_open(argv[2], &tc))
+			goto Ltexture_failed;
+		if (!sogl_swr_texture_from_cache(&tc, &tex)) {
+			sogl_texcache_close(&tc);
+			goto Ltexture_failed;
+		}
+	} else {
+		checker = malloc(sizeof(uint32_t) * CHECKER_SIZE * CHECKER_SIZE);
+		if (checker == NULL) {
+			fprintf(stderr, "Couldn't allocate texture\n");
+			goto Ltexture_failed;
+		}
+		make_checker(checker);
+		tex = (struct sogl_swr_texture) { checker, CHECKER_SIZE, CHECKER_SIZE };
+	}
+
+	struct mat4 proj;
+	sogl_mat4_perspective(sogl_radians(60), (GLfloat)WIN_WIDTH / WIN_HEIGHT, 0.1f, 100.0f, &proj);
+
+	static struct uniforms uniforms[NCUBES];
+	static struct sogl_swr_program programs[NCUBES];
+	for (int i = 0; i < NCUBES; ++i) {
+		uniforms[i].tex = &tex;
+		programs[i] = (struct sogl_swr_program) {
+			cube_vertex, cube_fragment, &uniforms[i], 5
+		};
+	}
+
+	Uint32 total_ms = 0;
+	for (int f = 0; f < frames; ++f) {
+		const Uint32 clk = SDL_GetTicks();
+
+		sogl_swr_clear(0xFF000000u, 1.0f);
+
+		for (int i = 0; i < NCUBES; ++i) {
+			make_mvp(&proj, i, sogl_radians(f), &uniforms[i].mvp);
+			sogl_swr_draw(&programs[i], verts, sizeof(verts) / sizeof(verts[0]),
+			              sizeof(struct vertex_data),
+			              indices, GL_UNSIGNED_SHORT, sizeof(indices) / sizeof(indices[0]));
+		}
+
+		const long ntris = sogl_swr_triangles();
+		sogl_swr_finish();
+
+		const Uint32 frame_ms = SDL_GetTicks() - clk;
+		total_ms += frame_ms;
+		printf("FRAME %d: %ld TRIANGLES %u MS\n", f, ntris, frame_ms);
+	}
+
+	printf("FRAMES: %d AVG: %.2f MS CHECKSUM: %016" PRIx64 "\n",
+	       frames, (double)total_ms / frames, sogl_swr_checksum());
+	retval = EXIT_SUCCESS;
+
+	if (checker != NULL) {
+		free(checker);
+	} else {
+		sogl_swr_texture_free(&tc, &tex);
+		sogl_texcache_close(&tc);
+	}
+Ltexture_failed:
+	sogl_swr_term();
+Lswr_failed:
+	sogl_jobs_term();
+Ljobs_failed:
+	SDL_Quit();
+	return retval;
+}
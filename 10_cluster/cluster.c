@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <sogl.h>
+#include <sogl_math.h>
+#include <sogl_jobs.h>
+#include <sogl_texture.h>
+#include <sogl_cluster.h>
+#include <sogl_startup.h>
+#define SOGL_RES_SHIM
+#include <sogl_res.h>
+
+#define WIN_WIDTH      (1280)
+#define WIN_HEIGHT     (720)
+#define DEFAULT_LIGHTS (10000)
+#define FIELD_SIDE     (64)      // cubes per side of the field
+#define SPACING        (3.0f)
+#define ZNEAR          (0.1f)
+#define ZFAR           (300.0f)
+#define CAMERA_HEIGHT  (18.0f)
+#define AMBIENT        "0.03"
+
+
+const GLchar* const vs_src =
+"#version 150\n"
+"in vec3 pos;\n"
+"in vec3 normal;\n"
+"in vec2 uv;\n"
+"uniform mat4 view;\n"
+"uniform mat4 proj;\n"
+"out vec3 frag_pos;\n"
+"out vec3 frag_normal;\n"
+"out vec2 frag_uv;\n"
+"void main()\n"
+"{\n"
+"	vec4 view_pos = view * vec4(pos, 1.0);\n"
+"	gl_Position = proj * view_pos;\n"
+"	frag_pos = view_pos.xyz;\n"
+"	frag_normal = mat3(view) * normal;\n"
+"	frag_uv = uv;\n"
+"}\n";
+
+const GLchar* const fs_src =
+"#version 150\n"
+SOGL_CLUSTER_GLSL
+"in vec3 frag_pos;\n"
+"in vec3 frag_normal;\n"
+"in vec2 frag_uv;\n"
+"uniform sampler2D texture_data;\n"
+"out vec4 outcolor;\n"
+"void main()\n"
+"{\n"
+"	vec3 albedo = texture(texture_data, frag_uv).rgb;\n"
+"	vec3 light = sogl_cluster_light(frag_pos, normalize(frag_normal), albedo);\n"
+"	outcolor = vec4(albedo * " AMBIENT " + light, 1.0);\n"
+"}\n";
+
+
+struct vertex_data {
+	struct vec3 pos;
+	struct vec3 normal;
+	struct vec2 uv;
+};
+
+struct orbit {
+	struct vec3 center;
+	GLfloat radius;
+	GLfloat speed;
+	GLfloat phase;
+};
+
+
+static const struct vertex_data cube_verts[] = {
+	/* FRONT */
+	{{ -0.5, -0.5, -0.5 }, { 0, 0, -1 }, {0, 0}},
+	{{ -0.5,  0.5, -0.5 }, { 0, 0, -1 }, {0, 1}},
+	{{  0.5,  0.5, -0.5 }, { 0, 0, -1 }, {1, 1}},
+	{{  0.5, -0.5, -0.5 }, { 0, 0, -1 }, {1, 0}},
+
+	/* BACK */
+	{{ -0.5, -0.5,  0.5 }, { 0, 0, 1 }, {0, 0}},
+	{{  0.5, -0.5,  0.5 }, { 0, 0, 1 }, {1, 0}},
+	{{  0.5,  0.5,  0.5 }, { 0, 0, 1 }, {1, 1}},
+	{{ -0.5,  0.5,  0.5 }, { 0, 0, 1 }, {0, 1}},
+
+	/* RIGHT */
+	{{  0.5, -0.5,  0.5 }, { 1, 0, 0 }, {0, 0}},
+	{{  0.5, -0.5, -0.5 }, { 1, 0, 0 }, {1, 0}},
+	{{  0.5,  0.5, -0.5 }, { 1, 0, 0 }, {1, 1}},
+	{{  0.5,  0.5,  0.5 }, { 1, 0, 0 }, {0, 1}},
+
+	/* LEFT */
+	{{ -0.5, -0.5,  0.5 }, { -1, 0, 0 }, {0, 0}},
+	{{ -0.5,  0.5,  0.5 }, { -1, 0, 0 }, {0, 1}},
+	{{ -0.5,  0.5, -0.5 }, { -1, 0, 0 }, {1, 1}},
+	{{ -0.5, -0.5, -0.5 }, { -1, 0, 0 }, {1, 0}},
+
+	/* UP */
+	{{ -0.5,  0.5,  0.5 }, { 0, 1, 0 }, {0, 0}},
+	{{  0.5,  0.5,  0.5 }, { 0, 1, 0 }, {1, 0}},
+	{{  0.5,  0.5, -0.5 }, { 0, 1, 0 }, {1, 1}},
+	{{ -0.5,  0.5, -0.5 }, { 0, 1, 0 }, {0, 1}},
+
+	/* DOWN */
+	{{ -0.5, -0.5,  0.5 }, { 0, -1, 0 }, {0, 0}},
+	{{ -0.5, -0.5, -0.5 }, { 0, -1, 0 }, {0, 1}},
+	{{  0.5, -0.5, -0.5 }, { 0, -1, 0 }, {1, 1}},
+	{{  0.5, -0.5,  0.5 }, { 0, -1, 0 }, {1, 0}},
+};
+
+#define CUBE_VERTS (sizeof(cube_verts) / sizeof(cube_verts[0]))
+
+
+static GLfloat randf(const GLfloat min, const GLfloat max)
+{
+	return 1.0f * rand() / RAND_MAX * (max - min) + min;
+}
+
+static GLfloat field_coord(const int i)
+{
+	return (i - FIELD_SIDE * 0.5f) * SPACING;
+}
+
+/* every cube of the field in one static vertex array,
+ * heights vary so the lights have walls to hit
+ * */
+static void make_field(struct vertex_data* const verts)
+{
+	for (int z = 0; z < FIELD_SIDE; ++z) {
+		for (int x = 0; x < FIELD_SIDE; ++x) {
+			const GLfloat height = randf(0.5f, 3.0f);
+			struct vertex_data* const cube = &verts[(z * FIELD_SIDE + x) * CUBE_VERTS];
+			for (unsigned v = 0; v < CUBE_VERTS; ++v) {
+				cube[v] = cube_verts[v];
+				cube[v].pos.x += field_coord(x);
+				cube[v].pos.y = (cube[v].pos.y + 0.5f) * height;
+				cube[v].pos.z += field_coord(z);
+			}
+		}
+	}
+}
+
+static void make_lights(const int count, struct orbit* const orbits,
+                        struct sogl_cluster_light* const lights)
+{
+	const GLfloat half = FIELD_SIDE * SPACING * 0.5f;
+	for (int i = 0; i < count; ++i) {
+		orbits[i] = (struct orbit) {
+			{ randf(-half, half), randf(0.5f, 4.0f), randf(-half, half) },
+			randf(0.5f, 3.0f), randf(0.5f, 2.0f), randf(0, 2 * (GLfloat)M_PI)
+		};
+		lights[i].radius = randf(1.5f, 4.0f);
+		lights[i].color = (struct vec3) { randf(0.2f, 1), randf(0.2f, 1), randf(0.2f, 1) };
+	}
+}
+
+static void move_lights(const int count, const GLfloat t, const struct orbit* const orbits,
+                        struct sogl_cluster_light* const lights)
+{
+	for (int i = 0; i < count; ++i) {
+		const struct orbit* const o = &orbits[i];
+		const GLfloat a = o->phase + t * o->speed;
+		lights[i].pos = (struct vec3) {
+			o->center.x + cosf(a) * o->radius, o->center.y, o->center.z + sinf(a) * o->radius
+		};
+	}
+}
+
+/* view matrix of a camera at eye looking at the origin */
+static void look_at_origin(const struct vec3* const eye, struct mat4* const view)
+{
+	struct vec3 f = { -eye->x, -eye->y, -eye->z };
+	sogl_norm_vec3(&f);
+	struct vec3 s = { -f.z, 0, f.x };   // f x up, up is +y
+	sogl_norm_vec3(&s);
+	const struct vec3 u = { s.y * f.z - s.z * f.y, s.z * f.x - s.x * f.z, s.x * f.y - s.y * f.x };
+
+	*view = SOGL_MAT4_IDENTITY;
+	view->x0 = s.x;  view->x1 = s.y;  view->x2 = s.z;
+	view->y0 = u.x;  view->y1 = u.y;  view->y2 = u.z;
+	view->z0 = -f.x; view->z1 = -f.y; view->z2 = -f.z;
+	view->x3 = -(s.x * eye->x + s.y * eye->y + s.z * eye->z);
+	view->y3 = -(u.x * eye->x + u.y * eye->y + u.z * eye->z);
+	view->z3 = f.x * eye->x + f.y * eye->y + f.z * eye->z;
+}
+
+
+int main(int argc, char** argv)
+{
+	const int nlights = argc > 1 ? atoi(argv[1]) : DEFAULT_LIGHTS;
+	if (nlights <= 0 || nlights > SOGL_CLUSTER_MAX_LIGHTS) {
+		fprintf(stderr, "usage: %s [lights, at most %d]\n", argv[0], SOGL_CLUSTER_MAX_LIGHTS);
+		return EXIT_FAILURE;
+	}
+
+	if (!sogl_init("CLUSTERED LIGHTS", WIN_WIDTH, WIN_HEIGHT, vs_src, fs_src))
+		return EXIT_FAILURE;
+
+	int retval = EXIT_FAILURE;
+	GLuint tex = 0;
+	struct vertex_data* verts = NULL;
+	struct orbit* orbits = NULL;
+	struct sogl_cluster_light* lights = NULL;
+
+	srand(sogl_seed());
+
+	if (!sogl_jobs_init(0))
+		goto Ljobs_failed;
+
+	if (!sogl_cluster_init(WIN_WIDTH, WIN_HEIGHT, nlights))
+		goto Lcluster_failed;
+
+	GLint program;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	sogl_cluster_locate(program);
+
+	glActiveTexture(GL_TEXTURE0);
+	tex = sogl_texture_load("../06_cube_texture/tex.png");
+	if (tex == 0)
+		goto Lfield_failed;
+	sogl_startup_phase("CLUSTERS AND TEXTURE");
+
+	const long nverts = (long)FIELD_SIDE * FIELD_SIDE * CUBE_VERTS;
+	verts = malloc(sizeof(*verts) * nverts);
+	orbits = malloc(sizeof(*orbits) * nlights);
+	lights = malloc(sizeof(*lights) * nlights);
+	if (verts == NULL || orbits == NULL || lights == NULL) {
+		fprintf(stderr, "Couldn't allocate the scene\n");
+		goto Lfield_failed;
+	}
+
+	make_field(verts);
+	make_lights(nlights, orbits, lights);
+
+	// the field never moves, it's uploaded once into sogl's VBO
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(*verts) * nverts, verts);
+
+	sogl_vattrp("pos", 3, GL_FLOAT, GL_FALSE, sizeof(struct vertex_data),
+	            (void*)offsetof(struct vertex_data, pos));
+	sogl_vattrp("normal", 3, GL_FLOAT, GL_FALSE, sizeof(struct vertex_data),
+	            (void*)offsetof(struct vertex_data, normal));
+	sogl_vattrp("uv", 2, GL_FLOAT, GL_FALSE, sizeof(struct vertex_data),
+	            (void*)offsetof(struct vertex_data, uv));
+
+	const GLfloat fovy = sogl_radians(60);
+	const GLfloat aspect = (GLfloat)WIN_WIDTH / WIN_HEIGHT;
+	struct mat4 proj;
+	sogl_mat4_perspective(fovy, aspect, ZNEAR, ZFAR, &proj);
+
+	SDL_GL_SetSwapInterval(0);
+	GLfloat t = 0;
+
+	while (sogl_handle_events()) {
+		sogl_begin_frame();
+
+		glClearColor(0, 0, 0, 0xFF);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		const GLfloat orbit_radius = FIELD_SIDE * SPACING * 0.3f;
+		const struct vec3 eye = {
+			cosf(t * 0.1f) * orbit_radius, CAMERA_HEIGHT, sinf(t * 0.1f) * orbit_radius
+		};
+		struct mat4 view;
+		look_at_origin(&eye, &view);
+
+		move_lights(nlights, t, orbits, lights);
+		sogl_cluster_update(lights, nlights, &view, fovy, aspect, ZNEAR, ZFAR);
+
+		sogl_set_uniform("view", &view);
+		sogl_set_uniform("proj", &proj);
+		sogl_cluster_bind(program);
+		sogl_draw_quads(0, nverts);
+
+		t += 1.0f / 60.0f;
+
+		struct sogl_cluster_stats stats;
+		sogl_cluster_stats(&stats);
+		const Uint32 frame_time = sogl_end_frame();
+		printf("LIGHTS: %d/%d REFS: %d MAX: %d DROPPED: %ld BIN: %.3f MS FRAME: %u MS\n",
+		       stats.lights, nlights, stats.refs, stats.max_refs, stats.dropped,
+		       stats.bin_ms, frame_time);
+	}
+
+	retval = EXIT_SUCCESS;
+
+Lfield_failed:
+	free(lights);
+	free(orbits);
+	free(verts);
+	if (tex != 0)
+		glDeleteTextures(1, &tex);
+	sogl_cluster_term();
+Lcluster_failed:
+	sogl_jobs_term();
+Ljobs_failed:
+	sogl_term();
+	return retval;
+}
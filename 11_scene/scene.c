@@ -0,0 +1,261 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <sogl.h>
+#include <sogl_math.h>
+#include <sogl_scene.h>
+#define SOGL_RES_SHIM
+#include <sogl_res.h>
+
+#define WIN_WIDTH        (1280)
+#define WIN_HEIGHT       (720)
+#define SYSTEMS_SIDE     (10)     // suns per side of the grid
+#define PLANETS          (10)     // per sun
+#define DEFAULT_MOONS    (99)     // per planet, 100100 nodes in all
+#define SPACING          (40.0f)
+#define ANIMATED_SHARE   (8)      // one system in this many moves per frame
+#define TEXTURE_UNIT     (1)
+
+
+const GLchar* const vs_src =
+"#version 150\n"
+"in vec3 pos;\n"
+"in vec3 rgb;\n"
+"uniform samplerBuffer worlds;\n"
+"uniform mat4 viewproj;\n"
+"out vec4 frag_color;\n"
+"void main()\n"
+"{\n"
+"	mat4 world = mat4(texelFetch(worlds, gl_InstanceID * 4),\n"
+"	                  texelFetch(worlds, gl_InstanceID * 4 + 1),\n"
+"	                  texelFetch(worlds, gl_InstanceID * 4 + 2),\n"
+"	                  texelFetch(worlds, gl_InstanceID * 4 + 3));\n"
+"	gl_Position = viewproj * world * vec4(pos, 1.0);\n"
+"	frag_color = vec4(rgb, 1.0);\n"
+"}\n";
+
+const GLchar* const fs_src =
+"#version 150\n"
+"in vec4 frag_color;\n"
+"out vec4 outcolor;\n"
+"void main()\n"
+"{\n"
+"	outcolor = frag_color;\n"
+"}\n";
+
+
+struct vertex_data {
+	struct vec3 pos;
+	struct vec3 rgb;
+};
+
+/* what a node does around its parent */
+struct orbit {
+	GLfloat radius;
+	GLfloat speed;
+	GLfloat phase;
+	GLfloat scale;
+};
+
+
+static const struct vertex_data cube_verts[] = {
+	/* FRONT */
+	{{ -0.5, -0.5, -0.5 }, {1, 0, 0}},
+	{{  0.5, -0.5, -0.5 }, {1, 0, 0}},
+	{{  0.5,  0.5, -0.5 }, {1, 0, 0}},
+	{{ -0.5,  0.5, -0.5 }, {1, 0, 0}},
+
+	/* BACK */
+	{{ -0.5, -0.5,  0.5 }, {0, 1, 0}},
+	{{  0.5, -0.5,  0.5 }, {0, 1, 0}},
+	{{  0.5,  0.5,  0.5 }, {0, 1, 0}},
+	{{ -0.5,  0.5,  0.5 }, {0, 1, 0}},
+
+	/* RIGHT */
+	{{  0.5, -0.5,  0.5 }, {0, 0, 1}},
+	{{  0.5, -0.5, -0.5 }, {0, 0, 1}},
+	{{  0.5,  0.5, -0.5 }, {0, 0, 1}},
+	{{  0.5,  0.5,  0.5 }, {0, 0, 1}},
+
+	/* LEFT */
+	{{ -0.5, -0.5,  0.5 }, {1, 0, 1}},
+	{{ -0.5, -0.5, -0.5 }, {1, 0, 1}},
+	{{ -0.5,  0.5, -0.5 }, {1, 0, 1}},
+	{{ -0.5,  0.5,  0.5 }, {1, 0, 1}},
+
+	/* UP */
+	{{ -0.5,  0.5,  0.5 }, {1, 1, 1}},
+	{{  0.5,  0.5,  0.5 }, {1, 1, 1}},
+	{{  0.5,  0.5, -0.5 }, {1, 1, 1}},
+	{{ -0.5,  0.5, -0.5 }, {1, 1, 1}},
+
+	/* DOWN */
+	{{ -0.5, -0.5,  0.5 }, {0, 1, 1}},
+	{{  0.5, -0.5,  0.5 }, {0, 1, 1}},
+	{{  0.5, -0.5, -0.5 }, {0, 1, 1}},
+	{{ -0.5, -0.5, -0.5 }, {0, 1, 1}},
+};
+
+
+static GLfloat randf(const GLfloat min, const GLfloat max)
+{
+	return 1.0f * rand() / RAND_MAX * (max - min) + min;
+}
+
+/* rotation around y, then the orbit radius along x, then the scale */
+static void orbit_matrix(const struct orbit* const o, const GLfloat t, struct mat4* const m)
+{
+	const GLfloat a = o->phase + t * o->speed;
+	const GLfloat c = cosf(a), s = sinf(a);
+	*m = SOGL_MAT4_IDENTITY;
+	m->x0 = c * o->scale;  m->z0 = -s * o->scale;
+	m->y1 = o->scale;
+	m->x2 = s * o->scale;  m->z2 = c * o->scale;
+	m->x3 = c * o->radius; m->z3 = -s * o->radius;
+}
+
+
+int main(int argc, char** argv)
+{
+	const int moons = argc > 1 ? atoi(argv[1]) : DEFAULT_MOONS;
+	if (moons < 0) {
+		fprintf(stderr, "usage: %s [moons per planet]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (!sogl_init("SCENE GRAPH", WIN_WIDTH, WIN_HEIGHT, vs_src, fs_src))
+		return EXIT_FAILURE;
+
+	int retval = EXIT_FAILURE;
+	struct sogl_scene scene = { 0 };
+	struct orbit* orbits = NULL;
+	GLuint worlds_buffer = 0, worlds_tex = 0;
+
+	const int nsystems = SYSTEMS_SIDE * SYSTEMS_SIDE;
+	const int system_nodes = 1 + PLANETS * (1 + moons);
+	const int nnodes = nsystems * system_nodes;
+
+	srand(sogl_seed());
+
+	orbits = malloc(sizeof(*orbits) * nnodes);
+	if (orbits == NULL) {
+		fprintf(stderr, "Couldn't allocate %d orbits\n", nnodes);
+		goto Lscene_failed;
+	}
+	if (!sogl_scene_init(&scene, nnodes))
+		goto Lscene_failed;
+
+	/* suns first, then their planets and moons: the nodes of a
+	 * system are contiguous, the scene sorts its slots by depth
+	 * */
+	for (int i = 0; i < nsystems; ++i) {
+		struct mat4 sun = SOGL_MAT4_IDENTITY;
+		sun.x3 = ((i % SYSTEMS_SIDE) - SYSTEMS_SIDE * 0.5f) * SPACING;
+		sun.z3 = ((i / SYSTEMS_SIDE) - SYSTEMS_SIDE * 0.5f) * SPACING;
+		const int sun_node = sogl_scene_add(&scene, SOGL_SCENE_ROOT, &sun);
+		orbits[sun_node] = (struct orbit) { 0, 0, 0, 1 };
+
+		for (int p = 0; p < PLANETS; ++p) {
+			const struct orbit planet = {
+				randf(3, 15), randf(0.2f, 1), randf(0, 2 * (GLfloat)M_PI), randf(0.3f, 0.6f)
+			};
+			struct mat4 local;
+			orbit_matrix(&planet, 0, &local);
+			const int planet_node = sogl_scene_add(&scene, sun_node, &local);
+			orbits[planet_node] = planet;
+
+			for (int m = 0; m < moons; ++m) {
+				const struct orbit moon = {
+					randf(1.5f, 4), randf(1, 4), randf(0, 2 * (GLfloat)M_PI), randf(0.05f, 0.2f)
+				};
+				orbit_matrix(&moon, 0, &local);
+				const int moon_node = sogl_scene_add(&scene, planet_node, &local);
+				orbits[moon_node] = moon;
+			}
+		}
+	}
+
+	glBufferData(GL_ARRAY_BUFFER, sizeof(cube_verts), cube_verts, GL_STATIC_DRAW);
+	sogl_vattrp("pos", 3, GL_FLOAT, GL_FALSE, sizeof(struct vertex_data),
+	            (void*)offsetof(struct vertex_data, pos));
+	sogl_vattrp("rgb", 3, GL_FLOAT, GL_FALSE, sizeof(struct vertex_data),
+	            (void*)offsetof(struct vertex_data, rgb));
+
+	// the world matrices go straight from the scene to a buffer texture
+	glGenBuffers(1, &worlds_buffer);
+	glGenTextures(1, &worlds_tex);
+	glBindBuffer(GL_TEXTURE_BUFFER, worlds_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(struct mat4) * nnodes, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, worlds_tex);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, worlds_buffer);
+	glActiveTexture(GL_TEXTURE0);
+
+	GLint program;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	glUniform1i(glGetUniformLocation(program, "worlds"), TEXTURE_UNIT);
+
+	struct mat4 proj;
+	sogl_mat4_perspective(sogl_radians(60), (GLfloat)WIN_WIDTH / WIN_HEIGHT,
+	                      0.1f, SPACING * SYSTEMS_SIDE * 2, &proj);
+
+	SDL_GL_SetSwapInterval(0);
+	GLfloat t = 0;
+	int frame = 0;
+
+	while (sogl_handle_events()) {
+		sogl_begin_frame();
+
+		glClearColor(0, 0, 0, 0xFF);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		/* only a share of the systems moves each frame, round robin,
+		 * the update touches just their subtrees
+		 * */
+		const Uint64 clk = SDL_GetPerformanceCounter();
+		for (int i = frame % ANIMATED_SHARE; i < nsystems; i += ANIMATED_SHARE) {
+			const int first = i * system_nodes;
+			for (int n = first + 1; n < first + system_nodes; ++n) {
+				struct mat4 local;
+				orbit_matrix(&orbits[n], t, &local);
+				sogl_scene_set_local(&scene, n, &local);
+			}
+		}
+		const int updated = sogl_scene_update(&scene);
+		const double update_ms = (SDL_GetPerformanceCounter() - clk) * 1000.0 /
+		                         SDL_GetPerformanceFrequency();
+
+		sogl_upload_orphaned(worlds_buffer, GL_TEXTURE_BUFFER, sizeof(struct mat4) * nnodes,
+		                     scene.worlds, sizeof(struct mat4) * nnodes);
+
+		struct mat4 view = SOGL_MAT4_IDENTITY, viewproj;
+		sogl_mat4_rotate(sogl_radians(-30), &(struct vec3){ 1, 0, 0 }, &view, &view);
+		view.y3 = -SPACING * 2;
+		view.z3 = -SPACING * SYSTEMS_SIDE * 0.9f;
+		sogl_mat4_mul(&proj, &view, &viewproj);
+		sogl_set_uniform("viewproj", &viewproj);
+
+		glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, worlds_tex);
+		glActiveTexture(GL_TEXTURE0);
+		sogl_draw_quads_instanced(0, sizeof(cube_verts) / sizeof(cube_verts[0]), nnodes);
+
+		t += 1.0f / 60.0f;
+		++frame;
+
+		const Uint32 frame_time = sogl_end_frame();
+		printf("NODES: %d UPDATED: %d UPDATE: %.3f MS FRAME: %u MS\n",
+		       nnodes, updated, update_ms, frame_time);
+	}
+
+	retval = EXIT_SUCCESS;
+
+	glDeleteTextures(1, &worlds_tex);
+	glDeleteBuffers(1, &worlds_buffer);
+Lscene_failed:
+	sogl_scene_free(&scene);
+	free(orbits);
+	sogl_term();
+	return retval;
+}
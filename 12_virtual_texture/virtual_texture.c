@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <sogl.h>
+#include <sogl_math.h>
+#include <sogl_vt.h>
+#include <sogl_hud.h>
+#include <sogl_startup.h>
+#define SOGL_RES_SHIM
+#include <sogl_res.h>
+
+#define WIN_WIDTH     (1280)
+#define WIN_HEIGHT    (720)
+#define DEFAULT_IMAGE ("../05_texture/tex.png")
+#define ZNEAR         (0.001f)   // the plane is a unit square
+#define ZFAR          (4.0f)
+#define PITCH         (50.0f)    // degrees the camera looks down
+
+
+/* a unit plane on XZ from the corners of a strip, no vertex
+ * attributes, the virtual uv is the corner
+ * */
+const GLchar* const vs_src =
+"#version 150\n"
+"uniform mat4 viewproj;\n"
+"out vec2 vt_uv;\n"
+"void main()\n"
+"{\n"
+"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+"	gl_Position = viewproj * vec4(corner.x - 0.5, 0.0, 0.5 - corner.y, 1.0);\n"
+"	vt_uv = corner;\n"
+"}\n";
+
+
+/* flies low and high over the plane, so the frame goes through
+ * every level and the pages keep changing
+ * */
+static void camera(const GLfloat t, const struct mat4* const proj, struct mat4* const viewproj)
+{
+	const struct vec3 eye = {
+		sinf(t * 0.11f) * 0.35f,
+		0.02f + 0.25f * (0.5f + 0.5f * sinf(t * 0.23f)),
+		cosf(t * 0.07f) * 0.35f + 0.3f
+	};
+
+	const GLfloat c = cosf(sogl_radians(PITCH)), s = sinf(sogl_radians(PITCH));
+	const struct mat4 view = { .vecs = {
+		{ 1,       0,                        0,                        0 },
+		{ 0,       c,                        s,                        0 },
+		{ 0,      -s,                        c,                        0 },
+		{ -eye.x, -(c * eye.y - s * eye.z), -(s * eye.y + c * eye.z), 1 }
+	} };
+
+	sogl_mat4_mul(proj, &view, viewproj);
+}
+
+int main(int argc, char** argv)
+{
+	const char* const image = argc > 1 ? argv[1] : DEFAULT_IMAGE;
+	if (argc > 2) {
+		fprintf(stderr, "usage: %s [image]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// sogl's program draws the virtual texture
+	if (!sogl_init("VIRTUAL TEXTURE", WIN_WIDTH, WIN_HEIGHT, vs_src, sogl_vt_fs_src))
+		return EXIT_FAILURE;
+
+	int retval = EXIT_FAILURE;
+	GLuint feedback_program = 0;
+
+	if (!sogl_vt_init(image, SOGL_VT_CACHE_SIDE, SOGL_VT_FRAME_PAGES, WIN_WIDTH, WIN_HEIGHT))
+		goto Lvt_failed;
+
+	feedback_program = sogl_create_program(vs_src, sogl_vt_feedback_fs_src);
+	if (feedback_program == 0)
+		goto Lprogram_failed;
+
+	GLint program;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	sogl_vt_setup_program(program, false);
+	sogl_vt_setup_program(feedback_program, true);
+	const GLint feedback_viewproj = glGetUniformLocation(feedback_program, "viewproj");
+	sogl_startup_phase("VIRTUAL TEXTURE");
+
+	if (!sogl_hud_init(WIN_WIDTH, WIN_HEIGHT, SOGL_HUD_REFRESH_MS))
+		fprintf(stderr, "Couldn't create the HUD, running without it\n");
+
+	struct mat4 proj;
+	sogl_mat4_perspective(sogl_radians(60), (GLfloat)WIN_WIDTH / WIN_HEIGHT,
+	                      ZNEAR, ZFAR, &proj);
+
+	SDL_GL_SetSwapInterval(0);
+	GLfloat t = 0;
+
+	while (sogl_handle_events()) {
+		sogl_begin_frame();
+
+		struct mat4 viewproj;
+		camera(t, &proj, &viewproj);
+
+		// the pages this frame samples, read back a few frames later
+		sogl_vt_begin_feedback();
+		glUseProgram(feedback_program);
+		glUniformMatrix4fv(feedback_viewproj, 1, GL_FALSE, &viewproj.x0);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		sogl_vt_end_feedback();
+		sogl_bind();
+
+		sogl_vt_update();
+
+		glClearColor(0, 0, 0, 0xFF);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		sogl_set_uniform("viewproj", &viewproj);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+		sogl_hud_draw();
+		const Uint32 frame_time = sogl_end_frame();
+		t += frame_time / 1000.0f;
+
+		struct sogl_vt_stats stats;
+		sogl_vt_stats(&stats);
+		sogl_hud_set("PAGES", stats.resident);
+		sogl_hud_set("PENDING", stats.pending);
+		sogl_hud_set("LOADED", stats.requested);
+		sogl_hud_set("EVICTED", stats.evicted);
+		sogl_hud_frame(frame_time);
+	}
+
+	retval = EXIT_SUCCESS;
+
+	sogl_hud_term();
+	glDeleteProgram(feedback_program);
+Lprogram_failed:
+	sogl_vt_term();
+Lvt_failed:
+	sogl_term();
+	return retval;
+}
@@ -1,20 +1,191 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include "sogl.h"
+#include "sogl_capture.h"
+#include "sogl_record.h"
+#include "sogl_apitrace.h"
+#include "sogl_input.h"
+#include "sogl_arena.h"
+#include "sogl_startup.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
 
 // graphics
 static SDL_Window* window = NULL;
 static SDL_GLContext glcontext = NULL;
 static GLuint vao = 0, vbo = 0;
-static GLuint sp_id = 0, vs_id = 0, fs_id = 0;
+static GLuint sp_id = 0;
+static GLuint quad_ibo = 0;           // see sogl_draw_quads
+static bool dsa = false;             // direct state access, GL 4.5 or the extension
 
 
 // timing
 static Uint32 frame_clk;
+static Uint32 fixed_dt = 0;          // SOGL_FIXED_DT, 0 returns the measured time
+static Uint64 measured_ms, measured_frames;
 
+// session seed, see sogl_seed
+static unsigned session_seed;
+static bool seeded = false;
+
+// capture, see sogl_capture.h
+static bool capturing = false;
+static int capture_frames = 0;
+
+// video recording, see sogl_record.h
+static bool recording = false;
+
+
+
+static GLuint compile_shader(const GLenum type, const GLchar* const src)
+{
+	const GLuint id = glCreateShader(type);
+	if (id == 0) {
+		fprintf(stderr, "Couldn't create %s Shader\n",
+		        type == GL_VERTEX_SHADER ? "Vertex" : "Fragment");
+		return 0;
+	}
+
+	glShaderSource(id, 1, &src, NULL);
+	glCompileShader(id);
+
+	GLint shader_success;
+	glGetShaderiv(id, GL_COMPILE_STATUS, &shader_success);
+	if (shader_success == GL_FALSE) {
+		GLchar log[1024];
+		glGetShaderInfoLog(id, sizeof(log), NULL, log);
+		fprintf(stderr, "Couldn't compile %s Shader:\n%s\n",
+		        type == GL_VERTEX_SHADER ? "Vertex" : "Fragment", log);
+		glDeleteShader(id);
+		return 0;
+	}
+
+	return id;
+}
+
+
+/* a core context, 4.5 for direct state access or else 3.3.
+ * SOGL_GL_COMPAT set to 1 takes the driver's default compatibility
+ * context instead, for traces recorded with older shaders
+ * */
+static bool create_context(void)
+{
+	const char* const compat = getenv("SOGL_GL_COMPAT");
+	if (compat != NULL && strcmp(compat, "1") == 0) {
+		glcontext = SDL_GL_CreateContext(window);
+		return glcontext != NULL;
+	}
+
+	static const int versions[][2] = { { 4, 5 }, { 3, 3 } };
+	for (int i = 0; i < 2 && glcontext == NULL; ++i) {
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, versions[i][0]);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, versions[i][1]);
+		glcontext = SDL_GL_CreateContext(window);
+	}
+	return glcontext != NULL;
+}
+
+// two triangles per quad, 16 bit so every batch rebases its vertices
+static bool create_quad_indices(void)
+{
+	GLushort* const indices = malloc(sizeof(GLushort) * 6 * SOGL_QUAD_BATCH);
+	if (indices == NULL) {
+		fprintf(stderr, "Couldn't allocate the quad indices\n");
+		return false;
+	}
+
+	for (int q = 0; q < SOGL_QUAD_BATCH; ++q) {
+		const GLushort v = q * 4;
+		GLushort* const tri = &indices[q * 6];
+		tri[0] = v;  tri[1] = v + 1;  tri[2] = v + 2;
+		tri[3] = v;  tri[4] = v + 2;  tri[5] = v + 3;
+	}
+
+	// lands in sogl's VAO, the draws bind it again in the VAO they use
+	glGenBuffers(1, &quad_ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * 6 * SOGL_QUAD_BATCH,
+	             indices, GL_STATIC_DRAW);
+	free(indices);
+	return true;
+}
+
+static bool start_capture(const int width, const int height)
+{
+	const char* const dir = getenv("SOGL_CAPTURE_DIR");
+	if (dir == NULL || dir[0] == '\0')
+		return true;
+
+	const char* const format = getenv("SOGL_CAPTURE_FORMAT");
+	const char* const frames = getenv("SOGL_CAPTURE_FRAMES");
+	capture_frames = frames != NULL ? atoi(frames) : 0;
+
+	capturing = sogl_capture_init(dir, width, height,
+	                              format != NULL && strcmp(format, "raw") == 0
+	                              ? SOGL_CAPTURE_RAW : SOGL_CAPTURE_PNG);
+	return capturing;
+}
+
+static bool start_recording(const int width, const int height)
+{
+	const char* const path = getenv("SOGL_VIDEO");
+	if (path == NULL || path[0] == '\0')
+		return true;
+
+	recording = sogl_record_init(path, width, height);
+	return recording;
+}
+
+static bool start_input(void)
+{
+	const char* const record = getenv("SOGL_INPUT_RECORD");
+	const char* const replay = getenv("SOGL_INPUT_REPLAY");
+	const char* const dt = getenv("SOGL_FIXED_DT");
+	fixed_dt = dt != NULL ? (Uint32)strtoul(dt, NULL, 10) : 0;
+	measured_ms = measured_frames = 0;
+
+	enum sogl_input_mode mode = SOGL_INPUT_LIVE;
+	const char* path = NULL;
+	if (replay != NULL && replay[0] != '\0') {
+		mode = SOGL_INPUT_REPLAY;
+		path = replay;
+	} else if (record != NULL && record[0] != '\0') {
+		mode = SOGL_INPUT_RECORD;
+		path = record;
+	}
+
+	sogl_seed();
+	return sogl_input_init(mode, path, &session_seed, &fixed_dt);
+}
+
+// SOGL_VRAM_BUDGET in megabytes, see sogl_res.h
+static void start_resources(void)
+{
+	const char* const budget = getenv("SOGL_VRAM_BUDGET");
+	sogl_res_init(budget != NULL ? strtoll(budget, NULL, 10) * 1024 * 1024 : 0);
+}
+
+static bool start_trace(const char* const winname,
+                        const int width, const int height,
+                        const GLchar* const vs_src,
+                        const GLchar* const fs_src)
+{
+	const char* const path = getenv("SOGL_TRACE");
+	if (path == NULL || path[0] == '\0')
+		return true;
+
+	if (!sogl_apitrace_init(path))
+		return false;
+
+	sogl_apitrace_record_init(winname, width, height, vs_src, fs_src);
+	return true;
+}
 
 
 bool sogl_init(const char* const winname,
@@ -22,11 +193,15 @@ bool sogl_init(const char* const winname,
                const GLchar* const vs_src,
                const GLchar* const fs_src)
 {
+	sogl_startup_begin();
+	sogl_arena_attach();
 
-	if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
+	// events come with video, the others wait for sogl_require
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
 		fprintf(stderr, "SDL_Init Error: %s\n", SDL_GetError());
 		return false;
 	}
+	sogl_startup_phase("SDL VIDEO");
 
 	window = SDL_CreateWindow(winname,
 	                          SDL_WINDOWPOS_CENTERED,
@@ -45,19 +220,30 @@ bool sogl_init(const char* const winname,
 		return false;
 	}
 
-	glcontext = SDL_GL_CreateContext(window);
-	if (glcontext == NULL) {
+	sogl_startup_phase("WINDOW");
+
+	if (!create_context()) {
 		fprintf(stderr, "Couldn't create GL Context: %s\n", SDL_GetError());
 		sogl_term();
 		return false;
 	}
+	sogl_startup_phase("GL CONTEXT");
 
+	// core contexts need it for GLEW to load the entry points
+	glewExperimental = GL_TRUE;
 	GLenum err;
 	if ((err = glewInit()) != GLEW_OK) {
 		fprintf(stderr, "GLEW Error: %s\n", glewGetErrorString(err));
 		sogl_term();
 		return false;
 	}
+	// glewInit queries GL_EXTENSIONS the old way, invalid on core
+	while (glGetError() != GL_NO_ERROR)
+		;
+	dsa = GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access;
+	sogl_startup_phase("GLEW");
+
+	start_resources();
 
 	glGenVertexArrays(1, &vao);
 	glGenBuffers(1, &vbo);
@@ -66,79 +252,143 @@ bool sogl_init(const char* const winname,
 	glBufferData(GL_ARRAY_BUFFER, MAX_VBO_BYTES,
 	             NULL, GL_DYNAMIC_DRAW);
 
-	sp_id = glCreateProgram();
-	if (sp_id == 0) {
-		fprintf(stderr, "Couldn't create GL Program\n");
+	if (!create_quad_indices()) {
 		sogl_term();
 		return false;
 	}
+	sogl_startup_phase("BUFFERS");
 
-	vs_id = glCreateShader(GL_VERTEX_SHADER);
-	if (vs_id == 0) {
-		fprintf(stderr, "Couldn't create Vertex Shader\n");
+	sp_id = sogl_create_program(vs_src, fs_src);
+	if (sp_id == 0) {
 		sogl_term();
 		return false;
 	}
 
-	fs_id = glCreateShader(GL_FRAGMENT_SHADER);
-	if (fs_id == 0) {
-		fprintf(stderr, "Couldn't create Fragment Shader\n");
+	glUseProgram(sp_id);
+	sogl_startup_phase("PROGRAM");
+
+	glEnable(GL_DEPTH_TEST);
+
+	if (!start_input() ||
+	    !start_capture(width, height) || !start_recording(width, height) ||
+	    !start_trace(winname, width, height, vs_src, fs_src)) {
 		sogl_term();
 		return false;
 	}
+	sogl_startup_phase("INPUT CAPTURE TRACE");
 
-	// compile vertex shader
-	glShaderSource(vs_id, 1, &vs_src, NULL);
-	glCompileShader(vs_id);
 	
-	GLint shader_success;
+	printf("SDL2 OPENGL INITIALIZED! %s%s\n"
+	       "W: set wireframe\n"
+	       "D: set depth bit\n",
+	       (const char*)glGetString(GL_VERSION), dsa ? " (DSA)" : "");
 
-	glGetShaderiv(vs_id, GL_COMPILE_STATUS, &shader_success);
-	if (shader_success == GL_FALSE) {
-		fprintf(stderr, "Couldn't compile Vertex Shader\n");
-		sogl_term();
-		return false;
+	return true;
+}
+
+// deletes the program if it didn't link
+static GLuint check_link(const GLuint program)
+{
+	GLint link_success;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_success);
+	if (link_success == GL_FALSE) {
+		GLchar log[1024];
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		fprintf(stderr, "Couldn't link GL Program:\n%s\n", log);
+		glDeleteProgram(program);
+		return 0;
 	}
 
+	return program;
+}
 
-	// compile fragment shader
-	glShaderSource(fs_id, 1, &fs_src, NULL);
-	glCompileShader(fs_id);
-	
-	glGetShaderiv(fs_id, GL_COMPILE_STATUS, &shader_success);
-	if (shader_success == GL_FALSE) {
-		fprintf(stderr, "Couldn't compile Fragment Shader\n");
-		sogl_term();
-		return false;
+GLuint sogl_create_program(const GLchar* const vs_src,
+                           const GLchar* const fs_src)
+{
+	const GLuint vs_id = compile_shader(GL_VERTEX_SHADER, vs_src);
+	if (vs_id == 0)
+		return 0;
+
+	const GLuint fs_id = compile_shader(GL_FRAGMENT_SHADER, fs_src);
+	if (fs_id == 0) {
+		glDeleteShader(vs_id);
+		return 0;
 	}
 
+	const GLuint program = glCreateProgram();
+	if (program == 0) {
+		fprintf(stderr, "Couldn't create GL Program\n");
+		glDeleteShader(vs_id);
+		glDeleteShader(fs_id);
+		return 0;
+	}
 
-	glAttachShader(sp_id, vs_id);
-	glAttachShader(sp_id, fs_id);
-	glLinkProgram(sp_id);
-	glUseProgram(sp_id);
+	glAttachShader(program, vs_id);
+	glAttachShader(program, fs_id);
+	glLinkProgram(program);
 
+	// the program keeps the compiled code, the shaders aren't needed anymore
+	glDetachShader(program, vs_id);
+	glDetachShader(program, fs_id);
+	glDeleteShader(vs_id);
+	glDeleteShader(fs_id);
 
-	glEnable(GL_DEPTH_TEST);
+	return check_link(program);
+}
 
-	
-	printf("SDL2 OPENGL INITIALIZED!\n"
-	       "W: set wireframe\n"
-	       "D: set depth bit\n");
+GLuint sogl_create_feedback_program(const GLchar* const vs_src,
+                                    const GLchar* const* const varyings,
+                                    const GLsizei nvaryings)
+{
+	const GLuint vs_id = compile_shader(GL_VERTEX_SHADER, vs_src);
+	if (vs_id == 0)
+		return 0;
 
-	return true;
+	const GLuint program = glCreateProgram();
+	if (program == 0) {
+		fprintf(stderr, "Couldn't create GL Program\n");
+		glDeleteShader(vs_id);
+		return 0;
+	}
+
+	glAttachShader(program, vs_id);
+	glTransformFeedbackVaryings(program, nvaryings, varyings, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(program);
+
+	glDetachShader(program, vs_id);
+	glDeleteShader(vs_id);
+
+	return check_link(program);
 }
 
+void sogl_bind(void)
+{
+	glUseProgram(sp_id);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+}
+
+
 void sogl_term(void)
 {
-	if (fs_id != 0) {
-		glDetachShader(sp_id, fs_id);
-		glDeleteShader(fs_id);
+	if (capturing) {
+		sogl_capture_term();
+		capturing = false;
 	}
 
-	if (vs_id != 0) {
-		glDetachShader(sp_id, vs_id);
-		glDeleteShader(vs_id);
+	if (recording) {
+		sogl_record_term();
+		recording = false;
+	}
+
+	sogl_apitrace_term();
+	sogl_input_term();
+	sogl_arena_term();
+
+	if (fixed_dt > 0 && measured_frames > 0) {
+		printf("FIXED DT: %u MS MEASURED: %.3f MS PER FRAME OVER %llu FRAMES\n",
+		       fixed_dt, (double)measured_ms / measured_frames,
+		       (unsigned long long)measured_frames);
 	}
 
 	if (sp_id != 0)
@@ -147,9 +397,15 @@ void sogl_term(void)
 	if (vbo != 0)
 		glDeleteBuffers(1, &vbo);
 
+	if (quad_ibo != 0)
+		glDeleteBuffers(1, &quad_ibo);
+
 	if (vao != 0)
 		glDeleteVertexArrays(1, &vao);
 
+	// after every module deleted its objects, what's left leaked
+	sogl_res_term();
+
 	if (glcontext != NULL)
 		SDL_GL_DeleteContext(glcontext);
 
@@ -160,14 +416,30 @@ void sogl_term(void)
 }
 
 
+bool sogl_require(const Uint32 subsystems)
+{
+	if (SDL_WasInit(subsystems) == subsystems)
+		return true;
+
+	if (SDL_InitSubSystem(subsystems) < 0) {
+		fprintf(stderr, "Couldn't init SDL subsystems: %s\n", SDL_GetError());
+		return false;
+	}
+	sogl_startup_phase("SDL SUBSYSTEMS");
+	return true;
+}
+
+
 bool sogl_handle_events(void)
 {
 	static SDL_Event event;
 	static bool wireframe = false;
 	static bool depth_bit = true;
 
+	if (capturing && capture_frames > 0 && sogl_capture_frames() >= capture_frames)
+		return false;
 
-	while (SDL_PollEvent(&event)) {
+	while (sogl_input_poll(&event)) {
 		if (event.type == SDL_QUIT)
 			return false;
 
@@ -177,7 +449,7 @@ bool sogl_handle_events(void)
 			switch (event.key.keysym.scancode) {
 				
 			case SDL_SCANCODE_W:
-				glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_FILL : GL_LINE);
+				sogl_apitrace_polygon_mode(GL_FRONT_AND_BACK, wireframe ? GL_FILL : GL_LINE);
 				wireframe = !wireframe;
 				printcfg = true;
 				break;
@@ -185,9 +457,9 @@ bool sogl_handle_events(void)
 			case SDL_SCANCODE_D:
 				depth_bit = !depth_bit;
 				if (depth_bit)
-					glEnable(GL_DEPTH_TEST);
+					sogl_apitrace_enable(GL_DEPTH_TEST);
 				else
-					glDisable(GL_DEPTH_TEST);
+					sogl_apitrace_disable(GL_DEPTH_TEST);
 				printcfg = true;
 				break;
 
@@ -210,15 +482,56 @@ bool sogl_handle_events(void)
 void sogl_begin_frame(void)
 {
 	frame_clk = SDL_GetTicks();
+	sogl_apitrace_record_frame(true);
 }
 
 Uint32 sogl_end_frame(void)
 {
 	frame_clk = SDL_GetTicks() - frame_clk;
+	sogl_apitrace_record_frame(false);
+	if (capturing)
+		sogl_capture_frame();
+	if (recording)
+		sogl_record_frame();
 	SDL_GL_SwapWindow(window);
-	return frame_clk;
+	sogl_startup_first_frame();
+	sogl_input_end_frame();
+	sogl_arena_end_frame();
+	sogl_res_end_frame();
+
+	measured_ms += frame_clk;
+	++measured_frames;
+	return fixed_dt > 0 ? fixed_dt : frame_clk;
+}
+
+Uint32 sogl_fixed_dt(void)
+{
+	return fixed_dt;
 }
 
+unsigned sogl_seed(void)
+{
+	if (!seeded) {
+		const char* const seed = getenv("SOGL_SEED");
+		session_seed = seed != NULL ? (unsigned)strtoul(seed, NULL, 0) : (unsigned)time(NULL);
+		seeded = true;
+	}
+	return session_seed;
+}
+
+
+static GLsizei type_bytes(const GLenum type)
+{
+	switch (type) {
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:  return 1;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+	case GL_HALF_FLOAT:     return 2;
+	case GL_DOUBLE:         return 8;
+	}
+	return 4;
+}
 
 void sogl_vattrp(const GLchar* const attrib_name,
                  const GLint size,
@@ -227,9 +540,96 @@ void sogl_vattrp(const GLchar* const attrib_name,
                  const GLsizei stride,
                  const GLvoid* const pointer)
 {
-	const GLuint index = glGetAttribLocation(sp_id, attrib_name);
-	glEnableVertexAttribArray(index);
-	glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+	sogl_apitrace_record_vattrp(attrib_name, size, type, normalized, stride, pointer);
+
+	const GLint index = glGetAttribLocation(sp_id, attrib_name);
+	if (index < 0)
+		return;
+
+	if (!dsa) {
+		glEnableVertexAttribArray(index);
+		glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+		return;
+	}
+
+	/* the format is set apart from the buffer, each attribute on the
+	 * binding of its index like glVertexAttribPointer does
+	 * */
+	GLint bound_vao, buffer;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &bound_vao);
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &buffer);
+	glVertexArrayAttribFormat(bound_vao, index, size, type, normalized, 0);
+	glVertexArrayAttribBinding(bound_vao, index, index);
+	glVertexArrayVertexBuffer(bound_vao, index, buffer, (GLintptr)pointer,
+	                          stride > 0 ? stride : size * type_bytes(type));
+	glEnableVertexArrayAttrib(bound_vao, index);
+}
+
+
+void sogl_draw_quads(const GLint first, const GLsizei count)
+{
+	sogl_apitrace_record_draw_quads(first, count);
+
+	const GLsizei nquads = count / 4;
+	if (nquads == 0)
+		return;
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_ibo);
+	if (nquads <= SOGL_QUAD_BATCH) {
+		glDrawElementsBaseVertex(GL_TRIANGLES, nquads * 6, GL_UNSIGNED_SHORT, NULL, first);
+		return;
+	}
+
+	// the batches go in one call, each rebased past the previous one
+	const GLsizei nbatches = (nquads + SOGL_QUAD_BATCH - 1) / SOGL_QUAD_BATCH;
+	GLsizei* const counts = sogl_arena_alloc(sizeof(GLsizei) * nbatches);
+	const GLvoid** const offsets = sogl_arena_alloc(sizeof(GLvoid*) * nbatches);
+	GLint* const bases = sogl_arena_alloc(sizeof(GLint) * nbatches);
+	if (counts == NULL || offsets == NULL || bases == NULL)
+		return;
+
+	for (GLsizei b = 0; b < nbatches; ++b) {
+		const GLsizei left = nquads - b * SOGL_QUAD_BATCH;
+		counts[b] = (left < SOGL_QUAD_BATCH ? left : SOGL_QUAD_BATCH) * 6;
+		offsets[b] = NULL;
+		bases[b] = first + b * SOGL_QUAD_BATCH * 4;
+	}
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, GL_UNSIGNED_SHORT,
+	                              offsets, nbatches, bases);
+}
+
+void sogl_draw_quads_instanced(const GLint first, const GLsizei count,
+                               const GLsizei instances)
+{
+	sogl_apitrace_record_draw_quads_instanced(first, count, instances);
+
+	const GLsizei nquads = count / 4;
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_ibo);
+	for (GLsizei q = 0; q < nquads; q += SOGL_QUAD_BATCH) {
+		const GLsizei n = nquads - q < SOGL_QUAD_BATCH ? nquads - q : SOGL_QUAD_BATCH;
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, n * 6, GL_UNSIGNED_SHORT, NULL,
+		                                  instances, first + q * 4);
+	}
+}
+
+void sogl_upload_orphaned(const GLuint buffer, const GLenum target,
+                          const GLsizeiptr size, const void* const data,
+                          const GLsizeiptr used)
+{
+	if (dsa) {
+		glNamedBufferData(buffer, size, NULL, GL_STREAM_DRAW);
+		glNamedBufferSubData(buffer, 0, used, data);
+		return;
+	}
+
+	glBindBuffer(target, buffer);
+	glBufferData(target, size, NULL, GL_STREAM_DRAW);
+	glBufferSubData(target, 0, used, data);
+}
+
+bool sogl_dsa(void)
+{
+	return dsa;
 }
 
 
@@ -237,6 +637,8 @@ void sogl_set_uniform(const GLchar* const name, const void* const data)
 {
 	static const GLchar* lastname_addr;
 	static GLint index;
+
+	sogl_apitrace_record_uniform(name, data);
 	
 	if (lastname_addr != name) {
 		index = glGetUniformLocation(sp_id, name);
@@ -4,7 +4,8 @@
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 
-#define MAX_VBO_BYTES (1024l * 1024l * 8l) // 8MB VRAM
+#define MAX_VBO_BYTES   (1024l * 1024l * 8l) // 8MB VRAM
+#define SOGL_QUAD_BATCH (16384)              // quads of the shared index buffer, 16 bit indices
 
 
 extern bool sogl_init(const char* winname,
@@ -14,12 +15,48 @@ extern bool sogl_init(const char* winname,
 
 extern void sogl_term(void);
 
+/* sogl_init asks for a core 4.5 context, or 3.3 without it, so the
+ * shaders need #version 150 or later. SOGL_GL_COMPAT=1 gets the
+ * compatibility context of the driver instead.
+ * true when direct state access is there, the hot paths then update
+ * buffers by name without binding them
+ * */
+extern bool sogl_dsa(void);
+
+/* compiles and links a program, returns 0 on failure */
+extern GLuint sogl_create_program(const GLchar* vs_src, const GLchar* fs_src);
+
+/* vertex shader only program capturing varyings interleaved with
+ * transform feedback, meant to run with GL_RASTERIZER_DISCARD
+ * */
+extern GLuint sogl_create_feedback_program(const GLchar* vs_src,
+                                           const GLchar* const* varyings,
+                                           GLsizei nvaryings);
+
+/* binds back sogl's program, VAO and VBO after using other ones */
+extern void sogl_bind(void);
+
+/* sogl_init only starts SDL's video and events, the subsystems a
+ * demo needs besides are started the first time it asks for them
+ * */
+extern bool sogl_require(Uint32 subsystems);
+
 extern bool sogl_handle_events(void);
 
 
 extern void sogl_begin_frame(void);
+
+/* returns the frame time in ms, or SOGL_FIXED_DT when set so what
+ * depends on it is reproducible, see sogl_input.h. The first
+ * one reports the startup phases, see sogl_startup.h. The frame
+ * arenas are rewound, see sogl_arena.h, and the cached GL objects
+ * over the VRAM budget evicted, see sogl_res.h
+ * */
 extern Uint32 sogl_end_frame(void);
 
+/* SOGL_FIXED_DT, or the one of the replayed input recording, 0 if none */
+extern Uint32 sogl_fixed_dt(void);
+
 extern void sogl_vattrp(const GLchar* attrib_name,
                         GLint size,
                         GLenum type,
@@ -27,6 +64,26 @@ extern void sogl_vattrp(const GLchar* attrib_name,
                         GLsizei stride,
                         const GLvoid* pointer);
 
+/* draws count vertices laid out as GL_QUADS from first, as indexed
+ * triangles through the shared quad index buffer. It's bound to the
+ * current VAO, replacing the element buffer there. A quad batch is
+ * one draw, more go through glMultiDrawElementsBaseVertex
+ * */
+extern void sogl_draw_quads(GLint first, GLsizei count);
+extern void sogl_draw_quads_instanced(GLint first, GLsizei count, GLsizei instances);
+
+/* orphans the size bytes of buffer and uploads the first used bytes
+ * of data, by name with DSA, else through target left bound to it
+ * */
+extern void sogl_upload_orphaned(GLuint buffer, GLenum target, GLsizeiptr size,
+                                 const void* data, GLsizeiptr used);
+
 extern void sogl_set_uniform(const GLchar* name, const void* data);
 
+/* the seed of the session: the one of the replayed input recording,
+ * SOGL_SEED when set, the current time otherwise, so captured and
+ * recorded runs can be reproduced. Same value on every call.
+ * */
+extern unsigned sogl_seed(void);
+
 #endif
@@ -0,0 +1,407 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include "sogl_apitrace.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+
+const char* const sogl_apitrace_op_names[SOGL_APITRACE_NOPS] = {
+	[SOGL_APITRACE_INIT]                 = "sogl_init",
+	[SOGL_APITRACE_TERM]                 = "sogl_term",
+	[SOGL_APITRACE_VATTRP]               = "sogl_vattrp",
+	[SOGL_APITRACE_UNIFORM]              = "sogl_set_uniform",
+	[SOGL_APITRACE_BEGIN_FRAME]          = "sogl_begin_frame",
+	[SOGL_APITRACE_END_FRAME]            = "sogl_end_frame",
+	[SOGL_APITRACE_BLOB]                 = "blob",
+	[SOGL_APITRACE_CLEAR_COLOR]          = "glClearColor",
+	[SOGL_APITRACE_CLEAR]                = "glClear",
+	[SOGL_APITRACE_BUFFER_DATA]          = "glBufferData",
+	[SOGL_APITRACE_BUFFER_SUB]           = "glBufferSubData",
+	[SOGL_APITRACE_DRAW_ARRAYS]          = "glDrawArrays",
+	[SOGL_APITRACE_ENABLE]               = "glEnable",
+	[SOGL_APITRACE_DISABLE]              = "glDisable",
+	[SOGL_APITRACE_POLYGON_MODE]         = "glPolygonMode",
+	[SOGL_APITRACE_SHADOW_CREATE]        = "sogl_buffer_init",
+	[SOGL_APITRACE_SHADOW_FLUSH]         = "sogl_buffer_flush",
+	[SOGL_APITRACE_SHADOW_RANGE]         = "sogl_buffer upload",
+	[SOGL_APITRACE_SHADOW_DELETE]        = "sogl_buffer_free",
+	[SOGL_APITRACE_DRAW_QUADS]           = "sogl_draw_quads",
+	[SOGL_APITRACE_DRAW_QUADS_INSTANCED] = "sogl_draw_quads_instanced",
+};
+
+
+static FILE* file;
+static char* file_buffer;
+static Uint64 start_clk;
+
+// open addressing set of the hashes already written, 0 is empty
+static uint64_t* hashes;
+static size_t hashes_size, nhashes;
+static long long nblobs, blob_bytes, dedup_bytes, nrecords;
+
+
+uint64_t sogl_apitrace_hash(const void* const data, size_t size)
+{
+	const unsigned char* p = data;
+	uint64_t h = 0x9E3779B97F4A7C15ull ^ size;
+
+	for (; size >= 8; size -= 8, p += 8) {
+		uint64_t w;
+		memcpy(&w, p, 8);
+		h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+		h ^= h >> 32;
+	}
+	for (; size > 0; --size, ++p)
+		h = (h ^ *p) * 0x100000001B3ull;
+
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ull;
+	h ^= h >> 33;
+	return h != 0 ? h : 1;
+}
+
+/* true when hash is new and got inserted */
+static bool insert_hash(const uint64_t hash)
+{
+	if ((nhashes + 1) * 2 > hashes_size) {
+		const size_t new_size = hashes_size * 2;
+		uint64_t* const new_hashes = calloc(new_size, sizeof(*new_hashes));
+		if (new_hashes == NULL) {
+			fprintf(stderr, "Couldn't grow trace blob set\n");
+			return true;
+		}
+		for (size_t i = 0; i < hashes_size; ++i) {
+			if (hashes[i] == 0)
+				continue;
+			size_t j = hashes[i] & (new_size - 1);
+			while (new_hashes[j] != 0)
+				j = (j + 1) & (new_size - 1);
+			new_hashes[j] = hashes[i];
+		}
+		free(hashes);
+		hashes = new_hashes;
+		hashes_size = new_size;
+	}
+
+	size_t i = hash & (hashes_size - 1);
+	while (hashes[i] != 0) {
+		if (hashes[i] == hash)
+			return false;
+		i = (i + 1) & (hashes_size - 1);
+	}
+	hashes[i] = hash;
+	++nhashes;
+	return true;
+}
+
+
+static void put(const void* const data, const size_t size)
+{
+	fwrite(data, size, 1, file);
+}
+
+static void put_op(const enum sogl_apitrace_op op)
+{
+	const uint8_t byte = op;
+	put(&byte, 1);
+	++nrecords;
+}
+
+static void put_u32(const uint32_t v)
+{
+	put(&v, sizeof(v));
+}
+
+static void put_i64(const int64_t v)
+{
+	put(&v, sizeof(v));
+}
+
+static void put_u64(const uint64_t v)
+{
+	put(&v, sizeof(v));
+}
+
+static void put_str(const char* const str)
+{
+	const uint32_t len = str != NULL ? strlen(str) : 0;
+	put_u32(len);
+	put(str, len);
+}
+
+static uint64_t elapsed_ns(void)
+{
+	const Uint64 ticks = SDL_GetPerformanceCounter() - start_clk;
+	return (uint64_t)(ticks * 1e9 / SDL_GetPerformanceFrequency());
+}
+
+/* writes the blob the first time its content is seen */
+static uint64_t put_blob(const void* const data, const GLsizeiptr size)
+{
+	if (data == NULL)
+		return 0;
+
+	const uint64_t hash = sogl_apitrace_hash(data, size);
+	if (insert_hash(hash)) {
+		put_op(SOGL_APITRACE_BLOB);
+		put_u64(hash);
+		put_u64(size);
+		put(data, size);
+		++nblobs;
+		blob_bytes += size;
+	} else {
+		dedup_bytes += size;
+	}
+
+	return hash;
+}
+
+
+bool sogl_apitrace_init(const char* const path)
+{
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Couldn't open trace %s\n", path);
+		return false;
+	}
+
+	file_buffer = malloc(SOGL_APITRACE_WRITE_BYTES);
+	if (file_buffer != NULL)
+		setvbuf(file, file_buffer, _IOFBF, SOGL_APITRACE_WRITE_BYTES);
+
+	hashes_size = SOGL_APITRACE_BLOBS;
+	hashes = calloc(hashes_size, sizeof(*hashes));
+	if (hashes == NULL) {
+		fprintf(stderr, "Couldn't allocate trace blob set\n");
+		sogl_apitrace_term();
+		return false;
+	}
+
+	nhashes = 0;
+	nblobs = blob_bytes = dedup_bytes = nrecords = 0;
+	start_clk = SDL_GetPerformanceCounter();
+	put(SOGL_APITRACE_MAGIC, SOGL_APITRACE_MAGIC_LEN);
+
+	printf("TRACING TO %s\n", path);
+	return true;
+}
+
+void sogl_apitrace_term(void)
+{
+	if (file != NULL) {
+		put_op(SOGL_APITRACE_TERM);
+		printf("TRACE: %lld RECORDS, %lld BLOBS, %lld BYTES UPLOADED, %lld DEDUPLICATED\n",
+		       nrecords, nblobs, blob_bytes + dedup_bytes, dedup_bytes);
+		fclose(file);
+	}
+
+	free(file_buffer);
+	free(hashes);
+	file = NULL;
+	file_buffer = NULL;
+	hashes = NULL;
+	hashes_size = nhashes = 0;
+}
+
+bool sogl_apitrace_active(void)
+{
+	return file != NULL;
+}
+
+
+void sogl_apitrace_record_init(const char* const winname, const int width, const int height,
+                               const GLchar* const vs_src, const GLchar* const fs_src)
+{
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_INIT);
+	put_str(winname);
+	put_u32(width);
+	put_u32(height);
+	put_str(vs_src);
+	put_str(fs_src);
+}
+
+void sogl_apitrace_record_vattrp(const GLchar* const attrib_name, const GLint size,
+                                 const GLenum type, const GLboolean normalized,
+                                 const GLsizei stride, const GLvoid* const pointer)
+{
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_VATTRP);
+	put_str(attrib_name);
+	put_u32(size);
+	put_u32(type);
+	put_u32(normalized);
+	put_u32(stride);
+	put_u64((uint64_t)(uintptr_t)pointer);
+}
+
+void sogl_apitrace_record_uniform(const GLchar* const name, const void* const data)
+{
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_UNIFORM);
+	put_str(name);
+	put(data, sizeof(GLfloat) * 16);
+}
+
+void sogl_apitrace_record_frame(const bool begin)
+{
+	if (file == NULL)
+		return;
+	put_op(begin ? SOGL_APITRACE_BEGIN_FRAME : SOGL_APITRACE_END_FRAME);
+	put_u64(elapsed_ns());
+}
+
+void sogl_apitrace_record_draw_quads(const GLint first, const GLsizei count)
+{
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_DRAW_QUADS);
+	put_u32(first);
+	put_u32(count);
+}
+
+void sogl_apitrace_record_draw_quads_instanced(const GLint first, const GLsizei count,
+                                               const GLsizei instances)
+{
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_DRAW_QUADS_INSTANCED);
+	put_u32(first);
+	put_u32(count);
+	put_u32(instances);
+}
+
+void sogl_apitrace_record_shadow_create(const GLuint buffer, const GLenum target,
+                                        const GLsizeiptr size, const GLenum usage)
+{
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_SHADOW_CREATE);
+	put_u32(buffer);
+	put_u32(target);
+	put_i64(size);
+	put_u32(usage);
+}
+
+void sogl_apitrace_record_shadow_flush(const GLuint buffer)
+{
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_SHADOW_FLUSH);
+	put_u32(buffer);
+}
+
+void sogl_apitrace_record_shadow_range(const GLuint buffer, const GLintptr offset,
+                                       const GLsizeiptr size, const void* const data)
+{
+	if (file == NULL)
+		return;
+	const uint64_t hash = put_blob(data, size);
+	put_op(SOGL_APITRACE_SHADOW_RANGE);
+	put_u32(buffer);
+	put_i64(offset);
+	put_i64(size);
+	put_u64(hash);
+}
+
+void sogl_apitrace_record_shadow_delete(const GLuint buffer)
+{
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_SHADOW_DELETE);
+	put_u32(buffer);
+}
+
+
+void sogl_apitrace_clear_color(const GLfloat r, const GLfloat g, const GLfloat b, const GLfloat a)
+{
+	glClearColor(r, g, b, a);
+	if (file == NULL)
+		return;
+	const GLfloat rgba[4] = { r, g, b, a };
+	put_op(SOGL_APITRACE_CLEAR_COLOR);
+	put(rgba, sizeof(rgba));
+}
+
+void sogl_apitrace_clear(const GLbitfield mask)
+{
+	glClear(mask);
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_CLEAR);
+	put_u32(mask);
+}
+
+void sogl_apitrace_buffer_data(const GLenum target, const GLsizeiptr size,
+                               const void* const data, const GLenum usage)
+{
+	glBufferData(target, size, data, usage);
+	if (file == NULL)
+		return;
+	const uint64_t hash = put_blob(data, size);
+	put_op(SOGL_APITRACE_BUFFER_DATA);
+	put_u32(target);
+	put_i64(size);
+	put_u64(hash);
+	put_u32(usage);
+}
+
+void sogl_apitrace_buffer_sub_data(const GLenum target, const GLintptr offset,
+                                   const GLsizeiptr size, const void* const data)
+{
+	glBufferSubData(target, offset, size, data);
+	if (file == NULL)
+		return;
+	const uint64_t hash = put_blob(data, size);
+	put_op(SOGL_APITRACE_BUFFER_SUB);
+	put_u32(target);
+	put_i64(offset);
+	put_i64(size);
+	put_u64(hash);
+}
+
+void sogl_apitrace_draw_arrays(const GLenum mode, const GLint first, const GLsizei count)
+{
+	glDrawArrays(mode, first, count);
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_DRAW_ARRAYS);
+	put_u32(mode);
+	put_u32(first);
+	put_u32(count);
+}
+
+void sogl_apitrace_enable(const GLenum cap)
+{
+	glEnable(cap);
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_ENABLE);
+	put_u32(cap);
+}
+
+void sogl_apitrace_disable(const GLenum cap)
+{
+	glDisable(cap);
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_DISABLE);
+	put_u32(cap);
+}
+
+void sogl_apitrace_polygon_mode(const GLenum face, const GLenum mode)
+{
+	glPolygonMode(face, mode);
+	if (file == NULL)
+		return;
+	put_op(SOGL_APITRACE_POLYGON_MODE);
+	put_u32(face);
+	put_u32(mode);
+}
@@ -0,0 +1,139 @@
+#ifndef SOGL_APITRACE_H_
+#define SOGL_APITRACE_H_
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <GL/glew.h>
+
+#define SOGL_APITRACE_MAGIC       ("SOGLTRC1")
+#define SOGL_APITRACE_MAGIC_LEN   (8)
+#define SOGL_APITRACE_WRITE_BYTES (1024l * 1024l * 8l) // stdio buffer of the trace
+#define SOGL_APITRACE_BLOBS       (4096)               // initial size of the hash set
+
+
+/* API trace:
+ * a binary stream of the sogl calls of a run and of the GL calls
+ * the application issues on sogl's program and VBO, with every
+ * uploaded buffer stored once per content hash. The shadowed
+ * buffers of sogl_buffer.h are recorded too, keyed by the GL name
+ * they were created with. tools/replay re-issues the stream, so a
+ * driver or upload change can be benchmarked on an identical
+ * command stream.
+ *
+ * sogl_init starts tracing when SOGL_TRACE is set to the path of
+ * the trace to write, sogl_term ends it.
+ *
+ * Records are one op byte followed by its fields in host byte
+ * order, strings as an uint32_t length and the bytes:
+ *   INIT                 name, width, height, vs_src, fs_src
+ *   VATTRP               name, size, type, normalized, stride, offset (uint64_t)
+ *   UNIFORM              name, 16 floats
+ *   BEGIN_FRAME          nanoseconds since INIT (uint64_t)
+ *   END_FRAME            nanoseconds since INIT (uint64_t)
+ *   BLOB                 hash (uint64_t), size (uint64_t), bytes
+ *   BUFFER_DATA          target, size (int64_t), hash, usage
+ *   BUFFER_SUB           target, offset, size (int64_t), hash
+ *   SHADOW_CREATE        buffer, target, size (int64_t), usage
+ *   SHADOW_FLUSH         buffer
+ *   SHADOW_RANGE         buffer, offset, size (int64_t), hash
+ *   SHADOW_DELETE        buffer
+ *   DRAW_QUADS           first, count
+ *   DRAW_QUADS_INSTANCED first, count, instances
+ *   the others           their GL arguments
+ * integers not marked otherwise are uint32_t, colors and matrices floats.
+ * A BLOB always comes before the first upload of its hash, hash 0
+ * stands for a NULL pointer.
+ * */
+enum sogl_apitrace_op {
+	SOGL_APITRACE_INIT,
+	SOGL_APITRACE_TERM,
+	SOGL_APITRACE_VATTRP,
+	SOGL_APITRACE_UNIFORM,
+	SOGL_APITRACE_BEGIN_FRAME,
+	SOGL_APITRACE_END_FRAME,
+	SOGL_APITRACE_BLOB,
+	SOGL_APITRACE_CLEAR_COLOR,
+	SOGL_APITRACE_CLEAR,
+	SOGL_APITRACE_BUFFER_DATA,
+	SOGL_APITRACE_BUFFER_SUB,
+	SOGL_APITRACE_DRAW_ARRAYS,
+	SOGL_APITRACE_ENABLE,
+	SOGL_APITRACE_DISABLE,
+	SOGL_APITRACE_POLYGON_MODE,
+	SOGL_APITRACE_SHADOW_CREATE,
+	SOGL_APITRACE_SHADOW_FLUSH,
+	SOGL_APITRACE_SHADOW_RANGE,
+	SOGL_APITRACE_SHADOW_DELETE,
+	SOGL_APITRACE_DRAW_QUADS,
+	SOGL_APITRACE_DRAW_QUADS_INSTANCED,
+	SOGL_APITRACE_NOPS
+};
+
+
+extern const char* const sogl_apitrace_op_names[SOGL_APITRACE_NOPS];
+
+extern bool sogl_apitrace_init(const char* path);
+extern void sogl_apitrace_term(void);
+extern bool sogl_apitrace_active(void);
+
+/* the content hash blobs are deduplicated by, never 0 */
+extern uint64_t sogl_apitrace_hash(const void* data, size_t size);
+
+/* recorded by sogl.c, they don't issue the call */
+extern void sogl_apitrace_record_init(const char* winname, int width, int height,
+                                      const GLchar* vs_src, const GLchar* fs_src);
+extern void sogl_apitrace_record_vattrp(const GLchar* attrib_name, GLint size, GLenum type,
+                                        GLboolean normalized, GLsizei stride,
+                                        const GLvoid* pointer);
+extern void sogl_apitrace_record_uniform(const GLchar* name, const void* data);
+extern void sogl_apitrace_record_frame(bool begin);
+extern void sogl_apitrace_record_draw_quads(GLint first, GLsizei count);
+extern void sogl_apitrace_record_draw_quads_instanced(GLint first, GLsizei count,
+                                                      GLsizei instances);
+
+/* recorded by sogl_buffer.c, a flush is followed by the ranges it sent */
+extern void sogl_apitrace_record_shadow_create(GLuint buffer, GLenum target,
+                                               GLsizeiptr size, GLenum usage);
+extern void sogl_apitrace_record_shadow_flush(GLuint buffer);
+extern void sogl_apitrace_record_shadow_range(GLuint buffer, GLintptr offset,
+                                              GLsizeiptr size, const void* data);
+extern void sogl_apitrace_record_shadow_delete(GLuint buffer);
+
+/* issue the GL call, then record it when tracing */
+extern void sogl_apitrace_clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+extern void sogl_apitrace_clear(GLbitfield mask);
+extern void sogl_apitrace_buffer_data(GLenum target, GLsizeiptr size,
+                                      const void* data, GLenum usage);
+extern void sogl_apitrace_buffer_sub_data(GLenum target, GLintptr offset,
+                                          GLsizeiptr size, const void* data);
+extern void sogl_apitrace_draw_arrays(GLenum mode, GLint first, GLsizei count);
+extern void sogl_apitrace_enable(GLenum cap);
+extern void sogl_apitrace_disable(GLenum cap);
+extern void sogl_apitrace_polygon_mode(GLenum face, GLenum mode);
+
+
+/* sources defining SOGL_APITRACE_SHIM before including this header
+ * have their GL calls on sogl's VBO traced. Modules owning other
+ * buffers or programs must not, replay only recreates sogl's and
+ * the sogl_buffer ones.
+ * */
+#ifdef SOGL_APITRACE_SHIM
+#undef glClearColor
+#undef glClear
+#undef glBufferData
+#undef glBufferSubData
+#undef glDrawArrays
+#undef glEnable
+#undef glDisable
+#undef glPolygonMode
+#define glClearColor    sogl_apitrace_clear_color
+#define glClear         sogl_apitrace_clear
+#define glBufferData    sogl_apitrace_buffer_data
+#define glBufferSubData sogl_apitrace_buffer_sub_data
+#define glDrawArrays    sogl_apitrace_draw_arrays
+#define glEnable        sogl_apitrace_enable
+#define glDisable       sogl_apitrace_disable
+#define glPolygonMode   sogl_apitrace_polygon_mode
+#endif
+
+#endif
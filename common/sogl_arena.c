@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include "sogl_arena.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+#define WAIT_TIMEOUT_NS (1000000000ull)
+
+
+/* allocations past the end of the block, header then the bytes */
+struct overflow {
+	struct overflow* next;
+};
+
+_Static_assert(sizeof(struct overflow) <= SOGL_ARENA_ALIGN, "keeps the bytes aligned");
+
+struct arena {
+	uint8_t* base;
+	size_t size;
+	size_t used;
+	size_t frame_bytes;       // used plus the overflows
+	size_t high;              // most frame_bytes over the run
+	struct overflow* overflows;
+	long noverflows;
+	int frame;                // frame of the allocations in it
+	SDL_threadID thread;
+};
+
+struct deferred {
+	sogl_defer_fn fn;         // NULL deletes name
+	void* data;
+	enum sogl_res_type type;  // of name, a buffer or a texture
+	GLuint name;
+};
+
+struct deferred_list {
+	struct deferred* entries;
+	int count;
+	int capacity;
+	GLsync fence;
+};
+
+
+static struct arena* arenas[SOGL_ARENA_MAX_THREADS];
+static int narenas;
+static SDL_SpinLock arenas_lock;
+static SDL_atomic_t frame;
+static SDL_atomic_t generation;   // bumped by term so threads register again
+
+static _Thread_local struct arena* local_arena;
+static _Thread_local int local_generation;
+static _Thread_local bool local_attached;  // steps with the frames, see sogl_arena_attach
+
+// deferred frees, the current frame's then one list per fenced frame
+static struct deferred_list current;
+static struct deferred_list in_flight[SOGL_ARENA_FRAMES_IN_FLIGHT];
+static int nfenced;
+
+
+static size_t align_up(const size_t size)
+{
+	return (size + SOGL_ARENA_ALIGN - 1) & ~(size_t)(SOGL_ARENA_ALIGN - 1);
+}
+
+static struct arena* register_arena(void)
+{
+	struct arena* const a = calloc(1, sizeof(*a));
+	if (a != NULL)
+		a->base = malloc(SOGL_ARENA_SIZE);
+	if (a == NULL || a->base == NULL) {
+		fprintf(stderr, "Couldn't allocate a frame arena\n");
+		free(a);
+		return NULL;
+	}
+	a->size = SOGL_ARENA_SIZE;
+	a->frame = SDL_AtomicGet(&frame);
+	a->thread = SDL_ThreadID();
+
+	SDL_AtomicLock(&arenas_lock);
+	const bool full = narenas == SOGL_ARENA_MAX_THREADS;
+	if (!full)
+		arenas[narenas++] = a;
+	SDL_AtomicUnlock(&arenas_lock);
+
+	if (full) {
+		fprintf(stderr, "Couldn't register a frame arena, %d threads at most\n",
+		        SOGL_ARENA_MAX_THREADS);
+		free(a->base);
+		free(a);
+		return NULL;
+	}
+
+	local_arena = a;
+	local_generation = SDL_AtomicGet(&generation);
+	return a;
+}
+
+static void free_overflows(struct arena* const a)
+{
+	while (a->overflows != NULL) {
+		struct overflow* const next = a->overflows->next;
+		free(a->overflows);
+		a->overflows = next;
+	}
+}
+
+/* rewinds the arena, the first allocation of a frame does it so
+ * worker threads never need to be reached at frame end
+ * */
+static void reset(struct arena* const a, const int new_frame)
+{
+	free_overflows(a);
+
+	// grows to the high-water mark so the next frames fit in the block
+	if (a->high > a->size) {
+		size_t size = a->size;
+		while (size < a->high)
+			size *= 2;
+		uint8_t* const base = malloc(size);
+		if (base != NULL) {
+			free(a->base);
+			a->base = base;
+			a->size = size;
+		}
+	}
+
+	a->used = 0;
+	a->frame_bytes = 0;
+	a->frame = new_frame;
+}
+
+void sogl_arena_attach(void)
+{
+	local_attached = true;
+}
+
+void* sogl_arena_alloc(size_t size)
+{
+	// the rewind below would free what a thread outliving the frame still uses
+	assert(local_attached);
+	if (!local_attached) {
+		fprintf(stderr, "Couldn't allocate from the frame arena, thread %lu isn't attached\n",
+		        (unsigned long)SDL_ThreadID());
+		return NULL;
+	}
+
+	struct arena* a = local_arena;
+	if (a == NULL || local_generation != SDL_AtomicGet(&generation)) {
+		a = register_arena();
+		if (a == NULL)
+			return NULL;
+	}
+
+	const int f = SDL_AtomicGet(&frame);
+	if (a->frame != f)
+		reset(a, f);
+
+	size = align_up(size);
+	a->frame_bytes += size;
+	if (a->frame_bytes > a->high)
+		a->high = a->frame_bytes;
+
+	if (a->used + size <= a->size) {
+		void* const p = a->base + a->used;
+		a->used += size;
+		return p;
+	}
+
+	struct overflow* const o = malloc(SOGL_ARENA_ALIGN + size);
+	if (o == NULL) {
+		fprintf(stderr, "Couldn't allocate %zu bytes past the frame arena\n", size);
+		return NULL;
+	}
+	o->next = a->overflows;
+	a->overflows = o;
+	++a->noverflows;
+	return (uint8_t*)o + SOGL_ARENA_ALIGN;
+}
+
+void* sogl_arena_calloc(const size_t count, const size_t size)
+{
+	void* const p = sogl_arena_alloc(count * size);
+	if (p != NULL)
+		memset(p, 0, count * size);
+	return p;
+}
+
+
+static void run_deferred(struct deferred_list* const list)
+{
+	for (int i = 0; i < list->count; ++i) {
+		const struct deferred* const d = &list->entries[i];
+		if (d->fn != NULL)
+			d->fn(d->data);
+		else if (d->type == SOGL_RES_TEXTURE)
+			glDeleteTextures(1, &d->name);
+		else
+			glDeleteBuffers(1, &d->name);
+	}
+	list->count = 0;
+}
+
+static void add_deferred(const struct deferred* const d)
+{
+	if (current.count == current.capacity) {
+		const int capacity = current.capacity > 0 ? current.capacity * 2 : 64;
+		struct deferred* const entries = realloc(current.entries, sizeof(*entries) * capacity);
+		if (entries == NULL) {
+			// can't wait for the GPU, waits for everything instead
+			fprintf(stderr, "Couldn't defer a free, finishing the GPU work\n");
+			glFinish();
+			struct deferred_list now = { (struct deferred*)d, 1, 1, NULL };
+			run_deferred(&now);
+			return;
+		}
+		current.entries = entries;
+		current.capacity = capacity;
+	}
+	current.entries[current.count++] = *d;
+}
+
+void sogl_defer(const sogl_defer_fn fn, void* const data)
+{
+	add_deferred(&(struct deferred) { fn, data, SOGL_RES_NTYPES, 0 });
+}
+
+void sogl_defer_delete_buffer(const GLuint buffer)
+{
+	sogl_res_forget(SOGL_RES_BUFFER, buffer);
+	add_deferred(&(struct deferred) { NULL, NULL, SOGL_RES_BUFFER, buffer });
+}
+
+void sogl_defer_delete_texture(const GLuint texture)
+{
+	sogl_res_forget(SOGL_RES_TEXTURE, texture);
+	add_deferred(&(struct deferred) { NULL, NULL, SOGL_RES_TEXTURE, texture });
+}
+
+/* runs the list once its fence passed, waiting for it when asked.
+ * A wait that times out or fails falls back to glFinish, the list
+ * must not run before the GPU is done with what it deletes
+ * */
+static bool retire(struct deferred_list* const list, const bool wait)
+{
+	if (list->fence == NULL)
+		return true;
+
+	const GLenum status = glClientWaitSync(list->fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+	                                       wait ? WAIT_TIMEOUT_NS : 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+		if (!wait)
+			return false;
+		glFinish();
+	}
+
+	glDeleteSync(list->fence);
+	list->fence = NULL;
+	run_deferred(list);
+	return true;
+}
+
+void sogl_arena_end_frame(void)
+{
+	SDL_AtomicAdd(&frame, 1);
+
+	for (int i = 0; i < SOGL_ARENA_FRAMES_IN_FLIGHT; ++i)
+		retire(&in_flight[i], false);
+
+	if (current.count == 0)
+		return;
+
+	/* the lists swap their storage, so after the first frames
+	 * deferring doesn't allocate either
+	 * */
+	struct deferred_list* const slot = &in_flight[nfenced++ % SOGL_ARENA_FRAMES_IN_FLIGHT];
+	retire(slot, true);
+	const struct deferred_list fenced = {
+		current.entries, current.count, current.capacity,
+		glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)
+	};
+	current = (struct deferred_list) { slot->entries, 0, slot->capacity, NULL };
+	*slot = fenced;
+}
+
+void sogl_arena_term(void)
+{
+	// oldest first, the ring is in frame order from the next slot
+	for (int i = 0; i < SOGL_ARENA_FRAMES_IN_FLIGHT; ++i)
+		retire(&in_flight[(nfenced + i) % SOGL_ARENA_FRAMES_IN_FLIGHT], true);
+	if (current.count > 0) {
+		glFinish();
+		run_deferred(&current);
+	}
+	for (int i = 0; i < SOGL_ARENA_FRAMES_IN_FLIGHT; ++i)
+		free(in_flight[i].entries);
+	free(current.entries);
+	memset(in_flight, 0, sizeof(in_flight));
+	memset(&current, 0, sizeof(current));
+	nfenced = 0;
+
+	SDL_AtomicLock(&arenas_lock);
+	for (int i = 0; i < narenas; ++i) {
+		struct arena* const a = arenas[i];
+		if (a->high > 0) {
+			printf("FRAME ARENA THREAD %lu: HIGH WATER %zu BYTES BLOCK %zu BYTES OVERFLOWS %ld\n",
+			       (unsigned long)a->thread, a->high, a->size, a->noverflows);
+		}
+		free_overflows(a);
+		free(a->base);
+		free(a);
+	}
+	narenas = 0;
+	SDL_AtomicAdd(&generation, 1);
+	SDL_AtomicUnlock(&arenas_lock);
+
+	local_arena = NULL;
+}
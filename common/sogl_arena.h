@@ -0,0 +1,63 @@
+#ifndef SOGL_ARENA_H_
+#define SOGL_ARENA_H_
+#include <stdbool.h>
+#include <stddef.h>
+#include <GL/glew.h>
+
+#define SOGL_ARENA_SIZE             (1024l * 1024l)  // initial bytes per thread
+#define SOGL_ARENA_ALIGN            (16)             // of every allocation
+#define SOGL_ARENA_MAX_THREADS      (64)
+#define SOGL_ARENA_FRAMES_IN_FLIGHT (3)              // frames of deferred frees pending on fences
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Frame arena:
+ * every thread bumps a pointer in an arena of its own, the
+ * allocations are valid until the end of the frame, then the
+ * arenas are rewound in one go. An arena outgrowing its block
+ * falls back to malloc for the rest of the frame, and the block
+ * is grown to the high-water mark at the next reset, so after
+ * the first frames nothing reaches the heap anymore.
+ * sogl_end_frame ends the frame, sogl_term reports the marks.
+ *
+ * An arena is rewound by its thread's first allocation after the
+ * frame ended, so only threads whose allocations never outlive the
+ * frame may use one: the main thread, attached by sogl_init, and
+ * the job workers, which only run inside a parallel_for of the
+ * frame. The loader threads of sogl_texstream and sogl_vt run
+ * across frames and must use the heap. Allocating on a thread not
+ * attached asserts, or fails when asserts are compiled out.
+ * */
+extern void sogl_arena_attach(void);
+
+extern void* sogl_arena_alloc(size_t size);
+extern void* sogl_arena_calloc(size_t count, size_t size);
+
+extern void sogl_arena_end_frame(void);
+extern void sogl_arena_term(void);
+
+
+/* Deferred frees:
+ * GL objects the frames in flight may still read are released
+ * once the fence of the current frame has passed, polled at the
+ * end of every frame. Main thread only, like every GL call, and
+ * before sogl_term, which waits for the GPU and runs what's left.
+ * The resource tracker counts the deleted buffers and textures as
+ * freed right away, so an eviction stops once enough was handed
+ * over.
+ * */
+typedef void (*sogl_defer_fn)(void* data);
+
+extern void sogl_defer(sogl_defer_fn fn, void* data);
+extern void sogl_defer_delete_buffer(GLuint buffer);
+extern void sogl_defer_delete_texture(GLuint texture);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
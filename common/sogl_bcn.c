@@ -0,0 +1,760 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <GL/glew.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "sogl_jobs.h"
+#include "sogl_bcn.h"
+
+#define REFINE_PASSES (2)  // least squares endpoint refits per block
+#define ROWS_PER_JOB  (2)  // block rows per job batch
+
+
+/* a block is kept as 16 pixels per channel so the index
+ * search can take 4 pixels per SSE2 register
+ * */
+struct block {
+	float px[4][16];
+};
+
+
+static void load_block(const unsigned char* const rgba,
+                       const int width, const int height,
+                       const int bx, const int by,
+                       struct block* const blk)
+{
+	for (int y = 0; y < 4; ++y) {
+		const int sy = by * 4 + y < height ? by * 4 + y : height - 1;
+		for (int x = 0; x < 4; ++x) {
+			const int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+			const unsigned char* const p = &rgba[((long)sy * width + sx) * 4];
+			for (int c = 0; c < 4; ++c)
+				blk->px[c][y * 4 + x] = p[c];
+		}
+	}
+}
+
+static void store_block(const unsigned char pixels[16][4],
+                        const int width, const int height,
+                        const int bx, const int by,
+                        unsigned char* const rgba)
+{
+	for (int y = 0; y < 4 && by * 4 + y < height; ++y) {
+		for (int x = 0; x < 4 && bx * 4 + x < width; ++x) {
+			unsigned char* const p = &rgba[((long)(by * 4 + y) * width + bx * 4 + x) * 4];
+			memcpy(p, pixels[y * 4 + x], 4);
+		}
+	}
+}
+
+
+/*
+ * Endpoint fitting
+ * */
+
+// principal axis of the first nch channels, by power iteration on the covariance
+static void principal_axis(const struct block* const blk, const int nch,
+                           float mean[4], float axis[4])
+{
+	float cov[4][4] = { { 0 } };
+	float lo[4], hi[4];
+
+	for (int c = 0; c < nch; ++c) {
+		mean[c] = 0.0f;
+		lo[c] = FLT_MAX;
+		hi[c] = -FLT_MAX;
+		for (int i = 0; i < 16; ++i) {
+			mean[c] += blk->px[c][i];
+			lo[c] = fminf(lo[c], blk->px[c][i]);
+			hi[c] = fmaxf(hi[c], blk->px[c][i]);
+		}
+		mean[c] /= 16.0f;
+	}
+
+	for (int i = 0; i < 16; ++i) {
+		for (int a = 0; a < nch; ++a) {
+			for (int b = a; b < nch; ++b)
+				cov[a][b] += (blk->px[a][i] - mean[a]) * (blk->px[b][i] - mean[b]);
+		}
+	}
+	for (int a = 0; a < nch; ++a) {
+		for (int b = 0; b < a; ++b)
+			cov[a][b] = cov[b][a];
+	}
+
+	// the bounding box diagonal is a good first guess
+	for (int c = 0; c < nch; ++c)
+		axis[c] = hi[c] - lo[c];
+
+	for (int iter = 0; iter < 6; ++iter) {
+		float next[4] = { 0, 0, 0, 0 };
+		float len = 0.0f;
+		for (int a = 0; a < nch; ++a) {
+			for (int b = 0; b < nch; ++b)
+				next[a] += cov[a][b] * axis[b];
+			len = fmaxf(len, fabsf(next[a]));
+		}
+		if (len < 1e-6f)
+			break;
+		for (int c = 0; c < nch; ++c)
+			axis[c] = next[c] / len;
+	}
+
+	float len = 0.0f;
+	for (int c = 0; c < nch; ++c)
+		len += axis[c] * axis[c];
+	len = sqrtf(len);
+	for (int c = 0; c < nch; ++c)
+		axis[c] = len > 1e-6f ? axis[c] / len : 0.0f;
+}
+
+// endpoints at the extents of the block along the axis, inset a little
+static void axis_endpoints(const struct block* const blk, const int nch,
+                           float e0[4], float e1[4])
+{
+	float mean[4], axis[4];
+	principal_axis(blk, nch, mean, axis);
+
+	float tmin = FLT_MAX, tmax = -FLT_MAX;
+	for (int i = 0; i < 16; ++i) {
+		float t = 0.0f;
+		for (int c = 0; c < nch; ++c)
+			t += (blk->px[c][i] - mean[c]) * axis[c];
+		tmin = fminf(tmin, t);
+		tmax = fmaxf(tmax, t);
+	}
+
+	const float inset = (tmax - tmin) / 32.0f;
+	tmin += inset;
+	tmax -= inset;
+
+	for (int c = 0; c < nch; ++c) {
+		e0[c] = mean[c] + axis[c] * tmax;
+		e1[c] = mean[c] + axis[c] * tmin;
+	}
+}
+
+/* least squares endpoints for fixed indices, weights[i] is how far
+ * palette entry i lies from e0 to e1. false if the system is singular
+ * */
+static bool refit_endpoints(const struct block* const blk, const int nch,
+                            const int idx[16], const float* const weights,
+                            float e0[4], float e1[4])
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float xa[4] = { 0, 0, 0, 0 }, xb[4] = { 0, 0, 0, 0 };
+
+	for (int i = 0; i < 16; ++i) {
+		const float w = weights[idx[i]];
+		const float a = 1.0f - w;
+		aa += a * a;
+		ab += a * w;
+		bb += w * w;
+		for (int c = 0; c < nch; ++c) {
+			xa[c] += a * blk->px[c][i];
+			xb[c] += w * blk->px[c][i];
+		}
+	}
+
+	const float det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-6f)
+		return false;
+
+	for (int c = 0; c < nch; ++c) {
+		e0[c] = (bb * xa[c] - ab * xb[c]) / det;
+		e1[c] = (aa * xb[c] - ab * xa[c]) / det;
+	}
+
+	return true;
+}
+
+/* nearest palette entry for every pixel over the first nch channels,
+ * returns the total squared error
+ * */
+static float select_indices(const struct block* const blk, const int nch,
+                            const float pal[][4], const int npal,
+                            int idx[16])
+{
+	float err = 0.0f;
+
+#ifdef __SSE2__
+	for (int i = 0; i < 16; i += 4) {
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i best_idx = _mm_setzero_si128();
+
+		for (int p = 0; p < npal; ++p) {
+			__m128 dist = _mm_setzero_ps();
+			for (int c = 0; c < nch; ++c) {
+				const __m128 d = _mm_sub_ps(_mm_loadu_ps(&blk->px[c][i]),
+				                            _mm_set1_ps(pal[p][c]));
+				dist = _mm_add_ps(dist, _mm_mul_ps(d, d));
+			}
+
+			const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(dist, best));
+			best = _mm_min_ps(dist, best);
+			best_idx = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)),
+			                        _mm_andnot_si128(closer, best_idx));
+		}
+
+		_mm_storeu_si128((__m128i*)&idx[i], best_idx);
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, best);
+		err += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+#else
+	for (int i = 0; i < 16; ++i) {
+		float best = FLT_MAX;
+		for (int p = 0; p < npal; ++p) {
+			float dist = 0.0f;
+			for (int c = 0; c < nch; ++c) {
+				const float d = blk->px[c][i] - pal[p][c];
+				dist += d * d;
+			}
+			if (dist < best) {
+				best = dist;
+				idx[i] = p;
+			}
+		}
+		err += best;
+	}
+#endif
+
+	return err;
+}
+
+
+/*
+ * BC1 color block, always in 4 color mode
+ * */
+static const float bc1_weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+static uint16_t pack_565(const float c[4])
+{
+	const int r = (int)lrintf(fminf(fmaxf(c[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+	const int g = (int)lrintf(fminf(fmaxf(c[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+	const int b = (int)lrintf(fminf(fmaxf(c[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(const uint16_t c, int rgb[3])
+{
+	const int r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// palette exactly as the decoder rebuilds it
+static int bc1_palette(const uint16_t c0, const uint16_t c1, int pal[4][3])
+{
+	unpack_565(c0, pal[0]);
+	unpack_565(c1, pal[1]);
+
+	if (c0 > c1) {
+		for (int c = 0; c < 3; ++c) {
+			pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+			pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+		}
+		return 4;
+	}
+
+	for (int c = 0; c < 3; ++c) {
+		pal[2][c] = (pal[0][c] + pal[1][c]) / 2;
+		pal[3][c] = 0;
+	}
+	return 3;
+}
+
+static float bc1_try(const struct block* const blk,
+                     const float e0[4], const float e1[4],
+                     uint16_t* const c0, uint16_t* const c1, int idx[16])
+{
+	*c0 = pack_565(e0);
+	*c1 = pack_565(e1);
+	if (*c0 < *c1) {
+		const uint16_t tmp = *c0;
+		*c0 = *c1;
+		*c1 = tmp;
+	}
+
+	int ipal[4][3];
+	float pal[4][4];
+	// equal endpoints collapse to a single color at index 0
+	const int npal = *c0 == *c1 ? 1 : bc1_palette(*c0, *c1, ipal);
+	if (npal == 1)
+		unpack_565(*c0, ipal[0]);
+
+	for (int p = 0; p < npal; ++p) {
+		for (int c = 0; c < 3; ++c)
+			pal[p][c] = ipal[p][c];
+	}
+
+	return select_indices(blk, 3, pal, npal, idx);
+}
+
+static void encode_bc1_block(const struct block* const blk, unsigned char* const out)
+{
+	float e0[4], e1[4];
+	axis_endpoints(blk, 3, e0, e1);
+
+	uint16_t c0, c1;
+	int idx[16];
+	float err = bc1_try(blk, e0, e1, &c0, &c1, idx);
+
+	for (int pass = 0; pass < REFINE_PASSES && err > 0.0f && c0 != c1; ++pass) {
+		uint16_t n0, n1;
+		int nidx[16];
+		float f0[4], f1[4];
+
+		// refit against the decoded endpoint order
+		if (!refit_endpoints(blk, 3, idx, bc1_weights, f0, f1))
+			break;
+
+		const float nerr = bc1_try(blk, f0, f1, &n0, &n1, nidx);
+		if (nerr >= err)
+			break;
+
+		err = nerr;
+		c0 = n0;
+		c1 = n1;
+		memcpy(idx, nidx, sizeof(idx));
+	}
+
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; ++i)
+		bits |= (uint32_t)idx[i] << (i * 2);
+
+	out[0] = c0 & 0xFF;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 0xFF;
+	out[3] = c1 >> 8;
+	out[4] = bits & 0xFF;
+	out[5] = (bits >> 8) & 0xFF;
+	out[6] = (bits >> 16) & 0xFF;
+	out[7] = bits >> 24;
+}
+
+static void decode_bc1_block(const unsigned char* const in, unsigned char pixels[16][4])
+{
+	const uint16_t c0 = in[0] | (in[1] << 8);
+	const uint16_t c1 = in[2] | (in[3] << 8);
+	const uint32_t bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+
+	int pal[4][3];
+	const int npal = bc1_palette(c0, c1, pal);
+
+	for (int i = 0; i < 16; ++i) {
+		const int p = (bits >> (i * 2)) & 3;
+		for (int c = 0; c < 3; ++c)
+			pixels[i][c] = pal[p][c];
+		pixels[i][3] = npal == 3 && p == 3 ? 0 : 255;
+	}
+}
+
+
+/*
+ * BC3 alpha block, in 8 alpha mode
+ * */
+static void alpha_palette(const int a0, const int a1, int pal[8])
+{
+	pal[0] = a0;
+	pal[1] = a1;
+	if (a0 > a1) {
+		for (int i = 1; i < 7; ++i)
+			pal[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+	} else {
+		for (int i = 1; i < 5; ++i)
+			pal[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+		pal[6] = 0;
+		pal[7] = 255;
+	}
+}
+
+static void encode_alpha_block(const struct block* const blk, unsigned char* const out)
+{
+	int a0 = 0, a1 = 255;
+	for (int i = 0; i < 16; ++i) {
+		const int a = (int)blk->px[3][i];
+		a0 = a > a0 ? a : a0;
+		a1 = a < a1 ? a : a1;
+	}
+
+	int pal[8];
+	alpha_palette(a0, a1, pal);
+
+	uint64_t bits = 0;
+	for (int i = 0; a0 != a1 && i < 16; ++i) {
+		const int a = (int)blk->px[3][i];
+		int best = 0, best_dist = 256;
+		for (int p = 0; p < 8; ++p) {
+			const int dist = abs(a - pal[p]);
+			if (dist < best_dist) {
+				best_dist = dist;
+				best = p;
+			}
+		}
+		bits |= (uint64_t)best << (i * 3);
+	}
+
+	out[0] = a0;
+	out[1] = a1;
+	for (int i = 0; i < 6; ++i)
+		out[2 + i] = (bits >> (i * 8)) & 0xFF;
+}
+
+static void decode_alpha_block(const unsigned char* const in, unsigned char pixels[16][4])
+{
+	int pal[8];
+	alpha_palette(in[0], in[1], pal);
+
+	uint64_t bits = 0;
+	for (int i = 0; i < 6; ++i)
+		bits |= (uint64_t)in[2 + i] << (i * 8);
+
+	for (int i = 0; i < 16; ++i)
+		pixels[i][3] = pal[(bits >> (i * 3)) & 7];
+}
+
+static void encode_bc3_block(const struct block* const blk, unsigned char* const out)
+{
+	encode_alpha_block(blk, out);
+	encode_bc1_block(blk, out + 8);
+}
+
+static void decode_bc3_block(const unsigned char* const in, unsigned char pixels[16][4])
+{
+	// the color half of BC3 is always read in 4 color mode
+	const uint16_t c0 = in[8] | (in[9] << 8);
+	const uint16_t c1 = in[10] | (in[11] << 8);
+	const uint32_t bits = in[12] | (in[13] << 8) | (in[14] << 16) | ((uint32_t)in[15] << 24);
+
+	int pal[4][3];
+	unpack_565(c0, pal[0]);
+	unpack_565(c1, pal[1]);
+	for (int c = 0; c < 3; ++c) {
+		pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+		pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+	}
+
+	for (int i = 0; i < 16; ++i) {
+		const int p = (bits >> (i * 2)) & 3;
+		for (int c = 0; c < 3; ++c)
+			pixels[i][c] = pal[p][c];
+	}
+
+	decode_alpha_block(in, pixels);
+}
+
+
+/*
+ * BC7 mode 6: one subset, RGBA 7 bit endpoints plus a p-bit each,
+ * 4 bit indices. The best of the 4 p-bit pairs is kept
+ * */
+static const int bc7_weights4[16] = {
+	0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+};
+
+struct bc7_endpoints {
+	int q[2][4];    // 7 bit endpoint channels
+	int p[2];       // p-bits
+};
+
+static void bc7_palette(const struct bc7_endpoints* const ep, int pal[16][4])
+{
+	for (int c = 0; c < 4; ++c) {
+		const int a = (ep->q[0][c] << 1) | ep->p[0];
+		const int b = (ep->q[1][c] << 1) | ep->p[1];
+		for (int i = 0; i < 16; ++i)
+			pal[i][c] = ((64 - bc7_weights4[i]) * a + bc7_weights4[i] * b + 32) >> 6;
+	}
+}
+
+static float bc7_try(const struct block* const blk,
+                     const float e0[4], const float e1[4],
+                     struct bc7_endpoints* const best, int idx[16])
+{
+	float best_err = FLT_MAX;
+
+	for (int pbits = 0; pbits < 4; ++pbits) {
+		struct bc7_endpoints ep;
+		ep.p[0] = pbits & 1;
+		ep.p[1] = pbits >> 1;
+
+		for (int c = 0; c < 4; ++c) {
+			const int q0 = (int)lrintf((fminf(fmaxf(e0[c], 0.0f), 255.0f) - ep.p[0]) / 2.0f);
+			const int q1 = (int)lrintf((fminf(fmaxf(e1[c], 0.0f), 255.0f) - ep.p[1]) / 2.0f);
+			ep.q[0][c] = q0 < 0 ? 0 : q0 > 127 ? 127 : q0;
+			ep.q[1][c] = q1 < 0 ? 0 : q1 > 127 ? 127 : q1;
+		}
+
+		int ipal[16][4];
+		float pal[16][4];
+		bc7_palette(&ep, ipal);
+		for (int i = 0; i < 16; ++i) {
+			for (int c = 0; c < 4; ++c)
+				pal[i][c] = ipal[i][c];
+		}
+
+		int tidx[16];
+		const float err = select_indices(blk, 4, pal, 16, tidx);
+		if (err < best_err) {
+			best_err = err;
+			*best = ep;
+			memcpy(idx, tidx, sizeof(tidx));
+		}
+	}
+
+	return best_err;
+}
+
+static void put_bits(unsigned char* const out, int* const pos, const uint32_t value, const int n)
+{
+	for (int i = 0; i < n; ++i, ++*pos) {
+		if ((value >> i) & 1)
+			out[*pos >> 3] |= 1 << (*pos & 7);
+	}
+}
+
+static uint32_t get_bits(const unsigned char* const in, int* const pos, const int n)
+{
+	uint32_t value = 0;
+	for (int i = 0; i < n; ++i, ++*pos)
+		value |= (uint32_t)((in[*pos >> 3] >> (*pos & 7)) & 1) << i;
+	return value;
+}
+
+static void encode_bc7_block(const struct block* const blk, unsigned char* const out)
+{
+	float weights[16];
+	for (int i = 0; i < 16; ++i)
+		weights[i] = bc7_weights4[i] / 64.0f;
+
+	float e0[4], e1[4];
+	axis_endpoints(blk, 4, e0, e1);
+
+	struct bc7_endpoints ep;
+	int idx[16];
+	float err = bc7_try(blk, e0, e1, &ep, idx);
+
+	for (int pass = 0; pass < REFINE_PASSES && err > 0.0f; ++pass) {
+		struct bc7_endpoints nep;
+		int nidx[16];
+		float f0[4], f1[4];
+
+		if (!refit_endpoints(blk, 4, idx, weights, f0, f1))
+			break;
+
+		const float nerr = bc7_try(blk, f0, f1, &nep, nidx);
+		if (nerr >= err)
+			break;
+
+		err = nerr;
+		ep = nep;
+		memcpy(idx, nidx, sizeof(idx));
+	}
+
+	// the anchor index stores 3 bits, its top bit must be clear
+	if (idx[0] & 8) {
+		for (int c = 0; c < 4; ++c) {
+			const int tmp = ep.q[0][c];
+			ep.q[0][c] = ep.q[1][c];
+			ep.q[1][c] = tmp;
+		}
+		const int tmp = ep.p[0];
+		ep.p[0] = ep.p[1];
+		ep.p[1] = tmp;
+		for (int i = 0; i < 16; ++i)
+			idx[i] = 15 - idx[i];
+	}
+
+	memset(out, 0, 16);
+	int pos = 0;
+	put_bits(out, &pos, 1 << 6, 7);
+	for (int c = 0; c < 4; ++c) {
+		put_bits(out, &pos, ep.q[0][c], 7);
+		put_bits(out, &pos, ep.q[1][c], 7);
+	}
+	put_bits(out, &pos, ep.p[0], 1);
+	put_bits(out, &pos, ep.p[1], 1);
+	put_bits(out, &pos, idx[0], 3);
+	for (int i = 1; i < 16; ++i)
+		put_bits(out, &pos, idx[i], 4);
+}
+
+static void decode_bc7_block(const unsigned char* const in, unsigned char pixels[16][4])
+{
+	if ((in[0] & 0x7F) != 0x40) {
+		memset(pixels, 0, 16 * 4);
+		return;
+	}
+
+	struct bc7_endpoints ep;
+	int pos = 7;
+	for (int c = 0; c < 4; ++c) {
+		ep.q[0][c] = get_bits(in, &pos, 7);
+		ep.q[1][c] = get_bits(in, &pos, 7);
+	}
+	ep.p[0] = get_bits(in, &pos, 1);
+	ep.p[1] = get_bits(in, &pos, 1);
+
+	int pal[16][4];
+	bc7_palette(&ep, pal);
+
+	for (int i = 0; i < 16; ++i) {
+		const int p = get_bits(in, &pos, i == 0 ? 3 : 4);
+		for (int c = 0; c < 4; ++c)
+			pixels[i][c] = pal[p][c];
+	}
+}
+
+
+/*
+ * Images
+ * */
+struct encode_job {
+	GLenum format;
+	const unsigned char* rgba;
+	int width, height;
+	int block_bytes;
+	unsigned char* dst;
+};
+
+static void encode_rows(void* const data, const int begin, const int end)
+{
+	const struct encode_job* const job = data;
+	const int bw = (job->width + 3) / 4;
+
+	for (int by = begin; by < end; ++by) {
+		for (int bx = 0; bx < bw; ++bx) {
+			unsigned char* const out = job->dst + ((long)by * bw + bx) * job->block_bytes;
+			struct block blk;
+			load_block(job->rgba, job->width, job->height, bx, by, &blk);
+
+			switch (job->format) {
+			case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: encode_bc1_block(&blk, out); break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: encode_bc3_block(&blk, out); break;
+			case GL_COMPRESSED_RGBA_BPTC_UNORM: encode_bc7_block(&blk, out); break;
+			}
+		}
+	}
+}
+
+int sogl_bcn_block_bytes(const GLenum format)
+{
+	switch (format) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return 8;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return 16;
+	case GL_COMPRESSED_RGBA_BPTC_UNORM: return 16;
+	}
+	return 0;
+}
+
+long sogl_bcn_size(const GLenum format, const int width, const int height)
+{
+	const int block_bytes = sogl_bcn_block_bytes(format);
+	if (block_bytes == 0)
+		return (long)width * height * 4;
+	return (long)((width + 3) / 4) * ((height + 3) / 4) * block_bytes;
+}
+
+void sogl_bcn_encode(const GLenum format,
+                     const unsigned char* const rgba,
+                     const int width, const int height,
+                     void* const dst)
+{
+	struct encode_job job = {
+		.format = format,
+		.rgba = rgba,
+		.width = width,
+		.height = height,
+		.block_bytes = sogl_bcn_block_bytes(format),
+		.dst = dst
+	};
+
+	if (job.block_bytes == 0) {
+		memcpy(dst, rgba, (long)width * height * 4);
+		return;
+	}
+
+	sogl_jobs_parallel_for(encode_rows, &job, (height + 3) / 4, ROWS_PER_JOB);
+}
+
+void sogl_bcn_decode(const GLenum format,
+                     const void* const src,
+                     const int width, const int height,
+                     unsigned char* const rgba)
+{
+	const int block_bytes = sogl_bcn_block_bytes(format);
+	if (block_bytes == 0) {
+		memcpy(rgba, src, (long)width * height * 4);
+		return;
+	}
+
+	const int bw = (width + 3) / 4, bh = (height + 3) / 4;
+	const unsigned char* in = src;
+
+	for (int by = 0; by < bh; ++by) {
+		for (int bx = 0; bx < bw; ++bx, in += block_bytes) {
+			unsigned char pixels[16][4];
+
+			switch (format) {
+			case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: decode_bc1_block(in, pixels); break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: decode_bc3_block(in, pixels); break;
+			case GL_COMPRESSED_RGBA_BPTC_UNORM: decode_bc7_block(in, pixels); break;
+			}
+
+			store_block(pixels, width, height, bx, by, rgba);
+		}
+	}
+}
+
+double sogl_bcn_psnr(const unsigned char* const a,
+                     const unsigned char* const b,
+                     const int width, const int height,
+                     const int channels)
+{
+	double sse = 0.0;
+	for (long i = 0; i < (long)width * height; ++i) {
+		for (int c = 0; c < channels; ++c) {
+			const double d = (double)a[i * 4 + c] - b[i * 4 + c];
+			sse += d * d;
+		}
+	}
+
+	if (sse == 0.0)
+		return INFINITY;
+
+	const double mse = sse / ((double)width * height * channels);
+	return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+bool sogl_bcn_supported(const GLenum format)
+{
+	switch (format) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return GLEW_EXT_texture_compression_s3tc;
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		return GLEW_ARB_texture_compression_bptc || GLEW_VERSION_4_2;
+	case GL_RGBA8:
+		return true;
+	}
+	return false;
+}
+
+const char* sogl_bcn_name(const GLenum format)
+{
+	switch (format) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return "BC1";
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return "BC3";
+	case GL_COMPRESSED_RGBA_BPTC_UNORM: return "BC7";
+	case GL_RGBA8: return "RGBA8";
+	}
+	return "UNKNOWN";
+}
@@ -0,0 +1,46 @@
+#ifndef SOGL_BCN_H_
+#define SOGL_BCN_H_
+#include <stdbool.h>
+#include <GL/glew.h>
+
+
+/* Block compression encoders:
+ * BC1 (GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8 bytes per 4x4 block, opaque),
+ * BC3 (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16 bytes per block) and
+ * BC7 (GL_COMPRESSED_RGBA_BPTC_UNORM, 16 bytes per block, mode 6 only).
+ * Endpoints are fit along the principal axis of each block and refined
+ * by least squares, the index search runs 4 pixels at a time with SSE2.
+ * Images are split in block rows over sogl_jobs.
+ * Blocks are laid out row by row in memory order, partial blocks on
+ * the right and top edges are padded by repeating the edge pixels.
+ * */
+
+/* bytes per block, 0 when format isn't a block compressed format */
+extern int sogl_bcn_block_bytes(GLenum format);
+
+/* bytes of a width x height image in format, RGBA8 when uncompressed */
+extern long sogl_bcn_size(GLenum format, int width, int height);
+
+extern void sogl_bcn_encode(GLenum format,
+                            const unsigned char* rgba,
+                            int width, int height,
+                            void* dst);
+
+/* decodes to RGBA8, BC7 blocks of other modes than 6 decode as black */
+extern void sogl_bcn_decode(GLenum format,
+                            const void* src,
+                            int width, int height,
+                            unsigned char* rgba);
+
+/* PSNR in dB over the first channels of two RGBA8 images */
+extern double sogl_bcn_psnr(const unsigned char* a,
+                            const unsigned char* b,
+                            int width, int height,
+                            int channels);
+
+/* whether the current context can sample format, GL thread only */
+extern bool sogl_bcn_supported(GLenum format);
+
+extern const char* sogl_bcn_name(GLenum format);
+
+#endif
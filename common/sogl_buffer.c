@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sogl.h"
+#include "sogl_buffer.h"
+#include "sogl_apitrace.h"
+#include "sogl_arena.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+
+bool sogl_buffer_init(struct sogl_buffer* const buf, const GLenum target,
+                      const GLsizeiptr size, const GLenum usage)
+{
+	memset(buf, 0, sizeof(*buf));
+	buf->target = target;
+	buf->size = size;
+	buf->npages = (size + SOGL_BUFFER_PAGE_SIZE - 1) / SOGL_BUFFER_PAGE_SIZE;
+	buf->first_page = buf->npages;
+	buf->last_page = -1;
+
+	buf->shadow = calloc(size, 1);
+	buf->dirty = calloc((buf->npages + 63) / 64, sizeof(uint64_t));
+	if (buf->shadow == NULL || buf->dirty == NULL) {
+		fprintf(stderr, "Couldn't allocate the shadow of a %ld bytes buffer\n", (long)size);
+		sogl_buffer_free(buf);
+		return false;
+	}
+
+	glGenBuffers(1, &buf->id);
+	glBindBuffer(target, buf->id);
+	glBufferData(target, size, NULL, usage);
+	sogl_apitrace_record_shadow_create(buf->id, target, size, usage);
+	return true;
+}
+
+void sogl_buffer_free(struct sogl_buffer* const buf)
+{
+	if (buf->id != 0) {
+		sogl_apitrace_record_shadow_delete(buf->id);
+		// the frames in flight may still read it
+		sogl_defer_delete_buffer(buf->id);
+	}
+	free(buf->dirty);
+	free(buf->shadow);
+	memset(buf, 0, sizeof(*buf));
+}
+
+
+static void mark_pages(struct sogl_buffer* const buf, const long first, const long last)
+{
+	const long first_word = first / 64, last_word = last / 64;
+	const uint64_t first_mask = ~0ull << (first % 64);
+	const uint64_t last_mask = ~0ull >> (63 - last % 64);
+
+	if (first_word == last_word) {
+		buf->dirty[first_word] |= first_mask & last_mask;
+	} else {
+		buf->dirty[first_word] |= first_mask;
+		for (long w = first_word + 1; w < last_word; ++w)
+			buf->dirty[w] = ~0ull;
+		buf->dirty[last_word] |= last_mask;
+	}
+
+	if (first < buf->first_page)
+		buf->first_page = first;
+	if (last > buf->last_page)
+		buf->last_page = last;
+}
+
+void* sogl_buffer_modify(struct sogl_buffer* const buf, const GLintptr offset,
+                         const GLsizeiptr size)
+{
+	if (size > 0) {
+		mark_pages(buf, offset / SOGL_BUFFER_PAGE_SIZE,
+		           (offset + size - 1) / SOGL_BUFFER_PAGE_SIZE);
+	}
+	return buf->shadow + offset;
+}
+
+void sogl_buffer_write(struct sogl_buffer* const buf, const GLintptr offset,
+                       const void* const data, const GLsizeiptr size)
+{
+	memcpy(sogl_buffer_modify(buf, offset, size), data, size);
+}
+
+
+static bool page_dirty(const struct sogl_buffer* const buf, const long page)
+{
+	return (buf->dirty[page / 64] >> (page % 64)) & 1;
+}
+
+static void upload(struct sogl_buffer* const buf, const long first, const long end)
+{
+	const GLintptr offset = (GLintptr)first * SOGL_BUFFER_PAGE_SIZE;
+	GLsizeiptr size = (GLsizeiptr)(end - first) * SOGL_BUFFER_PAGE_SIZE;
+	if (offset + size > buf->size)
+		size = buf->size - offset;
+
+	if (sogl_dsa())
+		glNamedBufferSubData(buf->id, offset, size, buf->shadow + offset);
+	else
+		glBufferSubData(buf->target, offset, size, buf->shadow + offset);
+	sogl_apitrace_record_shadow_range(buf->id, offset, size, buf->shadow + offset);
+	buf->uploaded += size;
+	++buf->ranges;
+}
+
+GLsizeiptr sogl_buffer_flush(struct sogl_buffer* const buf)
+{
+	if (!sogl_dsa())
+		glBindBuffer(buf->target, buf->id);
+	sogl_apitrace_record_shadow_flush(buf->id);
+	buf->uploaded = 0;
+	buf->ranges = 0;
+	if (buf->first_page > buf->last_page)
+		return 0;
+
+	/* walks the dirty bounds, a run ends once more than
+	 * SOGL_BUFFER_MERGE_GAP clean pages follow it
+	 * */
+	long run_first = -1, run_end = -1;
+	for (long p = buf->first_page; p <= buf->last_page; ++p) {
+		// whole clean words are skipped at once
+		if (p % 64 == 0 && buf->dirty[p / 64] == 0) {
+			p += 63;
+			continue;
+		}
+		if (!page_dirty(buf, p))
+			continue;
+
+		if (run_first >= 0 && p - run_end > SOGL_BUFFER_MERGE_GAP) {
+			upload(buf, run_first, run_end);
+			run_first = -1;
+		}
+		if (run_first < 0)
+			run_first = p;
+		run_end = p + 1;
+	}
+	if (run_first >= 0)
+		upload(buf, run_first, run_end);
+
+	memset(&buf->dirty[buf->first_page / 64], 0,
+	       sizeof(uint64_t) * (buf->last_page / 64 - buf->first_page / 64 + 1));
+	buf->first_page = buf->npages;
+	buf->last_page = -1;
+	return buf->uploaded;
+}
@@ -0,0 +1,48 @@
+#ifndef SOGL_BUFFER_H_
+#define SOGL_BUFFER_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <GL/glew.h>
+
+#define SOGL_BUFFER_PAGE_SIZE (4096)  // bytes tracked by one dirty bit
+#define SOGL_BUFFER_MERGE_GAP (2)     // clean pages between two dirty runs still sent as one
+
+
+/* GL buffer with a CPU shadow:
+ * writes go to the shadow and mark the pages they touch, a flush
+ * coalesces the dirty pages into ranges and uploads only those,
+ * so a mostly static buffer costs what changed in it. Runs closer
+ * than SOGL_BUFFER_MERGE_GAP clean pages are merged, a few more
+ * bytes being cheaper than another glBufferSubData.
+ * */
+struct sogl_buffer {
+	GLuint id;
+	GLenum target;
+	uint8_t* shadow;
+	GLsizeiptr size;
+	uint64_t* dirty;         // a bit per page
+	long npages;
+	long first_page;         // bounds of the dirty pages, first > last when clean
+	long last_page;
+	GLsizeiptr uploaded;     // bytes sent by the last flush
+	int ranges;              // glBufferSubData calls of the last flush
+};
+
+
+/* creates the GL buffer with size bytes of storage, left bound to target */
+extern bool sogl_buffer_init(struct sogl_buffer* buf, GLenum target,
+                             GLsizeiptr size, GLenum usage);
+extern void sogl_buffer_free(struct sogl_buffer* buf);
+
+/* marks [offset, offset + size) and returns the shadow there to write it */
+extern void* sogl_buffer_modify(struct sogl_buffer* buf, GLintptr offset, GLsizeiptr size);
+
+extern void sogl_buffer_write(struct sogl_buffer* buf, GLintptr offset,
+                              const void* data, GLsizeiptr size);
+
+/* uploads the dirty ranges, by name with DSA, else through the
+ * target it's left bound to. returns the bytes sent
+ * */
+extern GLsizeiptr sogl_buffer_flush(struct sogl_buffer* buf);
+
+#endif
@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "sogl_bvh.h"
+
+enum {
+	OUTSIDE,
+	INTERSECTING,
+	INSIDE
+};
+
+struct bin {
+	struct sogl_aabb box;
+	int count;
+};
+
+
+static const struct sogl_aabb empty_box = {
+	{ FLT_MAX, FLT_MAX, FLT_MAX },
+	{ -FLT_MAX, -FLT_MAX, -FLT_MAX }
+};
+
+static void grow(struct sogl_aabb* const box, const struct sogl_aabb* const other)
+{
+	box->min.x = fminf(box->min.x, other->min.x);
+	box->min.y = fminf(box->min.y, other->min.y);
+	box->min.z = fminf(box->min.z, other->min.z);
+	box->max.x = fmaxf(box->max.x, other->max.x);
+	box->max.y = fmaxf(box->max.y, other->max.y);
+	box->max.z = fmaxf(box->max.z, other->max.z);
+}
+
+static float half_area(const struct sogl_aabb* const box)
+{
+	const float dx = box->max.x - box->min.x;
+	const float dy = box->max.y - box->min.y;
+	const float dz = box->max.z - box->min.z;
+	if (dx < 0.0f)
+		return 0.0f;
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static float centroid(const struct sogl_aabb* const box, const int axis)
+{
+	switch (axis) {
+	case 0: return (box->min.x + box->max.x) * 0.5f;
+	case 1: return (box->min.y + box->max.y) * 0.5f;
+	}
+	return (box->min.z + box->max.z) * 0.5f;
+}
+
+
+/*
+ * Build
+ * */
+
+/* splits node along the best of SOGL_BVH_BINS buckets of its
+ * centroid bounds, returns the number of objects on the left
+ * or 0 if the node should stay a leaf
+ * */
+static int split_node(const struct sogl_aabb* const boxes, int* const objects,
+                      const struct sogl_bvh_node* const node)
+{
+	struct sogl_aabb cbounds = empty_box;
+	for (int i = node->first; i < node->first + node->count; ++i) {
+		const struct sogl_aabb* const b = &boxes[objects[i]];
+		const struct sogl_aabb c = {
+			{ centroid(b, 0), centroid(b, 1), centroid(b, 2) },
+			{ centroid(b, 0), centroid(b, 1), centroid(b, 2) }
+		};
+		grow(&cbounds, &c);
+	}
+
+	const float ext[3] = {
+		cbounds.max.x - cbounds.min.x,
+		cbounds.max.y - cbounds.min.y,
+		cbounds.max.z - cbounds.min.z
+	};
+	const float cmin[3] = { cbounds.min.x, cbounds.min.y, cbounds.min.z };
+	const int axis = ext[0] > ext[1] && ext[0] > ext[2] ? 0 : ext[1] > ext[2] ? 1 : 2;
+
+	// every centroid at the same spot, no split can separate them
+	if (ext[axis] <= 0.0f)
+		return 0;
+
+	struct bin bins[SOGL_BVH_BINS];
+	for (int b = 0; b < SOGL_BVH_BINS; ++b) {
+		bins[b].box = empty_box;
+		bins[b].count = 0;
+	}
+
+	const float scale = SOGL_BVH_BINS / ext[axis];
+	for (int i = node->first; i < node->first + node->count; ++i) {
+		const struct sogl_aabb* const box = &boxes[objects[i]];
+		int b = (int)((centroid(box, axis) - cmin[axis]) * scale);
+		b = b < SOGL_BVH_BINS ? b : SOGL_BVH_BINS - 1;
+		grow(&bins[b].box, box);
+		++bins[b].count;
+	}
+
+	// sweep from the right, then from the left evaluating each split plane
+	float right_cost[SOGL_BVH_BINS];
+	struct sogl_aabb acc = empty_box;
+	int acc_count = 0;
+	for (int b = SOGL_BVH_BINS - 1; b > 0; --b) {
+		grow(&acc, &bins[b].box);
+		acc_count += bins[b].count;
+		right_cost[b] = acc_count * half_area(&acc);
+	}
+
+	float best_cost = FLT_MAX;
+	int best_bin = -1;
+	acc = empty_box;
+	acc_count = 0;
+	for (int b = 0; b < SOGL_BVH_BINS - 1; ++b) {
+		grow(&acc, &bins[b].box);
+		acc_count += bins[b].count;
+		const float cost = acc_count * half_area(&acc) + right_cost[b + 1];
+		if (acc_count > 0 && acc_count < node->count && cost < best_cost) {
+			best_cost = cost;
+			best_bin = b;
+		}
+	}
+
+	if (best_bin < 0)
+		return 0;
+
+	// partition the objects around the chosen plane
+	int lo = node->first, hi = node->first + node->count - 1;
+	while (lo <= hi) {
+		int b = (int)((centroid(&boxes[objects[lo]], axis) - cmin[axis]) * scale);
+		b = b < SOGL_BVH_BINS ? b : SOGL_BVH_BINS - 1;
+		if (b <= best_bin) {
+			++lo;
+		} else {
+			const int tmp = objects[lo];
+			objects[lo] = objects[hi];
+			objects[hi--] = tmp;
+		}
+	}
+
+	return lo - node->first;
+}
+
+bool sogl_bvh_build(const struct sogl_aabb* const boxes, const int count,
+                    struct sogl_bvh* const bvh)
+{
+	memset(bvh, 0, sizeof(*bvh));
+	if (count <= 0)
+		return true;
+
+	bvh->nodes = malloc(sizeof(struct sogl_bvh_node) * (2 * count - 1));
+	bvh->objects = malloc(sizeof(int) * count);
+	if (bvh->nodes == NULL || bvh->objects == NULL) {
+		fprintf(stderr, "Couldn't allocate BVH for %d objects\n", count);
+		sogl_bvh_free(bvh);
+		return false;
+	}
+
+	for (int i = 0; i < count; ++i)
+		bvh->objects[i] = i;
+	bvh->nobjects = count;
+
+	struct sogl_bvh_node* const root = &bvh->nodes[0];
+	root->left = 0;
+	root->first = 0;
+	root->count = count;
+	bvh->nnodes = 1;
+
+	// depth first, so the children always come after their parent
+	int stack[SOGL_BVH_MAX_DEPTH + 2];
+	int depths[SOGL_BVH_MAX_DEPTH + 2];
+	int top = 0;
+	stack[top] = 0;
+	depths[top++] = 0;
+
+	while (top > 0) {
+		--top;
+		struct sogl_bvh_node* const node = &bvh->nodes[stack[top]];
+		const int depth = depths[top];
+
+		if (node->count <= SOGL_BVH_LEAF_SIZE || depth == SOGL_BVH_MAX_DEPTH)
+			continue;
+
+		const int nleft = split_node(boxes, bvh->objects, node);
+		if (nleft == 0)
+			continue;
+
+		struct sogl_bvh_node* const left = &bvh->nodes[bvh->nnodes];
+		struct sogl_bvh_node* const right = left + 1;
+		left->left = right->left = 0;
+		left->first = node->first;
+		left->count = nleft;
+		right->first = node->first + nleft;
+		right->count = node->count - nleft;
+		node->left = bvh->nnodes;
+		bvh->nnodes += 2;
+
+		stack[top] = node->left + 1;
+		depths[top++] = depth + 1;
+		stack[top] = node->left;
+		depths[top++] = depth + 1;
+	}
+
+	sogl_bvh_refit(bvh, boxes);
+	return true;
+}
+
+void sogl_bvh_free(struct sogl_bvh* const bvh)
+{
+	free(bvh->nodes);
+	free(bvh->objects);
+	memset(bvh, 0, sizeof(*bvh));
+}
+
+void sogl_bvh_refit(struct sogl_bvh* const bvh, const struct sogl_aabb* const boxes)
+{
+	// children come after their parents, so walk backwards
+	for (int n = bvh->nnodes - 1; n >= 0; --n) {
+		struct sogl_bvh_node* const node = &bvh->nodes[n];
+		node->box = empty_box;
+
+		if (node->left != 0) {
+			grow(&node->box, &bvh->nodes[node->left].box);
+			grow(&node->box, &bvh->nodes[node->left + 1].box);
+		} else {
+			for (int i = node->first; i < node->first + node->count; ++i)
+				grow(&node->box, &boxes[bvh->objects[i]]);
+		}
+	}
+}
+
+
+/*
+ * Culling
+ * */
+void sogl_frustum_from_mat4(const struct mat4* const m, struct sogl_frustum* const f)
+{
+	// rows of the column major matrix, planes are row3 +- row0..2
+	const GLfloat r[4][4] = {
+		{ m->x0, m->x1, m->x2, m->x3 },
+		{ m->y0, m->y1, m->y2, m->y3 },
+		{ m->z0, m->z1, m->z2, m->z3 },
+		{ m->w0, m->w1, m->w2, m->w3 }
+	};
+
+	for (int p = 0; p < 6; ++p) {
+		const GLfloat sign = p & 1 ? -1.0f : 1.0f;
+		const GLfloat* const row = r[p / 2];
+		GLfloat plane[4];
+		for (int c = 0; c < 4; ++c)
+			plane[c] = r[3][c] + sign * row[c];
+
+		const GLfloat len = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		f->nx[p] = plane[0] / len;
+		f->ny[p] = plane[1] / len;
+		f->nz[p] = plane[2] / len;
+		f->d[p] = plane[3] / len;
+	}
+
+	for (int p = 6; p < 8; ++p) {
+		f->nx[p] = f->ny[p] = f->nz[p] = 0.0f;
+		f->d[p] = 1.0f;
+	}
+}
+
+static int test_box(const struct sogl_frustum* const f, const struct sogl_aabb* const box)
+{
+	const float cx = (box->min.x + box->max.x) * 0.5f;
+	const float cy = (box->min.y + box->max.y) * 0.5f;
+	const float cz = (box->min.z + box->max.z) * 0.5f;
+	const float ex = (box->max.x - box->min.x) * 0.5f;
+	const float ey = (box->max.y - box->min.y) * 0.5f;
+	const float ez = (box->max.z - box->min.z) * 0.5f;
+
+#ifdef __SSE2__
+	// 4 planes at a time: distance of the center against the projected extent
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	__m128 outside = _mm_setzero_ps();
+	__m128 crossing = _mm_setzero_ps();
+
+	for (int p = 0; p < 8; p += 4) {
+		const __m128 nx = _mm_loadu_ps(&f->nx[p]);
+		const __m128 ny = _mm_loadu_ps(&f->ny[p]);
+		const __m128 nz = _mm_loadu_ps(&f->nz[p]);
+
+		const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_set1_ps(cx)),
+		                                          _mm_mul_ps(ny, _mm_set1_ps(cy))),
+		                               _mm_add_ps(_mm_mul_ps(nz, _mm_set1_ps(cz)),
+		                                          _mm_loadu_ps(&f->d[p])));
+		const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign, nx), _mm_set1_ps(ex)),
+		                                            _mm_mul_ps(_mm_andnot_ps(sign, ny), _mm_set1_ps(ey))),
+		                                 _mm_mul_ps(_mm_andnot_ps(sign, nz), _mm_set1_ps(ez)));
+
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), radius)));
+		crossing = _mm_or_ps(crossing, _mm_cmplt_ps(dist, radius));
+	}
+
+	if (_mm_movemask_ps(outside))
+		return OUTSIDE;
+	return _mm_movemask_ps(crossing) ? INTERSECTING : INSIDE;
+#else
+	int result = INSIDE;
+	for (int p = 0; p < 8; ++p) {
+		const float dist = f->nx[p] * cx + f->ny[p] * cy + f->nz[p] * cz + f->d[p];
+		const float radius = fabsf(f->nx[p]) * ex + fabsf(f->ny[p]) * ey + fabsf(f->nz[p]) * ez;
+		if (dist < -radius)
+			return OUTSIDE;
+		if (dist < radius)
+			result = INTERSECTING;
+	}
+	return result;
+#endif
+}
+
+int sogl_bvh_cull(const struct sogl_bvh* const bvh,
+                  const struct sogl_frustum* const frustum,
+                  int* const visible)
+{
+	if (bvh->nnodes == 0)
+		return 0;
+
+	int nvisible = 0;
+	int stack[SOGL_BVH_MAX_DEPTH + 2];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const struct sogl_bvh_node* const node = &bvh->nodes[stack[--top]];
+		const int result = test_box(frustum, &node->box);
+
+		if (result == OUTSIDE)
+			continue;
+
+		// leaves are small enough to take whole
+		if (result == INSIDE || node->left == 0) {
+			memcpy(&visible[nvisible], &bvh->objects[node->first], sizeof(int) * node->count);
+			nvisible += node->count;
+			continue;
+		}
+
+		stack[top++] = node->left + 1;
+		stack[top++] = node->left;
+	}
+
+	return nvisible;
+}
@@ -0,0 +1,63 @@
+#ifndef SOGL_BVH_H_
+#define SOGL_BVH_H_
+#include <stdbool.h>
+#include <GL/glew.h>
+#include "sogl_types.h"
+
+#define SOGL_BVH_BINS      (16)  // SAH buckets per split
+#define SOGL_BVH_LEAF_SIZE (4)   // objects per leaf at most
+#define SOGL_BVH_MAX_DEPTH (64)
+
+
+struct sogl_aabb {
+	struct vec3 min;
+	struct vec3 max;
+};
+
+/* nodes are stored depth first, a node's children are
+ * left and left + 1, and every node covers the objects
+ * [first, first + count) of the objects array, so a node
+ * fully inside the frustum is accepted in one go
+ * */
+struct sogl_bvh_node {
+	struct sogl_aabb box;
+	int left;     // 0 for leaves
+	int first;
+	int count;
+};
+
+struct sogl_bvh {
+	struct sogl_bvh_node* nodes;
+	int* objects;
+	int nnodes;
+	int nobjects;
+};
+
+/* the 6 planes with normals pointing inside, padded to 8
+ * with planes that accept everything, as 4 wide columns
+ * */
+struct sogl_frustum {
+	GLfloat nx[8], ny[8], nz[8], d[8];
+};
+
+
+/* binned SAH build over the object boxes */
+extern bool sogl_bvh_build(const struct sogl_aabb* boxes, int count,
+                           struct sogl_bvh* bvh);
+extern void sogl_bvh_free(struct sogl_bvh* bvh);
+
+/* updates the node boxes for objects that moved, keeping the tree */
+extern void sogl_bvh_refit(struct sogl_bvh* bvh, const struct sogl_aabb* boxes);
+
+/* planes of a column major view projection matrix */
+extern void sogl_frustum_from_mat4(const struct mat4* viewproj,
+                                   struct sogl_frustum* frustum);
+
+/* writes the ids of the objects intersecting the frustum,
+ * returns how many
+ * */
+extern int sogl_bvh_cull(const struct sogl_bvh* bvh,
+                         const struct sogl_frustum* frustum,
+                         int* visible);
+
+#endif
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glew.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#include "sogl_capture.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+#define WAIT_TIMEOUT_NS (1000000000ull)
+
+
+struct slot {
+	GLuint pbo;
+	GLsync fence;
+	int frame;
+};
+
+
+static struct slot slots[SOGL_CAPTURE_RING];
+static char capture_dir[SOGL_CAPTURE_MAX_PATH];
+static enum sogl_capture_format capture_format;
+static int capture_width, capture_height;
+static int nframes;
+
+
+bool sogl_capture_init(const char* const dir, const int width, const int height,
+                       const enum sogl_capture_format format)
+{
+	if (strlen(dir) + 32 > sizeof(capture_dir)) {
+		fprintf(stderr, "Couldn't capture to %s: path too long\n", dir);
+		return false;
+	}
+
+	strcpy(capture_dir, dir);
+	capture_format = format;
+	capture_width = width;
+	capture_height = height;
+	nframes = 0;
+
+	const GLsizeiptr bytes = (GLsizeiptr)width * height * 4;
+	for (int i = 0; i < SOGL_CAPTURE_RING; ++i) {
+		glGenBuffers(1, &slots[i].pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+		slots[i].fence = NULL;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	printf("CAPTURING %dx%d FRAMES TO %s AS %s\n", width, height, dir,
+	       format == SOGL_CAPTURE_PNG ? "PNG" : "RAW");
+	return true;
+}
+
+static void write_frame(const struct slot* const slot, const void* const pixels)
+{
+	char path[SOGL_CAPTURE_MAX_PATH];
+	bool ok;
+
+	if (capture_format == SOGL_CAPTURE_PNG) {
+		snprintf(path, sizeof(path), "%s/frame_%05d.png", capture_dir, slot->frame);
+		// GL rows are bottom first
+		stbi_flip_vertically_on_write(1);
+		ok = stbi_write_png(path, capture_width, capture_height, 4,
+		                    pixels, capture_width * 4) != 0;
+	} else {
+		snprintf(path, sizeof(path), "%s/frame_%05d.rgba", capture_dir, slot->frame);
+		FILE* const file = fopen(path, "wb");
+		ok = file != NULL;
+		if (ok) {
+			ok = fwrite(pixels, (size_t)capture_width * capture_height * 4, 1, file) == 1;
+			ok = fclose(file) == 0 && ok;
+		}
+	}
+
+	if (!ok)
+		fprintf(stderr, "Couldn't write capture %s\n", path);
+}
+
+/* waits for the read of the slot, normally done long ago */
+static void retire(struct slot* const slot)
+{
+	if (slot->fence == NULL)
+		return;
+
+	glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT_NS);
+	glDeleteSync(slot->fence);
+	slot->fence = NULL;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+	const void* const pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+	                                            (GLsizeiptr)capture_width * capture_height * 4,
+	                                            GL_MAP_READ_BIT);
+	if (pixels != NULL) {
+		write_frame(slot, pixels);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	} else {
+		fprintf(stderr, "Couldn't map capture of frame %d\n", slot->frame);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void sogl_capture_term(void)
+{
+	// oldest first, the ring is in frame order from the next slot
+	for (int i = 0; i < SOGL_CAPTURE_RING; ++i)
+		retire(&slots[(nframes + i) % SOGL_CAPTURE_RING]);
+
+	for (int i = 0; i < SOGL_CAPTURE_RING; ++i) {
+		if (slots[i].pbo != 0)
+			glDeleteBuffers(1, &slots[i].pbo);
+		slots[i].pbo = 0;
+	}
+}
+
+void sogl_capture_frame(void)
+{
+	struct slot* const slot = &slots[nframes % SOGL_CAPTURE_RING];
+	retire(slot);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+	glReadBuffer(GL_BACK);
+	glReadPixels(0, 0, capture_width, capture_height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot->frame = nframes++;
+}
+
+int sogl_capture_frames(void)
+{
+	return nframes;
+}
@@ -0,0 +1,40 @@
+#ifndef SOGL_CAPTURE_H_
+#define SOGL_CAPTURE_H_
+#include <stdbool.h>
+#include <GL/glew.h>
+
+#define SOGL_CAPTURE_RING     (3)    // frames read back before the oldest is waited on
+#define SOGL_CAPTURE_MAX_PATH (1024)
+
+
+/* Framebuffer capture:
+ * every captured frame is read with glReadPixels into the next
+ * pixel pack buffer of a ring and fenced, so the read is queued
+ * behind the frame instead of stalling it. A frame is written to
+ * dir when its buffer comes around again, SOGL_CAPTURE_RING frames
+ * later, by which time the copy is normally done.
+ *
+ * sogl_init starts a capture when SOGL_CAPTURE_DIR is set:
+ *   SOGL_CAPTURE_DIR     directory to write frame_NNNNN.png (or .rgba)
+ *   SOGL_CAPTURE_FORMAT  png (default) or raw, RGBA8 rows bottom first
+ *   SOGL_CAPTURE_FRAMES  stop the demo after this many frames
+ *   SOGL_SEED            seed returned by sogl_seed
+ * */
+enum sogl_capture_format {
+	SOGL_CAPTURE_PNG,
+	SOGL_CAPTURE_RAW
+};
+
+
+extern bool sogl_capture_init(const char* dir, int width, int height,
+                              enum sogl_capture_format format);
+
+/* writes the frames still in flight */
+extern void sogl_capture_term(void);
+
+/* reads the back buffer, call before swapping */
+extern void sogl_capture_frame(void);
+
+extern int sogl_capture_frames(void); // read so far
+
+#endif
@@ -0,0 +1,421 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include "sogl.h"
+#include "sogl_cluster.h"
+#include "sogl_jobs.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+#define LIGHT_BATCH (256)
+#define MAX_PROGRAMS (8)
+
+_Static_assert(SOGL_CLUSTER_X % 4 == 0, "tiles are tested four at a time");
+
+
+enum buffer {
+	GRID,
+	INDICES,
+	LIGHTS,
+	NBUFFERS
+};
+
+// two texels of cluster_lights
+struct view_light {
+	GLfloat x, y, z, radius;
+	GLfloat r, g, b, pad;
+};
+
+// clusters a light may touch, inclusive, z0 > z1 when behind or past zfar
+struct light_range {
+	int16_t x0, x1, y0, y1, z0, z1;
+};
+
+struct update {
+	const struct sogl_cluster_light* lights;
+	const struct mat4* view;
+	int nlights;
+};
+
+
+static GLuint buffers[NBUFFERS], textures[NBUFFERS];
+static int width, height, max_lights;
+
+static struct view_light* view_lights;
+static struct light_range* ranges;
+static uint16_t* slice_lights;     // per slice, the lights whose range covers it
+static uint16_t* scratch;          // SOGL_CLUSTER_CAPACITY per cluster
+static uint16_t* indices;          // the lists packed for upload
+static int counts[SOGL_CLUSTER_COUNT];
+static GLuint grid[SOGL_CLUSTER_COUNT][2];
+static long slice_dropped[SOGL_CLUSTER_Z];
+
+// view space bounds of the clusters, distances are positive
+static float tile_minx[SOGL_CLUSTER_Z][SOGL_CLUSTER_X];
+static float tile_maxx[SOGL_CLUSTER_Z][SOGL_CLUSTER_X];
+static float tile_miny[SOGL_CLUSTER_Z][SOGL_CLUSTER_Y];
+static float tile_maxy[SOGL_CLUSTER_Z][SOGL_CLUSTER_Y];
+static float slice_dist[SOGL_CLUSTER_Z + 1];
+static float xscale, yscale, near_dist, far_dist, slice_scale;
+
+static struct sogl_cluster_stats stats;
+
+// the programs located so far and their cluster_params
+static GLuint programs[MAX_PROGRAMS];
+static GLint params_locs[MAX_PROGRAMS];
+static int nprograms;
+
+
+bool sogl_cluster_init(const int w, const int h, const int lights)
+{
+	if (lights <= 0 || lights > SOGL_CLUSTER_MAX_LIGHTS) {
+		fprintf(stderr, "Couldn't init clusters for %d lights, at most %d\n",
+		        lights, SOGL_CLUSTER_MAX_LIGHTS);
+		return false;
+	}
+
+	width = w;
+	height = h;
+	max_lights = lights;
+	memset(&stats, 0, sizeof(stats));
+
+	view_lights = malloc(sizeof(*view_lights) * max_lights);
+	ranges = malloc(sizeof(*ranges) * max_lights);
+	slice_lights = malloc(sizeof(*slice_lights) * max_lights * SOGL_CLUSTER_Z);
+	scratch = malloc(sizeof(*scratch) * SOGL_CLUSTER_CAPACITY * SOGL_CLUSTER_COUNT);
+	indices = malloc(sizeof(*indices) * SOGL_CLUSTER_CAPACITY * SOGL_CLUSTER_COUNT);
+	if (view_lights == NULL || ranges == NULL || slice_lights == NULL ||
+	    scratch == NULL || indices == NULL) {
+		fprintf(stderr, "Couldn't allocate light clusters\n");
+		sogl_cluster_term();
+		return false;
+	}
+
+	static const GLenum formats[NBUFFERS] = { GL_RG32UI, GL_R16UI, GL_RGBA32F };
+	const GLsizeiptr sizes[NBUFFERS] = {
+		sizeof(grid),
+		sizeof(*indices) * SOGL_CLUSTER_CAPACITY * SOGL_CLUSTER_COUNT,
+		sizeof(*view_lights) * max_lights
+	};
+
+	glGenBuffers(NBUFFERS, buffers);
+	glGenTextures(NBUFFERS, textures);
+	for (int i = 0; i < NBUFFERS; ++i) {
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, sizes[i], NULL, GL_STREAM_DRAW);
+		glActiveTexture(GL_TEXTURE0 + SOGL_CLUSTER_TEXTURE_UNIT + i);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	return true;
+}
+
+void sogl_cluster_term(void)
+{
+	if (buffers[0] != 0) {
+		glDeleteTextures(NBUFFERS, textures);
+		glDeleteBuffers(NBUFFERS, buffers);
+	}
+	memset(buffers, 0, sizeof(buffers));
+	memset(textures, 0, sizeof(textures));
+
+	free(indices);
+	free(scratch);
+	free(slice_lights);
+	free(ranges);
+	free(view_lights);
+	indices = scratch = slice_lights = NULL;
+	ranges = NULL;
+	view_lights = NULL;
+	nprograms = 0;
+}
+
+
+/* view space boxes around the cells of every slice */
+static void update_bounds(const GLfloat fovy_radians, const GLfloat aspect,
+                          const GLfloat znear, const GLfloat zfar)
+{
+	yscale = tanf(fovy_radians * 0.5f);
+	xscale = yscale * aspect;
+	near_dist = znear;
+	far_dist = zfar;
+	slice_scale = SOGL_CLUSTER_Z / logf(zfar / znear);
+
+	for (int z = 0; z <= SOGL_CLUSTER_Z; ++z)
+		slice_dist[z] = znear * powf(zfar / znear, (float)z / SOGL_CLUSTER_Z);
+
+	for (int z = 0; z < SOGL_CLUSTER_Z; ++z) {
+		const float d0 = slice_dist[z];
+		const float d1 = slice_dist[z + 1];
+		for (int x = 0; x < SOGL_CLUSTER_X; ++x) {
+			const float a = (-1.0f + 2.0f * x / SOGL_CLUSTER_X) * xscale;
+			const float b = (-1.0f + 2.0f * (x + 1) / SOGL_CLUSTER_X) * xscale;
+			tile_minx[z][x] = a * (a < 0 ? d1 : d0);
+			tile_maxx[z][x] = b * (b > 0 ? d1 : d0);
+		}
+		for (int y = 0; y < SOGL_CLUSTER_Y; ++y) {
+			const float a = (-1.0f + 2.0f * y / SOGL_CLUSTER_Y) * yscale;
+			const float b = (-1.0f + 2.0f * (y + 1) / SOGL_CLUSTER_Y) * yscale;
+			tile_miny[z][y] = a * (a < 0 ? d1 : d0);
+			tile_maxy[z][y] = b * (b > 0 ? d1 : d0);
+		}
+	}
+}
+
+static int slice_of(const float dist)
+{
+	if (dist <= near_dist)
+		return 0;
+	const int z = (int)(logf(dist / near_dist) * slice_scale);
+	return z < SOGL_CLUSTER_Z ? z : SOGL_CLUSTER_Z - 1;
+}
+
+/* tile of a tan space coordinate (ndc times scale) */
+static int tile_of(const float t, const float scale, const int tiles)
+{
+	const int i = (int)floorf((t / scale + 1.0f) * 0.5f * tiles);
+	return i < 0 ? 0 : i >= tiles ? tiles - 1 : i;
+}
+
+/* view space lights and the clusters their bounding box projects to */
+static void transform_lights(void* const data, const int begin, const int end)
+{
+	const struct update* const u = data;
+	const struct mat4* const v = u->view;
+
+	for (int i = begin; i < end; ++i) {
+		const struct sogl_cluster_light* const l = &u->lights[i];
+		struct view_light* const vl = &view_lights[i];
+		struct light_range* const r = &ranges[i];
+
+		vl->x = v->x0 * l->pos.x + v->x1 * l->pos.y + v->x2 * l->pos.z + v->x3;
+		vl->y = v->y0 * l->pos.x + v->y1 * l->pos.y + v->y2 * l->pos.z + v->y3;
+		vl->z = v->z0 * l->pos.x + v->z1 * l->pos.y + v->z2 * l->pos.z + v->z3;
+		vl->radius = l->radius;
+		vl->r = l->color.x;
+		vl->g = l->color.y;
+		vl->b = l->color.z;
+		vl->pad = 0;
+
+		const float dist = -vl->z;
+		const float dmin = dist - l->radius < near_dist ? near_dist : dist - l->radius;
+		const float dmax = dist + l->radius;
+		*r = (struct light_range) { 0, -1, 0, -1, 1, 0 };
+		if (dmax < near_dist || dist - l->radius > far_dist)
+			continue;
+
+		const float lox = vl->x - l->radius, hix = vl->x + l->radius;
+		const float loy = vl->y - l->radius, hiy = vl->y + l->radius;
+		const float tlox = lox / (lox < 0 ? dmin : dmax);
+		const float thix = hix / (hix > 0 ? dmin : dmax);
+		const float tloy = loy / (loy < 0 ? dmin : dmax);
+		const float thiy = hiy / (hiy > 0 ? dmin : dmax);
+		if (thix < -xscale || tlox > xscale || thiy < -yscale || tloy > yscale)
+			continue;
+
+		r->x0 = tile_of(tlox, xscale, SOGL_CLUSTER_X);
+		r->x1 = tile_of(thix, xscale, SOGL_CLUSTER_X);
+		r->y0 = tile_of(tloy, yscale, SOGL_CLUSTER_Y);
+		r->y1 = tile_of(thiy, yscale, SOGL_CLUSTER_Y);
+		r->z0 = slice_of(dmin);
+		r->z1 = slice_of(dmax);
+	}
+}
+
+static void append(const int cluster, const uint16_t light, const int z)
+{
+	if (counts[cluster] < SOGL_CLUSTER_CAPACITY)
+		scratch[cluster * SOGL_CLUSTER_CAPACITY + counts[cluster]++] = light;
+	else
+		++slice_dropped[z];
+}
+
+/* tiles x0 to x1 of a row whose cells are dyz2 away from the light */
+static void bin_row(const int z, const int row, const int x0, const int x1,
+                    const float cx, const float r2, const float dyz2, const uint16_t light)
+{
+#ifdef __SSE2__
+	const __m128 vcx = _mm_set1_ps(cx);
+	const __m128 vr2 = _mm_set1_ps(r2 - dyz2);
+	const __m128 zero = _mm_setzero_ps();
+	for (int x = x0 & ~3; x <= x1; x += 4) {
+		const __m128 minx = _mm_loadu_ps(&tile_minx[z][x]);
+		const __m128 maxx = _mm_loadu_ps(&tile_maxx[z][x]);
+		const __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minx, vcx), _mm_sub_ps(vcx, maxx)), zero);
+		int mask = _mm_movemask_ps(_mm_cmple_ps(_mm_mul_ps(dx, dx), vr2));
+		for (; mask != 0; mask &= mask - 1) {
+			const int tx = x + __builtin_ctz(mask);
+			if (tx >= x0 && tx <= x1)
+				append(row + tx, light, z);
+		}
+	}
+#else
+	for (int x = x0; x <= x1; ++x) {
+		const float dx = fmaxf(fmaxf(tile_minx[z][x] - cx, cx - tile_maxx[z][x]), 0.0f);
+		if (dx * dx <= r2 - dyz2)
+			append(row + x, light, z);
+	}
+#endif
+}
+
+/* one slice, its clusters are only written by this job */
+static void bin_slices(void* const data, const int begin, const int end)
+{
+	const struct update* const u = data;
+
+	for (int z = begin; z < end; ++z) {
+		uint16_t* const list = &slice_lights[(long)z * max_lights];
+		int n = 0;
+		for (int i = 0; i < u->nlights; ++i) {
+			if (ranges[i].z0 <= z && ranges[i].z1 >= z)
+				list[n++] = i;
+		}
+
+		const int first = z * SOGL_CLUSTER_X * SOGL_CLUSTER_Y;
+		memset(&counts[first], 0, sizeof(*counts) * SOGL_CLUSTER_X * SOGL_CLUSTER_Y);
+		slice_dropped[z] = 0;
+
+		// view space z of the slice is [-slice_dist[z + 1], -slice_dist[z]]
+		for (int k = 0; k < n; ++k) {
+			const uint16_t light = list[k];
+			const struct view_light* const l = &view_lights[light];
+			const struct light_range* const r = &ranges[light];
+			const float r2 = l->radius * l->radius;
+			const float dist = -l->z;
+			const float dz = fmaxf(fmaxf(slice_dist[z] - dist, dist - slice_dist[z + 1]), 0.0f);
+
+			for (int y = r->y0; y <= r->y1; ++y) {
+				const float dy = fmaxf(fmaxf(tile_miny[z][y] - l->y, l->y - tile_maxy[z][y]), 0.0f);
+				const float dyz2 = dy * dy + dz * dz;
+				if (dyz2 > r2)
+					continue;
+				bin_row(z, first + y * SOGL_CLUSTER_X, r->x0, r->x1, l->x, r2, dyz2, light);
+			}
+		}
+	}
+}
+
+
+void sogl_cluster_update(const struct sogl_cluster_light* const lights, int nlights,
+                         const struct mat4* const view,
+                         const GLfloat fovy_radians, const GLfloat aspect,
+                         const GLfloat znear, const GLfloat zfar)
+{
+	const Uint64 clk = SDL_GetPerformanceCounter();
+
+	if (nlights > max_lights)
+		nlights = max_lights;
+
+	struct update u = { lights, view, nlights };
+	update_bounds(fovy_radians, aspect, znear, zfar);
+	sogl_jobs_parallel_for(transform_lights, &u, nlights, LIGHT_BATCH);
+	sogl_jobs_parallel_for(bin_slices, &u, SOGL_CLUSTER_Z, 1);
+
+	// packs the lists, a serial pass over the few thousand clusters
+	int nindices = 0, max_refs = 0;
+	long dropped = 0;
+	for (int c = 0; c < SOGL_CLUSTER_COUNT; ++c) {
+		grid[c][0] = nindices;
+		grid[c][1] = counts[c];
+		memcpy(&indices[nindices], &scratch[c * SOGL_CLUSTER_CAPACITY],
+		       sizeof(*indices) * counts[c]);
+		nindices += counts[c];
+		max_refs = counts[c] > max_refs ? counts[c] : max_refs;
+	}
+	for (int z = 0; z < SOGL_CLUSTER_Z; ++z)
+		dropped += slice_dropped[z];
+
+	int visible = 0;
+	for (int i = 0; i < nlights; ++i)
+		visible += ranges[i].z0 <= ranges[i].z1;
+
+	stats.bin_ms = (SDL_GetPerformanceCounter() - clk) * 1000.0 / SDL_GetPerformanceFrequency();
+	stats.lights = visible;
+	stats.refs = nindices;
+	stats.max_refs = max_refs;
+	stats.dropped = dropped;
+
+	// orphan the buffers so the driver doesn't wait on the previous frame
+	const void* const datas[NBUFFERS] = { grid, indices, view_lights };
+	const GLsizeiptr sizes[NBUFFERS] = {
+		sizeof(grid),
+		sizeof(*indices) * SOGL_CLUSTER_CAPACITY * SOGL_CLUSTER_COUNT,
+		sizeof(*view_lights) * max_lights
+	};
+	const GLsizeiptr used[NBUFFERS] = {
+		sizeof(grid),
+		sizeof(*indices) * nindices,
+		sizeof(*view_lights) * nlights
+	};
+	for (int i = 0; i < NBUFFERS; ++i)
+		sogl_upload_orphaned(buffers[i], GL_TEXTURE_BUFFER, sizes[i], datas[i], used[i]);
+}
+
+/* sets the samplers of the current program, they never change,
+ * and remembers where its cluster_params is
+ * */
+static int locate(const GLuint program)
+{
+	static const char* const samplers[NBUFFERS] = {
+		"cluster_grid", "cluster_indices", "cluster_lights"
+	};
+
+	for (int i = 0; i < nprograms; ++i) {
+		if (programs[i] == program)
+			return i;
+	}
+
+	if (nprograms == MAX_PROGRAMS) {
+		fprintf(stderr, "Couldn't locate the cluster uniforms of program %u, "
+		        "too many programs\n", program);
+		return -1;
+	}
+
+	for (int i = 0; i < NBUFFERS; ++i)
+		glUniform1i(glGetUniformLocation(program, samplers[i]), SOGL_CLUSTER_TEXTURE_UNIT + i);
+
+	programs[nprograms] = program;
+	params_locs[nprograms] = glGetUniformLocation(program, "cluster_params");
+	return nprograms++;
+}
+
+void sogl_cluster_locate(const GLuint program)
+{
+	GLint prev_program;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &prev_program);
+	glUseProgram(program);
+	locate(program);
+	glUseProgram(prev_program);
+}
+
+void sogl_cluster_bind(const GLuint program)
+{
+	for (int i = 0; i < NBUFFERS; ++i) {
+		glActiveTexture(GL_TEXTURE0 + SOGL_CLUSTER_TEXTURE_UNIT + i);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	const int p = locate(program);
+	if (p < 0)
+		return;
+
+	glUniform4f(params_locs[p],
+	            (float)SOGL_CLUSTER_X / width, (float)SOGL_CLUSTER_Y / height,
+	            slice_scale, 1.0f / near_dist);
+}
+
+void sogl_cluster_stats(struct sogl_cluster_stats* const out)
+{
+	*out = stats;
+}
@@ -0,0 +1,101 @@
+#ifndef SOGL_CLUSTER_H_
+#define SOGL_CLUSTER_H_
+#include <stdbool.h>
+#include <GL/glew.h>
+#include "sogl_types.h"
+
+#define SOGL_CLUSTER_X            (16)    // tiles across, a multiple of 4
+#define SOGL_CLUSTER_Y            (9)     // tiles down
+#define SOGL_CLUSTER_Z            (24)    // depth slices, exponential
+#define SOGL_CLUSTER_COUNT        (SOGL_CLUSTER_X * SOGL_CLUSTER_Y * SOGL_CLUSTER_Z)
+#define SOGL_CLUSTER_CAPACITY     (256)   // lights per cluster, more are dropped
+#define SOGL_CLUSTER_MAX_LIGHTS   (65535) // light indices are 16 bit
+#define SOGL_CLUSTER_TEXTURE_UNIT (4)     // the grid, indices and lights use 4, 5 and 6
+
+#define SOGL_CLUSTER_STR_(x) #x
+#define SOGL_CLUSTER_STR(x)  SOGL_CLUSTER_STR_(x)
+
+
+/* Clustered forward lighting:
+ * the view frustum is split in SOGL_CLUSTER_X * Y screen tiles and
+ * SOGL_CLUSTER_Z slices growing with the distance, every frame the
+ * lights are binned on the CPU into the clusters their sphere
+ * touches (over the sogl_jobs workers, four tiles per SSE2 test)
+ * and the lists are uploaded as buffer textures:
+ *   cluster_grid     RG32UI  first index and count per cluster
+ *   cluster_indices  R16UI   light indices, cluster after cluster
+ *   cluster_lights   RGBA32F view space position and radius, color
+ *
+ * A fragment shader prepends SOGL_CLUSTER_GLSL (after its #version,
+ * 140 or later) and calls
+ *   vec3 sogl_cluster_light(vec3 view_pos, vec3 normal, vec3 albedo)
+ * with its view space position and normal, it returns the diffuse
+ * light of the lights of its cluster.
+ * */
+#define SOGL_CLUSTER_GLSL \
+"uniform usamplerBuffer cluster_grid;\n" \
+"uniform usamplerBuffer cluster_indices;\n" \
+"uniform samplerBuffer cluster_lights;\n" \
+"uniform vec4 cluster_params;\n" \
+"vec3 sogl_cluster_light(vec3 view_pos, vec3 normal, vec3 albedo)\n" \
+"{\n" \
+"	int tx = clamp(int(gl_FragCoord.x * cluster_params.x), 0, " SOGL_CLUSTER_STR(SOGL_CLUSTER_X) " - 1);\n" \
+"	int ty = clamp(int(gl_FragCoord.y * cluster_params.y), 0, " SOGL_CLUSTER_STR(SOGL_CLUSTER_Y) " - 1);\n" \
+"	int tz = clamp(int(log(-view_pos.z * cluster_params.w) * cluster_params.z), 0, " \
+	SOGL_CLUSTER_STR(SOGL_CLUSTER_Z) " - 1);\n" \
+"	uvec2 cell = texelFetch(cluster_grid, (tz * " SOGL_CLUSTER_STR(SOGL_CLUSTER_Y) " + ty) * " \
+	SOGL_CLUSTER_STR(SOGL_CLUSTER_X) " + tx).xy;\n" \
+"	vec3 color = vec3(0.0);\n" \
+"	for (uint i = 0u; i < cell.y; ++i) {\n" \
+"		int light = int(texelFetch(cluster_indices, int(cell.x + i)).x);\n" \
+"		vec4 pos_radius = texelFetch(cluster_lights, light * 2);\n" \
+"		vec3 to_light = pos_radius.xyz - view_pos;\n" \
+"		float dist = max(length(to_light), 1e-4);\n" \
+"		float falloff = clamp(1.0 - dist / pos_radius.w, 0.0, 1.0);\n" \
+"		float diffuse = max(dot(normal, to_light / dist), 0.0);\n" \
+"		color += texelFetch(cluster_lights, light * 2 + 1).rgb * diffuse * falloff * falloff;\n" \
+"	}\n" \
+"	return color * albedo;\n" \
+"}\n"
+
+
+struct sogl_cluster_light {
+	struct vec3 pos;     // world space
+	GLfloat radius;      // no light past it
+	struct vec3 color;
+};
+
+struct sogl_cluster_stats {
+	double bin_ms;       // CPU time of the last sogl_cluster_update, upload excluded
+	int lights;          // in front of the camera
+	int refs;            // light indices over every cluster
+	int max_refs;        // most lights in one cluster
+	long dropped;        // refs past SOGL_CLUSTER_CAPACITY
+};
+
+
+/* width and height of the viewport the fragments come from */
+extern bool sogl_cluster_init(int width, int height, int max_lights);
+extern void sogl_cluster_term(void);
+
+/* bins the lights for the camera and uploads the lists,
+ * fovy, aspect, znear and zfar as given to sogl_mat4_perspective
+ * */
+extern void sogl_cluster_update(const struct sogl_cluster_light* lights, int nlights,
+                                const struct mat4* view,
+                                GLfloat fovy_radians, GLfloat aspect,
+                                GLfloat znear, GLfloat zfar);
+
+/* sets the samplers of program and looks its uniforms up, once after
+ * linking it, so binding doesn't ask GL for them every frame
+ * */
+extern void sogl_cluster_locate(GLuint program);
+
+/* binds the lists and sets the uniforms of program, which must be
+ * current. One never located is located on its first bind
+ * */
+extern void sogl_cluster_bind(GLuint program);
+
+extern void sogl_cluster_stats(struct sogl_cluster_stats* stats);
+
+#endif
@@ -0,0 +1,379 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <GL/glew.h>
+#include "sogl.h"
+#include "sogl_hud.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+#define GLYPH_W    (5)
+#define GLYPH_H    (7)
+#define CELL_W     (GLYPH_W + 1)   // a blank column and row apart
+#define CELL_H     (GLYPH_H + 1)
+#define FIRST_CHAR (' ')
+#define NCHARS     (64)            // ' ' to '_', lowercase is folded into it
+#define SOLID      (NCHARS)        // the filled glyph the panel and bars use
+#define ATLAS_W    ((NCHARS + 1) * CELL_W)
+#define ATLAS_H    (CELL_H)
+
+#define MARGIN     (4 * SOGL_HUD_SCALE)
+#define LINE_H     (CELL_H * SOGL_HUD_SCALE)
+#define BAR_W      (2 * SOGL_HUD_SCALE)
+#define GRAPH_H    (24 * SOGL_HUD_SCALE)
+#define GRAPH_MS   (1000.0 / 30.0) // frame time of a full bar, longer ones rescale the graph
+#define SLOW_MS    (1000.0 / 60.0) // bars past it are drawn red
+
+#define TEXT_COLOR  (0xFFFFFFFFu)  // RGBA8 packed as 0xAABBGGRR
+#define PANEL_COLOR (0xA0000000u)
+#define FAST_COLOR  (0xFF40D040u)
+#define SLOW_COLOR  (0xFF4040E0u)
+
+
+/* 5x7 font, a byte per column from the left, bit 0 the top row */
+static const uint8_t font[NCHARS][GLYPH_W] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 }, // ' ' !
+	{ 0x00, 0x07, 0x00, 0x07, 0x00 }, { 0x14, 0x7F, 0x14, 0x7F, 0x14 }, // " #
+	{ 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 }, // $ %
+	{ 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 }, // & '
+	{ 0x00, 0x1C, 0x22, 0x41, 0x00 }, { 0x00, 0x41, 0x22, 0x1C, 0x00 }, // ( )
+	{ 0x14, 0x08, 0x3E, 0x08, 0x14 }, { 0x08, 0x08, 0x3E, 0x08, 0x08 }, // * +
+	{ 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, // , -
+	{ 0x00, 0x60, 0x60, 0x00, 0x00 }, { 0x20, 0x10, 0x08, 0x04, 0x02 }, // . /
+	{ 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 }, // 0 1
+	{ 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4B, 0x31 }, // 2 3
+	{ 0x18, 0x14, 0x12, 0x7F, 0x10 }, { 0x27, 0x45, 0x45, 0x45, 0x39 }, // 4 5
+	{ 0x3C, 0x4A, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 }, // 6 7
+	{ 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1E }, // 8 9
+	{ 0x00, 0x36, 0x36, 0x00, 0x00 }, { 0x00, 0x56, 0x36, 0x00, 0x00 }, // : ;
+	{ 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 }, // < =
+	{ 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 }, // > ?
+	{ 0x32, 0x49, 0x79, 0x41, 0x3E }, { 0x7E, 0x11, 0x11, 0x11, 0x7E }, // @ A
+	{ 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 }, // B C
+	{ 0x7F, 0x41, 0x41, 0x22, 0x1C }, { 0x7F, 0x49, 0x49, 0x49, 0x41 }, // D E
+	{ 0x7F, 0x09, 0x09, 0x01, 0x01 }, { 0x3E, 0x41, 0x41, 0x51, 0x32 }, // F G
+	{ 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 }, // H I
+	{ 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 }, // J K
+	{ 0x7F, 0x40, 0x40, 0x40, 0x40 }, { 0x7F, 0x02, 0x04, 0x02, 0x7F }, // L M
+	{ 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E }, // N O
+	{ 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E }, // P Q
+	{ 0x7F, 0x09, 0x19, 0x29, 0x46 }, { 0x46, 0x49, 0x49, 0x49, 0x31 }, // R S
+	{ 0x01, 0x01, 0x7F, 0x01, 0x01 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F }, // T U
+	{ 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x7F, 0x20, 0x18, 0x20, 0x7F }, // V W
+	{ 0x63, 0x14, 0x08, 0x14, 0x63 }, { 0x03, 0x04, 0x78, 0x04, 0x03 }, // X Y
+	{ 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x00 }, // Z [
+	{ 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7F, 0x00 }, // '\' ]
+	{ 0x04, 0x02, 0x01, 0x02, 0x04 }, { 0x40, 0x40, 0x40, 0x40, 0x40 }  // ^ _
+};
+
+
+static const GLchar* const vs_src =
+"#version 150\n"
+"in vec4 rect;\n"
+"in float glyph;\n"
+"in vec4 color;\n"
+"uniform vec2 viewport;\n"
+"out vec2 frag_uv;\n"
+"out vec4 frag_color;\n"
+"void main()\n"
+"{\n"
+"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+"	vec2 pos = (rect.xy + corner * rect.zw) / viewport * 2.0 - 1.0;\n"
+"	gl_Position = vec4(pos.x, -pos.y, 0.0, 1.0);\n"
+"	frag_uv = vec2((glyph * 6.0 + corner.x * 5.0) / 390.0, corner.y * 7.0 / 8.0);\n"
+"	frag_color = color;\n"
+"}\n";
+
+static const GLchar* const fs_src =
+"#version 150\n"
+"in vec2 frag_uv;\n"
+"in vec4 frag_color;\n"
+"out vec4 outcolor;\n"
+"uniform sampler2D font;\n"
+"void main()\n"
+"{\n"
+"	outcolor = vec4(frag_color.rgb, frag_color.a * texture(font, frag_uv).r);\n"
+"}\n";
+
+
+struct instance {
+	GLfloat rect[4];    // left, top, width, height in pixels
+	GLfloat glyph;
+	uint32_t color;
+};
+
+struct counter {
+	const char* label;
+	double value;
+};
+
+
+static GLuint program, vao, instance_vbo, font_tex;
+static struct instance instances[SOGL_HUD_MAX_INSTANCES];
+static int ninstances;
+static bool dirty;       // rebuilt since the last upload
+
+static struct counter counters[SOGL_HUD_MAX_COUNTERS];
+static int ncounters;
+
+static double samples[SOGL_HUD_GRAPH_SAMPLES];
+static int nsamples, next_sample;
+static double refresh_ms, since_refresh_ms;
+static double window_ms, window_max_ms;   // of the frames since the last rebuild
+static int window_frames;
+
+
+static void vattr(const GLchar* const name, const GLint size, const GLenum type,
+                  const GLboolean normalized, const size_t offset)
+{
+	const GLint index = glGetAttribLocation(program, name);
+	if (index < 0)
+		return;
+
+	glEnableVertexAttribArray(index);
+	glVertexAttribPointer(index, size, type, normalized,
+	                      sizeof(struct instance), (const GLvoid*)offset);
+	glVertexAttribDivisor(index, 1);
+}
+
+static void bake_font(void)
+{
+	static uint8_t texels[ATLAS_H][ATLAS_W];
+	memset(texels, 0, sizeof(texels));
+
+	for (int g = 0; g <= NCHARS; ++g) {
+		for (int x = 0; x < GLYPH_W; ++x) {
+			const uint8_t column = g < NCHARS ? font[g][x] : 0x7F;
+			for (int y = 0; y < GLYPH_H; ++y)
+				texels[y][g * CELL_W + x] = (column >> y) & 1 ? 0xFF : 0x00;
+		}
+	}
+
+	glGenTextures(1, &font_tex);
+	glActiveTexture(GL_TEXTURE0 + SOGL_HUD_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, font_tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_W, ATLAS_H, 0,
+	             GL_RED, GL_UNSIGNED_BYTE, texels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+bool sogl_hud_init(const int width, const int height, const Uint32 refresh)
+{
+	ncounters = nsamples = next_sample = 0;
+	ninstances = 0;
+	dirty = false;
+	refresh_ms = refresh > 0 ? refresh : SOGL_HUD_REFRESH_MS;
+	since_refresh_ms = window_ms = window_max_ms = 0;
+	window_frames = 0;
+
+	program = sogl_create_program(vs_src, fs_src);
+	if (program == 0) {
+		fprintf(stderr, "Couldn't create the HUD program\n");
+		return false;
+	}
+
+	GLint prev_program, prev_vao, prev_buffer;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &prev_program);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prev_vao);
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &prev_buffer);
+
+	bake_font();
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &instance_vbo);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(instances), NULL, GL_STREAM_DRAW);
+
+	vattr("rect", 4, GL_FLOAT, GL_FALSE, offsetof(struct instance, rect));
+	vattr("glyph", 1, GL_FLOAT, GL_FALSE, offsetof(struct instance, glyph));
+	vattr("color", 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(struct instance, color));
+
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "font"), SOGL_HUD_TEXTURE_UNIT);
+	glUniform2f(glGetUniformLocation(program, "viewport"), width, height);
+
+	glUseProgram(prev_program);
+	glBindVertexArray(prev_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, prev_buffer);
+	return true;
+}
+
+void sogl_hud_term(void)
+{
+	if (font_tex != 0)
+		glDeleteTextures(1, &font_tex);
+	if (instance_vbo != 0)
+		glDeleteBuffers(1, &instance_vbo);
+	if (vao != 0)
+		glDeleteVertexArrays(1, &vao);
+	if (program != 0)
+		glDeleteProgram(program);
+
+	font_tex = instance_vbo = vao = program = 0;
+}
+
+void sogl_hud_set(const char* const label, const double value)
+{
+	for (int i = 0; i < ncounters; ++i) {
+		if (counters[i].label == label) {
+			counters[i].value = value;
+			return;
+		}
+	}
+
+	if (ncounters < SOGL_HUD_MAX_COUNTERS)
+		counters[ncounters++] = (struct counter) { label, value };
+}
+
+
+static void push(const GLfloat x, const GLfloat y, const GLfloat w, const GLfloat h,
+                 const int glyph, const uint32_t color)
+{
+	if (ninstances < SOGL_HUD_MAX_INSTANCES)
+		instances[ninstances++] = (struct instance) { { x, y, w, h }, glyph, color };
+}
+
+// returns the right end of the text
+static GLfloat push_text(GLfloat x, const GLfloat y, const char* text)
+{
+	for (; *text != '\0'; ++text, x += CELL_W * SOGL_HUD_SCALE) {
+		int c = *text;
+		if (c >= 'a' && c <= 'z')
+			c -= 'a' - 'A';
+		if (c < FIRST_CHAR || c >= FIRST_CHAR + NCHARS)
+			c = '?';
+		if (c != ' ') {
+			push(x, y, GLYPH_W * SOGL_HUD_SCALE, GLYPH_H * SOGL_HUD_SCALE,
+			     c - FIRST_CHAR, TEXT_COLOR);
+		}
+	}
+	return x;
+}
+
+static void rebuild(void)
+{
+	// the panel goes first so it's drawn under the rest, sized at the end
+	ninstances = 1;
+
+	char line[64];
+	const double mean_ms = window_frames > 0 ? window_ms / window_frames : 0;
+	snprintf(line, sizeof(line), "FPS %.1f  FRAME %.2f MS  MAX %.2f MS",
+	         mean_ms > 0 ? 1000.0 / mean_ms : 0.0, mean_ms, window_max_ms);
+
+	GLfloat y = MARGIN;
+	GLfloat right = push_text(MARGIN, y, line);
+	y += LINE_H;
+
+	for (int i = 0; i < ncounters; ++i) {
+		const double v = counters[i].value;
+		snprintf(line, sizeof(line), v == floor(v) || fabs(v) >= 1000.0
+		         ? "%s %.0f" : "%s %.2f", counters[i].label, v);
+		const GLfloat end = push_text(MARGIN, y, line);
+		if (end > right)
+			right = end;
+		y += LINE_H;
+	}
+
+	// oldest sample on the left
+	double scale_ms = GRAPH_MS;
+	for (int i = 0; i < nsamples; ++i) {
+		if (samples[i] > scale_ms)
+			scale_ms = samples[i];
+	}
+	y += MARGIN;
+	for (int i = 0; i < nsamples; ++i) {
+		const int s = (next_sample - nsamples + i + SOGL_HUD_GRAPH_SAMPLES) % SOGL_HUD_GRAPH_SAMPLES;
+		const GLfloat h = (GLfloat)(samples[s] / scale_ms * GRAPH_H);
+		push(MARGIN + i * BAR_W, y + GRAPH_H - h, BAR_W, h, SOLID,
+		     samples[s] > SLOW_MS ? SLOW_COLOR : FAST_COLOR);
+	}
+	if (MARGIN + SOGL_HUD_GRAPH_SAMPLES * BAR_W > right)
+		right = MARGIN + SOGL_HUD_GRAPH_SAMPLES * BAR_W;
+
+	instances[0] = (struct instance) {
+		{ 0, 0, right + MARGIN, y + GRAPH_H + MARGIN }, SOLID, PANEL_COLOR
+	};
+
+	window_ms = window_max_ms = 0;
+	window_frames = 0;
+	dirty = true;
+}
+
+void sogl_hud_frame(const double frame_ms)
+{
+	if (program == 0)
+		return;
+
+	samples[next_sample] = frame_ms;
+	next_sample = (next_sample + 1) % SOGL_HUD_GRAPH_SAMPLES;
+	if (nsamples < SOGL_HUD_GRAPH_SAMPLES)
+		++nsamples;
+
+	window_ms += frame_ms;
+	if (frame_ms > window_max_ms)
+		window_max_ms = frame_ms;
+	++window_frames;
+
+	since_refresh_ms += frame_ms;
+	if (since_refresh_ms >= refresh_ms || ninstances == 0) {
+		since_refresh_ms = 0;
+		rebuild();
+	}
+}
+
+static bool draw(void)
+{
+	if (program == 0 || ninstances == 0)
+		return false;
+
+	// the frames between two rebuilds draw the instances already uploaded
+	if (dirty) {
+		sogl_upload_orphaned(instance_vbo, GL_ARRAY_BUFFER, sizeof(instances),
+		                     instances, sizeof(struct instance) * ninstances);
+		dirty = false;
+	}
+
+	// nothing is asked of GL, the callers put back the state they know
+	glUseProgram(program);
+	glBindVertexArray(vao);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, ninstances);
+	glDisable(GL_BLEND);
+	return true;
+}
+
+void sogl_hud_draw(void)
+{
+	if (!draw())
+		return;
+
+	// sogl_init's state
+	glEnable(GL_DEPTH_TEST);
+	sogl_bind();
+}
+
+void sogl_hud_draw_then_bind(const GLuint prev_program, const GLuint prev_vao,
+                             const GLuint prev_buffer, const bool depth_test)
+{
+	if (!draw())
+		return;
+
+	if (depth_test)
+		glEnable(GL_DEPTH_TEST);
+	glUseProgram(prev_program);
+	glBindVertexArray(prev_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, prev_buffer);
+}
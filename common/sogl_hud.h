@@ -0,0 +1,59 @@
+#ifndef SOGL_HUD_H_
+#define SOGL_HUD_H_
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+
+#define SOGL_HUD_REFRESH_MS    (250)   // default time between two rebuilds
+#define SOGL_HUD_MAX_COUNTERS  (8)
+#define SOGL_HUD_GRAPH_SAMPLES (120)   // frame times in the graph, one bar each
+#define SOGL_HUD_MAX_INSTANCES (1024)  // glyphs and bars of a rebuild
+#define SOGL_HUD_SCALE         (2)     // screen pixels per font texel
+#define SOGL_HUD_TEXTURE_UNIT  (8)     // the glyph atlas stays bound there
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* On-screen stats:
+ * counters and a frame time graph drawn over the frame from a 5x7
+ * glyph atlas baked at init, every glyph and bar an instance of a
+ * quad so the whole HUD is a single draw. The values are formatted
+ * and the instances uploaded only every refresh_ms of frame time,
+ * the frames in between draw what's already in VRAM, so watching a
+ * workload doesn't add I/O or uploads to its frames.
+ *
+ * The calls do nothing when init failed, a benchmark can go on
+ * without it.
+ * */
+extern bool sogl_hud_init(int width, int height, Uint32 refresh_ms);
+extern void sogl_hud_term(void);
+
+/* label is kept by address, like the names of sogl_set_uniform,
+ * lowercase letters show as uppercase
+ * */
+extern void sogl_hud_set(const char* label, double value);
+
+/* records the frame time, rebuilds once refresh_ms have passed */
+extern void sogl_hud_frame(double frame_ms);
+
+/* the last draw of a frame, it queries no GL state: it leaves
+ * blending disabled with the HUD's blend function set, the depth
+ * test enabled as sogl_init does and sogl's program, VAO and VBO
+ * bound as sogl_bind does
+ * */
+extern void sogl_hud_draw(void);
+
+/* for programs not drawing through sogl, the state it leaves is
+ * the one passed instead, kept by the caller
+ * */
+extern void sogl_hud_draw_then_bind(GLuint program, GLuint vao, GLuint buffer,
+                                    bool depth_test);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
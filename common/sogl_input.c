@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "sogl_input.h"
+
+
+static enum sogl_input_mode mode = SOGL_INPUT_LIVE;
+static FILE* file;
+static Uint32 frame;
+static Uint32 start_ms;
+
+// replay
+static struct sogl_input_event* events;
+static long nevents, next_event;
+
+
+static bool read_events(void)
+{
+	long size = 16;
+	events = malloc(sizeof(*events) * size);
+	if (events == NULL)
+		return false;
+
+	struct sogl_input_event ev;
+	while (fread(&ev, sizeof(ev), 1, file) == 1) {
+		if (nevents == size) {
+			struct sogl_input_event* const grown = realloc(events, sizeof(*events) * size * 2);
+			if (grown == NULL)
+				return false;
+			events = grown;
+			size *= 2;
+		}
+		events[nevents++] = ev;
+		if (ev.type == SOGL_INPUT_END)
+			return true;
+	}
+
+	fprintf(stderr, "Input recording has no end, replaying it until the window closes\n");
+	return true;
+}
+
+bool sogl_input_init(const enum sogl_input_mode new_mode, const char* const path,
+                     unsigned* const seed, Uint32* const fixed_dt)
+{
+	mode = SOGL_INPUT_LIVE;
+	frame = 0;
+	nevents = next_event = 0;
+	start_ms = SDL_GetTicks();
+
+	if (new_mode == SOGL_INPUT_LIVE)
+		return true;
+
+	file = fopen(path, new_mode == SOGL_INPUT_RECORD ? "wb" : "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Couldn't open input recording %s\n", path);
+		return false;
+	}
+
+	char magic[SOGL_INPUT_MAGIC_LEN];
+	uint32_t header[2] = { *seed, *fixed_dt };
+
+	if (new_mode == SOGL_INPUT_RECORD) {
+		if (fwrite(SOGL_INPUT_MAGIC, SOGL_INPUT_MAGIC_LEN, 1, file) != 1 ||
+		    fwrite(header, sizeof(header), 1, file) != 1) {
+			fprintf(stderr, "Couldn't write input recording %s\n", path);
+			goto Lfailed;
+		}
+		printf("RECORDING INPUT TO %s SEED: %u FIXED DT: %u MS\n", path, *seed, *fixed_dt);
+	} else {
+		if (fread(magic, sizeof(magic), 1, file) != 1 ||
+		    memcmp(magic, SOGL_INPUT_MAGIC, sizeof(magic)) != 0 ||
+		    fread(header, sizeof(header), 1, file) != 1) {
+			fprintf(stderr, "Couldn't replay %s, not a sogl input recording\n", path);
+			goto Lfailed;
+		}
+		if (!read_events()) {
+			fprintf(stderr, "Couldn't allocate input events\n");
+			goto Lfailed;
+		}
+		fclose(file);
+		file = NULL;
+
+		*seed = header[0];
+		*fixed_dt = header[1];
+		printf("REPLAYING INPUT FROM %s SEED: %u FIXED DT: %u MS EVENTS: %ld\n",
+		       path, *seed, *fixed_dt, nevents);
+	}
+
+	mode = new_mode;
+	return true;
+
+Lfailed:
+	fclose(file);
+	file = NULL;
+	free(events);
+	events = NULL;
+	return false;
+}
+
+static void write_event(const Uint32 type, const SDL_Event* const event)
+{
+	struct sogl_input_event ev = {
+		.frame = frame,
+		.ms = SDL_GetTicks() - start_ms,
+		.type = type
+	};
+
+	if (event != NULL && type != SDL_QUIT) {
+		ev.scancode = event->key.keysym.scancode;
+		ev.sym = event->key.keysym.sym;
+		ev.mod = event->key.keysym.mod;
+		ev.repeat = event->key.repeat;
+	}
+
+	if (fwrite(&ev, sizeof(ev), 1, file) != 1)
+		fprintf(stderr, "Couldn't write input event\n");
+}
+
+void sogl_input_term(void)
+{
+	if (mode == SOGL_INPUT_RECORD) {
+		write_event(SOGL_INPUT_END, NULL);
+		printf("INPUT RECORDED: %u FRAMES\n", frame);
+	}
+
+	if (file != NULL)
+		fclose(file);
+	file = NULL;
+	free(events);
+	events = NULL;
+	nevents = next_event = 0;
+	mode = SOGL_INPUT_LIVE;
+}
+
+
+bool sogl_input_poll(SDL_Event* const event)
+{
+	if (mode != SOGL_INPUT_REPLAY) {
+		if (!SDL_PollEvent(event))
+			return false;
+		if (mode == SOGL_INPUT_RECORD &&
+		    (event->type == SDL_QUIT || event->type == SDL_KEYDOWN || event->type == SDL_KEYUP))
+			write_event(event->type, event);
+		return true;
+	}
+
+	// the live queue still has to be pumped, closing the window aborts
+	while (SDL_PollEvent(event)) {
+		if (event->type == SDL_QUIT)
+			return true;
+	}
+
+	if (next_event >= nevents || events[next_event].frame > frame)
+		return false;
+
+	const struct sogl_input_event* const ev = &events[next_event++];
+	memset(event, 0, sizeof(*event));
+	if (ev->type == SOGL_INPUT_END || ev->type == SDL_QUIT) {
+		event->type = SDL_QUIT;
+		// stays on the end so every later poll quits too
+		if (ev->type == SOGL_INPUT_END)
+			--next_event;
+	} else {
+		event->type = ev->type;
+		event->key.state = ev->type == SDL_KEYDOWN ? SDL_PRESSED : SDL_RELEASED;
+		event->key.repeat = ev->repeat;
+		event->key.keysym.scancode = ev->scancode;
+		event->key.keysym.sym = ev->sym;
+		event->key.keysym.mod = ev->mod;
+	}
+	event->common.timestamp = SDL_GetTicks();
+	return true;
+}
+
+void sogl_input_end_frame(void)
+{
+	++frame;
+}
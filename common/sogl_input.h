@@ -0,0 +1,58 @@
+#ifndef SOGL_INPUT_H_
+#define SOGL_INPUT_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+#define SOGL_INPUT_MAGIC     ("SOGLINP1")
+#define SOGL_INPUT_MAGIC_LEN (8)
+#define SOGL_INPUT_END       (0)  // event type ending a recorded session
+
+
+enum sogl_input_mode {
+	SOGL_INPUT_LIVE,
+	SOGL_INPUT_RECORD,
+	SOGL_INPUT_REPLAY
+};
+
+/* one recorded event as stored in the file, after the magic,
+ * the seed and the fixed frame time (uint32_t each)
+ * */
+struct sogl_input_event {
+	uint32_t frame;     // frames ended before it was polled
+	uint32_t ms;        // since sogl_input_init, informative only
+	uint32_t type;      // SDL_QUIT, SDL_KEYDOWN, SDL_KEYUP or SOGL_INPUT_END
+	int32_t scancode;
+	int32_t sym;
+	uint16_t mod;
+	uint8_t repeat;
+	uint8_t pad;
+};
+
+
+/* Input recording:
+ * a session is the seed, the fixed frame time and the keyboard and
+ * quit events tagged with the frame they were polled on. Replay
+ * injects them on the same frames whatever the frame rate, so a
+ * run with a fixed frame time goes through the same states.
+ * Live events are still polled on replay, only SDL_QUIT is kept
+ * so the window can be closed.
+ *
+ * sogl_init records to SOGL_INPUT_RECORD or replays
+ * SOGL_INPUT_REPLAY when they're set.
+ *
+ * seed and fixed_dt: stored when recording, overwritten from the
+ * file when replaying
+ * */
+extern bool sogl_input_init(enum sogl_input_mode mode, const char* path,
+                            unsigned* seed, Uint32* fixed_dt);
+
+/* recording: writes the end of the session */
+extern void sogl_input_term(void);
+
+/* SDL_PollEvent, recorded or replayed */
+extern bool sogl_input_poll(SDL_Event* event);
+
+extern void sogl_input_end_frame(void);
+
+#endif
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "sogl_jobs.h"
+#include "sogl_arena.h"
+
+
+static SDL_Thread* workers[SOGL_JOBS_MAX_THREADS];
+static int nworkers;
+
+static SDL_mutex* mutex;
+static SDL_cond* work_cond;
+static SDL_cond* done_cond;
+static bool quit;
+
+// the loop being run, guarded by mutex
+static unsigned generation;
+static sogl_job_fn job_fn;
+static void* job_data;
+static int job_count;
+static int job_batch;
+static SDL_atomic_t job_next;
+static int job_busy;    // workers inside the current loop
+static SDL_atomic_t dispatching; // 1 while a thread owns the loop above
+
+
+static void run_batches(void)
+{
+	for (;;) {
+		const int begin = SDL_AtomicAdd(&job_next, job_batch);
+		if (begin >= job_count)
+			break;
+		const int end = begin + job_batch < job_count ? begin + job_batch : job_count;
+		job_fn(job_data, begin, end);
+	}
+}
+
+static int worker_main(void* const unused)
+{
+	((void)unused);
+	unsigned seen = 0;
+
+	// the batches run inside the caller's frame, which waits for them
+	sogl_arena_attach();
+
+	SDL_LockMutex(mutex);
+	for (;;) {
+		while (!quit && seen == generation)
+			SDL_CondWait(work_cond, mutex);
+
+		if (quit)
+			break;
+
+		seen = generation;
+		++job_busy;
+		SDL_UnlockMutex(mutex);
+
+		run_batches();
+
+		SDL_LockMutex(mutex);
+		if (--job_busy == 0)
+			SDL_CondSignal(done_cond);
+	}
+	SDL_UnlockMutex(mutex);
+
+	return 0;
+}
+
+
+bool sogl_jobs_init(int nthreads)
+{
+	if (nthreads <= 0)
+		nthreads = SDL_GetCPUCount();
+	if (nthreads > SOGL_JOBS_MAX_THREADS)
+		nthreads = SOGL_JOBS_MAX_THREADS;
+
+	quit = false;
+	generation = 0;
+	nworkers = 0;
+
+	mutex = SDL_CreateMutex();
+	work_cond = SDL_CreateCond();
+	done_cond = SDL_CreateCond();
+	if (mutex == NULL || work_cond == NULL || done_cond == NULL) {
+		fprintf(stderr, "Couldn't create job sync: %s\n", SDL_GetError());
+		sogl_jobs_term();
+		return false;
+	}
+
+	// the calling thread is one of the threads
+	for (int i = 0; i < nthreads - 1; ++i) {
+		workers[i] = SDL_CreateThread(worker_main, "sogl_jobs", NULL);
+		if (workers[i] == NULL) {
+			fprintf(stderr, "Couldn't create job thread: %s\n", SDL_GetError());
+			sogl_jobs_term();
+			return false;
+		}
+		++nworkers;
+	}
+
+	return true;
+}
+
+void sogl_jobs_term(void)
+{
+	if (mutex != NULL) {
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondBroadcast(work_cond);
+		SDL_UnlockMutex(mutex);
+	}
+
+	for (int i = 0; i < nworkers; ++i)
+		SDL_WaitThread(workers[i], NULL);
+	nworkers = 0;
+
+	if (done_cond != NULL)
+		SDL_DestroyCond(done_cond);
+	if (work_cond != NULL)
+		SDL_DestroyCond(work_cond);
+	if (mutex != NULL)
+		SDL_DestroyMutex(mutex);
+
+	done_cond = work_cond = NULL;
+	mutex = NULL;
+}
+
+void sogl_jobs_parallel_for(const sogl_job_fn fn, void* const data,
+                            const int count, const int batch)
+{
+	if (count <= 0)
+		return;
+
+	/* one loop runs on the pool at a time, a caller finding it taken
+	 * (another thread, or fn calling back in) runs its loop alone
+	 * rather than waiting behind it or clobbering it
+	 * */
+	if (nworkers == 0 || count <= batch || !SDL_AtomicCAS(&dispatching, 0, 1)) {
+		fn(data, 0, count);
+		return;
+	}
+
+	SDL_LockMutex(mutex);
+	job_fn = fn;
+	job_data = data;
+	job_count = count;
+	job_batch = batch > 0 ? batch : 1;
+	SDL_AtomicSet(&job_next, 0);
+	++generation;
+	SDL_CondBroadcast(work_cond);
+	SDL_UnlockMutex(mutex);
+
+	run_batches();
+
+	// wait for the workers still finishing their last batch
+	SDL_LockMutex(mutex);
+	while (job_busy > 0)
+		SDL_CondWait(done_cond, mutex);
+	SDL_UnlockMutex(mutex);
+
+	SDL_AtomicSet(&dispatching, 0);
+}
+
+int sogl_jobs_threads(void)
+{
+	return nworkers + 1;
+}
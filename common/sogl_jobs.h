@@ -0,0 +1,31 @@
+#ifndef SOGL_JOBS_H_
+#define SOGL_JOBS_H_
+#include <stdbool.h>
+
+#define SOGL_JOBS_MAX_THREADS (64)
+
+
+/* A pool of worker threads for data parallel loops.
+ * fn is called with [begin, end) ranges of at most batch items
+ * from the workers and from the calling thread, which returns
+ * once every item is done. Without sogl_jobs_init the loop
+ * runs on the calling thread alone.
+ *
+ * Any thread may call sogl_jobs_parallel_for, but the pool runs one
+ * loop at a time: a call made while another thread's loop is on the
+ * pool, or from inside fn, runs on its calling thread alone. The
+ * render thread is never held up by a loader thread's bake.
+ * */
+typedef void (*sogl_job_fn)(void* data, int begin, int end);
+
+/* nthreads: total threads including the caller, 0 for one per CPU */
+extern bool sogl_jobs_init(int nthreads);
+extern void sogl_jobs_term(void);
+
+extern void sogl_jobs_parallel_for(sogl_job_fn fn, void* data,
+                                   int count, int batch);
+
+/* threads working on a parallel_for, including the caller */
+extern int sogl_jobs_threads(void);
+
+#endif
@@ -0,0 +1,520 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <GL/glew.h>
+#include "sogl.h"
+#include "sogl_lod.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+
+static const GLchar* const point_vs_src =
+"#version 150\n"
+"in vec3 point;\n"
+"in vec4 rgba;\n"
+"out vec4 frag_color;\n"
+"void main()\n"
+"{\n"
+"	gl_Position = vec4(point.xy, 0.0, 1.0);\n"
+"	gl_PointSize = point.z;\n"
+"	frag_color = rgba;\n"
+"}\n";
+
+static const GLchar* const point_fs_src =
+"#version 150\n"
+"in vec4 frag_color;\n"
+"out vec4 outcolor;\n"
+"void main()\n"
+"{\n"
+"	outcolor = frag_color;\n"
+"}\n";
+
+/* one triangle covering the viewport, no vertex buffer needed */
+static const GLchar* const density_vs_src =
+"#version 150\n"
+"out vec2 frag_uv;\n"
+"void main()\n"
+"{\n"
+"	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+"	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+"	frag_uv = corner;\n"
+"}\n";
+
+static const GLchar* const density_fs_src =
+"#version 150\n"
+"in vec2 frag_uv;\n"
+"out vec4 outcolor;\n"
+"uniform sampler2D density;\n"
+"void main()\n"
+"{\n"
+"	outcolor = texture(density, frag_uv);\n"
+"}\n";
+
+
+struct point {
+	GLfloat x, y, pixels;
+	uint32_t rgba;
+};
+
+
+static GLuint point_program, point_vao, point_vbo;
+static GLuint density_program, density_vao, density_tex;
+static struct point batch[SOGL_LOD_POINT_BATCH];
+static int batch_count;
+static int draw_calls;
+
+static GLfloat* density_acc; // RGB per texel, in 0-255 units
+static uint32_t* density_texels;
+static int density_w, density_h;
+static bool density_dirty;
+
+
+GLfloat sogl_lod_ndc_pixels(const GLfloat ndc_size, const int viewport_size)
+{
+	return ndc_size * viewport_size * 0.5f;
+}
+
+GLfloat sogl_lod_projected_pixels(const struct mat4* const viewproj,
+                                  const struct vec3* const center,
+                                  const GLfloat radius,
+                                  const int viewport_height)
+{
+	const GLfloat w = viewproj->vecs[0].w * center->x +
+	                  viewproj->vecs[1].w * center->y +
+	                  viewproj->vecs[2].w * center->z +
+	                  viewproj->vecs[3].w;
+
+	// the camera is inside the bounds
+	if (w <= radius)
+		return viewport_height;
+
+	/* the view is a rigid transform, so the length of the y row
+	 * is the y scale of the projection
+	 * */
+	const GLfloat sy = sqrtf(viewproj->vecs[0].y * viewproj->vecs[0].y +
+	                         viewproj->vecs[1].y * viewproj->vecs[1].y +
+	                         viewproj->vecs[2].y * viewproj->vecs[2].y);
+
+	return radius * sy / w * viewport_height;
+}
+
+enum sogl_lod_tier sogl_lod_pick(const GLfloat pixels, const struct sogl_lod_tiers* const tiers)
+{
+	if (pixels >= tiers->point_pixels)
+		return SOGL_LOD_FULL;
+	if (pixels >= tiers->density_pixels)
+		return SOGL_LOD_POINT;
+	return SOGL_LOD_DENSITY;
+}
+
+
+/*
+ * Points and density
+ * */
+static void point_vattr(const GLchar* const name, const GLint size, const GLenum type,
+                        const GLboolean normalized, const size_t offset)
+{
+	const GLint index = glGetAttribLocation(point_program, name);
+	if (index < 0)
+		return;
+
+	glEnableVertexAttribArray(index);
+	glVertexAttribPointer(index, size, type, normalized,
+	                      sizeof(struct point), (const GLvoid*)offset);
+}
+
+bool sogl_lod_init(const int viewport_width, const int viewport_height)
+{
+	batch_count = 0;
+	density_dirty = false;
+	density_w = (viewport_width + SOGL_LOD_DENSITY_DIV - 1) / SOGL_LOD_DENSITY_DIV;
+	density_h = (viewport_height + SOGL_LOD_DENSITY_DIV - 1) / SOGL_LOD_DENSITY_DIV;
+
+	density_acc = calloc((size_t)density_w * density_h, sizeof(GLfloat) * 3);
+	density_texels = malloc((size_t)density_w * density_h * sizeof(uint32_t));
+	if (density_acc == NULL || density_texels == NULL) {
+		fprintf(stderr, "Couldn't allocate LOD density texture\n");
+		goto Lalloc_failed;
+	}
+
+	point_program = sogl_create_program(point_vs_src, point_fs_src);
+	if (point_program == 0)
+		goto Lalloc_failed;
+
+	density_program = sogl_create_program(density_vs_src, density_fs_src);
+	if (density_program == 0)
+		goto Ldensity_program_failed;
+
+	glGenVertexArrays(1, &point_vao);
+	glGenBuffers(1, &point_vbo);
+	glBindVertexArray(point_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, point_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(batch), NULL, GL_STREAM_DRAW);
+
+	point_vattr("point", 3, GL_FLOAT, GL_FALSE, offsetof(struct point, x));
+	point_vattr("rgba", 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(struct point, rgba));
+
+	glGenVertexArrays(1, &density_vao);
+	glGenTextures(1, &density_tex);
+	glBindTexture(GL_TEXTURE_2D, density_tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, density_w, density_h,
+	             0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	glUseProgram(density_program);
+	glUniform1i(glGetUniformLocation(density_program, "density"), 0);
+
+	sogl_bind();
+	return true;
+
+Ldensity_program_failed:
+	glDeleteProgram(point_program);
+	point_program = 0;
+Lalloc_failed:
+	free(density_texels);
+	free(density_acc);
+	density_texels = NULL;
+	density_acc = NULL;
+	return false;
+}
+
+void sogl_lod_term(void)
+{
+	if (density_tex != 0)
+		glDeleteTextures(1, &density_tex);
+	if (density_vao != 0)
+		glDeleteVertexArrays(1, &density_vao);
+	if (point_vbo != 0)
+		glDeleteBuffers(1, &point_vbo);
+	if (point_vao != 0)
+		glDeleteVertexArrays(1, &point_vao);
+	if (density_program != 0)
+		glDeleteProgram(density_program);
+	if (point_program != 0)
+		glDeleteProgram(point_program);
+
+	free(density_texels);
+	free(density_acc);
+	density_texels = NULL;
+	density_acc = NULL;
+
+	density_tex = density_vao = point_vbo = point_vao = 0;
+	density_program = point_program = 0;
+}
+
+static void flush(void)
+{
+	if (batch_count == 0)
+		return;
+
+	glUseProgram(point_program);
+	glBindVertexArray(point_vao);
+
+	// orphan the buffer so the driver doesn't wait on the previous draw
+	sogl_upload_orphaned(point_vbo, GL_ARRAY_BUFFER, sizeof(batch),
+	                     batch, sizeof(struct point) * batch_count);
+	glDrawArrays(GL_POINTS, 0, batch_count);
+
+	batch_count = 0;
+	++draw_calls;
+}
+
+void sogl_lod_begin(void)
+{
+	draw_calls = 0;
+	batch_count = 0;
+
+	if (density_dirty) {
+		memset(density_acc, 0, (size_t)density_w * density_h * sizeof(GLfloat) * 3);
+		density_dirty = false;
+	}
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_PROGRAM_POINT_SIZE);
+}
+
+void sogl_lod_point(const GLfloat x, const GLfloat y,
+                    const GLfloat pixels, const uint32_t rgba)
+{
+	if (batch_count == SOGL_LOD_POINT_BATCH)
+		flush();
+
+	struct point* const p = &batch[batch_count++];
+	p->x = x;
+	p->y = y;
+	p->pixels = pixels;
+	p->rgba = rgba;
+}
+
+/* the color is weighted by the part of the texel the object covers,
+ * so a texel keeps the mean brightness of what falls into it
+ * */
+void sogl_lod_splat(const GLfloat x, const GLfloat y,
+                    const GLfloat pixels, const uint32_t rgba)
+{
+	const int tx = (int)((x * 0.5f + 0.5f) * density_w);
+	const int ty = (int)((y * 0.5f + 0.5f) * density_h);
+	if (tx < 0 || tx >= density_w || ty < 0 || ty >= density_h)
+		return;
+
+	const GLfloat coverage = pixels * pixels *
+	                         (1.0f / (SOGL_LOD_DENSITY_DIV * SOGL_LOD_DENSITY_DIV));
+
+	GLfloat* const acc = &density_acc[((size_t)ty * density_w + tx) * 3];
+	acc[0] += (rgba & 0xFF) * coverage;
+	acc[1] += ((rgba >> 8) & 0xFF) * coverage;
+	acc[2] += ((rgba >> 16) & 0xFF) * coverage;
+	density_dirty = true;
+}
+
+static void draw_density(void)
+{
+	const size_t ntexels = (size_t)density_w * density_h;
+	for (size_t i = 0; i < ntexels; ++i) {
+		const GLfloat* const acc = &density_acc[i * 3];
+		const uint32_t r = acc[0] < 255.0f ? (uint32_t)acc[0] : 255;
+		const uint32_t g = acc[1] < 255.0f ? (uint32_t)acc[1] : 255;
+		const uint32_t b = acc[2] < 255.0f ? (uint32_t)acc[2] : 255;
+		density_texels[i] = 0xFF000000u | (b << 16) | (g << 8) | r;
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, density_tex);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, density_w, density_h,
+	                GL_RGBA, GL_UNSIGNED_BYTE, density_texels);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	glUseProgram(density_program);
+	glBindVertexArray(density_vao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glDisable(GL_BLEND);
+
+	++draw_calls;
+}
+
+void sogl_lod_end(void)
+{
+	flush();
+
+	if (density_dirty)
+		draw_density();
+
+	// sogl_init's state, nothing is asked of GL to put it back
+	glDisable(GL_PROGRAM_POINT_SIZE);
+	glEnable(GL_DEPTH_TEST);
+
+	sogl_bind();
+}
+
+int sogl_lod_draw_calls(void)
+{
+	return draw_calls;
+}
+
+
+/*
+ * Vertex clustering
+ * */
+#define EMPTY_CELL (UINT32_MAX)
+
+struct cluster {
+	GLfloat sum[3];
+	long count;
+	long first;
+};
+
+
+static GLuint mesh_index(const struct sogl_mesh* const mesh, const long i)
+{
+	return mesh->index_type == GL_UNSIGNED_SHORT
+	       ? ((const GLushort*)mesh->indices)[i]
+	       : ((const GLuint*)mesh->indices)[i];
+}
+
+static GLfloat* vertex_pos(void* const verts, const GLsizei vertex_size,
+                           const size_t pos_offset, const long i)
+{
+	return (GLfloat*)((unsigned char*)verts + (size_t)i * vertex_size + pos_offset);
+}
+
+/* open addressing table from cell to cluster, fills vert_cluster
+ * and returns the number of clusters
+ * */
+static long cluster_vertices(const struct sogl_mesh* const mesh, const size_t pos_offset,
+                             const int grid, uint32_t* const keys, long* const values,
+                             const long table_size, struct cluster* const clusters,
+                             long* const vert_cluster)
+{
+	GLfloat min[3] = { INFINITY, INFINITY, INFINITY };
+	GLfloat max[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for (long i = 0; i < mesh->nverts; ++i) {
+		const GLfloat* const p = vertex_pos(mesh->verts, mesh->vertex_size, pos_offset, i);
+		for (int k = 0; k < 3; ++k) {
+			if (p[k] < min[k])
+				min[k] = p[k];
+			if (p[k] > max[k])
+				max[k] = p[k];
+		}
+	}
+
+	GLfloat scale[3];
+	for (int k = 0; k < 3; ++k)
+		scale[k] = max[k] > min[k] ? grid / (max[k] - min[k]) : 0;
+
+	long nclusters = 0;
+	for (long i = 0; i < mesh->nverts; ++i) {
+		const GLfloat* const p = vertex_pos(mesh->verts, mesh->vertex_size, pos_offset, i);
+
+		uint32_t cell[3];
+		for (int k = 0; k < 3; ++k) {
+			const int c = (int)((p[k] - min[k]) * scale[k]);
+			cell[k] = c < grid ? c : grid - 1;
+		}
+
+		const uint32_t key = cell[0] + (cell[1] + cell[2] * grid) * grid;
+		long slot = (key * 2654435761u) & (table_size - 1);
+		while (keys[slot] != EMPTY_CELL && keys[slot] != key)
+			slot = (slot + 1) & (table_size - 1);
+
+		if (keys[slot] == EMPTY_CELL) {
+			keys[slot] = key;
+			values[slot] = nclusters;
+			clusters[nclusters] = (struct cluster) { { 0, 0, 0 }, 0, i };
+			++nclusters;
+		}
+
+		struct cluster* const cl = &clusters[values[slot]];
+		for (int k = 0; k < 3; ++k)
+			cl->sum[k] += p[k];
+		++cl->count;
+		vert_cluster[i] = values[slot];
+	}
+
+	return nclusters;
+}
+
+bool sogl_lod_simplify(const struct sogl_mesh* const mesh, const size_t pos_offset,
+                       const int grid, struct sogl_mesh* const out)
+{
+	bool retval = false;
+	memset(out, 0, sizeof(*out));
+
+	if (grid < 1 || grid > 1024) {
+		fprintf(stderr, "Couldn't simplify mesh: grid %d out of range\n", grid);
+		return false;
+	}
+
+	long table_size = 1;
+	while (table_size < mesh->nverts * 2)
+		table_size <<= 1;
+
+	uint32_t* const keys = malloc(sizeof(uint32_t) * table_size);
+	long* const values = malloc(sizeof(long) * table_size);
+	struct cluster* const clusters = malloc(sizeof(struct cluster) * mesh->nverts);
+	long* const vert_cluster = malloc(sizeof(long) * mesh->nverts);
+	unsigned char* const tris = malloc((size_t)mesh->nindices * mesh->vertex_size);
+	if (keys == NULL || values == NULL || clusters == NULL ||
+	    vert_cluster == NULL || tris == NULL) {
+		fprintf(stderr, "Couldn't allocate mesh simplification\n");
+		goto Lfree;
+	}
+
+	memset(keys, 0xFF, sizeof(uint32_t) * table_size);
+	const long nclusters = cluster_vertices(mesh, pos_offset, grid, keys, values,
+	                                        table_size, clusters, vert_cluster);
+
+	// the first vertex of every cluster takes the mean position
+	for (long c = 0; c < nclusters; ++c) {
+		for (int k = 0; k < 3; ++k)
+			clusters[c].sum[k] /= clusters[c].count;
+	}
+
+	long ntris = 0;
+	for (long t = 0; t < mesh->nindices; t += 3) {
+		const long c0 = vert_cluster[mesh_index(mesh, t)];
+		const long c1 = vert_cluster[mesh_index(mesh, t + 1)];
+		const long c2 = vert_cluster[mesh_index(mesh, t + 2)];
+		if (c0 == c1 || c1 == c2 || c0 == c2)
+			continue;
+
+		const long corners[3] = { c0, c1, c2 };
+		for (int v = 0; v < 3; ++v) {
+			const struct cluster* const cl = &clusters[corners[v]];
+			unsigned char* const dst = &tris[(size_t)(ntris * 3 + v) * mesh->vertex_size];
+			memcpy(dst, (const unsigned char*)mesh->verts + (size_t)cl->first * mesh->vertex_size,
+			       mesh->vertex_size);
+			memcpy(dst + pos_offset, cl->sum, sizeof(GLfloat) * 3);
+		}
+		++ntris;
+	}
+
+	if (ntris == 0) {
+		fprintf(stderr, "Couldn't simplify mesh: every triangle collapsed\n");
+		goto Lfree;
+	}
+
+	retval = sogl_mesh_build(tris, ntris * 3, mesh->vertex_size, pos_offset, out);
+
+Lfree:
+	free(tris);
+	free(vert_cluster);
+	free(clusters);
+	free(values);
+	free(keys);
+	return retval;
+}
+
+bool sogl_lod_chain_build(const struct sogl_mesh* const base, const size_t pos_offset,
+                          const GLfloat full_pixels, struct sogl_lod_chain* const chain)
+{
+	memset(chain, 0, sizeof(*chain));
+	chain->levels[0] = *base;
+	chain->min_pixels[0] = full_pixels;
+	chain->nlevels = 1;
+
+	int grid = SOGL_LOD_GRID;
+	while (chain->nlevels < SOGL_LOD_MAX_LEVELS && grid >= 2) {
+		const struct sogl_mesh* const prev = &chain->levels[chain->nlevels - 1];
+		struct sogl_mesh* const level = &chain->levels[chain->nlevels];
+
+		if (!sogl_lod_simplify(base, pos_offset, grid, level))
+			break;
+
+		// nothing left to remove
+		if (level->nindices >= prev->nindices) {
+			sogl_mesh_free(level);
+			break;
+		}
+
+		chain->min_pixels[chain->nlevels] = chain->min_pixels[chain->nlevels - 1] * 0.5f;
+		++chain->nlevels;
+		grid /= 2;
+	}
+
+	chain->min_pixels[chain->nlevels - 1] = 0;
+	return chain->nlevels > 1;
+}
+
+void sogl_lod_chain_free(struct sogl_lod_chain* const chain)
+{
+	// level 0 belongs to the caller
+	for (int l = 1; l < chain->nlevels; ++l)
+		sogl_mesh_free(&chain->levels[l]);
+	chain->nlevels = 0;
+}
+
+int sogl_lod_chain_level(const struct sogl_lod_chain* const chain, const GLfloat pixels)
+{
+	int l = 0;
+	while (l < chain->nlevels - 1 && pixels < chain->min_pixels[l])
+		++l;
+	return l;
+}
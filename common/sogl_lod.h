@@ -0,0 +1,90 @@
+#ifndef SOGL_LOD_H_
+#define SOGL_LOD_H_
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <GL/glew.h>
+#include "sogl_types.h"
+#include "sogl_mesh.h"
+
+#define SOGL_LOD_MAX_LEVELS    (4)
+#define SOGL_LOD_GRID          (16)        // clustering cells per axis of the first simplified level
+#define SOGL_LOD_POINT_BATCH   (1024 * 64) // points per draw call
+#define SOGL_LOD_DENSITY_DIV   (2)         // density texels are DIV x DIV pixels
+#define SOGL_LOD_TIERS_DEFAULT { 3.0f, 1.0f }
+
+
+/* Level of detail:
+ * an object is drawn by what it covers on screen. Full geometry
+ * when it is big enough to show its shape, a single point sprite
+ * of its size in pixels when it isn't, and when it is smaller than
+ * a pixel its color weighted by its area is added into a density
+ * texture that is blended over the frame in one fullscreen draw.
+ * */
+enum sogl_lod_tier {
+	SOGL_LOD_FULL,
+	SOGL_LOD_POINT,
+	SOGL_LOD_DENSITY
+};
+
+struct sogl_lod_tiers {
+	GLfloat point_pixels;   // objects smaller than this become points
+	GLfloat density_pixels; // and smaller than this are accumulated
+};
+
+/* a mesh and its vertex clustered simplifications, level 0 is the
+ * base mesh, still owned by the caller. level l is picked while the
+ * object covers at least min_pixels[l], the cells double in size
+ * from one level to the next so min_pixels halves
+ * */
+struct sogl_lod_chain {
+	struct sogl_mesh levels[SOGL_LOD_MAX_LEVELS];
+	GLfloat min_pixels[SOGL_LOD_MAX_LEVELS];
+	int nlevels;
+};
+
+
+/* pixels covered by a size in NDC along a viewport_size pixels axis */
+extern GLfloat sogl_lod_ndc_pixels(GLfloat ndc_size, int viewport_size);
+
+/* pixels covered by the diameter of a bounding sphere */
+extern GLfloat sogl_lod_projected_pixels(const struct mat4* viewproj,
+                                         const struct vec3* center,
+                                         GLfloat radius,
+                                         int viewport_height);
+
+extern enum sogl_lod_tier sogl_lod_pick(GLfloat pixels, const struct sogl_lod_tiers* tiers);
+
+
+/* points and the density texture, x, y: center in NDC,
+ * pixels: size on screen, rgba: RGBA8 packed as 0xAABBGGRR
+ * */
+extern bool sogl_lod_init(int viewport_width, int viewport_height);
+extern void sogl_lod_term(void);
+
+/* the end leaves the depth test enabled as sogl_init does and
+ * sogl's objects bound as sogl_bind does, no GL state is queried
+ * */
+extern void sogl_lod_begin(void);
+extern void sogl_lod_point(GLfloat x, GLfloat y, GLfloat pixels, uint32_t rgba);
+extern void sogl_lod_splat(GLfloat x, GLfloat y, GLfloat pixels, uint32_t rgba);
+extern void sogl_lod_end(void);
+
+extern int sogl_lod_draw_calls(void); // of the last begin/end
+
+
+/* merges the vertices sharing a cell of a grid x grid x grid
+ * lattice over the mesh bounds into their mean position, keeping
+ * the other attributes of the first one, and drops the triangles
+ * that collapse. The result goes through sogl_mesh_build
+ * */
+extern bool sogl_lod_simplify(const struct sogl_mesh* mesh, size_t pos_offset,
+                              int grid, struct sogl_mesh* out);
+
+/* full_pixels: size from which the base mesh is drawn */
+extern bool sogl_lod_chain_build(const struct sogl_mesh* base, size_t pos_offset,
+                                 GLfloat full_pixels, struct sogl_lod_chain* chain);
+extern void sogl_lod_chain_free(struct sogl_lod_chain* chain);
+extern int sogl_lod_chain_level(const struct sogl_lod_chain* chain, GLfloat pixels);
+
+#endif
@@ -131,6 +131,38 @@ static inline void sogl_mat4_rotate(const GLfloat radians,
 
 }
 
+static inline void sogl_mat4_mul(const struct mat4* const ma,
+                                 const struct mat4* const mb,
+                                 struct mat4* const mout)
+{
+	/* column major, vecs[c] is column c: mout = ma * mb */
+	struct mat4 mr;
+	for (int c = 0; c < 4; ++c) {
+		const struct vec4* const b = &mb->vecs[c];
+		mr.vecs[c].x = ma->x0 * b->x + ma->x1 * b->y + ma->x2 * b->z + ma->x3 * b->w;
+		mr.vecs[c].y = ma->y0 * b->x + ma->y1 * b->y + ma->y2 * b->z + ma->y3 * b->w;
+		mr.vecs[c].z = ma->z0 * b->x + ma->z1 * b->y + ma->z2 * b->z + ma->z3 * b->w;
+		mr.vecs[c].w = ma->w0 * b->x + ma->w1 * b->y + ma->w2 * b->z + ma->w3 * b->w;
+	}
+	memcpy(mout, &mr, sizeof(struct mat4));
+}
+
+static inline void sogl_mat4_perspective(const GLfloat fovy_radians,
+                                         const GLfloat aspect,
+                                         const GLfloat znear,
+                                         const GLfloat zfar,
+                                         struct mat4* const mat_out)
+{
+	const GLfloat f = 1.0f / tanf(fovy_radians * 0.5f);
+	const struct mat4 p = { .vecs = {
+		{ f / aspect, 0, 0,                                    0 },
+		{ 0,          f, 0,                                    0 },
+		{ 0,          0, (zfar + znear) / (znear - zfar),     -1 },
+		{ 0,          0, 2 * zfar * znear / (znear - zfar),    0 }
+	} };
+	memcpy(mat_out, &p, sizeof(struct mat4));
+}
+
 static inline void sogl_mul_mat4_vec3(const struct mat4* const rot,
                                       const struct vec3* const vin,
                                       struct vec3* const vout)
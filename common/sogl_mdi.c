@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <GL/glew.h>
+#include "sogl.h"
+#include "sogl_mdi.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+
+struct mesh {
+	GLuint first_index;
+	GLuint count;
+	GLint base_vertex;
+};
+
+
+static GLuint program;
+static GLuint vao, vbo, ebo;
+static GLuint instance_vbo, indirect_buffer;
+static GLuint transform_buffer, transform_tex;
+static GLint draw_id_index;
+static GLsizei vertex_size;
+static bool use_indirect;
+
+static struct mesh meshes[SOGL_MDI_MAX_MESHES];
+static int nmeshes;
+static long arena_verts, arena_indices;
+
+static struct mat4 transforms[SOGL_MDI_MAX_OBJECTS];
+static int object_meshes[SOGL_MDI_MAX_OBJECTS];
+static int nobjects, max_objects;
+
+// the per frame command buffer and the transforms it draws, grouped by mesh
+static struct mat4 drawn[SOGL_MDI_MAX_OBJECTS];
+static struct sogl_mdi_command commands[SOGL_MDI_MAX_MESHES];
+static int mesh_first[SOGL_MDI_MAX_MESHES];
+static int ncommands;
+static int draw_calls;
+
+
+bool sogl_mdi_init(const GLuint prog, const GLsizei vsize)
+{
+	program = prog;
+	vertex_size = vsize;
+	nmeshes = 0;
+	nobjects = 0;
+	arena_verts = arena_indices = 0;
+
+	draw_id_index = glGetAttribLocation(program, "draw_id");
+	if (draw_id_index < 0) {
+		fprintf(stderr, "Couldn't find draw_id attribute for MDI\n");
+		return false;
+	}
+
+	GLint max_texels;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+	max_objects = max_texels / 4 < SOGL_MDI_MAX_OBJECTS ? max_texels / 4 : SOGL_MDI_MAX_OBJECTS;
+
+	use_indirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &ebo);
+	glGenBuffers(1, &instance_vbo);
+	glGenBuffers(1, &indirect_buffer);
+	glGenBuffers(1, &transform_buffer);
+	glGenTextures(1, &transform_tex);
+
+	glBindVertexArray(vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, SOGL_MDI_ARENA_BYTES, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * SOGL_MDI_ARENA_INDICES,
+	             NULL, GL_STATIC_DRAW);
+
+	/* draw ids count up once per instance starting at baseInstance,
+	 * so they never change and the buffer is static
+	 * */
+	GLint* const ids = malloc(sizeof(GLint) * max_objects);
+	if (ids == NULL) {
+		fprintf(stderr, "Couldn't allocate MDI draw ids\n");
+		return false;
+	}
+	for (int i = 0; i < max_objects; ++i)
+		ids[i] = i;
+
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLint) * max_objects, ids, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(draw_id_index);
+	glVertexAttribIPointer(draw_id_index, 1, GL_INT, sizeof(GLint), NULL);
+	glVertexAttribDivisor(draw_id_index, 1);
+	free(ids);
+
+	if (use_indirect) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(commands), NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, transform_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(struct mat4) * max_objects, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glActiveTexture(GL_TEXTURE0 + SOGL_MDI_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, transform_tex);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, transform_buffer);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "transforms"), SOGL_MDI_TEXTURE_UNIT);
+
+	printf("MDI: %s, UP TO %d OBJECTS\n",
+	       use_indirect ? "glMultiDrawElementsIndirect" : "glDrawElementsInstancedBaseVertex",
+	       max_objects);
+
+	sogl_bind();
+	return true;
+}
+
+void sogl_mdi_term(void)
+{
+	if (transform_tex != 0)
+		glDeleteTextures(1, &transform_tex);
+	if (transform_buffer != 0)
+		glDeleteBuffers(1, &transform_buffer);
+	if (indirect_buffer != 0)
+		glDeleteBuffers(1, &indirect_buffer);
+	if (instance_vbo != 0)
+		glDeleteBuffers(1, &instance_vbo);
+	if (ebo != 0)
+		glDeleteBuffers(1, &ebo);
+	if (vbo != 0)
+		glDeleteBuffers(1, &vbo);
+	if (vao != 0)
+		glDeleteVertexArrays(1, &vao);
+
+	transform_tex = transform_buffer = indirect_buffer = 0;
+	instance_vbo = ebo = vbo = vao = 0;
+	nmeshes = nobjects = 0;
+}
+
+void sogl_mdi_vattrp(const GLchar* const attrib_name,
+                     const GLint size,
+                     const GLenum type,
+                     const GLboolean normalized,
+                     const size_t offset)
+{
+	const GLint index = glGetAttribLocation(program, attrib_name);
+	if (index < 0)
+		return;
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glEnableVertexAttribArray(index);
+	glVertexAttribPointer(index, size, type, normalized,
+	                      vertex_size, (const GLvoid*)offset);
+
+	sogl_bind();
+}
+
+int sogl_mdi_add_mesh(const struct sogl_mesh* const mesh)
+{
+	if (mesh->vertex_size != vertex_size) {
+		fprintf(stderr, "Couldn't add mesh to MDI arena: vertex size %d != %d\n",
+		        mesh->vertex_size, vertex_size);
+		return -1;
+	}
+
+	if (nmeshes == SOGL_MDI_MAX_MESHES ||
+	    (arena_verts + mesh->nverts) * vertex_size > SOGL_MDI_ARENA_BYTES ||
+	    arena_indices + mesh->nindices > SOGL_MDI_ARENA_INDICES) {
+		fprintf(stderr, "Couldn't add mesh to MDI arena: arena is full\n");
+		return -1;
+	}
+
+	// the arena is always 32 bit indexed, meshes keep their own numbering
+	GLuint* const indices = malloc(sizeof(GLuint) * mesh->nindices);
+	if (indices == NULL) {
+		fprintf(stderr, "Couldn't allocate MDI mesh indices\n");
+		return -1;
+	}
+
+	for (long i = 0; i < mesh->nindices; ++i) {
+		indices[i] = mesh->index_type == GL_UNSIGNED_SHORT
+		             ? ((const GLushort*)mesh->indices)[i]
+		             : ((const GLuint*)mesh->indices)[i];
+	}
+
+	// upload through the copy target so no VAO state changes
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, arena_verts * vertex_size,
+	                mesh->nverts * vertex_size, mesh->verts);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, arena_indices * sizeof(GLuint),
+	                mesh->nindices * sizeof(GLuint), indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	free(indices);
+
+	struct mesh* const m = &meshes[nmeshes];
+	m->first_index = arena_indices;
+	m->count = mesh->nindices;
+	m->base_vertex = arena_verts;
+
+	arena_verts += mesh->nverts;
+	arena_indices += mesh->nindices;
+
+	return nmeshes++;
+}
+
+int sogl_mdi_add_object(const int mesh)
+{
+	if (nobjects == max_objects) {
+		fprintf(stderr, "MDI object limit reached\n");
+		return -1;
+	}
+
+	const int object = nobjects++;
+	object_meshes[object] = mesh;
+	transforms[object] = SOGL_MAT4_IDENTITY;
+	return object;
+}
+
+void sogl_mdi_set_transform(const int object, const struct mat4* const transform)
+{
+	transforms[object] = *transform;
+}
+
+void sogl_mdi_set_mesh(const int object, const int mesh)
+{
+	object_meshes[object] = mesh;
+}
+
+
+/*
+ * Drawing
+ * */
+
+/* counting sort of the objects by mesh, every mesh with objects
+ * becomes one command instancing them, and their transforms are
+ * gathered in draw order. objects NULL means all
+ * */
+static int build_commands(const int* const objects, const int count)
+{
+	memset(mesh_first, 0, sizeof(int) * nmeshes);
+	for (int i = 0; i < count; ++i)
+		++mesh_first[object_meshes[objects != NULL ? objects[i] : i]];
+
+	ncommands = 0;
+	int first = 0;
+	for (int m = 0; m < nmeshes; ++m) {
+		const int n = mesh_first[m];
+		mesh_first[m] = first;
+		if (n == 0)
+			continue;
+
+		struct sogl_mdi_command* const cmd = &commands[ncommands++];
+		cmd->count = meshes[m].count;
+		cmd->instance_count = n;
+		cmd->first_index = meshes[m].first_index;
+		cmd->base_vertex = meshes[m].base_vertex;
+		cmd->base_instance = first;
+		first += n;
+	}
+
+	for (int i = 0; i < count; ++i) {
+		const int object = objects != NULL ? objects[i] : i;
+		drawn[mesh_first[object_meshes[object]]++] = transforms[object];
+	}
+
+	return first;
+}
+
+void sogl_mdi_draw(const int* const objects, const int nobjs)
+{
+	draw_calls = 0;
+
+	const int ninstances = build_commands(objects, nobjs);
+	if (ninstances == 0)
+		return;
+
+	// orphan the per frame buffers so the driver doesn't wait on the previous draw
+	sogl_upload_orphaned(transform_buffer, GL_TEXTURE_BUFFER, sizeof(struct mat4) * max_objects,
+	                     drawn, sizeof(struct mat4) * ninstances);
+
+	glUseProgram(program);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+
+	glActiveTexture(GL_TEXTURE0 + SOGL_MDI_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, transform_tex);
+	glActiveTexture(GL_TEXTURE0);
+
+	if (use_indirect) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+		sogl_upload_orphaned(indirect_buffer, GL_DRAW_INDIRECT_BUFFER, sizeof(commands),
+		                     commands, sizeof(struct sogl_mdi_command) * ncommands);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, ncommands, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		draw_calls = 1;
+	} else {
+		// no baseInstance before GL 4.2, so the draw ids are offset by hand
+		for (int i = 0; i < ncommands; ++i) {
+			const struct sogl_mdi_command* const cmd = &commands[i];
+			glVertexAttribIPointer(draw_id_index, 1, GL_INT, sizeof(GLint),
+			                       (const GLvoid*)(sizeof(GLint) * cmd->base_instance));
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, cmd->count, GL_UNSIGNED_INT,
+			                                  (const GLvoid*)(sizeof(GLuint) * cmd->first_index),
+			                                  cmd->instance_count, cmd->base_vertex);
+		}
+		glVertexAttribIPointer(draw_id_index, 1, GL_INT, sizeof(GLint), NULL);
+		draw_calls = ncommands;
+	}
+
+	sogl_bind();
+}
+
+void sogl_mdi_draw_all(void)
+{
+	sogl_mdi_draw(NULL, nobjects);
+}
+
+int sogl_mdi_objects(void)
+{
+	return nobjects;
+}
+
+int sogl_mdi_draw_calls(void)
+{
+	return draw_calls;
+}
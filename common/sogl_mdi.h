@@ -0,0 +1,77 @@
+#ifndef SOGL_MDI_H_
+#define SOGL_MDI_H_
+#include <stdbool.h>
+#include <stddef.h>
+#include <GL/glew.h>
+#include "sogl_types.h"
+#include "sogl_mesh.h"
+
+#define SOGL_MDI_ARENA_BYTES   (1024l * 1024l * 16l) // shared vertex arena
+#define SOGL_MDI_ARENA_INDICES (1024l * 1024l * 4l)  // shared GLuint index arena
+#define SOGL_MDI_MAX_MESHES    (256)
+#define SOGL_MDI_MAX_OBJECTS   (1024 * 256)
+#define SOGL_MDI_TEXTURE_UNIT  (7)                   // unit the transforms are bound to
+
+
+/* Multi-draw indirect renderer:
+ * every mesh lives in one vertex and index arena, and a frame is a
+ * single glMultiDrawElementsIndirect with one command per mesh, each
+ * command instancing the drawn objects of that mesh.
+ * Only the transforms of the drawn objects are uploaded, packed in
+ * draw order into a buffer texture. The vertex shader finds its
+ * transform through the per-instance attribute "draw_id" (advanced
+ * by baseInstance), 4 texels per transform:
+ *
+ *   #version 150
+ *   in int draw_id;
+ *   uniform samplerBuffer transforms;
+ *   mat4 model = mat4(texelFetch(transforms, draw_id * 4),
+ *                     texelFetch(transforms, draw_id * 4 + 1),
+ *                     texelFetch(transforms, draw_id * 4 + 2),
+ *                     texelFetch(transforms, draw_id * 4 + 3));
+ *
+ * Without GL 4.3 / ARB_multi_draw_indirect it falls back to one
+ * glDrawElementsInstancedBaseVertex per mesh.
+ * */
+struct sogl_mdi_command {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+
+
+/* program must declare draw_id and transforms as above,
+ * all meshes share the vertex layout of vertex_size bytes
+ * */
+extern bool sogl_mdi_init(GLuint program, GLsizei vertex_size);
+extern void sogl_mdi_term(void);
+
+/* vertex attributes of the arena, like sogl_vattrp */
+extern void sogl_mdi_vattrp(const GLchar* attrib_name,
+                            GLint size,
+                            GLenum type,
+                            GLboolean normalized,
+                            size_t offset);
+
+/* copies the mesh into the arenas, returns the mesh id or -1 */
+extern int sogl_mdi_add_mesh(const struct sogl_mesh* mesh);
+
+/* returns the object id or -1, the transform starts as identity */
+extern int sogl_mdi_add_object(int mesh);
+extern void sogl_mdi_set_transform(int object, const struct mat4* transform);
+
+/* switches the mesh an object is drawn with, e.g. to a LOD level */
+extern void sogl_mdi_set_mesh(int object, int mesh);
+
+/* draws every object, or just the given ones (e.g. the visible ones),
+ * submission cost is proportional to the objects drawn
+ * */
+extern void sogl_mdi_draw_all(void);
+extern void sogl_mdi_draw(const int* objects, int nobjects);
+
+extern int sogl_mdi_objects(void);
+extern int sogl_mdi_draw_calls(void); // of the last draw
+
+#endif
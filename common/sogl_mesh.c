@@ -0,0 +1,592 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <GL/glew.h>
+#include "sogl_mesh.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+
+/*
+ * Vertex welding
+ * */
+static uint64_t hash_bytes(const unsigned char* const data, const GLsizei size)
+{
+	// FNV-1a
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (GLsizei i = 0; i < size; ++i) {
+		h ^= data[i];
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+long sogl_mesh_weld(const void* const verts, const long nverts,
+                    const GLsizei vertex_size,
+                    void* const out_verts, GLuint* const out_indices)
+{
+	const unsigned char* const src = verts;
+	unsigned char* const dst = out_verts;
+
+	long table_size = 1;
+	while (table_size < nverts * 2)
+		table_size <<= 1;
+
+	long* const table = malloc(sizeof(long) * table_size);
+	if (table == NULL) {
+		fprintf(stderr, "Couldn't allocate weld table\n");
+		return -1;
+	}
+
+	for (long i = 0; i < table_size; ++i)
+		table[i] = -1;
+
+	long nunique = 0;
+	for (long i = 0; i < nverts; ++i) {
+		const unsigned char* const v = src + i * vertex_size;
+		long slot = hash_bytes(v, vertex_size) & (table_size - 1);
+
+		for (;;) {
+			const long entry = table[slot];
+			if (entry == -1) {
+				memcpy(dst + nunique * vertex_size, v, vertex_size);
+				table[slot] = nunique;
+				out_indices[i] = nunique++;
+				break;
+			} else if (memcmp(dst + entry * vertex_size, v, vertex_size) == 0) {
+				out_indices[i] = entry;
+				break;
+			}
+			slot = (slot + 1) & (table_size - 1);
+		}
+	}
+
+	free(table);
+	return nunique;
+}
+
+
+/*
+ * Post-transform cache optimization (Tom Forsyth's linear-speed algorithm)
+ * */
+#define VCACHE_MAX_VALENCE_SCORE (32)
+
+static float cache_pos_scores[SOGL_MESH_CACHE_SIZE];
+static float valence_scores[VCACHE_MAX_VALENCE_SCORE];
+static bool scores_ready = false;
+
+static void init_scores(void)
+{
+	for (int i = 0; i < SOGL_MESH_CACHE_SIZE; ++i) {
+		if (i < 3) {
+			// the last triangle's vertices get a fixed score
+			// so it doesn't matter which order they went in
+			cache_pos_scores[i] = 0.75f;
+		} else {
+			const float s = 1.0f - (float)(i - 3) / (SOGL_MESH_CACHE_SIZE - 3);
+			cache_pos_scores[i] = powf(s, 1.5f);
+		}
+	}
+
+	for (int i = 1; i < VCACHE_MAX_VALENCE_SCORE; ++i)
+		valence_scores[i] = 2.0f * powf((float)i, -0.5f);
+
+	scores_ready = true;
+}
+
+static float vertex_score(const int cache_pos, const long valence)
+{
+	if (valence == 0)
+		return -1.0f;
+
+	float score = cache_pos >= 0 ? cache_pos_scores[cache_pos] : 0.0f;
+
+	if (valence < VCACHE_MAX_VALENCE_SCORE)
+		score += valence_scores[valence];
+	else
+		score += 2.0f * powf((float)valence, -0.5f);
+
+	return score;
+}
+
+void sogl_mesh_optimize_vcache(GLuint* const indices, const long nindices,
+                               const long nverts)
+{
+	const long ntris = nindices / 3;
+	if (ntris == 0)
+		return;
+
+	if (!scores_ready)
+		init_scores();
+
+	long* const valence = calloc(nverts, sizeof(long));
+	long* const adj_offset = malloc(sizeof(long) * (nverts + 1));
+	long* const adj = malloc(sizeof(long) * ntris * 3);
+	int* const cache_pos = malloc(sizeof(int) * nverts);
+	float* const vscore = malloc(sizeof(float) * nverts);
+	float* const tscore = malloc(sizeof(float) * ntris);
+	bool* const emitted = calloc(ntris, sizeof(bool));
+	GLuint* const out = malloc(sizeof(GLuint) * ntris * 3);
+
+	if (!valence || !adj_offset || !adj || !cache_pos ||
+	    !vscore || !tscore || !emitted || !out) {
+		fprintf(stderr, "Couldn't allocate vertex cache optimizer data\n");
+		goto Lfree;
+	}
+
+	for (long i = 0; i < ntris * 3; ++i)
+		++valence[indices[i]];
+
+	// build vertex -> triangle adjacency
+	adj_offset[0] = 0;
+	for (long v = 0; v < nverts; ++v)
+		adj_offset[v + 1] = adj_offset[v] + valence[v];
+
+	for (long v = 0; v < nverts; ++v)
+		valence[v] = 0;
+
+	for (long t = 0; t < ntris; ++t) {
+		for (int k = 0; k < 3; ++k) {
+			const GLuint v = indices[t * 3 + k];
+			adj[adj_offset[v] + valence[v]++] = t;
+		}
+	}
+
+	for (long v = 0; v < nverts; ++v) {
+		cache_pos[v] = -1;
+		vscore[v] = vertex_score(-1, valence[v]);
+	}
+
+	long best_tri = 0;
+	float best_score = -1.0f;
+	for (long t = 0; t < ntris; ++t) {
+		tscore[t] = vscore[indices[t * 3]] +
+		            vscore[indices[t * 3 + 1]] +
+		            vscore[indices[t * 3 + 2]];
+		if (tscore[t] > best_score) {
+			best_score = tscore[t];
+			best_tri = t;
+		}
+	}
+
+	// cache has 3 extra slots for the vertices pushed out by the new triangle
+	long cache[SOGL_MESH_CACHE_SIZE + 3];
+	long cache_count = 0;
+	long scan_cursor = 0;
+
+	for (long n = 0; n < ntris; ++n) {
+		if (best_tri < 0) {
+			// nothing in the cache has triangles left, get the next one in order
+			while (emitted[scan_cursor])
+				++scan_cursor;
+			best_tri = scan_cursor;
+		}
+
+		const GLuint* const tri = &indices[best_tri * 3];
+		memcpy(&out[n * 3], tri, sizeof(GLuint) * 3);
+		emitted[best_tri] = true;
+
+		// remove the triangle from its vertices' adjacency
+		for (int k = 0; k < 3; ++k) {
+			const GLuint v = tri[k];
+			long* const list = &adj[adj_offset[v]];
+			for (long i = 0; i < valence[v]; ++i) {
+				if (list[i] == best_tri) {
+					list[i] = list[valence[v] - 1];
+					break;
+				}
+			}
+			--valence[v];
+		}
+
+		// push the triangle's vertices to the front of the LRU cache
+		long new_cache[SOGL_MESH_CACHE_SIZE + 3];
+		long new_count = 0;
+		for (int k = 0; k < 3; ++k)
+			new_cache[new_count++] = tri[k];
+		for (long i = 0; i < cache_count; ++i) {
+			const long v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				new_cache[new_count++] = v;
+		}
+
+		for (long i = 0; i < new_count; ++i) {
+			const long v = new_cache[i];
+			cache_pos[v] = i < SOGL_MESH_CACHE_SIZE ? i : -1;
+			vscore[v] = vertex_score(cache_pos[v], valence[v]);
+		}
+
+		// rescore the triangles touching the cached vertices
+		best_tri = -1;
+		best_score = -1.0f;
+		for (long i = 0; i < new_count; ++i) {
+			const long v = new_cache[i];
+			const long* const list = &adj[adj_offset[v]];
+			for (long j = 0; j < valence[v]; ++j) {
+				const long t = list[j];
+				const float s = vscore[indices[t * 3]] +
+				                vscore[indices[t * 3 + 1]] +
+				                vscore[indices[t * 3 + 2]];
+				tscore[t] = s;
+				if (s > best_score) {
+					best_score = s;
+					best_tri = t;
+				}
+			}
+		}
+
+		cache_count = new_count < SOGL_MESH_CACHE_SIZE ? new_count : SOGL_MESH_CACHE_SIZE;
+		memcpy(cache, new_cache, sizeof(long) * cache_count);
+	}
+
+	memcpy(indices, out, sizeof(GLuint) * ntris * 3);
+
+Lfree:
+	free(out);
+	free(emitted);
+	free(tscore);
+	free(vscore);
+	free(cache_pos);
+	free(adj);
+	free(adj_offset);
+	free(valence);
+}
+
+
+float sogl_mesh_acmr(const GLuint* const indices, const long nindices,
+                     const long nverts, const int cache_size)
+{
+	const long ntris = nindices / 3;
+	if (ntris == 0)
+		return 0.0f;
+
+	// FIFO cache simulated with insertion timestamps
+	long* const stamp = malloc(sizeof(long) * nverts);
+	if (stamp == NULL)
+		return 0.0f;
+
+	for (long v = 0; v < nverts; ++v)
+		stamp[v] = -cache_size - 1;
+
+	long clock = 0, misses = 0;
+	for (long i = 0; i < ntris * 3; ++i) {
+		const GLuint v = indices[i];
+		if (clock - stamp[v] > cache_size) {
+			stamp[v] = clock++;
+			++misses;
+		}
+	}
+
+	free(stamp);
+	return (float)misses / ntris;
+}
+
+
+/*
+ * Overdraw optimization: split the cache optimized triangle order into
+ * clusters at the points where the cache restarts, then sort the clusters
+ * so the ones facing outwards from the mesh center are drawn first
+ * */
+struct cluster {
+	float sort_key;
+	long first_tri;
+	long ntris;
+};
+
+static int cmp_cluster(const void* const a, const void* const b)
+{
+	const float ka = ((const struct cluster*)a)->sort_key;
+	const float kb = ((const struct cluster*)b)->sort_key;
+	return (ka < kb) - (ka > kb);
+}
+
+static const GLfloat* vertex_pos(const void* const verts, const GLsizei vertex_size,
+                                 const size_t pos_offset, const GLuint v)
+{
+	return (const GLfloat*)((const unsigned char*)verts + (size_t)v * vertex_size + pos_offset);
+}
+
+void sogl_mesh_optimize_overdraw(GLuint* const indices, const long nindices,
+                                 const void* const verts, const long nverts,
+                                 const GLsizei vertex_size, const size_t pos_offset,
+                                 const float threshold)
+{
+	const long ntris = nindices / 3;
+	if (ntris < 2)
+		return;
+
+	struct cluster* const clusters = malloc(sizeof(struct cluster) * ntris);
+	long* const stamp = malloc(sizeof(long) * nverts);
+	GLuint* const out = malloc(sizeof(GLuint) * ntris * 3);
+	if (!clusters || !stamp || !out) {
+		fprintf(stderr, "Couldn't allocate overdraw optimizer data\n");
+		goto Lfree;
+	}
+
+	// hard boundaries: triangles that miss the FIFO cache on every vertex
+	for (long v = 0; v < nverts; ++v)
+		stamp[v] = -SOGL_MESH_FIFO_SIZE - 1;
+
+	long nclusters = 0, clock = 0;
+	for (long t = 0; t < ntris; ++t) {
+		int misses = 0;
+		for (int k = 0; k < 3; ++k) {
+			const GLuint v = indices[t * 3 + k];
+			if (clock - stamp[v] > SOGL_MESH_FIFO_SIZE) {
+				stamp[v] = clock++;
+				++misses;
+			}
+		}
+
+		if (t == 0 || misses == 3) {
+			clusters[nclusters].first_tri = t;
+			clusters[nclusters].ntris = 0;
+			++nclusters;
+		}
+		++clusters[nclusters - 1].ntris;
+	}
+
+	if (nclusters < 2)
+		goto Lfree;
+
+	GLfloat center[3] = { 0, 0, 0 };
+	for (long v = 0; v < nverts; ++v) {
+		const GLfloat* const p = vertex_pos(verts, vertex_size, pos_offset, v);
+		center[0] += p[0];
+		center[1] += p[1];
+		center[2] += p[2];
+	}
+	center[0] /= nverts;
+	center[1] /= nverts;
+	center[2] /= nverts;
+
+	for (long c = 0; c < nclusters; ++c) {
+		GLfloat centroid[3] = { 0, 0, 0 };
+		GLfloat normal[3] = { 0, 0, 0 };
+		GLfloat area_sum = 0;
+
+		for (long t = clusters[c].first_tri;
+		     t < clusters[c].first_tri + clusters[c].ntris; ++t) {
+			const GLfloat* const a = vertex_pos(verts, vertex_size, pos_offset, indices[t * 3]);
+			const GLfloat* const b = vertex_pos(verts, vertex_size, pos_offset, indices[t * 3 + 1]);
+			const GLfloat* const d = vertex_pos(verts, vertex_size, pos_offset, indices[t * 3 + 2]);
+
+			const GLfloat e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			const GLfloat e1[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+			const GLfloat n[3] = {
+				e0[1] * e1[2] - e0[2] * e1[1],
+				e0[2] * e1[0] - e0[0] * e1[2],
+				e0[0] * e1[1] - e0[1] * e1[0]
+			};
+			const GLfloat area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			// area weighted centroid and normal
+			for (int k = 0; k < 3; ++k) {
+				centroid[k] += (a[k] + b[k] + d[k]) * (area / 3.0f);
+				normal[k] += n[k];
+			}
+			area_sum += area;
+		}
+
+		const GLfloat nlen = sqrtf(normal[0] * normal[0] +
+		                           normal[1] * normal[1] +
+		                           normal[2] * normal[2]);
+		if (area_sum > 0)
+			for (int k = 0; k < 3; ++k)
+				centroid[k] /= area_sum;
+
+		clusters[c].sort_key = 0;
+		if (nlen > 0) {
+			for (int k = 0; k < 3; ++k)
+				clusters[c].sort_key += (centroid[k] - center[k]) * (normal[k] / nlen);
+		}
+	}
+
+	qsort(clusters, nclusters, sizeof(struct cluster), cmp_cluster);
+
+	long n = 0;
+	for (long c = 0; c < nclusters; ++c) {
+		memcpy(&out[n * 3], &indices[clusters[c].first_tri * 3],
+		       sizeof(GLuint) * clusters[c].ntris * 3);
+		n += clusters[c].ntris;
+	}
+
+	// keep the new order only if it doesn't cost too much vertex cache
+	const float acmr_before = sogl_mesh_acmr(indices, nindices, nverts, SOGL_MESH_FIFO_SIZE);
+	const float acmr_after = sogl_mesh_acmr(out, nindices, nverts, SOGL_MESH_FIFO_SIZE);
+	if (acmr_after <= acmr_before * threshold)
+		memcpy(indices, out, sizeof(GLuint) * ntris * 3);
+
+Lfree:
+	free(out);
+	free(stamp);
+	free(clusters);
+}
+
+
+/*
+ * Vertex fetch optimization: vertices in the order they're first referenced
+ * */
+void sogl_mesh_optimize_vfetch(void* const verts, const long nverts,
+                               const GLsizei vertex_size,
+                               GLuint* const indices, const long nindices)
+{
+	long* const remap = malloc(sizeof(long) * nverts);
+	unsigned char* const tmp = malloc((size_t)nverts * vertex_size);
+	if (!remap || !tmp) {
+		fprintf(stderr, "Couldn't allocate vertex fetch optimizer data\n");
+		goto Lfree;
+	}
+
+	for (long v = 0; v < nverts; ++v)
+		remap[v] = -1;
+
+	long next = 0;
+	for (long i = 0; i < nindices; ++i) {
+		const GLuint v = indices[i];
+		if (remap[v] == -1)
+			remap[v] = next++;
+		indices[i] = remap[v];
+	}
+
+	// unreferenced vertices go to the end
+	for (long v = 0; v < nverts; ++v)
+		if (remap[v] == -1)
+			remap[v] = next++;
+
+	for (long v = 0; v < nverts; ++v)
+		memcpy(tmp + remap[v] * vertex_size,
+		       (unsigned char*)verts + v * vertex_size, vertex_size);
+
+	memcpy(verts, tmp, (size_t)nverts * vertex_size);
+
+Lfree:
+	free(tmp);
+	free(remap);
+}
+
+
+bool sogl_mesh_build(const void* const verts, const long nverts,
+                     const GLsizei vertex_size, const size_t pos_offset,
+                     struct sogl_mesh* const mesh)
+{
+	memset(mesh, 0, sizeof(*mesh));
+
+	void* const welded = malloc((size_t)nverts * vertex_size);
+	GLuint* const indices = malloc(sizeof(GLuint) * nverts);
+	if (welded == NULL || indices == NULL) {
+		fprintf(stderr, "Couldn't allocate mesh\n");
+		free(welded);
+		free(indices);
+		return false;
+	}
+
+	const long nunique = sogl_mesh_weld(verts, nverts, vertex_size, welded, indices);
+	if (nunique < 0) {
+		free(welded);
+		free(indices);
+		return false;
+	}
+
+	const float acmr_welded = sogl_mesh_acmr(indices, nverts, nunique, SOGL_MESH_FIFO_SIZE);
+
+	sogl_mesh_optimize_vcache(indices, nverts, nunique);
+	sogl_mesh_optimize_overdraw(indices, nverts, welded, nunique,
+	                            vertex_size, pos_offset, 1.05f);
+	sogl_mesh_optimize_vfetch(welded, nunique, vertex_size, indices, nverts);
+
+	const float acmr_optimized = sogl_mesh_acmr(indices, nverts, nunique, SOGL_MESH_FIFO_SIZE);
+
+	printf("MESH: %ld -> %ld VERTICES, %ld TRIANGLES\n"
+	       "ACMR: unindexed 3.000, welded %.3f, optimized %.3f\n",
+	       nverts, nunique, nverts / 3, acmr_welded, acmr_optimized);
+
+	mesh->verts = realloc(welded, (size_t)nunique * vertex_size);
+	if (mesh->verts == NULL)
+		mesh->verts = welded;
+
+	mesh->nverts = nunique;
+	mesh->nindices = nverts;
+	mesh->vertex_size = vertex_size;
+
+	if (nunique <= 0xFFFF) {
+		GLushort* const packed = malloc(sizeof(GLushort) * nverts);
+		if (packed == NULL) {
+			fprintf(stderr, "Couldn't allocate mesh indices\n");
+			free(indices);
+			sogl_mesh_free(mesh);
+			return false;
+		}
+
+		for (long i = 0; i < nverts; ++i)
+			packed[i] = (GLushort)indices[i];
+
+		free(indices);
+		mesh->indices = packed;
+		mesh->index_type = GL_UNSIGNED_SHORT;
+	} else {
+		mesh->indices = indices;
+		mesh->index_type = GL_UNSIGNED_INT;
+	}
+
+	return true;
+}
+
+bool sogl_mesh_build_quads(const void* const verts, const long nverts,
+                           const GLsizei vertex_size, const size_t pos_offset,
+                           struct sogl_mesh* const mesh)
+{
+	static const int quad_tris[6] = { 0, 1, 2, 0, 2, 3 };
+	const long nquads = nverts / 4;
+
+	unsigned char* const tris = malloc((size_t)nquads * 6 * vertex_size);
+	if (tris == NULL) {
+		fprintf(stderr, "Couldn't allocate mesh\n");
+		return false;
+	}
+
+	for (long q = 0; q < nquads; ++q) {
+		for (int k = 0; k < 6; ++k) {
+			memcpy(tris + (q * 6 + k) * vertex_size,
+			       (const unsigned char*)verts + (q * 4 + quad_tris[k]) * vertex_size,
+			       vertex_size);
+		}
+	}
+
+	const bool ret = sogl_mesh_build(tris, nquads * 6, vertex_size, pos_offset, mesh);
+	free(tris);
+	return ret;
+}
+
+void sogl_mesh_free(struct sogl_mesh* const mesh)
+{
+	if (mesh->ebo != 0)
+		glDeleteBuffers(1, &mesh->ebo);
+
+	free(mesh->indices);
+	free(mesh->verts);
+	memset(mesh, 0, sizeof(*mesh));
+}
+
+
+void sogl_mesh_upload(struct sogl_mesh* const mesh, const GLenum usage)
+{
+	const size_t index_size = mesh->index_type == GL_UNSIGNED_SHORT
+	                          ? sizeof(GLushort) : sizeof(GLuint);
+
+	if (mesh->ebo == 0)
+		glGenBuffers(1, &mesh->ebo);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->nindices * index_size,
+	             mesh->indices, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, mesh->nverts * mesh->vertex_size,
+	             mesh->verts, usage);
+}
+
+void sogl_mesh_draw(const struct sogl_mesh* const mesh)
+{
+	glDrawElements(GL_TRIANGLES, mesh->nindices, mesh->index_type, NULL);
+}
@@ -0,0 +1,70 @@
+#ifndef SOGL_MESH_H_
+#define SOGL_MESH_H_
+#include <stdbool.h>
+#include <stddef.h>
+#include <GL/glew.h>
+
+#define SOGL_MESH_CACHE_SIZE (32)  // post-transform cache entries we optimize for
+#define SOGL_MESH_FIFO_SIZE  (16)  // FIFO size used when reporting ACMR
+
+
+/* An indexed triangle list ready to be sent to the GPU.
+ * verts is tightly packed with vertex_size bytes per vertex,
+ * indices is GLushort or GLuint depending on index_type
+ * */
+struct sogl_mesh {
+	void* verts;
+	void* indices;
+	long nverts;
+	long nindices;
+	GLsizei vertex_size;
+	GLenum index_type;
+	GLuint ebo;
+};
+
+
+/* Welds, reorders for the post-transform cache and for overdraw,
+ * reorders vertices for fetch locality and packs the indices into
+ * 16 or 32 bits. pos_offset is the offset of the vec3 position
+ * inside the vertex, used by the overdraw pass.
+ * Prints the ACMR before and after the optimization.
+ * */
+extern bool sogl_mesh_build(const void* verts, long nverts,
+                            GLsizei vertex_size, size_t pos_offset,
+                            struct sogl_mesh* mesh);
+
+/* same as sogl_mesh_build for vertices laid out as GL_QUADS */
+extern bool sogl_mesh_build_quads(const void* verts, long nverts,
+                                  GLsizei vertex_size, size_t pos_offset,
+                                  struct sogl_mesh* mesh);
+
+extern void sogl_mesh_free(struct sogl_mesh* mesh);
+
+/* creates the element buffer, binds it to the current VAO,
+ * and uploads the vertices to the current GL_ARRAY_BUFFER
+ * */
+extern void sogl_mesh_upload(struct sogl_mesh* mesh, GLenum usage);
+extern void sogl_mesh_draw(const struct sogl_mesh* mesh);
+
+
+/* building blocks used by sogl_mesh_build */
+extern long sogl_mesh_weld(const void* verts, long nverts,
+                           GLsizei vertex_size,
+                           void* out_verts, GLuint* out_indices);
+
+extern void sogl_mesh_optimize_vcache(GLuint* indices, long nindices,
+                                      long nverts);
+
+extern void sogl_mesh_optimize_overdraw(GLuint* indices, long nindices,
+                                        const void* verts, long nverts,
+                                        GLsizei vertex_size, size_t pos_offset,
+                                        float threshold);
+
+extern void sogl_mesh_optimize_vfetch(void* verts, long nverts,
+                                      GLsizei vertex_size,
+                                      GLuint* indices, long nindices);
+
+extern float sogl_mesh_acmr(const GLuint* indices, long nindices,
+                            long nverts, int cache_size);
+
+#endif
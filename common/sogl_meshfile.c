@@ -0,0 +1,302 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <GL/glew.h>
+#include "sogl.h"
+#include "sogl_meshfile.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+
+static uint64_t align_up(const uint64_t value)
+{
+	return (value + SOGL_MESHFILE_ALIGN - 1) & ~(uint64_t)(SOGL_MESHFILE_ALIGN - 1);
+}
+
+static bool write_padded(FILE* const file, const void* const data,
+                         const uint64_t bytes, const uint64_t padded)
+{
+	static const unsigned char zeros[SOGL_MESHFILE_ALIGN];
+
+	if (bytes > 0 && fwrite(data, 1, bytes, file) != bytes)
+		return false;
+
+	for (uint64_t left = padded - bytes; left > 0;) {
+		const uint64_t n = left < sizeof(zeros) ? left : sizeof(zeros);
+		if (fwrite(zeros, 1, n, file) != n)
+			return false;
+		left -= n;
+	}
+
+	return true;
+}
+
+bool sogl_meshfile_write(const char* const path,
+                         const struct sogl_mesh* const mesh,
+                         const struct sogl_meshfile_attrib* const attribs,
+                         const int nattribs, const size_t pos_offset)
+{
+	if (nattribs > SOGL_MESHFILE_MAX_ATTRIBS) {
+		fprintf(stderr, "Too many vertex attributes for mesh file\n");
+		return false;
+	}
+
+	const uint64_t index_size = mesh->index_type == GL_UNSIGNED_SHORT
+	                            ? sizeof(GLushort) : sizeof(GLuint);
+
+	struct sogl_meshfile_header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = SOGL_MESHFILE_MAGIC;
+	header.version = SOGL_MESHFILE_VERSION;
+	header.vertex_size = mesh->vertex_size;
+	header.nattribs = nattribs;
+	header.nverts = mesh->nverts;
+	header.nindices = mesh->nindices;
+	header.index_type = mesh->index_type;
+	header.vertex_offset = align_up(sizeof(header));
+	header.vertex_bytes = (uint64_t)mesh->nverts * mesh->vertex_size;
+	header.index_offset = align_up(header.vertex_offset + header.vertex_bytes);
+	header.index_bytes = (uint64_t)mesh->nindices * index_size;
+	memcpy(header.attribs, attribs, sizeof(*attribs) * nattribs);
+
+	for (int k = 0; k < 3; ++k) {
+		header.bounds_min[k] = FLT_MAX;
+		header.bounds_max[k] = -FLT_MAX;
+	}
+
+	for (long v = 0; v < mesh->nverts; ++v) {
+		const float* const pos = (const float*)((const unsigned char*)mesh->verts +
+		                         v * mesh->vertex_size + pos_offset);
+		for (int k = 0; k < 3; ++k) {
+			if (pos[k] < header.bounds_min[k])
+				header.bounds_min[k] = pos[k];
+			if (pos[k] > header.bounds_max[k])
+				header.bounds_max[k] = pos[k];
+		}
+	}
+
+	FILE* const file = fopen(path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Couldn't open %s for writing\n", path);
+		return false;
+	}
+
+	const bool ok =
+	  write_padded(file, &header, sizeof(header), header.vertex_offset) &&
+	  write_padded(file, mesh->verts, header.vertex_bytes,
+	               header.index_offset - header.vertex_offset) &&
+	  write_padded(file, mesh->indices, header.index_bytes, header.index_bytes);
+
+	if (fclose(file) != 0 || !ok) {
+		fprintf(stderr, "Couldn't write mesh file %s\n", path);
+		return false;
+	}
+
+	return true;
+}
+
+
+/* true when [offset, offset + bytes) lies inside a file of size bytes,
+ * without overflowing on hostile headers
+ * */
+static bool blob_fits(const uint64_t offset, const uint64_t bytes, const uint64_t size)
+{
+	return offset <= size && bytes <= size - offset;
+}
+
+/* bytes one attribute takes inside the vertex, 0 for types mesh files don't use */
+static uint64_t attrib_bytes(const struct sogl_meshfile_attrib* const attr)
+{
+	if (attr->size < 1 || attr->size > 4)
+		return 0;
+
+	switch (attr->type) {
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:  return attr->size;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+	case GL_HALF_FLOAT:     return attr->size * 2ull;
+	case GL_INT:
+	case GL_UNSIGNED_INT:
+	case GL_FLOAT:          return attr->size * 4ull;
+	case GL_DOUBLE:         return attr->size * 8ull;
+	case GL_INT_2_10_10_10_REV:
+	case GL_UNSIGNED_INT_2_10_10_10_REV: return attr->size == 4 ? 4 : 0;
+	}
+	return 0;
+}
+
+/* returns why the header can't be trusted, NULL when it can */
+static const char* check_header(const struct sogl_meshfile_header* const header,
+                                const uint64_t file_size)
+{
+	if (header->magic != SOGL_MESHFILE_MAGIC ||
+	    header->version != SOGL_MESHFILE_VERSION)
+		return "not a mesh file of this version";
+
+	if (header->nattribs > SOGL_MESHFILE_MAX_ATTRIBS)
+		return "too many vertex attributes";
+
+	if (header->index_type != GL_UNSIGNED_SHORT && header->index_type != GL_UNSIGNED_INT)
+		return "unknown index type";
+
+	if (!blob_fits(header->vertex_offset, header->vertex_bytes, file_size) ||
+	    !blob_fits(header->index_offset, header->index_bytes, file_size))
+		return "blobs run past the end of the file";
+
+	const uint64_t index_size = header->index_type == GL_UNSIGNED_SHORT
+	                            ? sizeof(GLushort) : sizeof(GLuint);
+	if (header->vertex_size == 0 ||
+	    header->nverts > header->vertex_bytes / header->vertex_size ||
+	    header->nindices > header->index_bytes / index_size)
+		return "counts don't fit in the blobs";
+
+	if (header->index_offset % index_size != 0)
+		return "misaligned index blob";
+
+	for (uint32_t i = 0; i < header->nattribs; ++i) {
+		const struct sogl_meshfile_attrib* const attr = &header->attribs[i];
+		const uint64_t bytes = attrib_bytes(attr);
+		if (memchr(attr->name, '\0', sizeof(attr->name)) == NULL || bytes == 0 ||
+		    attr->offset > header->vertex_size || bytes > header->vertex_size - attr->offset)
+			return "bad vertex attribute";
+	}
+
+	return NULL;
+}
+
+/* the GPU would read past the vertex buffer on an index out of range */
+static bool indices_fit(const void* const indices, const uint32_t index_type,
+                        const uint64_t nindices, const uint64_t nverts)
+{
+	if (index_type == GL_UNSIGNED_SHORT) {
+		const GLushort* const idx = indices;
+		for (uint64_t i = 0; i < nindices; ++i)
+			if (idx[i] >= nverts)
+				return false;
+	} else {
+		const GLuint* const idx = indices;
+		for (uint64_t i = 0; i < nindices; ++i)
+			if (idx[i] >= nverts)
+				return false;
+	}
+	return true;
+}
+
+bool sogl_meshfile_open(const char* const path, struct sogl_meshfile* const mf)
+{
+	memset(mf, 0, sizeof(*mf));
+
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Couldn't open mesh file %s\n", path);
+		return false;
+	}
+
+	// the header is checked before anything is mapped
+	struct stat st;
+	struct sogl_meshfile_header header;
+	const char* error = NULL;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(header) ||
+	    pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+		error = "truncated header";
+	else
+		error = check_header(&header, st.st_size);
+
+	if (error != NULL) {
+		fprintf(stderr, "Couldn't read mesh file %s: %s\n", path, error);
+		close(fd);
+		return false;
+	}
+
+	void* const map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "Couldn't map mesh file %s\n", path);
+		return false;
+	}
+
+	// the blobs are read front to back exactly once
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	const void* const indices = (const unsigned char*)map + header.index_offset;
+	if (!indices_fit(indices, header.index_type, header.nindices, header.nverts)) {
+		fprintf(stderr, "Couldn't read mesh file %s: index out of range\n", path);
+		munmap(map, st.st_size);
+		return false;
+	}
+
+	mf->map = map;
+	mf->map_size = st.st_size;
+	mf->header = map;
+	mf->verts = (const unsigned char*)map + header.vertex_offset;
+	mf->indices = indices;
+	return true;
+}
+
+void sogl_meshfile_close(struct sogl_meshfile* const mf)
+{
+	if (mf->ebo != 0)
+		glDeleteBuffers(1, &mf->ebo);
+
+	if (mf->map != NULL)
+		munmap(mf->map, mf->map_size);
+
+	memset(mf, 0, sizeof(*mf));
+}
+
+
+static void stream_blob(const GLenum target,
+                        const unsigned char* const data,
+                        const uint64_t bytes)
+{
+	glBufferData(target, bytes, NULL, GL_STATIC_DRAW);
+
+	for (uint64_t off = 0; off < bytes; off += SOGL_MESHFILE_CHUNK_BYTES) {
+		const uint64_t left = bytes - off;
+		const uint64_t len = left < SOGL_MESHFILE_CHUNK_BYTES
+		                     ? left : SOGL_MESHFILE_CHUNK_BYTES;
+
+		// start paging in the next chunk while the driver copies this one
+		if (len < left) {
+			const uint64_t next = left - len;
+			madvise((void*)(data + off + len),
+			        next < SOGL_MESHFILE_CHUNK_BYTES ? next : SOGL_MESHFILE_CHUNK_BYTES,
+			        MADV_WILLNEED);
+		}
+
+		glBufferSubData(target, off, len, data + off);
+	}
+}
+
+void sogl_meshfile_upload(struct sogl_meshfile* const mf)
+{
+	const struct sogl_meshfile_header* const header = mf->header;
+
+	if (mf->ebo == 0)
+		glGenBuffers(1, &mf->ebo);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mf->ebo);
+	stream_blob(GL_ARRAY_BUFFER, mf->verts, header->vertex_bytes);
+	stream_blob(GL_ELEMENT_ARRAY_BUFFER, mf->indices, header->index_bytes);
+
+	for (uint32_t i = 0; i < header->nattribs; ++i) {
+		const struct sogl_meshfile_attrib* const attr = &header->attribs[i];
+		sogl_vattrp(attr->name, attr->size, attr->type,
+		            attr->normalized ? GL_TRUE : GL_FALSE,
+		            header->vertex_size,
+		            (const GLvoid*)(uintptr_t)attr->offset);
+	}
+}
+
+void sogl_meshfile_draw(const struct sogl_meshfile* const mf)
+{
+	glDrawElements(GL_TRIANGLES, mf->header->nindices,
+	               mf->header->index_type, NULL);
+}
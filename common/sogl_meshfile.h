@@ -0,0 +1,76 @@
+#ifndef SOGL_MESHFILE_H_
+#define SOGL_MESHFILE_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <GL/glew.h>
+#include "sogl_mesh.h"
+
+#define SOGL_MESHFILE_MAGIC       (0x48534D53u) // "SMSH"
+#define SOGL_MESHFILE_VERSION     (1)
+#define SOGL_MESHFILE_ALIGN       (4096)        // blobs start on page boundaries
+#define SOGL_MESHFILE_MAX_ATTRIBS (8)
+#define SOGL_MESHFILE_CHUNK_BYTES (1024l * 1024l * 16l) // 16MB per upload
+
+
+/* the file layout is:
+ * [header][padding][vertex blob][padding][index blob]
+ * everything is little endian and read in place through mmap
+ * */
+struct sogl_meshfile_attrib {
+	char name[16];
+	uint32_t size;        // components
+	uint32_t type;        // GLenum
+	uint32_t normalized;
+	uint32_t offset;      // inside the vertex
+};
+
+struct sogl_meshfile_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertex_size;
+	uint32_t nattribs;
+	uint64_t nverts;
+	uint64_t nindices;
+	uint32_t index_type;  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	uint32_t reserved;
+	uint64_t vertex_offset;
+	uint64_t vertex_bytes;
+	uint64_t index_offset;
+	uint64_t index_bytes;
+	float bounds_min[3];
+	float bounds_max[3];
+	struct sogl_meshfile_attrib attribs[SOGL_MESHFILE_MAX_ATTRIBS];
+};
+
+
+struct sogl_meshfile {
+	const struct sogl_meshfile_header* header;
+	const void* verts;
+	const void* indices;
+	void* map;
+	size_t map_size;
+	GLuint ebo;
+};
+
+
+extern bool sogl_meshfile_write(const char* path,
+                                const struct sogl_mesh* mesh,
+                                const struct sogl_meshfile_attrib* attribs,
+                                int nattribs, size_t pos_offset);
+
+/* files aren't trusted: the header, the attribute layout and every
+ * index are checked against the file before anything is uploaded
+ * */
+extern bool sogl_meshfile_open(const char* path, struct sogl_meshfile* mf);
+extern void sogl_meshfile_close(struct sogl_meshfile* mf);
+
+/* streams the blobs from the mapping into the current GL_ARRAY_BUFFER
+ * and a new element buffer bound to the current VAO, then sets up the
+ * vertex attributes found in the shader program
+ * */
+extern void sogl_meshfile_upload(struct sogl_meshfile* mf);
+extern void sogl_meshfile_draw(const struct sogl_meshfile* mf);
+
+
+#endif
@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include "sogl_record.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+
+struct slot {
+	GLuint pbo;
+	GLsync fence;
+};
+
+
+static struct slot slots[SOGL_RECORD_PBOS];
+static int next_slot, oldest_slot, pending;
+static int width, height;       // of the framebuffer
+static int video_w, video_h;    // cropped to even sizes
+static size_t frame_bytes;
+
+static FILE* file;
+static char* file_buffer;
+static SDL_Thread* writer;
+static SDL_mutex* mutex;
+static SDL_cond* cond;
+static uint8_t* queue[SOGL_RECORD_QUEUE];
+static int queue_head, queue_count;
+static bool quit;
+
+static long frames_seen, frames_read, frames_written, frames_dropped;
+static Uint64 overhead_ticks;
+
+
+/*
+ * Color conversion
+ * BT.601 limited range, the chroma of every 2x2 block is the
+ * one of its mean color. The SSE2 and scalar paths give the
+ * same bytes.
+ * */
+static uint8_t luma(const int r, const int g, const int b)
+{
+	return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static void chroma(const int r, const int g, const int b, uint8_t* const u, uint8_t* const v)
+{
+	*u = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+	*v = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+static void convert_pair_scalar(const uint8_t* const row0, const uint8_t* const row1,
+                                const int x0, const int w,
+                                uint8_t* const y0, uint8_t* const y1,
+                                uint8_t* const u, uint8_t* const v)
+{
+	for (int x = x0; x < w; x += 2) {
+		int sr = 0, sg = 0, sb = 0;
+		for (int k = 0; k < 2; ++k) {
+			const uint8_t* const p0 = &row0[(x + k) * 4];
+			const uint8_t* const p1 = &row1[(x + k) * 4];
+			y0[x + k] = luma(p0[0], p0[1], p0[2]);
+			y1[x + k] = luma(p1[0], p1[1], p1[2]);
+			sr += p0[0] + p1[0];
+			sg += p0[1] + p1[1];
+			sb += p0[2] + p1[2];
+		}
+		chroma((sr + 2) >> 2, (sg + 2) >> 2, (sb + 2) >> 2, &u[x / 2], &v[x / 2]);
+	}
+}
+
+#ifdef __SSE2__
+/* splits 8 RGBA pixels into 16 bit R, G and B lanes */
+static void split_rgb(const uint8_t* const src, __m128i* const r, __m128i* const g, __m128i* const b)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	const __m128i lo = _mm_loadu_si128((const __m128i*)src);
+	const __m128i hi = _mm_loadu_si128((const __m128i*)(src + 16));
+	*r = _mm_packs_epi32(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+	*g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 8), mask),
+	                     _mm_and_si128(_mm_srli_epi32(hi, 8), mask));
+	*b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, 16), mask),
+	                     _mm_and_si128(_mm_srli_epi32(hi, 16), mask));
+}
+
+/* the sum fits 16 bits unsigned, the shift is a logical one */
+static __m128i luma8(const __m128i r, const __m128i g, const __m128i b)
+{
+	__m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+	                            _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+	sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+	sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+	return _mm_add_epi16(sum, _mm_set1_epi16(16));
+}
+
+/* means of the 2x2 blocks of two rows of 8 pixels, 4 in 32 bit lanes */
+static __m128i block_mean(const __m128i a, const __m128i b)
+{
+	const __m128i sums = _mm_madd_epi16(_mm_add_epi16(a, b), _mm_set1_epi16(1));
+	return _mm_srli_epi32(_mm_add_epi32(sums, _mm_set1_epi32(2)), 2);
+}
+
+/* signed sums fit 16 bits, the shift is an arithmetic one */
+static __m128i chroma4(const __m128i r, const __m128i g, const __m128i b,
+                       const int cr, const int cg, const int cb)
+{
+	__m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)),
+	                            _mm_mullo_epi16(g, _mm_set1_epi16(cg)));
+	sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(cb)));
+	sum = _mm_srai_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+	return _mm_add_epi16(sum, _mm_set1_epi16(128));
+}
+
+static void convert_pair(const uint8_t* const row0, const uint8_t* const row1, const int w,
+                         uint8_t* const y0, uint8_t* const y1,
+                         uint8_t* const u, uint8_t* const v)
+{
+	int x = 0;
+	for (; x + 8 <= w; x += 8) {
+		__m128i r0, g0, b0, r1, g1, b1;
+		split_rgb(&row0[x * 4], &r0, &g0, &b0);
+		split_rgb(&row1[x * 4], &r1, &g1, &b1);
+
+		_mm_storel_epi64((__m128i*)&y0[x], _mm_packus_epi16(luma8(r0, g0, b0), _mm_setzero_si128()));
+		_mm_storel_epi64((__m128i*)&y1[x], _mm_packus_epi16(luma8(r1, g1, b1), _mm_setzero_si128()));
+
+		const __m128i rm = _mm_packs_epi32(block_mean(r0, r1), _mm_setzero_si128());
+		const __m128i gm = _mm_packs_epi32(block_mean(g0, g1), _mm_setzero_si128());
+		const __m128i bm = _mm_packs_epi32(block_mean(b0, b1), _mm_setzero_si128());
+
+		const __m128i uu = _mm_packus_epi16(chroma4(rm, gm, bm, -38, -74, 112), _mm_setzero_si128());
+		const __m128i vv = _mm_packus_epi16(chroma4(rm, gm, bm, 112, -94, -18), _mm_setzero_si128());
+		const uint32_t u4 = (uint32_t)_mm_cvtsi128_si32(uu);
+		const uint32_t v4 = (uint32_t)_mm_cvtsi128_si32(vv);
+		memcpy(&u[x / 2], &u4, 4);
+		memcpy(&v[x / 2], &v4, 4);
+	}
+
+	convert_pair_scalar(row0, row1, x, w, y0, y1, u, v);
+}
+#else
+static void convert_pair(const uint8_t* const row0, const uint8_t* const row1, const int w,
+                         uint8_t* const y0, uint8_t* const y1,
+                         uint8_t* const u, uint8_t* const v)
+{
+	convert_pair_scalar(row0, row1, 0, w, y0, y1, u, v);
+}
+#endif
+
+void sogl_record_rgba_to_i420(const uint8_t* const rgba, const int w, const int h,
+                              uint8_t* const y, uint8_t* const u, uint8_t* const v)
+{
+	const size_t stride = (size_t)w * 4;
+	for (int row = 0; row < h; row += 2) {
+		// GL rows are bottom first, video rows top first
+		const uint8_t* const src0 = rgba + (size_t)(h - 1 - row) * stride;
+		const uint8_t* const src1 = rgba + (size_t)(h - 2 - row) * stride;
+		convert_pair(src0, src1, w,
+		             &y[(size_t)row * w], &y[(size_t)(row + 1) * w],
+		             &u[(size_t)(row / 2) * (w / 2)], &v[(size_t)(row / 2) * (w / 2)]);
+	}
+}
+
+
+/*
+ * Writer thread
+ * */
+static int writer_main(void* const unused)
+{
+	((void)unused);
+
+	const size_t luma_bytes = (size_t)video_w * video_h;
+	uint8_t* const yuv = malloc(luma_bytes * 3 / 2);
+	uint8_t* const rgba = malloc((size_t)video_w * video_h * 4);
+	if (yuv == NULL || rgba == NULL)
+		fprintf(stderr, "Couldn't allocate video frame, frames will be dropped\n");
+
+	SDL_LockMutex(mutex);
+	for (;;) {
+		while (!quit && queue_count == 0)
+			SDL_CondWait(cond, mutex);
+		if (queue_count == 0)
+			break;
+
+		uint8_t* const frame = queue[queue_head];
+		SDL_UnlockMutex(mutex);
+
+		if (yuv != NULL && rgba != NULL) {
+			// drop the odd column and row of odd sized windows
+			const uint8_t* src = frame;
+			if (video_w != width || video_h != height) {
+				for (int row = 0; row < video_h; ++row) {
+					memcpy(&rgba[(size_t)row * video_w * 4],
+					       &frame[(size_t)(row + height - video_h) * width * 4],
+					       (size_t)video_w * 4);
+				}
+				src = rgba;
+			}
+
+			sogl_record_rgba_to_i420(src, video_w, video_h, yuv,
+			                         yuv + luma_bytes, yuv + luma_bytes + luma_bytes / 4);
+			fputs("FRAME\n", file);
+			if (fwrite(yuv, luma_bytes * 3 / 2, 1, file) != 1)
+				fprintf(stderr, "Couldn't write video frame\n");
+		}
+
+		SDL_LockMutex(mutex);
+		queue_head = (queue_head + 1) % SOGL_RECORD_QUEUE;
+		--queue_count;
+		++frames_written;
+	}
+	SDL_UnlockMutex(mutex);
+
+	free(rgba);
+	free(yuv);
+	return 0;
+}
+
+
+bool sogl_record_init(const char* const path, const int w, const int h)
+{
+	width = w;
+	height = h;
+	video_w = w & ~1;
+	video_h = h & ~1;
+	frame_bytes = (size_t)w * h * 4;
+	next_slot = oldest_slot = pending = 0;
+	queue_head = queue_count = 0;
+	frames_seen = frames_read = frames_written = frames_dropped = 0;
+	overhead_ticks = 0;
+	quit = false;
+
+	if (video_w == 0 || video_h == 0) {
+		fprintf(stderr, "Couldn't record a %dx%d window\n", w, h);
+		return false;
+	}
+
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Couldn't open video %s\n", path);
+		return false;
+	}
+
+	// large sequential writes instead of one syscall per plane
+	file_buffer = malloc(SOGL_RECORD_WRITE_BYTES);
+	if (file_buffer != NULL)
+		setvbuf(file, file_buffer, _IOFBF, SOGL_RECORD_WRITE_BYTES);
+
+	fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+	        video_w, video_h, SOGL_RECORD_FPS);
+
+	for (int i = 0; i < SOGL_RECORD_QUEUE; ++i) {
+		queue[i] = malloc(frame_bytes);
+		if (queue[i] == NULL) {
+			fprintf(stderr, "Couldn't allocate video queue\n");
+			goto Lfailed;
+		}
+	}
+
+	mutex = SDL_CreateMutex();
+	cond = SDL_CreateCond();
+	if (mutex == NULL || cond == NULL) {
+		fprintf(stderr, "Couldn't create video queue sync: %s\n", SDL_GetError());
+		goto Lfailed;
+	}
+
+	writer = SDL_CreateThread(writer_main, "sogl_record", NULL);
+	if (writer == NULL) {
+		fprintf(stderr, "Couldn't create video writer thread: %s\n", SDL_GetError());
+		goto Lfailed;
+	}
+
+	for (int i = 0; i < SOGL_RECORD_PBOS; ++i) {
+		glGenBuffers(1, &slots[i].pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, frame_bytes, NULL, GL_STREAM_READ);
+		slots[i].fence = NULL;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	printf("RECORDING %dx%d VIDEO TO %s\n", video_w, video_h, path);
+	return true;
+
+Lfailed:
+	sogl_record_term();
+	return false;
+}
+
+/* maps a finished readback and queues it for the writer,
+ * wait: block on the fence, only when draining
+ * */
+static bool collect(const bool wait)
+{
+	struct slot* const slot = &slots[oldest_slot];
+	const GLenum status = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+	                                       wait ? 1000000000ull : 0);
+	if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+		return false;
+
+	glDeleteSync(slot->fence);
+	slot->fence = NULL;
+	oldest_slot = (oldest_slot + 1) % SOGL_RECORD_PBOS;
+	--pending;
+
+	SDL_LockMutex(mutex);
+	const bool full = queue_count == SOGL_RECORD_QUEUE;
+	const int tail = (queue_head + queue_count) % SOGL_RECORD_QUEUE;
+	SDL_UnlockMutex(mutex);
+
+	if (full) {
+		++frames_dropped;
+		return true;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+	const void* const pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame_bytes,
+	                                            GL_MAP_READ_BIT);
+	if (pixels != NULL) {
+		// the writer only touches queued buffers, the tail is ours
+		memcpy(queue[tail], pixels, frame_bytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+		SDL_LockMutex(mutex);
+		++queue_count;
+		SDL_CondSignal(cond);
+		SDL_UnlockMutex(mutex);
+	} else {
+		++frames_dropped;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	return true;
+}
+
+void sogl_record_frame(void)
+{
+	const Uint64 clk = SDL_GetPerformanceCounter();
+
+	while (pending > 0 && collect(false))
+		continue;
+
+	// the GPU is SOGL_RECORD_PBOS frames behind, skip this one
+	if (pending == SOGL_RECORD_PBOS) {
+		++frames_dropped;
+	} else {
+		struct slot* const slot = &slots[next_slot];
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+		glReadBuffer(GL_BACK);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		next_slot = (next_slot + 1) % SOGL_RECORD_PBOS;
+		++pending;
+		++frames_read;
+	}
+
+	++frames_seen;
+	overhead_ticks += SDL_GetPerformanceCounter() - clk;
+}
+
+void sogl_record_term(void)
+{
+	while (pending > 0 && collect(true))
+		continue;
+
+	if (writer != NULL) {
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondSignal(cond);
+		SDL_UnlockMutex(mutex);
+		SDL_WaitThread(writer, NULL);
+		writer = NULL;
+
+		printf("VIDEO: %ld FRAMES WRITTEN, %ld DROPPED, %.3f MS PER FRAME ON THE RENDER THREAD\n",
+		       frames_written, frames_dropped,
+		       frames_seen > 0 ? overhead_ticks * 1000.0 / SDL_GetPerformanceFrequency() / frames_seen : 0.0);
+	}
+
+	for (int i = 0; i < SOGL_RECORD_PBOS; ++i) {
+		if (slots[i].fence != NULL)
+			glDeleteSync(slots[i].fence);
+		if (slots[i].pbo != 0)
+			glDeleteBuffers(1, &slots[i].pbo);
+		slots[i].fence = NULL;
+		slots[i].pbo = 0;
+	}
+	pending = 0;
+
+	if (cond != NULL)
+		SDL_DestroyCond(cond);
+	if (mutex != NULL)
+		SDL_DestroyMutex(mutex);
+	cond = NULL;
+	mutex = NULL;
+
+	for (int i = 0; i < SOGL_RECORD_QUEUE; ++i) {
+		free(queue[i]);
+		queue[i] = NULL;
+	}
+
+	if (file != NULL)
+		fclose(file);
+	file = NULL;
+	free(file_buffer);
+	file_buffer = NULL;
+}
@@ -0,0 +1,38 @@
+#ifndef SOGL_RECORD_H_
+#define SOGL_RECORD_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SOGL_RECORD_PBOS        (4)                   // readbacks in flight
+#define SOGL_RECORD_QUEUE       (8)                   // frames waiting for the writer
+#define SOGL_RECORD_WRITE_BYTES (1024l * 1024l * 8l) // stdio buffer of the stream
+#define SOGL_RECORD_FPS         (60)
+
+
+/* Video recorder:
+ * frames are read back into a ring of pixel pack buffers and only
+ * collected once their fence has signaled, the render thread never
+ * waits on the GPU nor on the disk. Collected frames go through a
+ * bounded queue to a writer thread converting RGBA to YUV 4:2:0
+ * (BT.601, SSE2) and appending them to a Y4M stream.
+ * When a readback isn't done by the time its buffer is needed, or
+ * the queue is full, the frame is dropped and counted instead.
+ *
+ * sogl_init starts a recording when SOGL_VIDEO is set to the path
+ * of the .y4m file to write.
+ * */
+extern bool sogl_record_init(const char* path, int width, int height);
+
+/* writes the frames still queued and prints the statistics */
+extern void sogl_record_term(void);
+
+/* reads the back buffer, call before swapping */
+extern void sogl_record_frame(void);
+
+/* RGBA8 rows bottom first (as read from GL) to I420 top first,
+ * width and height even
+ * */
+extern void sogl_record_rgba_to_i420(const uint8_t* rgba, int width, int height,
+                                     uint8_t* y, uint8_t* u, uint8_t* v);
+
+#endif
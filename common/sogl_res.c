@@ -0,0 +1,667 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sogl_res.h"
+
+
+struct record {
+	GLuint name;
+	enum sogl_res_type type;
+	bool used;                // the slot holds a record
+	int line;
+	const char* file;         // creation site, the shim passes literals
+	int64_t bytes;
+	int64_t level_bytes[SOGL_RES_MAX_LEVELS];  // textures only
+	long last_use;            // frame it was last bound on
+	GLuint element_buffer;    // vertex arrays only, GL keeps it per VAO
+	sogl_res_evict_fn evict;
+	void* data;
+};
+
+struct candidate {
+	enum sogl_res_type type;
+	GLuint name;
+	long last_use;
+	sogl_res_evict_fn evict;
+	void* data;
+};
+
+
+const char* const sogl_res_type_names[SOGL_RES_NTYPES] = {
+	"BUFFER", "TEXTURE", "SHADER", "PROGRAM", "VERTEX ARRAY"
+};
+
+// open addressing with linear probing, the size a power of two
+static struct record* table;
+static long table_size;
+static long nrecords;
+
+static struct sogl_res_stats stats;
+static long frame;
+static bool over_budget;   // reported once until it fits again
+
+static struct candidate* candidates;
+static long candidates_capacity;
+
+/* the bindings as the shim last set them, so sizing a buffer or a
+ * texture never asks GL which one is bound
+ * */
+enum buffer_target {
+	ARRAY_BUFFER,
+	PIXEL_PACK_BUFFER,
+	PIXEL_UNPACK_BUFFER,
+	DRAW_INDIRECT_BUFFER,
+	TRANSFORM_FEEDBACK_BUFFER,
+	UNIFORM_BUFFER,
+	TEXTURE_BUFFER,
+	COPY_READ_BUFFER,
+	COPY_WRITE_BUFFER,
+	NBUFFER_TARGETS
+};
+
+enum texture_target {
+	TEXTURE_1D,
+	TEXTURE_2D,
+	TEXTURE_3D,
+	TEXTURE_1D_ARRAY,
+	TEXTURE_2D_ARRAY,
+	TEXTURE_RECTANGLE,
+	TEXTURE_CUBE_MAP,
+	NTEXTURE_TARGETS
+};
+
+static GLuint bound_buffers[NBUFFER_TARGETS];
+static GLuint bound_textures[SOGL_RES_MAX_UNITS][NTEXTURE_TARGETS];
+static GLuint bound_vertex_array;
+static GLuint default_element_buffer;  // of VAO 0 and of the untracked ones
+static GLuint active_unit;
+
+
+static uint64_t key_of(const enum sogl_res_type type, const GLuint name)
+{
+	return ((uint64_t)type << 32) | name;
+}
+
+static long slot_of(const uint64_t key)
+{
+	return (long)((key * 0x9E3779B97F4A7C15ull) >> 32) & (table_size - 1);
+}
+
+static struct record* find(const enum sogl_res_type type, const GLuint name)
+{
+	if (table == NULL || name == 0)
+		return NULL;
+
+	const uint64_t key = key_of(type, name);
+	for (long s = slot_of(key); table[s].used; s = (s + 1) & (table_size - 1)) {
+		if (key_of(table[s].type, table[s].name) == key)
+			return &table[s];
+	}
+	return NULL;
+}
+
+static void insert(const struct record* const rec)
+{
+	long s = slot_of(key_of(rec->type, rec->name));
+	while (table[s].used)
+		s = (s + 1) & (table_size - 1);
+	table[s] = *rec;
+}
+
+static bool grow(void)
+{
+	struct record* const old = table;
+	const long old_size = table_size;
+	const long size = old_size > 0 ? old_size * 2 : SOGL_RES_TABLE_SIZE;
+
+	struct record* const resized = calloc(size, sizeof(*resized));
+	if (resized == NULL) {
+		fprintf(stderr, "Couldn't grow the GL resource table\n");
+		return false;
+	}
+
+	table = resized;
+	table_size = size;
+	for (long s = 0; s < old_size; ++s) {
+		if (old[s].used)
+			insert(&old[s]);
+	}
+	free(old);
+	return true;
+}
+
+static void set_bytes(struct record* const rec, const int64_t bytes)
+{
+	stats.bytes[rec->type] += bytes - rec->bytes;
+	stats.total += bytes - rec->bytes;
+	rec->bytes = bytes;
+	if (stats.bytes[rec->type] > stats.peak[rec->type])
+		stats.peak[rec->type] = stats.bytes[rec->type];
+}
+
+static void track(const enum sogl_res_type type, const GLuint name,
+                  const char* const file, const int line)
+{
+	if (name == 0)
+		return;
+
+	// a name the driver hands out again was deleted behind the shim
+	struct record* const stale = find(type, name);
+	if (stale != NULL) {
+		set_bytes(stale, 0);
+		memset(stale->level_bytes, 0, sizeof(stale->level_bytes));
+		stale->file = file;
+		stale->line = line;
+		stale->last_use = frame;
+		stale->evict = NULL;
+		return;
+	}
+
+	// kept under three quarters full so the probes stay short
+	if ((nrecords + 1) * 4 > table_size * 3 && !grow())
+		return;
+
+	insert(&(struct record) {
+		.name = name, .type = type, .used = true,
+		.line = line, .file = file, .last_use = frame
+	});
+	++nrecords;
+	++stats.count[type];
+}
+
+static void untrack(const enum sogl_res_type type, const GLuint name)
+{
+	struct record* const rec = find(type, name);
+	if (rec == NULL)
+		return;
+
+	set_bytes(rec, 0);
+	--stats.count[type];
+	--nrecords;
+
+	// backward shift, the records after it in the run move up
+	long hole = rec - table;
+	rec->used = false;
+	for (long s = (hole + 1) & (table_size - 1); table[s].used; s = (s + 1) & (table_size - 1)) {
+		const long home = slot_of(key_of(table[s].type, table[s].name));
+		// stays when its home is cyclically in (hole, s]
+		const bool stays = hole <= s ? (home > hole && home <= s) : (home > hole || home <= s);
+		if (stays)
+			continue;
+		table[hole] = table[s];
+		table[s].used = false;
+		hole = s;
+	}
+}
+
+static void use(const enum sogl_res_type type, const GLuint name)
+{
+	struct record* const rec = find(type, name);
+	if (rec != NULL)
+		rec->last_use = frame;
+}
+
+
+void sogl_res_init(const int64_t budget)
+{
+	memset(&stats, 0, sizeof(stats));
+	stats.budget = budget;
+	frame = 0;
+	over_budget = false;
+
+	// a new context has nothing bound
+	memset(bound_buffers, 0, sizeof(bound_buffers));
+	memset(bound_textures, 0, sizeof(bound_textures));
+	bound_vertex_array = default_element_buffer = 0;
+	active_unit = 0;
+}
+
+void sogl_res_term(void)
+{
+	for (long s = 0; s < table_size; ++s) {
+		const struct record* const rec = &table[s];
+		if (!rec->used)
+			continue;
+		printf("GL RESOURCE LEAKED: %s %u %lld BYTES CREATED AT %s:%d\n",
+		       sogl_res_type_names[rec->type], rec->name,
+		       (long long)rec->bytes, rec->file, rec->line);
+	}
+
+	for (int t = 0; t < SOGL_RES_NTYPES; ++t) {
+		if (stats.peak[t] > 0) {
+			printf("GL RESOURCES %s: PEAK %lld BYTES\n",
+			       sogl_res_type_names[t], (long long)stats.peak[t]);
+		}
+	}
+	if (stats.evicted > 0)
+		printf("GL RESOURCES EVICTED: %ld\n", stats.evicted);
+
+	free(table);
+	free(candidates);
+	table = NULL;
+	candidates = NULL;
+	table_size = nrecords = candidates_capacity = 0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+void sogl_res_set_budget(const int64_t budget)
+{
+	stats.budget = budget;
+}
+
+void sogl_res_stats(struct sogl_res_stats* const out)
+{
+	*out = stats;
+}
+
+void sogl_res_evictable(const enum sogl_res_type type, const GLuint name,
+                        const sogl_res_evict_fn fn, void* const data)
+{
+	struct record* const rec = find(type, name);
+	if (rec == NULL)
+		return;
+	rec->evict = fn;
+	rec->data = data;
+}
+
+void sogl_res_forget(const enum sogl_res_type type, const GLuint name)
+{
+	untrack(type, name);
+}
+
+
+static int cmp_last_use(const void* const a, const void* const b)
+{
+	const long la = ((const struct candidate*)a)->last_use;
+	const long lb = ((const struct candidate*)b)->last_use;
+	return (la > lb) - (la < lb);
+}
+
+static void evict(void)
+{
+	long ncandidates = 0;
+	for (long s = 0; s < table_size; ++s) {
+		const struct record* const rec = &table[s];
+		// what the ending frame bound may still be read by the GPU
+		if (!rec->used || rec->evict == NULL || rec->last_use >= frame)
+			continue;
+
+		if (ncandidates == candidates_capacity) {
+			const long capacity = candidates_capacity > 0 ? candidates_capacity * 2 : 64;
+			struct candidate* const grown = realloc(candidates, sizeof(*grown) * capacity);
+			if (grown == NULL) {
+				fprintf(stderr, "Couldn't allocate the eviction candidates\n");
+				break;
+			}
+			candidates = grown;
+			candidates_capacity = capacity;
+		}
+		candidates[ncandidates++] = (struct candidate) {
+			rec->type, rec->name, rec->last_use, rec->evict, rec->data
+		};
+	}
+
+	qsort(candidates, ncandidates, sizeof(*candidates), cmp_last_use);
+
+	// the callbacks delete through the shim, so the table changes under the loop
+	for (long i = 0; i < ncandidates && stats.total > stats.budget; ++i) {
+		const struct candidate* const c = &candidates[i];
+		c->evict(c->data, c->name);
+		++stats.evicted;
+
+		struct record* const kept = find(c->type, c->name);
+		if (kept != NULL)
+			kept->evict = NULL;
+	}
+}
+
+void sogl_res_end_frame(void)
+{
+	if (stats.budget > 0 && stats.total > stats.budget) {
+		evict();
+		if (stats.total > stats.budget && !over_budget) {
+			fprintf(stderr, "Couldn't fit the GL resources in the budget: "
+			        "%lld of %lld bytes\n", (long long)stats.total, (long long)stats.budget);
+		}
+		over_budget = stats.total > stats.budget;
+	}
+	++frame;
+}
+
+
+/*
+ * Tracked GL calls
+ * */
+static int buffer_index(const GLenum target)
+{
+	switch (target) {
+	case GL_ARRAY_BUFFER:              return ARRAY_BUFFER;
+	case GL_PIXEL_PACK_BUFFER:         return PIXEL_PACK_BUFFER;
+	case GL_PIXEL_UNPACK_BUFFER:       return PIXEL_UNPACK_BUFFER;
+	case GL_DRAW_INDIRECT_BUFFER:      return DRAW_INDIRECT_BUFFER;
+	case GL_TRANSFORM_FEEDBACK_BUFFER: return TRANSFORM_FEEDBACK_BUFFER;
+	case GL_UNIFORM_BUFFER:            return UNIFORM_BUFFER;
+	case GL_TEXTURE_BUFFER:            return TEXTURE_BUFFER;
+	case GL_COPY_READ_BUFFER:          return COPY_READ_BUFFER;
+	case GL_COPY_WRITE_BUFFER:         return COPY_WRITE_BUFFER;
+	}
+	return -1;  // GL_ELEMENT_ARRAY_BUFFER is the bound VAO's, see element_buffer
+}
+
+static int texture_index(const GLenum target)
+{
+	switch (target) {
+	case GL_TEXTURE_1D:                  return TEXTURE_1D;
+	case GL_TEXTURE_2D:                  return TEXTURE_2D;
+	case GL_TEXTURE_3D:                  return TEXTURE_3D;
+	case GL_TEXTURE_1D_ARRAY:            return TEXTURE_1D_ARRAY;
+	case GL_TEXTURE_2D_ARRAY:            return TEXTURE_2D_ARRAY;
+	case GL_TEXTURE_RECTANGLE:           return TEXTURE_RECTANGLE;
+	case GL_TEXTURE_CUBE_MAP:
+	case GL_TEXTURE_CUBE_MAP_POSITIVE_X:
+	case GL_TEXTURE_CUBE_MAP_NEGATIVE_X:
+	case GL_TEXTURE_CUBE_MAP_POSITIVE_Y:
+	case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
+	case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
+	case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z: return TEXTURE_CUBE_MAP;
+	}
+	return -1;  // proxies and targets without storage of their own
+}
+
+static GLuint* element_buffer(void)
+{
+	struct record* const vao = find(SOGL_RES_VERTEX_ARRAY, bound_vertex_array);
+	return vao != NULL ? &vao->element_buffer : &default_element_buffer;
+}
+
+static GLuint* buffer_slot(const GLenum target)
+{
+	if (target == GL_ELEMENT_ARRAY_BUFFER)
+		return element_buffer();
+	const int index = buffer_index(target);
+	return index >= 0 ? &bound_buffers[index] : NULL;
+}
+
+static GLuint* texture_slot(const GLenum target)
+{
+	const int index = texture_index(target);
+	if (index < 0 || active_unit >= SOGL_RES_MAX_UNITS)
+		return NULL;
+	return &bound_textures[active_unit][index];
+}
+
+/* bytes per texel of the uncompressed formats, rounded
+ * up to the sizes drivers actually store
+ * */
+static int texel_bytes(const GLint internal_format)
+{
+	switch (internal_format) {
+	case GL_R8: case GL_R8_SNORM: case GL_R8UI: case GL_R8I:
+	case GL_RED: case GL_ALPHA8: case GL_STENCIL_INDEX8:
+		return 1;
+	case GL_RG8: case GL_RG8_SNORM: case GL_RG8UI: case GL_RG8I:
+	case GL_R16: case GL_R16F: case GL_R16UI: case GL_R16I:
+	case GL_RG: case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGB16: case GL_RGB16F: case GL_RGB16UI: case GL_RGB16I:
+	case GL_RGBA16: case GL_RGBA16F: case GL_RGBA16UI: case GL_RGBA16I:
+	case GL_RG32F: case GL_RG32UI: case GL_RG32I: case GL_DEPTH32F_STENCIL8:
+		return 8;
+	case GL_RGB32F: case GL_RGB32UI: case GL_RGB32I:
+	case GL_RGBA32F: case GL_RGBA32UI: case GL_RGBA32I:
+		return 16;
+	}
+	return 4;  // RGBA8 and everything packed in 32 bits, RGB8 included
+}
+
+static void set_level(const GLenum target, const GLint level, const int64_t bytes)
+{
+	const GLuint* const slot = texture_slot(target);
+	struct record* const rec = slot != NULL ? find(SOGL_RES_TEXTURE, *slot) : NULL;
+	if (rec == NULL || level < 0 || level >= SOGL_RES_MAX_LEVELS)
+		return;
+
+	// the faces of a cube map are sized as the one respecified
+	const int64_t level_bytes = texture_index(target) == TEXTURE_CUBE_MAP
+	                            ? bytes * 6 : bytes;
+	set_bytes(rec, rec->bytes - rec->level_bytes[level] + level_bytes);
+	rec->level_bytes[level] = level_bytes;
+}
+
+
+void sogl_res_gen_buffers(const GLsizei n, GLuint* const names,
+                          const char* const file, const int line)
+{
+	glGenBuffers(n, names);
+	for (GLsizei i = 0; i < n; ++i)
+		track(SOGL_RES_BUFFER, names[i], file, line);
+}
+
+void sogl_res_create_buffers(const GLsizei n, GLuint* const names,
+                             const char* const file, const int line)
+{
+	glCreateBuffers(n, names);
+	for (GLsizei i = 0; i < n; ++i)
+		track(SOGL_RES_BUFFER, names[i], file, line);
+}
+
+void sogl_res_delete_buffers(const GLsizei n, const GLuint* const names)
+{
+	for (GLsizei i = 0; i < n; ++i) {
+		untrack(SOGL_RES_BUFFER, names[i]);
+
+		// deleting a bound buffer binds 0 in its place
+		for (int t = 0; t < NBUFFER_TARGETS; ++t) {
+			if (bound_buffers[t] == names[i])
+				bound_buffers[t] = 0;
+		}
+		GLuint* const element = element_buffer();
+		if (*element == names[i])
+			*element = 0;
+	}
+	glDeleteBuffers(n, names);
+}
+
+void sogl_res_bind_buffer(const GLenum target, const GLuint name)
+{
+	glBindBuffer(target, name);
+	use(SOGL_RES_BUFFER, name);
+
+	GLuint* const slot = buffer_slot(target);
+	if (slot != NULL)
+		*slot = name;
+}
+
+// the indexed bindings set the generic one too
+void sogl_res_bind_buffer_base(const GLenum target, const GLuint index, const GLuint name)
+{
+	glBindBufferBase(target, index, name);
+	use(SOGL_RES_BUFFER, name);
+
+	GLuint* const slot = buffer_slot(target);
+	if (slot != NULL)
+		*slot = name;
+}
+
+void sogl_res_bind_buffer_range(const GLenum target, const GLuint index, const GLuint name,
+                                const GLintptr offset, const GLsizeiptr size)
+{
+	glBindBufferRange(target, index, name, offset, size);
+	use(SOGL_RES_BUFFER, name);
+
+	GLuint* const slot = buffer_slot(target);
+	if (slot != NULL)
+		*slot = name;
+}
+
+void sogl_res_buffer_data(const GLenum target, const GLsizeiptr size,
+                          const void* const data, const GLenum usage)
+{
+	glBufferData(target, size, data, usage);
+
+	const GLuint* const slot = buffer_slot(target);
+	struct record* const rec = slot != NULL ? find(SOGL_RES_BUFFER, *slot) : NULL;
+	if (rec != NULL)
+		set_bytes(rec, size);
+}
+
+void sogl_res_named_buffer_data(const GLuint name, const GLsizeiptr size,
+                                const void* const data, const GLenum usage)
+{
+	glNamedBufferData(name, size, data, usage);
+
+	struct record* const rec = find(SOGL_RES_BUFFER, name);
+	if (rec != NULL)
+		set_bytes(rec, size);
+}
+
+
+void sogl_res_gen_textures(const GLsizei n, GLuint* const names,
+                           const char* const file, const int line)
+{
+	glGenTextures(n, names);
+	for (GLsizei i = 0; i < n; ++i)
+		track(SOGL_RES_TEXTURE, names[i], file, line);
+}
+
+void sogl_res_create_textures(const GLenum target, const GLsizei n, GLuint* const names,
+                              const char* const file, const int line)
+{
+	glCreateTextures(target, n, names);
+	for (GLsizei i = 0; i < n; ++i)
+		track(SOGL_RES_TEXTURE, names[i], file, line);
+}
+
+void sogl_res_delete_textures(const GLsizei n, const GLuint* const names)
+{
+	for (GLsizei i = 0; i < n; ++i) {
+		untrack(SOGL_RES_TEXTURE, names[i]);
+
+		// unbound from every unit it was bound to
+		for (int u = 0; u < SOGL_RES_MAX_UNITS; ++u) {
+			for (int t = 0; t < NTEXTURE_TARGETS; ++t) {
+				if (bound_textures[u][t] == names[i])
+					bound_textures[u][t] = 0;
+			}
+		}
+	}
+	glDeleteTextures(n, names);
+}
+
+void sogl_res_active_texture(const GLenum unit)
+{
+	glActiveTexture(unit);
+	active_unit = unit - GL_TEXTURE0;
+}
+
+void sogl_res_bind_texture(const GLenum target, const GLuint name)
+{
+	glBindTexture(target, name);
+	use(SOGL_RES_TEXTURE, name);
+
+	GLuint* const slot = texture_slot(target);
+	if (slot != NULL)
+		*slot = name;
+}
+
+void sogl_res_tex_image_2d(const GLenum target, const GLint level,
+                           const GLint internal_format,
+                           const GLsizei width, const GLsizei height,
+                           const GLint border, const GLenum format,
+                           const GLenum type, const void* const pixels)
+{
+	glTexImage2D(target, level, internal_format, width, height,
+	             border, format, type, pixels);
+	set_level(target, level, (int64_t)width * height * texel_bytes(internal_format));
+}
+
+void sogl_res_tex_image_3d(const GLenum target, const GLint level,
+                           const GLint internal_format,
+                           const GLsizei width, const GLsizei height,
+                           const GLsizei depth, const GLint border,
+                           const GLenum format, const GLenum type,
+                           const void* const pixels)
+{
+	glTexImage3D(target, level, internal_format, width, height, depth,
+	             border, format, type, pixels);
+	set_level(target, level,
+	          (int64_t)width * height * depth * texel_bytes(internal_format));
+}
+
+void sogl_res_compressed_tex_image_2d(const GLenum target, const GLint level,
+                                      const GLenum internal_format,
+                                      const GLsizei width, const GLsizei height,
+                                      const GLint border, const GLsizei size,
+                                      const void* const data)
+{
+	glCompressedTexImage2D(target, level, internal_format, width, height,
+	                       border, size, data);
+	set_level(target, level, size);
+}
+
+
+void sogl_res_gen_vertex_arrays(const GLsizei n, GLuint* const names,
+                                const char* const file, const int line)
+{
+	glGenVertexArrays(n, names);
+	for (GLsizei i = 0; i < n; ++i)
+		track(SOGL_RES_VERTEX_ARRAY, names[i], file, line);
+}
+
+void sogl_res_create_vertex_arrays(const GLsizei n, GLuint* const names,
+                                   const char* const file, const int line)
+{
+	glCreateVertexArrays(n, names);
+	for (GLsizei i = 0; i < n; ++i)
+		track(SOGL_RES_VERTEX_ARRAY, names[i], file, line);
+}
+
+void sogl_res_delete_vertex_arrays(const GLsizei n, const GLuint* const names)
+{
+	for (GLsizei i = 0; i < n; ++i) {
+		untrack(SOGL_RES_VERTEX_ARRAY, names[i]);
+		if (bound_vertex_array == names[i])
+			bound_vertex_array = 0;
+	}
+	glDeleteVertexArrays(n, names);
+}
+
+void sogl_res_bind_vertex_array(const GLuint name)
+{
+	glBindVertexArray(name);
+	use(SOGL_RES_VERTEX_ARRAY, name);
+	bound_vertex_array = name;
+}
+
+
+GLuint sogl_res_create_shader(const GLenum type, const char* const file, const int line)
+{
+	const GLuint name = glCreateShader(type);
+	track(SOGL_RES_SHADER, name, file, line);
+	return name;
+}
+
+void sogl_res_delete_shader(const GLuint name)
+{
+	untrack(SOGL_RES_SHADER, name);
+	glDeleteShader(name);
+}
+
+GLuint sogl_res_create_program(const char* const file, const int line)
+{
+	const GLuint name = glCreateProgram();
+	track(SOGL_RES_PROGRAM, name, file, line);
+	return name;
+}
+
+void sogl_res_delete_program(const GLuint name)
+{
+	untrack(SOGL_RES_PROGRAM, name);
+	glDeleteProgram(name);
+}
+
+void sogl_res_use_program(const GLuint name)
+{
+	glUseProgram(name);
+	use(SOGL_RES_PROGRAM, name);
+}
@@ -0,0 +1,192 @@
+#ifndef SOGL_RES_H_
+#define SOGL_RES_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <GL/glew.h>
+
+#define SOGL_RES_MAX_LEVELS (16)    // mip levels sized per texture
+#define SOGL_RES_TABLE_SIZE (1024)  // initial slots of the hash table
+#define SOGL_RES_MAX_UNITS  (32)    // texture units whose bindings are shadowed
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+enum sogl_res_type {
+	SOGL_RES_BUFFER,
+	SOGL_RES_TEXTURE,
+	SOGL_RES_SHADER,
+	SOGL_RES_PROGRAM,
+	SOGL_RES_VERTEX_ARRAY,
+	SOGL_RES_NTYPES
+};
+
+struct sogl_res_stats {
+	long count[SOGL_RES_NTYPES];
+	int64_t bytes[SOGL_RES_NTYPES];   // estimated GPU memory
+	int64_t peak[SOGL_RES_NTYPES];    // most bytes over the run
+	int64_t total;
+	int64_t budget;                   // 0 when there's none
+	long evicted;                     // resources evicted over the run
+};
+
+/* called with the name of the resource to release, the owner
+ * deletes it and forgets it, it's drawn from again later
+ * */
+typedef void (*sogl_res_evict_fn)(void* data, GLuint name);
+
+
+/* Resource tracker:
+ * the GL objects created by the sources built with the shim below
+ * are recorded with their type, creation site, estimated size and
+ * the frame they were last bound on. Sizes are estimates, buffers
+ * their data store and textures the sum of their levels at the
+ * bytes per texel of the internal format, the driver's padding and
+ * its own allocations aren't known.
+ *
+ * A resource marked evictable is a cache its owner can rebuild,
+ * once the total goes over the budget the ones least recently
+ * bound, and not bound on the frame ending, are handed back to
+ * their owner until it fits again.
+ *
+ * The shim shadows the bindings it makes, so sizing a resource on
+ * glBufferData or glTexImage never queries GL: a tracked object is
+ * only sized when it was bound, and its texture unit made active,
+ * through the shim. The DSA calls take the name and need neither.
+ *
+ * sogl_init sets the budget to SOGL_VRAM_BUDGET megabytes when it's
+ * set, sogl_end_frame evicts, sogl_term reports the peaks and the
+ * resources never deleted with the line that created them.
+ * */
+extern const char* const sogl_res_type_names[SOGL_RES_NTYPES];
+
+extern void sogl_res_init(int64_t budget);
+extern void sogl_res_term(void);
+extern void sogl_res_end_frame(void);
+
+/* 0 for no budget */
+extern void sogl_res_set_budget(int64_t budget);
+extern void sogl_res_stats(struct sogl_res_stats* stats);
+
+/* a NULL fn makes the resource resident again */
+extern void sogl_res_evictable(enum sogl_res_type type, GLuint name,
+                               sogl_res_evict_fn fn, void* data);
+
+/* stops tracking a resource whose delete is deferred, see
+ * sogl_arena.h, its bytes count as freed from now on
+ * */
+extern void sogl_res_forget(enum sogl_res_type type, GLuint name);
+
+
+/* issue the GL call, then record it, see the shim */
+extern void sogl_res_gen_buffers(GLsizei n, GLuint* names, const char* file, int line);
+extern void sogl_res_delete_buffers(GLsizei n, const GLuint* names);
+extern void sogl_res_create_buffers(GLsizei n, GLuint* names, const char* file, int line);
+extern void sogl_res_bind_buffer(GLenum target, GLuint name);
+extern void sogl_res_bind_buffer_base(GLenum target, GLuint index, GLuint name);
+extern void sogl_res_bind_buffer_range(GLenum target, GLuint index, GLuint name,
+                                       GLintptr offset, GLsizeiptr size);
+extern void sogl_res_buffer_data(GLenum target, GLsizeiptr size,
+                                 const void* data, GLenum usage);
+extern void sogl_res_named_buffer_data(GLuint name, GLsizeiptr size,
+                                       const void* data, GLenum usage);
+
+extern void sogl_res_gen_textures(GLsizei n, GLuint* names, const char* file, int line);
+extern void sogl_res_delete_textures(GLsizei n, const GLuint* names);
+extern void sogl_res_create_textures(GLenum target, GLsizei n, GLuint* names,
+                                     const char* file, int line);
+extern void sogl_res_active_texture(GLenum unit);
+extern void sogl_res_bind_texture(GLenum target, GLuint name);
+extern void sogl_res_tex_image_2d(GLenum target, GLint level, GLint internal_format,
+                                  GLsizei width, GLsizei height, GLint border,
+                                  GLenum format, GLenum type, const void* pixels);
+extern void sogl_res_tex_image_3d(GLenum target, GLint level, GLint internal_format,
+                                  GLsizei width, GLsizei height, GLsizei depth,
+                                  GLint border, GLenum format, GLenum type,
+                                  const void* pixels);
+extern void sogl_res_compressed_tex_image_2d(GLenum target, GLint level,
+                                             GLenum internal_format,
+                                             GLsizei width, GLsizei height,
+                                             GLint border, GLsizei size,
+                                             const void* data);
+
+extern void sogl_res_gen_vertex_arrays(GLsizei n, GLuint* names, const char* file, int line);
+extern void sogl_res_create_vertex_arrays(GLsizei n, GLuint* names,
+                                          const char* file, int line);
+extern void sogl_res_delete_vertex_arrays(GLsizei n, const GLuint* names);
+extern void sogl_res_bind_vertex_array(GLuint name);
+
+extern GLuint sogl_res_create_shader(GLenum type, const char* file, int line);
+extern void sogl_res_delete_shader(GLuint name);
+extern GLuint sogl_res_create_program(const char* file, int line);
+extern void sogl_res_delete_program(GLuint name);
+extern void sogl_res_use_program(GLuint name);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+/* sources defining SOGL_RES_SHIM before including this header have
+ * the GL objects they create and delete tracked. Every source
+ * deleting or resizing a tracked object must use it too, or the
+ * object is reported as a leak.
+ * */
+#ifdef SOGL_RES_SHIM
+#undef glGenBuffers
+#undef glDeleteBuffers
+#undef glCreateBuffers
+#undef glBindBuffer
+#undef glBindBufferBase
+#undef glBindBufferRange
+#undef glBufferData
+#undef glNamedBufferData
+#undef glGenTextures
+#undef glCreateTextures
+#undef glDeleteTextures
+#undef glActiveTexture
+#undef glBindTexture
+#undef glTexImage2D
+#undef glTexImage3D
+#undef glCompressedTexImage2D
+#undef glGenVertexArrays
+#undef glCreateVertexArrays
+#undef glDeleteVertexArrays
+#undef glBindVertexArray
+#undef glCreateShader
+#undef glDeleteShader
+#undef glCreateProgram
+#undef glDeleteProgram
+#undef glUseProgram
+#define glGenBuffers(n, names)      sogl_res_gen_buffers(n, names, __FILE__, __LINE__)
+#define glDeleteBuffers             sogl_res_delete_buffers
+#define glCreateBuffers(n, names)   sogl_res_create_buffers(n, names, __FILE__, __LINE__)
+#define glBindBuffer                sogl_res_bind_buffer
+#define glBindBufferBase            sogl_res_bind_buffer_base
+#define glBindBufferRange           sogl_res_bind_buffer_range
+#define glBufferData                sogl_res_buffer_data
+#define glNamedBufferData           sogl_res_named_buffer_data
+#define glGenTextures(n, names)     sogl_res_gen_textures(n, names, __FILE__, __LINE__)
+#define glCreateTextures(target, n, names) \
+	sogl_res_create_textures(target, n, names, __FILE__, __LINE__)
+#define glDeleteTextures            sogl_res_delete_textures
+#define glActiveTexture             sogl_res_active_texture
+#define glBindTexture               sogl_res_bind_texture
+#define glTexImage2D                sogl_res_tex_image_2d
+#define glTexImage3D                sogl_res_tex_image_3d
+#define glCompressedTexImage2D      sogl_res_compressed_tex_image_2d
+#define glGenVertexArrays(n, names) sogl_res_gen_vertex_arrays(n, names, __FILE__, __LINE__)
+#define glCreateVertexArrays(n, names) \
+	sogl_res_create_vertex_arrays(n, names, __FILE__, __LINE__)
+#define glDeleteVertexArrays        sogl_res_delete_vertex_arrays
+#define glBindVertexArray           sogl_res_bind_vertex_array
+#define glCreateShader(type)        sogl_res_create_shader(type, __FILE__, __LINE__)
+#define glDeleteShader              sogl_res_delete_shader
+#define glCreateProgram()           sogl_res_create_program(__FILE__, __LINE__)
+#define glDeleteProgram             sogl_res_delete_program
+#define glUseProgram                sogl_res_use_program
+#endif
+
+#endif
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "sogl_scene.h"
+#include "sogl_math.h"
+
+
+bool sogl_scene_init(struct sogl_scene* const scene, const int capacity)
+{
+	memset(scene, 0, sizeof(*scene));
+	scene->capacity = capacity;
+
+	scene->locals = malloc(sizeof(*scene->locals) * capacity);
+	scene->worlds = malloc(sizeof(*scene->worlds) * capacity);
+	scene->parents = malloc(sizeof(*scene->parents) * capacity);
+	scene->depths = malloc(sizeof(*scene->depths) * capacity);
+	scene->nodes = malloc(sizeof(*scene->nodes) * capacity);
+	scene->dirty = malloc(sizeof(*scene->dirty) * capacity);
+	scene->slots = malloc(sizeof(*scene->slots) * capacity);
+	if (scene->locals == NULL || scene->worlds == NULL || scene->parents == NULL ||
+	    scene->depths == NULL || scene->nodes == NULL || scene->dirty == NULL ||
+	    scene->slots == NULL) {
+		fprintf(stderr, "Couldn't allocate a scene of %d nodes\n", capacity);
+		sogl_scene_free(scene);
+		return false;
+	}
+
+	return true;
+}
+
+void sogl_scene_free(struct sogl_scene* const scene)
+{
+	free(scene->slots);
+	free(scene->dirty);
+	free(scene->nodes);
+	free(scene->depths);
+	free(scene->parents);
+	free(scene->worlds);
+	free(scene->locals);
+	memset(scene, 0, sizeof(*scene));
+}
+
+int sogl_scene_add(struct sogl_scene* const scene, const int parent,
+                   const struct mat4* const local)
+{
+	if (scene->count == scene->capacity) {
+		fprintf(stderr, "Couldn't add a node, the scene is full\n");
+		return -1;
+	}
+
+	const int node = scene->count;
+	const int slot = scene->count++;
+	const int parent_slot = parent == SOGL_SCENE_ROOT ? SOGL_SCENE_ROOT : scene->slots[parent];
+	const int depth = parent == SOGL_SCENE_ROOT ? 0 : scene->depths[parent_slot] + 1;
+
+	if (slot > 0 && depth < scene->depths[slot - 1])
+		scene->unsorted = true;
+
+	scene->locals[slot] = *local;
+	scene->parents[slot] = parent_slot;
+	scene->depths[slot] = depth;
+	scene->nodes[slot] = node;
+	scene->dirty[slot] = 1;
+	scene->slots[node] = slot;
+	if (slot < scene->first_dirty)
+		scene->first_dirty = slot;
+
+	return node;
+}
+
+void sogl_scene_set_local(struct sogl_scene* const scene, const int node,
+                          const struct mat4* const local)
+{
+	const int slot = scene->slots[node];
+	scene->locals[slot] = *local;
+	scene->dirty[slot] = 1;
+	if (slot < scene->first_dirty)
+		scene->first_dirty = slot;
+}
+
+const struct mat4* sogl_scene_world(const struct sogl_scene* const scene, const int node)
+{
+	return &scene->worlds[scene->slots[node]];
+}
+
+
+/* stable counting sort of the slots by depth, nodes keep
+ * their order within a level so siblings stay together
+ * */
+static bool sort_slots(struct sogl_scene* const scene)
+{
+	const int count = scene->count;
+	int max_depth = 0;
+	for (int s = 0; s < count; ++s)
+		max_depth = scene->depths[s] > max_depth ? scene->depths[s] : max_depth;
+
+	int* const first = calloc(max_depth + 2, sizeof(int));
+	int* const order = malloc(sizeof(int) * count);
+	struct mat4* const locals = malloc(sizeof(*locals) * count);
+	struct mat4* const worlds = malloc(sizeof(*worlds) * count);
+	int* const parents = malloc(sizeof(int) * count);
+	uint8_t* const dirty = malloc(count);
+	bool ok = first != NULL && order != NULL && locals != NULL &&
+	          worlds != NULL && parents != NULL && dirty != NULL;
+	if (!ok) {
+		fprintf(stderr, "Couldn't sort the scene\n");
+		goto Lfree;
+	}
+
+	for (int s = 0; s < count; ++s)
+		++first[scene->depths[s] + 1];
+	for (int d = 0; d <= max_depth; ++d)
+		first[d + 1] += first[d];
+	for (int s = 0; s < count; ++s)
+		order[first[scene->depths[s]]++] = s;
+
+	// the new slot of every old one, in slots while parents are remapped
+	for (int s = 0; s < count; ++s)
+		scene->slots[scene->nodes[order[s]]] = s;
+
+	for (int s = 0; s < count; ++s) {
+		const int old = order[s];
+		locals[s] = scene->locals[old];
+		worlds[s] = scene->worlds[old];
+		dirty[s] = scene->dirty[old];
+		parents[s] = scene->parents[old] == SOGL_SCENE_ROOT
+		             ? SOGL_SCENE_ROOT
+		             : scene->slots[scene->nodes[scene->parents[old]]];
+	}
+	// levels are now contiguous, first[d] ends level d
+	for (int d = 0, s = 0; d <= max_depth; ++d) {
+		for (; s < first[d]; ++s)
+			scene->depths[s] = d;
+	}
+	for (int node = 0; node < count; ++node)
+		scene->nodes[scene->slots[node]] = node;
+	memcpy(scene->locals, locals, sizeof(*locals) * count);
+	memcpy(scene->worlds, worlds, sizeof(*worlds) * count);
+	memcpy(scene->parents, parents, sizeof(int) * count);
+	memcpy(scene->dirty, dirty, count);
+
+	scene->first_dirty = 0;
+	scene->unsorted = false;
+
+Lfree:
+	free(dirty);
+	free(parents);
+	free(worlds);
+	free(locals);
+	free(order);
+	free(first);
+	return ok;
+}
+
+/* out = parent * local */
+static void world_of(const struct mat4* const parent, const struct mat4* const local,
+                     struct mat4* const out)
+{
+#ifdef __SSE2__
+	const __m128 c0 = _mm_loadu_ps(&parent->x0);
+	const __m128 c1 = _mm_loadu_ps(&parent->x1);
+	const __m128 c2 = _mm_loadu_ps(&parent->x2);
+	const __m128 c3 = _mm_loadu_ps(&parent->x3);
+	for (int c = 0; c < 4; ++c) {
+		const struct vec4* const l = &local->vecs[c];
+		const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(l->x)),
+		                                       _mm_mul_ps(c1, _mm_set1_ps(l->y))),
+		                            _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(l->z)),
+		                                       _mm_mul_ps(c3, _mm_set1_ps(l->w))));
+		_mm_storeu_ps(&out->vecs[c].x, r);
+	}
+#else
+	sogl_mat4_mul(parent, local, out);
+#endif
+}
+
+int sogl_scene_update(struct sogl_scene* const scene)
+{
+	scene->updated = 0;
+	if (scene->unsorted && !sort_slots(scene))
+		return 0;
+
+	/* a slot is dirty when its local changed or its parent's
+	 * world did, parents come first so one pass propagates it
+	 * */
+	const int first = scene->first_dirty;
+	int updated = 0;
+	for (int s = first; s < scene->count; ++s) {
+		const int p = scene->parents[s];
+		if (p != SOGL_SCENE_ROOT)
+			scene->dirty[s] |= scene->dirty[p];
+		if (!scene->dirty[s])
+			continue;
+
+		if (p == SOGL_SCENE_ROOT)
+			scene->worlds[s] = scene->locals[s];
+		else
+			world_of(&scene->worlds[p], &scene->locals[s], &scene->worlds[s]);
+		++updated;
+	}
+
+	if (first < scene->count)
+		memset(&scene->dirty[first], 0, scene->count - first);
+	scene->first_dirty = scene->count;
+	scene->updated = updated;
+	return updated;
+}
@@ -0,0 +1,57 @@
+#ifndef SOGL_SCENE_H_
+#define SOGL_SCENE_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <GL/glew.h>
+#include "sogl_types.h"
+
+#define SOGL_SCENE_ROOT (-1)   // parent of the nodes without one
+
+
+/* Transform hierarchy:
+ * nodes keep their handle for life, but their matrices live in
+ * slots sorted by depth, so every parent comes before its children
+ * and the world matrices are refreshed in one pass over the slots.
+ * Only the slots whose local matrix changed, or one of whose
+ * ancestors did, are recomputed. worlds is contiguous in slot
+ * order, ready to be uploaded for instancing, nodes gives the
+ * node of every slot.
+ * */
+struct sogl_scene {
+	// per slot
+	struct mat4* locals;
+	struct mat4* worlds;
+	int* parents;        // slot of the parent, SOGL_SCENE_ROOT for roots
+	int* depths;
+	int* nodes;
+	uint8_t* dirty;
+
+	// per node
+	int* slots;
+
+	int count;
+	int capacity;
+	int first_dirty;     // no slot before it is dirty
+	int updated;         // worlds recomputed by the last update
+	bool unsorted;       // a node was added shallower than the last slot
+};
+
+
+extern bool sogl_scene_init(struct sogl_scene* scene, int capacity);
+extern void sogl_scene_free(struct sogl_scene* scene);
+
+/* returns the new node, or -1 when the scene is full,
+ * parent must already be in the scene or be SOGL_SCENE_ROOT
+ * */
+extern int sogl_scene_add(struct sogl_scene* scene, int parent, const struct mat4* local);
+
+/* marks the node and its subtree for the next update */
+extern void sogl_scene_set_local(struct sogl_scene* scene, int node, const struct mat4* local);
+
+/* recomputes the dirty world matrices, returns how many */
+extern int sogl_scene_update(struct sogl_scene* scene);
+
+/* valid after the update following the last change */
+extern const struct mat4* sogl_scene_world(const struct sogl_scene* scene, int node);
+
+#endif
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include "sogl_sim.h"
+
+
+void sogl_sim_init(struct sogl_sim* const sim, const double step_ms, const double fixed_ms)
+{
+	*sim = (struct sogl_sim) {
+		.step_ms = step_ms,
+		.fixed_ms = fixed_ms
+	};
+}
+
+int sogl_sim_advance(struct sogl_sim* const sim)
+{
+	const Uint64 clk = SDL_GetPerformanceCounter();
+	sim->frame_ms = sim->last_clk != 0
+	                ? (clk - sim->last_clk) * 1000.0 / SDL_GetPerformanceFrequency()
+	                : 0.0;
+	sim->last_clk = clk;
+
+	sim->acc_ms += sim->fixed_ms > 0 ? sim->fixed_ms : sim->frame_ms;
+
+	int steps = (int)(sim->acc_ms / sim->step_ms);
+	if (steps > SOGL_SIM_MAX_STEPS) {
+		// too slow to catch up, slows the simulation down instead
+		steps = SOGL_SIM_MAX_STEPS;
+		sim->acc_ms = fmod(sim->acc_ms, sim->step_ms);
+	} else {
+		sim->acc_ms -= steps * sim->step_ms;
+	}
+
+	sim->steps += steps;
+	return steps;
+}
+
+float sogl_sim_alpha(const struct sogl_sim* const sim)
+{
+	return (float)(sim->acc_ms / sim->step_ms);
+}
+
+
+void sogl_loadctl_init(struct sogl_loadctl* const ctl, const double target_ms,
+                       const long long min, const long long max)
+{
+	*ctl = (struct sogl_loadctl) {
+		.target_ms = target_ms,
+		.count = min,
+		.min = min,
+		.max = max
+	};
+}
+
+static double clamp(const double v, const double min, const double max)
+{
+	return v < min ? min : v > max ? max : v;
+}
+
+long long sogl_loadctl_update(struct sogl_loadctl* const ctl, const double frame_ms)
+{
+	// the first frames include startup work, they only seed the filter
+	if (ctl->frames++ == 0 || frame_ms <= 0) {
+		ctl->filtered_ms = frame_ms;
+		return (long long)ctl->count;
+	}
+
+	ctl->filtered_ms += (frame_ms - ctl->filtered_ms) * SOGL_LOADCTL_SMOOTHING;
+
+	// positive while there's room left in the budget
+	const double error = (ctl->target_ms - ctl->filtered_ms) / ctl->target_ms;
+	ctl->integral = clamp(ctl->integral + error, -SOGL_LOADCTL_WINDUP, SOGL_LOADCTL_WINDUP);
+	const double derivative = error - ctl->prev_error;
+	ctl->prev_error = error;
+
+	const double rate = clamp(SOGL_LOADCTL_KP * error +
+	                          SOGL_LOADCTL_KI * ctl->integral +
+	                          SOGL_LOADCTL_KD * derivative,
+	                          -SOGL_LOADCTL_MAX_RATE, SOGL_LOADCTL_MAX_RATE);
+
+	ctl->count = clamp(ctl->count + (ctl->count + SOGL_LOADCTL_FLOOR) * rate,
+	                   ctl->min, ctl->max);
+
+	if (fabs(error) <= SOGL_LOADCTL_TOLERANCE)
+		++ctl->stable_frames;
+	else
+		ctl->stable_frames = 0;
+
+	if (ctl->stable_frames >= SOGL_LOADCTL_SETTLE) {
+		ctl->capacity_sum += ctl->count;
+		++ctl->capacity_frames;
+	}
+
+	return (long long)ctl->count;
+}
+
+long long sogl_loadctl_capacity(const struct sogl_loadctl* const ctl)
+{
+	if (ctl->capacity_frames == 0)
+		return -1;
+	return (long long)(ctl->capacity_sum / ctl->capacity_frames + 0.5);
+}
+
+void sogl_loadctl_report(const struct sogl_loadctl* const ctl, const char* const objects)
+{
+	const long long capacity = sogl_loadctl_capacity(ctl);
+	if (capacity < 0) {
+		printf("CAPACITY: NOT SETTLED AFTER %lld FRAMES, LAST: %lld %s AT %.2f MS\n",
+		       ctl->frames, (long long)ctl->count, objects, ctl->filtered_ms);
+		return;
+	}
+
+	printf("CAPACITY: %lld %s AT %.2f MS (%lld FRAMES ON TARGET OF %lld)\n",
+	       capacity, objects, ctl->target_ms, ctl->capacity_frames, ctl->frames);
+}
@@ -0,0 +1,83 @@
+#ifndef SOGL_SIM_H_
+#define SOGL_SIM_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SOGL_SIM_MAX_STEPS      (8)       // steps per frame before time is dropped
+
+#define SOGL_LOADCTL_KP         (0.08)    // gains on the relative frame time error
+#define SOGL_LOADCTL_KI         (0.004)
+#define SOGL_LOADCTL_KD         (0.2)
+#define SOGL_LOADCTL_WINDUP     (25.0)    // bound of the integral term
+#define SOGL_LOADCTL_MAX_RATE   (0.05)    // largest count change per frame, relative
+#define SOGL_LOADCTL_FLOOR      (100.0)   // so an empty scene still grows
+#define SOGL_LOADCTL_SMOOTHING  (0.1)     // weight of a new frame time in the filter
+#define SOGL_LOADCTL_TOLERANCE  (0.05)    // relative error counted as on target
+#define SOGL_LOADCTL_SETTLE     (120)     // frames on target before the count is averaged
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Fixed timestep:
+ * the simulation advances by step_ms whatever the frame rate,
+ * frames run the steps their time covers and draw between the
+ * last two states with sogl_sim_alpha.
+ * fixed_ms > 0 makes every frame last that long instead of the
+ * measured time, pass sogl_fixed_dt() for reproducible runs.
+ * */
+struct sogl_sim {
+	double step_ms;
+	double fixed_ms;
+	double acc_ms;       // time not simulated yet
+	double frame_ms;     // measured time since the previous frame
+	uint64_t last_clk;
+	long long steps;
+};
+
+extern void sogl_sim_init(struct sogl_sim* sim, double step_ms, double fixed_ms);
+
+/* once per frame, returns the steps to run */
+extern int sogl_sim_advance(struct sogl_sim* sim);
+
+/* [0, 1) from the previous state to the current one */
+extern float sogl_sim_alpha(const struct sogl_sim* sim);
+
+
+/* Load controller:
+ * a PID on the relative error of the filtered frame time against
+ * target_ms, its output is the relative change of the object count,
+ * so the gains don't depend on the scene size. Once the frame time
+ * stays on target for SOGL_LOADCTL_SETTLE frames, the counts are
+ * averaged into the capacity of the build.
+ * */
+struct sogl_loadctl {
+	double target_ms;
+	double filtered_ms;
+	double integral, prev_error;
+	double count;
+	long long min, max;
+	long long frames, stable_frames;
+	double capacity_sum;
+	long long capacity_frames;
+};
+
+extern void sogl_loadctl_init(struct sogl_loadctl* ctl, double target_ms,
+                              long long min, long long max);
+
+/* returns the object count to run the next frame with */
+extern long long sogl_loadctl_update(struct sogl_loadctl* ctl, double frame_ms);
+
+/* mean count while on target, -1 until it has settled */
+extern long long sogl_loadctl_capacity(const struct sogl_loadctl* ctl);
+
+/* prints the capacity, or that it didn't settle */
+extern void sogl_loadctl_report(const struct sogl_loadctl* ctl, const char* objects);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
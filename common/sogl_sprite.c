@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <GL/glew.h>
+#include "sogl.h"
+#include "sogl_sprite.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+#define MAX_SKYLINE_NODES (SOGL_SPRITE_ATLAS_SIZE)
+
+
+static const GLchar* const vs_src =
+"#version 150\n"
+"in vec4 rect;\n"
+"in vec4 uvrect;\n"
+"in float layer;\n"
+"in vec4 tint;\n"
+"out vec3 frag_uv;\n"
+"out vec4 frag_tint;\n"
+"void main()\n"
+"{\n"
+"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+"	gl_Position = vec4(rect.xy + (corner * 2.0 - 1.0) * rect.zw, 0.0, 1.0);\n"
+"	frag_uv = vec3(mix(uvrect.xy, uvrect.zw, corner), layer);\n"
+"	frag_tint = tint;\n"
+"}\n";
+
+static const GLchar* const fs_src =
+"#version 150\n"
+"in vec3 frag_uv;\n"
+"in vec4 frag_tint;\n"
+"out vec4 outcolor;\n"
+"uniform sampler2DArray atlas;\n"
+"void main()\n"
+"{\n"
+"	outcolor = frag_tint * texture(atlas, frag_uv);\n"
+"}\n";
+
+
+struct instance {
+	GLfloat rect[4];
+	GLfloat uvrect[4];
+	GLfloat layer;
+	uint32_t tint;
+};
+
+struct skyline_node {
+	int x, y, width;
+};
+
+struct layer {
+	unsigned char* pixels;
+	struct skyline_node nodes[MAX_SKYLINE_NODES];
+	int nnodes;
+};
+
+
+static struct layer* layers[SOGL_SPRITE_MAX_LAYERS];
+static int nlayers;
+static struct sogl_sprite_image images[SOGL_SPRITE_MAX_IMAGES];
+static int nimages;
+
+static GLuint program, vao, instance_vbo, atlas_tex;
+static struct instance batch[SOGL_SPRITE_BATCH_SIZE];
+static int batch_count;
+static int draw_calls;
+
+
+/*
+ * Skyline bottom-left packer
+ * */
+static int skyline_fit(const struct layer* const layer, const int index,
+                       const int width, const int height)
+{
+	const int x = layer->nodes[index].x;
+	if (x + width > SOGL_SPRITE_ATLAS_SIZE)
+		return -1;
+
+	int y = 0;
+	int width_left = width;
+	for (int i = index; width_left > 0; ++i) {
+		if (i == layer->nnodes)
+			return -1;
+		if (layer->nodes[i].y > y)
+			y = layer->nodes[i].y;
+		if (y + height > SOGL_SPRITE_ATLAS_SIZE)
+			return -1;
+		width_left -= layer->nodes[i].width;
+	}
+
+	return y;
+}
+
+static bool skyline_insert(struct layer* const layer,
+                           const int width, const int height,
+                           int* const out_x, int* const out_y)
+{
+	int best_index = -1, best_y = SOGL_SPRITE_ATLAS_SIZE, best_width = SOGL_SPRITE_ATLAS_SIZE;
+
+	for (int i = 0; i < layer->nnodes; ++i) {
+		const int y = skyline_fit(layer, i, width, height);
+		if (y < 0)
+			continue;
+		if (y < best_y ||
+		    (y == best_y && layer->nodes[i].width < best_width)) {
+			best_index = i;
+			best_y = y;
+			best_width = layer->nodes[i].width;
+		}
+	}
+
+	if (best_index < 0 || layer->nnodes == MAX_SKYLINE_NODES)
+		return false;
+
+	const struct skyline_node node = {
+		layer->nodes[best_index].x, best_y + height, width
+	};
+
+	memmove(&layer->nodes[best_index + 1], &layer->nodes[best_index],
+	        sizeof(struct skyline_node) * (layer->nnodes - best_index));
+	layer->nodes[best_index] = node;
+	++layer->nnodes;
+
+	// shrink or remove the nodes now covered by the new one
+	for (int i = best_index + 1; i < layer->nnodes; ++i) {
+		struct skyline_node* const cur = &layer->nodes[i];
+		const struct skyline_node* const prev = &layer->nodes[i - 1];
+		if (cur->x >= prev->x + prev->width)
+			break;
+
+		const int shrink = prev->x + prev->width - cur->x;
+		cur->x += shrink;
+		cur->width -= shrink;
+		if (cur->width > 0)
+			break;
+
+		memmove(cur, cur + 1, sizeof(struct skyline_node) * (layer->nnodes - i - 1));
+		--layer->nnodes;
+		--i;
+	}
+
+	// merge neighbours at the same height
+	for (int i = 0; i < layer->nnodes - 1; ++i) {
+		if (layer->nodes[i].y == layer->nodes[i + 1].y) {
+			layer->nodes[i].width += layer->nodes[i + 1].width;
+			memmove(&layer->nodes[i + 1], &layer->nodes[i + 2],
+			        sizeof(struct skyline_node) * (layer->nnodes - i - 2));
+			--layer->nnodes;
+			--i;
+		}
+	}
+
+	*out_x = node.x;
+	*out_y = best_y;
+	return true;
+}
+
+static struct layer* new_layer(void)
+{
+	if (nlayers == SOGL_SPRITE_MAX_LAYERS)
+		return NULL;
+
+	struct layer* const layer = malloc(sizeof(struct layer));
+	if (layer == NULL)
+		return NULL;
+
+	layer->pixels = calloc((size_t)SOGL_SPRITE_ATLAS_SIZE * SOGL_SPRITE_ATLAS_SIZE, 4);
+	if (layer->pixels == NULL) {
+		free(layer);
+		return NULL;
+	}
+
+	layer->nodes[0] = (struct skyline_node) { 0, 0, SOGL_SPRITE_ATLAS_SIZE };
+	layer->nnodes = 1;
+	layers[nlayers++] = layer;
+	return layer;
+}
+
+static void blit_padded(unsigned char* const dst, const int dx, const int dy,
+                        const unsigned char* const src, const int width, const int height)
+{
+	const int pad = SOGL_SPRITE_PADDING;
+	for (int y = -pad; y < height + pad; ++y) {
+		const int sy = y < 0 ? 0 : y >= height ? height - 1 : y;
+		for (int x = -pad; x < width + pad; ++x) {
+			const int sx = x < 0 ? 0 : x >= width ? width - 1 : x;
+			memcpy(&dst[(((size_t)dy + pad + y) * SOGL_SPRITE_ATLAS_SIZE + dx + pad + x) * 4],
+			       &src[((size_t)sy * width + sx) * 4], 4);
+		}
+	}
+}
+
+
+int sogl_sprite_add_image(const void* const rgba, const int width, const int height)
+{
+	const int pw = width + SOGL_SPRITE_PADDING * 2;
+	const int ph = height + SOGL_SPRITE_PADDING * 2;
+
+	if (nimages == SOGL_SPRITE_MAX_IMAGES || atlas_tex != 0 ||
+	    pw > SOGL_SPRITE_ATLAS_SIZE || ph > SOGL_SPRITE_ATLAS_SIZE) {
+		fprintf(stderr, "Couldn't add sprite image\n");
+		return -1;
+	}
+
+	int x = 0, y = 0, l;
+	for (l = 0; l < nlayers; ++l)
+		if (skyline_insert(layers[l], pw, ph, &x, &y))
+			break;
+
+	if (l == nlayers) {
+		struct layer* const layer = new_layer();
+		if (layer == NULL || !skyline_insert(layer, pw, ph, &x, &y)) {
+			fprintf(stderr, "Sprite atlas is full\n");
+			return -1;
+		}
+	}
+
+	blit_padded(layers[l]->pixels, x, y, rgba, width, height);
+
+	struct sogl_sprite_image* const img = &images[nimages];
+	img->u0 = (GLfloat)(x + SOGL_SPRITE_PADDING) / SOGL_SPRITE_ATLAS_SIZE;
+	img->v0 = (GLfloat)(y + SOGL_SPRITE_PADDING) / SOGL_SPRITE_ATLAS_SIZE;
+	img->u1 = (GLfloat)(x + SOGL_SPRITE_PADDING + width) / SOGL_SPRITE_ATLAS_SIZE;
+	img->v1 = (GLfloat)(y + SOGL_SPRITE_PADDING + height) / SOGL_SPRITE_ATLAS_SIZE;
+	img->layer = l;
+	img->width = width;
+	img->height = height;
+
+	return nimages++;
+}
+
+bool sogl_sprite_build(void)
+{
+	if (nlayers == 0) {
+		fprintf(stderr, "No sprite images to build\n");
+		return false;
+	}
+
+	glGenTextures(1, &atlas_tex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, atlas_tex);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8,
+	             SOGL_SPRITE_ATLAS_SIZE, SOGL_SPRITE_ATLAS_SIZE, nlayers,
+	             0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	for (int l = 0; l < nlayers; ++l) {
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, l,
+		                SOGL_SPRITE_ATLAS_SIZE, SOGL_SPRITE_ATLAS_SIZE, 1,
+		                GL_RGBA, GL_UNSIGNED_BYTE, layers[l]->pixels);
+
+		// the packed pixels live in VRAM from now on
+		free(layers[l]->pixels);
+		layers[l]->pixels = NULL;
+	}
+
+	printf("SPRITE ATLAS: %d IMAGES IN %d LAYERS OF %dx%d\n",
+	       nimages, nlayers, SOGL_SPRITE_ATLAS_SIZE, SOGL_SPRITE_ATLAS_SIZE);
+	return true;
+}
+
+const struct sogl_sprite_image* sogl_sprite_get_image(const int image)
+{
+	return &images[image];
+}
+
+
+/*
+ * Batching
+ * */
+static void vattr(const GLchar* const name, const GLint size, const GLenum type,
+                  const GLboolean normalized, const size_t offset)
+{
+	const GLint index = glGetAttribLocation(program, name);
+	if (index < 0)
+		return;
+
+	glEnableVertexAttribArray(index);
+	glVertexAttribPointer(index, size, type, normalized,
+	                      sizeof(struct instance), (const GLvoid*)offset);
+	glVertexAttribDivisor(index, 1);
+}
+
+bool sogl_sprite_init(void)
+{
+	nlayers = 0;
+	nimages = 0;
+	batch_count = 0;
+
+	program = sogl_create_program(vs_src, fs_src);
+	if (program == 0)
+		return false;
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &instance_vbo);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(batch), NULL, GL_STREAM_DRAW);
+
+	vattr("rect", 4, GL_FLOAT, GL_FALSE, offsetof(struct instance, rect));
+	vattr("uvrect", 4, GL_FLOAT, GL_FALSE, offsetof(struct instance, uvrect));
+	vattr("layer", 1, GL_FLOAT, GL_FALSE, offsetof(struct instance, layer));
+	vattr("tint", 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(struct instance, tint));
+
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "atlas"), 0);
+
+	sogl_bind();
+	return true;
+}
+
+void sogl_sprite_term(void)
+{
+	for (int l = 0; l < nlayers; ++l) {
+		free(layers[l]->pixels);
+		free(layers[l]);
+		layers[l] = NULL;
+	}
+	nlayers = 0;
+	nimages = 0;
+
+	if (atlas_tex != 0)
+		glDeleteTextures(1, &atlas_tex);
+	if (instance_vbo != 0)
+		glDeleteBuffers(1, &instance_vbo);
+	if (vao != 0)
+		glDeleteVertexArrays(1, &vao);
+	if (program != 0)
+		glDeleteProgram(program);
+
+	atlas_tex = instance_vbo = vao = program = 0;
+}
+
+static void flush(void)
+{
+	if (batch_count == 0)
+		return;
+
+	// orphan the buffer so the driver doesn't wait on the previous draw
+	sogl_upload_orphaned(instance_vbo, GL_ARRAY_BUFFER, sizeof(batch),
+	                     batch, sizeof(struct instance) * batch_count);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, batch_count);
+
+	batch_count = 0;
+	++draw_calls;
+}
+
+void sogl_sprite_begin(void)
+{
+	draw_calls = 0;
+	batch_count = 0;
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glUseProgram(program);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, atlas_tex);
+}
+
+void sogl_sprite_draw(const int image,
+                      const GLfloat x, const GLfloat y,
+                      const GLfloat hw, const GLfloat hh,
+                      const uint32_t tint)
+{
+	// sprites off the viewport never reach the instance buffer
+	if (x + hw < -1.0f || x - hw > 1.0f || y + hh < -1.0f || y - hh > 1.0f)
+		return;
+
+	if (batch_count == SOGL_SPRITE_BATCH_SIZE)
+		flush();
+
+	const struct sogl_sprite_image* const img = &images[image];
+	struct instance* const inst = &batch[batch_count++];
+	inst->rect[0] = x;
+	inst->rect[1] = y;
+	inst->rect[2] = hw;
+	inst->rect[3] = hh;
+	inst->uvrect[0] = img->u0;
+	inst->uvrect[1] = img->v0;
+	inst->uvrect[2] = img->u1;
+	inst->uvrect[3] = img->v1;
+	inst->layer = img->layer;
+	inst->tint = tint;
+}
+
+void sogl_sprite_end(void)
+{
+	flush();
+
+	// sogl_init's state, nothing is asked of GL to put it back
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+
+	sogl_bind();
+}
+
+int sogl_sprite_layers(void)
+{
+	return nlayers;
+}
+
+int sogl_sprite_draw_calls(void)
+{
+	return draw_calls;
+}
@@ -0,0 +1,56 @@
+#ifndef SOGL_SPRITE_H_
+#define SOGL_SPRITE_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <GL/glew.h>
+
+#define SOGL_SPRITE_ATLAS_SIZE  (2048)      // layer width and height
+#define SOGL_SPRITE_MAX_LAYERS  (16)
+#define SOGL_SPRITE_MAX_IMAGES  (4096)
+#define SOGL_SPRITE_PADDING     (1)         // edge texels duplicated around images
+#define SOGL_SPRITE_BATCH_SIZE  (1024 * 64) // instances per draw call
+
+
+/* Sprite batcher:
+ * images are packed with a skyline packer into the layers of a
+ * GL_TEXTURE_2D_ARRAY, then every sprite is a single instance of a
+ * unit quad carrying its rect, uv rect, layer and tint, so any mix
+ * of images draws in one call per SOGL_SPRITE_BATCH_SIZE sprites
+ * */
+struct sogl_sprite_image {
+	GLfloat u0, v0, u1, v1;
+	GLfloat layer;
+	int width, height;
+};
+
+
+extern bool sogl_sprite_init(void);
+extern void sogl_sprite_term(void);
+
+/* packs an RGBA8 image into the atlas, returns the image id or -1.
+ * images can only be added before sogl_sprite_build
+ * */
+extern int sogl_sprite_add_image(const void* rgba, int width, int height);
+
+/* uploads the packed layers to the texture array */
+extern bool sogl_sprite_build(void);
+
+extern const struct sogl_sprite_image* sogl_sprite_get_image(int image);
+
+/* x, y: center in NDC; hw, hh: half width and height in NDC
+ * tint: RGBA8 packed as 0xAABBGGRR
+ * the end leaves blending disabled, the depth test enabled as
+ * sogl_init does and sogl's objects bound as sogl_bind does, no
+ * GL state is queried
+ * */
+extern void sogl_sprite_begin(void);
+extern void sogl_sprite_draw(int image,
+                             GLfloat x, GLfloat y,
+                             GLfloat hw, GLfloat hh,
+                             uint32_t tint);
+extern void sogl_sprite_end(void);
+
+extern int sogl_sprite_layers(void);
+extern int sogl_sprite_draw_calls(void); // of the last begin/end
+
+#endif
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "sogl_startup.h"
+
+
+struct phase {
+	const char* name;
+	Uint64 end;
+};
+
+
+static struct phase phases[SOGL_STARTUP_MAX_PHASES];
+static int nphases;
+static int nmore;                // phases past the table, summed in one entry
+static Uint64 begin_clk;
+static bool tracing = false;
+
+
+static double ms_between(const Uint64 from, const Uint64 to)
+{
+	return (double)(to - from) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void sogl_startup_begin(void)
+{
+	nphases = 0;
+	nmore = 0;
+	begin_clk = SDL_GetPerformanceCounter();
+	tracing = true;
+}
+
+void sogl_startup_phase(const char* const name)
+{
+	if (!tracing)
+		return;
+
+	/* the last slot is kept for the first frame and the one before it
+	 * for everything past the table, the phases already marked keep
+	 * their names and times
+	 * */
+	if (nphases >= SOGL_STARTUP_MAX_PHASES - 2) {
+		phases[SOGL_STARTUP_MAX_PHASES - 2] =
+		  (struct phase) { "MORE PHASES", SDL_GetPerformanceCounter() };
+		nphases = SOGL_STARTUP_MAX_PHASES - 1;
+		++nmore;
+		return;
+	}
+
+	phases[nphases++] = (struct phase) { name, SDL_GetPerformanceCounter() };
+}
+
+void sogl_startup_first_frame(void)
+{
+	if (!tracing)
+		return;
+
+	phases[nphases++] = (struct phase) { "FIRST FRAME", SDL_GetPerformanceCounter() };
+	tracing = false;
+
+	const double total_ms = ms_between(begin_clk, phases[nphases - 1].end);
+	Uint64 prev = begin_clk;
+	for (int i = 0; i < nphases; ++i) {
+		const double ms = ms_between(prev, phases[i].end);
+		if (nmore > 0 && i == SOGL_STARTUP_MAX_PHASES - 2)
+			printf("STARTUP %d %s: %.2f MS (%.1f%%)\n", nmore, phases[i].name, ms,
+			       total_ms > 0 ? ms * 100.0 / total_ms : 0.0);
+		else
+			printf("STARTUP %s: %.2f MS (%.1f%%)\n", phases[i].name, ms,
+			       total_ms > 0 ? ms * 100.0 / total_ms : 0.0);
+		prev = phases[i].end;
+	}
+	printf("STARTUP TO FIRST PRESENTED FRAME: %.2f MS\n", total_ms);
+}
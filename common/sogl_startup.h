@@ -0,0 +1,31 @@
+#ifndef SOGL_STARTUP_H_
+#define SOGL_STARTUP_H_
+
+#define SOGL_STARTUP_MAX_PHASES (32)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Startup trace:
+ * the time from sogl_init to the first presented frame, split in
+ * the phases that led to it. A phase ends when it's marked, so it
+ * covers everything since the previous mark, sogl_init marks its
+ * own steps and an application marks its loading the same way.
+ * The first sogl_end_frame closes the trace once the frame is
+ * swapped and prints it.
+ * */
+extern void sogl_startup_begin(void);
+
+/* name must outlive the trace, a literal usually */
+extern void sogl_startup_phase(const char* name);
+
+extern void sogl_startup_first_frame(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,635 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <GL/glew.h>
+#include "sogl_jobs.h"
+#include "sogl_bcn.h"
+#include "sogl_swr.h"
+
+#define SUBPIXELS (16.0f) // vertices snap to 1/16 pixel
+
+
+/* a triangle ready to rasterize, counter clockwise on screen,
+ * edge i is the one opposite to vertex i and starts at (ox, oy):
+ * e = a * (x - ox) + b * (y - oy), relative to the edge so the
+ * products stay small and exact enough for the fill rule
+ * */
+struct tri {
+	const struct sogl_swr_program* program;
+	GLfloat a[3], b[3], ox[3], oy[3];
+	bool top_left[3];
+	GLfloat inv_area;
+	GLfloat z[3];
+	GLfloat inv_w[3];
+	GLfloat varyings[3][SOGL_SWR_MAX_VARYINGS]; // divided by w
+	int minx, miny, maxx, maxy;
+};
+
+struct bin {
+	int* tris;
+	int count;
+	int capacity;
+};
+
+struct clip_vertex {
+	struct vec4 clip;
+	GLfloat varyings[SOGL_SWR_MAX_VARYINGS];
+};
+
+struct vertex_job {
+	const struct sogl_swr_program* program;
+	const unsigned char* verts;
+	GLsizei vertex_size;
+};
+
+
+static uint32_t* color;
+static GLfloat* depth;
+static int fb_width, fb_height;
+
+static struct bin* bins;
+static int tiles_x, tiles_y;
+
+static struct tri* tris;
+static long ntris, tris_capacity;
+
+static GLfloat* transformed; // clip position then varyings per vertex
+static long transformed_capacity;
+static int transformed_stride;
+
+
+bool sogl_swr_init(const int width, const int height)
+{
+	if (width <= 0 || height <= 0 || width % 4 != 0) {
+		fprintf(stderr, "Couldn't create software framebuffer: %dx%d, "
+		                "width must be a multiple of 4\n", width, height);
+		return false;
+	}
+
+	fb_width = width;
+	fb_height = height;
+	tiles_x = (width + SOGL_SWR_TILE_SIZE - 1) / SOGL_SWR_TILE_SIZE;
+	tiles_y = (height + SOGL_SWR_TILE_SIZE - 1) / SOGL_SWR_TILE_SIZE;
+	ntris = tris_capacity = 0;
+	transformed_capacity = 0;
+
+	color = malloc(sizeof(uint32_t) * width * height);
+	depth = malloc(sizeof(GLfloat) * width * height);
+	bins = calloc((size_t)tiles_x * tiles_y, sizeof(struct bin));
+	if (color == NULL || depth == NULL || bins == NULL) {
+		fprintf(stderr, "Couldn't allocate software framebuffer\n");
+		sogl_swr_term();
+		return false;
+	}
+
+	printf("SWR: %dx%d, %dx%d TILES, %d THREADS, %s\n",
+	       width, height, tiles_x, tiles_y, sogl_jobs_threads(),
+#ifdef __SSE2__
+	       "SSE2"
+#else
+	       "SCALAR"
+#endif
+	       );
+
+	sogl_swr_clear(0, 1.0f);
+	return true;
+}
+
+void sogl_swr_term(void)
+{
+	if (bins != NULL) {
+		for (int i = 0; i < tiles_x * tiles_y; ++i)
+			free(bins[i].tris);
+	}
+
+	free(transformed);
+	free(tris);
+	free(bins);
+	free(depth);
+	free(color);
+	transformed = NULL;
+	tris = NULL;
+	bins = NULL;
+	depth = NULL;
+	color = NULL;
+	ntris = tris_capacity = transformed_capacity = 0;
+}
+
+void sogl_swr_clear(const uint32_t rgba, const GLfloat d)
+{
+	const long npixels = (long)fb_width * fb_height;
+	for (long i = 0; i < npixels; ++i) {
+		color[i] = rgba;
+		depth[i] = d;
+	}
+
+	for (int i = 0; i < tiles_x * tiles_y; ++i)
+		bins[i].count = 0;
+	ntris = 0;
+}
+
+
+/*
+ * Geometry
+ * */
+static void vertex_stage(void* const data, const int begin, const int end)
+{
+	const struct vertex_job* const job = data;
+	const struct sogl_swr_program* const prog = job->program;
+
+	for (int i = begin; i < end; ++i) {
+		GLfloat* const out = &transformed[(long)i * transformed_stride];
+		prog->vertex(prog->uniforms, job->verts + (size_t)i * job->vertex_size,
+		             (struct vec4*)out, out + 4);
+	}
+}
+
+static bool grow(void** const array, long* const capacity, const long needed,
+                 const size_t item_size)
+{
+	if (needed <= *capacity)
+		return true;
+
+	long cap = *capacity > 0 ? *capacity : 256;
+	while (cap < needed)
+		cap *= 2;
+
+	void* const p = realloc(*array, item_size * cap);
+	if (p == NULL) {
+		fprintf(stderr, "Couldn't grow software rasterizer buffers\n");
+		return false;
+	}
+
+	*array = p;
+	*capacity = cap;
+	return true;
+}
+
+static bool bin_tri(const int index, const struct tri* const t)
+{
+	const int bx0 = t->minx / SOGL_SWR_TILE_SIZE, bx1 = t->maxx / SOGL_SWR_TILE_SIZE;
+	const int by0 = t->miny / SOGL_SWR_TILE_SIZE, by1 = t->maxy / SOGL_SWR_TILE_SIZE;
+
+	for (int by = by0; by <= by1; ++by) {
+		for (int bx = bx0; bx <= bx1; ++bx) {
+			struct bin* const bin = &bins[by * tiles_x + bx];
+			long cap = bin->capacity;
+			void* p = bin->tris;
+			if (!grow(&p, &cap, bin->count + 1, sizeof(int)))
+				return false;
+			bin->tris = p;
+			bin->capacity = cap;
+			bin->tris[bin->count++] = index;
+		}
+	}
+
+	return true;
+}
+
+static GLfloat snap(const GLfloat v)
+{
+	return floorf(v * SUBPIXELS + 0.5f) * (1.0f / SUBPIXELS);
+}
+
+/* viewport transform, edge setup and binning of a triangle
+ * already in front of the near plane
+ * */
+static bool setup_tri(const struct sogl_swr_program* const prog,
+                      const struct clip_vertex* v0,
+                      const struct clip_vertex* v1,
+                      const struct clip_vertex* v2)
+{
+	GLfloat x[3], y[3];
+	const struct clip_vertex* v[3] = { v0, v1, v2 };
+
+	for (int i = 0; i < 3; ++i) {
+		const GLfloat inv_w = 1.0f / v[i]->clip.w;
+		x[i] = snap((v[i]->clip.x * inv_w * 0.5f + 0.5f) * fb_width);
+		y[i] = snap((v[i]->clip.y * inv_w * 0.5f + 0.5f) * fb_height);
+	}
+
+	GLfloat area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0)
+		return true;
+
+	// both faces are drawn, clockwise ones are turned around
+	if (area < 0) {
+		const struct clip_vertex* const tv = v[1];
+		v[1] = v[2];
+		v[2] = tv;
+		GLfloat tmp = x[1];
+		x[1] = x[2];
+		x[2] = tmp;
+		tmp = y[1];
+		y[1] = y[2];
+		y[2] = tmp;
+		area = -area;
+	}
+
+	GLfloat fminx = x[0], fmaxx = x[0], fminy = y[0], fmaxy = y[0];
+	for (int i = 1; i < 3; ++i) {
+		fminx = x[i] < fminx ? x[i] : fminx;
+		fmaxx = x[i] > fmaxx ? x[i] : fmaxx;
+		fminy = y[i] < fminy ? y[i] : fminy;
+		fmaxy = y[i] > fmaxy ? y[i] : fmaxy;
+	}
+
+	// pixel centers are at + 0.5
+	int minx = (int)ceilf(fminx - 0.5f), maxx = (int)floorf(fmaxx - 0.5f);
+	int miny = (int)ceilf(fminy - 0.5f), maxy = (int)floorf(fmaxy - 0.5f);
+	minx = minx < 0 ? 0 : minx;
+	miny = miny < 0 ? 0 : miny;
+	maxx = maxx >= fb_width ? fb_width - 1 : maxx;
+	maxy = maxy >= fb_height ? fb_height - 1 : maxy;
+	if (minx > maxx || miny > maxy)
+		return true;
+
+	if (!grow((void**)&tris, &tris_capacity, ntris + 1, sizeof(struct tri)))
+		return false;
+
+	struct tri* const t = &tris[ntris];
+	t->program = prog;
+	t->inv_area = 1.0f / area;
+	t->minx = minx;
+	t->miny = miny;
+	t->maxx = maxx;
+	t->maxy = maxy;
+
+	for (int i = 0; i < 3; ++i) {
+		const int j = (i + 1) % 3, k = (i + 2) % 3;
+		t->a[i] = y[j] - y[k];
+		t->b[i] = x[k] - x[j];
+		t->ox[i] = x[j];
+		t->oy[i] = y[j];
+		t->top_left[i] = t->a[i] > 0 || (t->a[i] == 0 && t->b[i] < 0);
+
+		const GLfloat inv_w = 1.0f / v[i]->clip.w;
+		t->z[i] = v[i]->clip.z * inv_w * 0.5f + 0.5f;
+		t->inv_w[i] = inv_w;
+		for (int n = 0; n < prog->nvaryings; ++n)
+			t->varyings[i][n] = v[i]->varyings[n] * inv_w;
+	}
+
+	if (!bin_tri(ntris, t))
+		return false;
+
+	++ntris;
+	return true;
+}
+
+static void lerp_vertex(const struct clip_vertex* const a, const struct clip_vertex* const b,
+                        const GLfloat t, const int nvaryings, struct clip_vertex* const out)
+{
+	out->clip.x = a->clip.x + (b->clip.x - a->clip.x) * t;
+	out->clip.y = a->clip.y + (b->clip.y - a->clip.y) * t;
+	out->clip.z = a->clip.z + (b->clip.z - a->clip.z) * t;
+	out->clip.w = a->clip.w + (b->clip.w - a->clip.w) * t;
+	for (int k = 0; k < nvaryings; ++k)
+		out->varyings[k] = a->varyings[k] + (b->varyings[k] - a->varyings[k]) * t;
+}
+
+/* clips against the near plane z = -w, the other planes are
+ * handled by the bounding box and the depth test
+ * */
+static bool clip_tri(const struct sogl_swr_program* const prog,
+                     const struct clip_vertex* const in)
+{
+	GLfloat d[3];
+	int inside = 0;
+	for (int i = 0; i < 3; ++i) {
+		d[i] = in[i].clip.z + in[i].clip.w;
+		inside += d[i] >= 0;
+	}
+
+	if (inside == 3)
+		return setup_tri(prog, &in[0], &in[1], &in[2]);
+	if (inside == 0)
+		return true;
+
+	struct clip_vertex out[4];
+	int nout = 0;
+	for (int i = 0; i < 3; ++i) {
+		const int j = (i + 1) % 3;
+		if (d[i] >= 0)
+			out[nout++] = in[i];
+		if ((d[i] >= 0) != (d[j] >= 0))
+			lerp_vertex(&in[i], &in[j], d[i] / (d[i] - d[j]), prog->nvaryings, &out[nout++]);
+	}
+
+	for (int i = 2; i < nout; ++i) {
+		if (!setup_tri(prog, &out[0], &out[i - 1], &out[i]))
+			return false;
+	}
+
+	return true;
+}
+
+static long fetch_index(const void* const indices, const GLenum index_type, const long i)
+{
+	if (indices == NULL)
+		return i;
+	return index_type == GL_UNSIGNED_SHORT
+	       ? ((const GLushort*)indices)[i]
+	       : ((const GLuint*)indices)[i];
+}
+
+bool sogl_swr_draw(const struct sogl_swr_program* const program,
+                   const void* const verts, const long nverts, const GLsizei vertex_size,
+                   const void* const indices, const GLenum index_type, const long count)
+{
+	if (program->nvaryings > SOGL_SWR_MAX_VARYINGS) {
+		fprintf(stderr, "Couldn't draw: %d varyings, at most %d\n",
+		        program->nvaryings, SOGL_SWR_MAX_VARYINGS);
+		return false;
+	}
+
+	transformed_stride = 4 + program->nvaryings;
+	if (!grow((void**)&transformed, &transformed_capacity,
+	          nverts * transformed_stride, sizeof(GLfloat)))
+		return false;
+
+	struct vertex_job job = { program, verts, vertex_size };
+	sogl_jobs_parallel_for(vertex_stage, &job, nverts, SOGL_SWR_VERTEX_BATCH);
+
+	// binning keeps the draw order in every tile
+	for (long i = 0; i + 2 < count; i += 3) {
+		struct clip_vertex cv[3];
+		for (int k = 0; k < 3; ++k) {
+			const long index = fetch_index(indices, index_type, i + k);
+			const GLfloat* const src = &transformed[index * transformed_stride];
+			memcpy(&cv[k].clip, src, sizeof(struct vec4));
+			memcpy(cv[k].varyings, src + 4, sizeof(GLfloat) * program->nvaryings);
+		}
+
+		if (!clip_tri(program, cv))
+			return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * Rasterization
+ * */
+static void shade(const struct tri* const t, const long pixel,
+                  const GLfloat l0, const GLfloat l1, const GLfloat l2)
+{
+	const struct sogl_swr_program* const prog = t->program;
+
+	// the varyings and 1/w are linear on screen, their ratio isn't
+	const GLfloat w = 1.0f / (l0 * t->inv_w[0] + l1 * t->inv_w[1] + l2 * t->inv_w[2]);
+	GLfloat varyings[SOGL_SWR_MAX_VARYINGS];
+	for (int k = 0; k < prog->nvaryings; ++k) {
+		varyings[k] = (l0 * t->varyings[0][k] +
+		               l1 * t->varyings[1][k] +
+		               l2 * t->varyings[2][k]) * w;
+	}
+
+	color[pixel] = prog->fragment(prog->uniforms, varyings);
+}
+
+#ifdef __SSE2__
+static void raster_tri(const struct tri* const t,
+                       const int x0, const int y0, const int x1, const int y1)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128i lane_x = _mm_set_epi32(3, 2, 1, 0);
+	const __m128i before_x = _mm_set1_epi32(x0 - 1);
+	const __m128i after_x = _mm_set1_epi32(x1 + 1);
+	const __m128 inv_area = _mm_set1_ps(t->inv_area);
+	const __m128 z0 = _mm_set1_ps(t->z[0]);
+	const __m128 dz1 = _mm_set1_ps(t->z[1] - t->z[0]);
+	const __m128 dz2 = _mm_set1_ps(t->z[2] - t->z[0]);
+
+	__m128 a[3], ox[3], tl[3];
+	for (int i = 0; i < 3; ++i) {
+		a[i] = _mm_set1_ps(t->a[i]);
+		ox[i] = _mm_set1_ps(t->ox[i]);
+		tl[i] = _mm_castsi128_ps(_mm_set1_epi32(t->top_left[i] ? -1 : 0));
+	}
+
+	// 4 pixel aligned spans, the framebuffer width is a multiple of 4
+	const int sx = x0 & ~3;
+
+	for (int y = y0; y <= y1; ++y) {
+		const GLfloat fy = y + 0.5f;
+		__m128 by[3];
+		for (int i = 0; i < 3; ++i)
+			by[i] = _mm_set1_ps(t->b[i] * (fy - t->oy[i]));
+
+		for (int x = sx; x <= x1; x += 4) {
+			// lanes outside [x0, x1] belong to the neighbour tile
+			const __m128i px = _mm_add_epi32(_mm_set1_epi32(x), lane_x);
+			__m128 inside = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(px, before_x),
+			                                               _mm_cmpgt_epi32(after_x, px)));
+
+			const __m128 fx = _mm_add_ps(_mm_set1_ps((GLfloat)x), lane);
+			__m128 e[3];
+			for (int i = 0; i < 3; ++i) {
+				e[i] = _mm_add_ps(_mm_mul_ps(a[i], _mm_sub_ps(fx, ox[i])), by[i]);
+				const __m128 edge = _mm_or_ps(_mm_cmpgt_ps(e[i], zero),
+				                              _mm_and_ps(_mm_cmpeq_ps(e[i], zero), tl[i]));
+				inside = _mm_and_ps(inside, edge);
+			}
+
+			if (_mm_movemask_ps(inside) != 0) {
+				const long pixel = (long)y * fb_width + x;
+				const __m128 l1 = _mm_mul_ps(e[1], inv_area);
+				const __m128 l2 = _mm_mul_ps(e[2], inv_area);
+				const __m128 z = _mm_add_ps(z0, _mm_add_ps(_mm_mul_ps(l1, dz1),
+				                                           _mm_mul_ps(l2, dz2)));
+				const __m128 old = _mm_loadu_ps(&depth[pixel]);
+				const __m128 pass = _mm_and_ps(inside, _mm_cmplt_ps(z, old));
+				const int mask = _mm_movemask_ps(pass);
+
+				if (mask != 0) {
+					_mm_storeu_ps(&depth[pixel], _mm_or_ps(_mm_and_ps(pass, z),
+					                                       _mm_andnot_ps(pass, old)));
+
+					GLfloat l1s[4], l2s[4];
+					_mm_storeu_ps(l1s, l1);
+					_mm_storeu_ps(l2s, l2);
+					for (int k = 0; k < 4; ++k) {
+						if (mask & (1 << k))
+							shade(t, pixel + k, 1.0f - l1s[k] - l2s[k], l1s[k], l2s[k]);
+					}
+				}
+			}
+		}
+	}
+}
+#else
+static void raster_tri(const struct tri* const t,
+                       const int x0, const int y0, const int x1, const int y1)
+{
+	for (int y = y0; y <= y1; ++y) {
+		const GLfloat fy = y + 0.5f;
+		for (int x = x0; x <= x1; ++x) {
+			const GLfloat fx = x + 0.5f;
+			GLfloat e[3];
+			bool inside = true;
+			for (int i = 0; i < 3; ++i) {
+				e[i] = t->a[i] * (fx - t->ox[i]) + t->b[i] * (fy - t->oy[i]);
+				inside = inside && (e[i] > 0 || (e[i] == 0 && t->top_left[i]));
+			}
+			if (!inside)
+				continue;
+
+			const long pixel = (long)y * fb_width + x;
+			const GLfloat l1 = e[1] * t->inv_area;
+			const GLfloat l2 = e[2] * t->inv_area;
+			const GLfloat z = t->z[0] + (l1 * (t->z[1] - t->z[0]) + l2 * (t->z[2] - t->z[0]));
+			if (!(z < depth[pixel]))
+				continue;
+
+			depth[pixel] = z;
+			shade(t, pixel, 1.0f - l1 - l2, l1, l2);
+		}
+	}
+}
+#endif
+
+static void raster_tiles(void* const unused, const int begin, const int end)
+{
+	((void)unused);
+
+	for (int tile = begin; tile < end; ++tile) {
+		const struct bin* const bin = &bins[tile];
+		const int tx0 = (tile % tiles_x) * SOGL_SWR_TILE_SIZE;
+		const int ty0 = (tile / tiles_x) * SOGL_SWR_TILE_SIZE;
+		const int tx1 = tx0 + SOGL_SWR_TILE_SIZE - 1;
+		const int ty1 = ty0 + SOGL_SWR_TILE_SIZE - 1;
+
+		for (int i = 0; i < bin->count; ++i) {
+			const struct tri* const t = &tris[bin->tris[i]];
+			const int x0 = t->minx > tx0 ? t->minx : tx0;
+			const int y0 = t->miny > ty0 ? t->miny : ty0;
+			const int x1 = t->maxx < tx1 ? t->maxx : tx1;
+			const int y1 = t->maxy < ty1 ? t->maxy : ty1;
+			raster_tri(t, x0, y0, x1, y1);
+		}
+	}
+}
+
+void sogl_swr_finish(void)
+{
+	// one tile per batch, tiles share no pixels
+	sogl_jobs_parallel_for(raster_tiles, NULL, tiles_x * tiles_y, 1);
+
+	for (int i = 0; i < tiles_x * tiles_y; ++i)
+		bins[i].count = 0;
+	ntris = 0;
+}
+
+const uint32_t* sogl_swr_pixels(void)
+{
+	return color;
+}
+
+uint64_t sogl_swr_checksum(void)
+{
+	const unsigned char* const bytes = (const unsigned char*)color;
+	const size_t size = sizeof(uint32_t) * fb_width * fb_height;
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+long sogl_swr_triangles(void)
+{
+	return ntris;
+}
+
+
+/*
+ * Textures
+ * */
+static void unpack(const uint32_t texel, GLfloat* const rgba)
+{
+	rgba[0] = (texel & 0xFF) * (1.0f / 255.0f);
+	rgba[1] = ((texel >> 8) & 0xFF) * (1.0f / 255.0f);
+	rgba[2] = ((texel >> 16) & 0xFF) * (1.0f / 255.0f);
+	rgba[3] = (texel >> 24) * (1.0f / 255.0f);
+}
+
+void sogl_swr_sample(const struct sogl_swr_texture* const tex,
+                     const GLfloat u, const GLfloat v, GLfloat* const rgba)
+{
+	const GLfloat fx = u * tex->width - 0.5f;
+	const GLfloat fy = v * tex->height - 0.5f;
+	const GLfloat flx = floorf(fx), fly = floorf(fy);
+	const GLfloat tx = fx - flx, ty = fy - fly;
+
+	int x0 = (int)flx % tex->width, y0 = (int)fly % tex->height;
+	x0 = x0 < 0 ? x0 + tex->width : x0;
+	y0 = y0 < 0 ? y0 + tex->height : y0;
+	const int x1 = x0 + 1 < tex->width ? x0 + 1 : 0;
+	const int y1 = y0 + 1 < tex->height ? y0 + 1 : 0;
+
+	GLfloat c00[4], c10[4], c01[4], c11[4];
+	unpack(tex->texels[(long)y0 * tex->width + x0], c00);
+	unpack(tex->texels[(long)y0 * tex->width + x1], c10);
+	unpack(tex->texels[(long)y1 * tex->width + x0], c01);
+	unpack(tex->texels[(long)y1 * tex->width + x1], c11);
+
+	for (int k = 0; k < 4; ++k) {
+		const GLfloat bottom = c00[k] + (c10[k] - c00[k]) * tx;
+		const GLfloat top = c01[k] + (c11[k] - c01[k]) * tx;
+		rgba[k] = bottom + (top - bottom) * ty;
+	}
+}
+
+bool sogl_swr_texture_from_cache(const struct sogl_texcache* const tc,
+                                 struct sogl_swr_texture* const tex)
+{
+	const struct sogl_texcache_level* const level = &tc->header->levels[0];
+	tex->width = level->width;
+	tex->height = level->height;
+
+	if (tc->header->format == GL_RGBA8) {
+		tex->texels = sogl_texcache_level(tc, 0);
+		return true;
+	}
+
+	unsigned char* const rgba = malloc((size_t)level->width * level->height * 4);
+	if (rgba == NULL) {
+		fprintf(stderr, "Couldn't allocate software texture\n");
+		return false;
+	}
+
+	sogl_bcn_decode(tc->header->format, sogl_texcache_level(tc, 0),
+	                level->width, level->height, rgba);
+	tex->texels = (const uint32_t*)rgba;
+	return true;
+}
+
+void sogl_swr_texture_free(const struct sogl_texcache* const tc,
+                           struct sogl_swr_texture* const tex)
+{
+	// uncompressed texels point into the cache mapping
+	if (tc->header->format != GL_RGBA8)
+		free((void*)tex->texels);
+	tex->texels = NULL;
+}
+
+uint32_t sogl_swr_pack(const GLfloat* const rgba)
+{
+	uint32_t packed = 0;
+	for (int k = 0; k < 4; ++k) {
+		const GLfloat c = rgba[k];
+		const uint32_t v = c <= 0.0f ? 0 : c >= 1.0f ? 255 : (uint32_t)(c * 255.0f + 0.5f);
+		packed |= v << (k * 8);
+	}
+	return packed;
+}
@@ -0,0 +1,83 @@
+#ifndef SOGL_SWR_H_
+#define SOGL_SWR_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <GL/glew.h>
+#include "sogl_types.h"
+#include "sogl_texture.h"
+
+#define SOGL_SWR_TILE_SIZE    (64) // pixels per tile side, a multiple of 4
+#define SOGL_SWR_MAX_VARYINGS (12) // floats passed from the vertex to the fragment stage
+#define SOGL_SWR_VERTEX_BATCH (1024)
+
+
+/* Software rasterizer:
+ * sogl_swr_draw runs the vertex stage on the job threads, clips
+ * against the near plane and bins the triangles into tiles.
+ * sogl_swr_finish then rasterizes every tile on the job threads
+ * with the edge functions evaluated 4 pixels at a time (SSE2),
+ * a depth test (GL_LESS) and perspective correct varyings.
+ * Tiles keep the draw order, so the output doesn't depend on the
+ * number of threads. Rows are stored bottom first, as GL does.
+ * */
+
+/* writes the clip space position and nvaryings floats */
+typedef void (*sogl_swr_vertex_fn)(const void* uniforms, const void* vertex,
+                                   struct vec4* clip, GLfloat* varyings);
+
+/* returns the RGBA8 color packed as 0xAABBGGRR */
+typedef uint32_t (*sogl_swr_fragment_fn)(const void* uniforms, const GLfloat* varyings);
+
+/* must stay alive until sogl_swr_finish */
+struct sogl_swr_program {
+	sogl_swr_vertex_fn vertex;
+	sogl_swr_fragment_fn fragment;
+	const void* uniforms;
+	int nvaryings;
+};
+
+/* RGBA8 texels, rows bottom first like the texture cache */
+struct sogl_swr_texture {
+	const uint32_t* texels;
+	int width, height;
+};
+
+
+/* width must be a multiple of 4, the job threads are used
+ * when sogl_jobs_init was called
+ * */
+extern bool sogl_swr_init(int width, int height);
+extern void sogl_swr_term(void);
+
+/* drops the triangles drawn since the last finish */
+extern void sogl_swr_clear(uint32_t rgba, GLfloat depth);
+
+/* indices: GL_UNSIGNED_SHORT or GL_UNSIGNED_INT triangle list,
+ * NULL to draw the vertices in order
+ * */
+extern bool sogl_swr_draw(const struct sogl_swr_program* program,
+                          const void* verts, long nverts, GLsizei vertex_size,
+                          const void* indices, GLenum index_type, long count);
+
+extern void sogl_swr_finish(void);
+
+extern const uint32_t* sogl_swr_pixels(void);
+extern uint64_t sogl_swr_checksum(void); // FNV-1a of the color buffer
+extern long sogl_swr_triangles(void);    // binned since the last finish
+
+
+/* bilinear with repeat, rgba in [0, 1] */
+extern void sogl_swr_sample(const struct sogl_swr_texture* tex,
+                            GLfloat u, GLfloat v, GLfloat* rgba);
+
+/* level 0 of a texture cache, decoded when block compressed.
+ * texels are allocated when decoded, free with sogl_swr_texture_free
+ * */
+extern bool sogl_swr_texture_from_cache(const struct sogl_texcache* tc,
+                                        struct sogl_swr_texture* tex);
+extern void sogl_swr_texture_free(const struct sogl_texcache* tc,
+                                  struct sogl_swr_texture* tex);
+
+extern uint32_t sogl_swr_pack(const GLfloat* rgba);
+
+#endif
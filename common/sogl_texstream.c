@@ -0,0 +1,586 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include "sogl_bcn.h"
+#include "sogl_texture.h"
+#include "sogl_texstream.h"
+#include "sogl_arena.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+#define MAX_SLOT_CHUNKS (64)
+#define CHUNK_ALIGN     (64)
+
+
+/* unpack buffer slots go around this cycle:
+ * FREE -> MAPPED (render thread maps it)
+ * MAPPED -> FILLING -> READY (loader thread copies level rows into it)
+ * READY -> UPLOADING (render thread unmaps it and uploads under budget)
+ * UPLOADING -> FENCED -> FREE (once the GPU is done reading it)
+ * */
+enum slot_state {
+	SLOT_FREE,
+	SLOT_MAPPED,
+	SLOT_FILLING,
+	SLOT_READY,
+	SLOT_UPLOADING,
+	SLOT_FENCED
+};
+
+struct chunk {
+	int tex;
+	int level;
+	int y;
+	int width;
+	int rows;
+	long offset;
+	long bytes;
+};
+
+struct slot {
+	GLuint pbo;
+	void* ptr;
+	GLsync fence;
+	enum slot_state state;
+	long used;
+	int nchunks;
+	int next_chunk;
+	struct chunk chunks[MAX_SLOT_CHUNKS];
+};
+
+struct texture {
+	GLuint id;
+	GLenum format;   // GL_RGBA8 or the block format of the cache
+	char path[256];
+	int nlevels;
+	int level_width[SOGL_TEXCACHE_MAX_LEVELS];
+	int level_height[SOGL_TEXCACHE_MAX_LEVELS];
+	long bytes_left;
+	Uint32 request_clk;
+	bool allocated;
+	bool resident;
+	bool evicted;    // streamed again the next time it's bound
+	bool failed;
+};
+
+
+static struct slot slots[SOGL_TEXSTREAM_PBOS];
+static struct texture textures[SOGL_TEXSTREAM_MAX_TEXTURES];
+static int ntextures;
+
+static int requests[SOGL_TEXSTREAM_MAX_TEXTURES];
+static int requests_head, requests_tail;
+
+static SDL_Thread* worker;
+static SDL_mutex* mutex;
+static SDL_cond* cond;
+static bool quit;
+
+static struct slot* filling; // owned by the loader thread
+static bool s3tc_ok, bptc_ok; // set before the loader thread starts
+static GLuint placeholder;
+static long budget;
+
+
+/*
+ * Loader thread
+ * */
+static void flush_filling(void)
+{
+	if (filling == NULL)
+		return;
+
+	SDL_LockMutex(mutex);
+	filling->state = SLOT_READY;
+	SDL_UnlockMutex(mutex);
+	filling = NULL;
+}
+
+static struct slot* acquire_space(const long bytes)
+{
+	if (filling != NULL &&
+	    (filling->used + bytes > SOGL_TEXSTREAM_PBO_BYTES ||
+	     filling->nchunks == MAX_SLOT_CHUNKS))
+		flush_filling();
+
+	if (filling != NULL)
+		return filling;
+
+	SDL_LockMutex(mutex);
+	for (;;) {
+		for (int i = 0; i < SOGL_TEXSTREAM_PBOS; ++i) {
+			if (slots[i].state == SLOT_MAPPED) {
+				filling = &slots[i];
+				break;
+			}
+		}
+		if (filling != NULL || quit)
+			break;
+		SDL_CondWait(cond, mutex);
+	}
+
+	if (filling != NULL) {
+		filling->state = SLOT_FILLING;
+		filling->used = 0;
+		filling->nchunks = 0;
+		filling->next_chunk = 0;
+	}
+	SDL_UnlockMutex(mutex);
+
+	return filling;
+}
+
+// block formats the context can't sample are decoded on this thread
+static bool can_upload(const GLenum format)
+{
+	switch (format) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return s3tc_ok;
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		return bptc_ok;
+	}
+	return false;
+}
+
+// the texture stays on the placeholder, reported once here
+static void give_up(struct texture* const tex)
+{
+	SDL_LockMutex(mutex);
+	tex->failed = true;
+	SDL_UnlockMutex(mutex);
+	fprintf(stderr, "Couldn't stream texture %s, drawing the placeholder\n", tex->path);
+}
+
+static void load_texture(const int handle)
+{
+	struct texture* const tex = &textures[handle];
+
+	struct sogl_texcache tc;
+	if (!sogl_texcache_open(tex->path, &tc)) {
+		give_up(tex);
+		return;
+	}
+
+	const struct sogl_texcache_header* const header = tc.header;
+	const bool compressed = can_upload(header->format);
+	const bool decode = !compressed && sogl_bcn_block_bytes(header->format) != 0;
+	unsigned char* rgba = NULL;
+
+	if (decode) {
+		rgba = malloc((long)header->width * header->height * 4);
+		if (rgba == NULL) {
+			fprintf(stderr, "Couldn't allocate texture decode buffer\n");
+			give_up(tex);
+			goto Lclose;
+		}
+	}
+
+	// published to the render thread by the mutex taken in flush_filling
+	tex->format = compressed ? header->format : GL_RGBA8;
+	tex->nlevels = header->nlevels;
+	tex->bytes_left = 0;
+	for (uint32_t l = 0; l < header->nlevels; ++l) {
+		tex->level_width[l] = header->levels[l].width;
+		tex->level_height[l] = header->levels[l].height;
+		tex->bytes_left += sogl_bcn_size(tex->format, tex->level_width[l],
+		                                 tex->level_height[l]);
+	}
+
+	/* chunks are made of whole rows, a row being 4 pixel rows
+	 * of blocks for compressed levels
+	 * */
+	const int row_pixels = compressed ? 4 : 1;
+
+	for (uint32_t l = 0; l < header->nlevels; ++l) {
+		const int width = header->levels[l].width;
+		const int height = header->levels[l].height;
+		const int nrows = (height + row_pixels - 1) / row_pixels;
+		const long row_bytes = sogl_bcn_size(tex->format, width, row_pixels);
+		const unsigned char* data = sogl_texcache_level(&tc, l);
+
+		if (decode) {
+			sogl_bcn_decode(header->format, data, width, height, rgba);
+			data = rgba;
+		}
+
+		int rows_per_chunk = SOGL_TEXSTREAM_CHUNK_BYTES / row_bytes;
+		if (rows_per_chunk < 1)
+			rows_per_chunk = 1;
+
+		for (int row = 0; row < nrows; row += rows_per_chunk) {
+			const int rows = row + rows_per_chunk <= nrows ? rows_per_chunk : nrows - row;
+			const long bytes = row_bytes * rows;
+			const int y = row * row_pixels;
+
+			if (bytes > SOGL_TEXSTREAM_PBO_BYTES) {
+				fprintf(stderr, "Texture %s is too wide to stream\n", tex->path);
+				give_up(tex);
+				goto Lclose;
+			}
+
+			struct slot* const slot = acquire_space(bytes);
+			if (slot == NULL)
+				goto Lclose;
+
+			struct chunk* const chunk = &slot->chunks[slot->nchunks++];
+			chunk->tex = handle;
+			chunk->level = l;
+			chunk->y = y;
+			chunk->width = width;
+			chunk->rows = y + rows * row_pixels <= height ? rows * row_pixels : height - y;
+			chunk->offset = slot->used;
+			chunk->bytes = bytes;
+
+			memcpy((unsigned char*)slot->ptr + slot->used, data + row_bytes * row, bytes);
+			slot->used = (slot->used + bytes + CHUNK_ALIGN - 1) & ~(long)(CHUNK_ALIGN - 1);
+		}
+	}
+
+Lclose:
+	free(rgba);
+	sogl_texcache_close(&tc);
+}
+
+static int worker_main(void* const unused)
+{
+	((void)unused);
+
+	for (;;) {
+		SDL_LockMutex(mutex);
+		const bool idle = requests_head == requests_tail;
+		SDL_UnlockMutex(mutex);
+
+		// don't hold back a partially filled buffer when there's nothing else to load
+		if (idle)
+			flush_filling();
+
+		SDL_LockMutex(mutex);
+		while (!quit && requests_head == requests_tail)
+			SDL_CondWait(cond, mutex);
+
+		if (quit) {
+			SDL_UnlockMutex(mutex);
+			break;
+		}
+
+		const int handle = requests[requests_head];
+		requests_head = (requests_head + 1) % SOGL_TEXSTREAM_MAX_TEXTURES;
+		SDL_UnlockMutex(mutex);
+
+		load_texture(handle);
+	}
+
+	return 0;
+}
+
+
+/*
+ * Render thread
+ * */
+bool sogl_texstream_init(const long frame_budget)
+{
+	budget = frame_budget;
+	quit = false;
+	ntextures = 0;
+	requests_head = requests_tail = 0;
+	filling = NULL;
+	s3tc_ok = sogl_bcn_supported(GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+	bptc_ok = sogl_bcn_supported(GL_COMPRESSED_RGBA_BPTC_UNORM);
+
+	static const GLubyte checker[] = {
+		0x80, 0x80, 0x80, 0xFF,  0xC0, 0xC0, 0xC0, 0xFF,
+		0xC0, 0xC0, 0xC0, 0xFF,  0x80, 0x80, 0x80, 0xFF
+	};
+
+	glGenTextures(1, &placeholder);
+	glBindTexture(GL_TEXTURE_2D, placeholder);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0,
+	             GL_RGBA, GL_UNSIGNED_BYTE, checker);
+
+	for (int i = 0; i < SOGL_TEXSTREAM_PBOS; ++i) {
+		memset(&slots[i], 0, sizeof(slots[i]));
+		glGenBuffers(1, &slots[i].pbo);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slots[i].pbo);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, SOGL_TEXSTREAM_PBO_BYTES,
+		             NULL, GL_STREAM_DRAW);
+		slots[i].state = SLOT_FREE;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	mutex = SDL_CreateMutex();
+	cond = SDL_CreateCond();
+	if (mutex == NULL || cond == NULL) {
+		fprintf(stderr, "Couldn't create texture stream sync: %s\n", SDL_GetError());
+		sogl_texstream_term();
+		return false;
+	}
+
+	worker = SDL_CreateThread(worker_main, "sogl_texstream", NULL);
+	if (worker == NULL) {
+		fprintf(stderr, "Couldn't create texture stream thread: %s\n", SDL_GetError());
+		sogl_texstream_term();
+		return false;
+	}
+
+	return true;
+}
+
+void sogl_texstream_term(void)
+{
+	if (worker != NULL) {
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondBroadcast(cond);
+		SDL_UnlockMutex(mutex);
+		SDL_WaitThread(worker, NULL);
+		worker = NULL;
+	}
+
+	for (int i = 0; i < SOGL_TEXSTREAM_PBOS; ++i) {
+		struct slot* const slot = &slots[i];
+		if (slot->pbo == 0)
+			continue;
+
+		if (slot->ptr != NULL) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->pbo);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+
+		if (slot->fence != NULL)
+			glDeleteSync(slot->fence);
+
+		glDeleteBuffers(1, &slot->pbo);
+		memset(slot, 0, sizeof(*slot));
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	for (int i = 0; i < ntextures; ++i)
+		glDeleteTextures(1, &textures[i].id);
+	ntextures = 0;
+
+	if (placeholder != 0) {
+		glDeleteTextures(1, &placeholder);
+		placeholder = 0;
+	}
+
+	if (cond != NULL) {
+		SDL_DestroyCond(cond);
+		cond = NULL;
+	}
+
+	if (mutex != NULL) {
+		SDL_DestroyMutex(mutex);
+		mutex = NULL;
+	}
+}
+
+static void queue(const int handle)
+{
+	textures[handle].request_clk = SDL_GetTicks();
+
+	SDL_LockMutex(mutex);
+	requests[requests_tail] = handle;
+	requests_tail = (requests_tail + 1) % SOGL_TEXSTREAM_MAX_TEXTURES;
+	SDL_CondBroadcast(cond);
+	SDL_UnlockMutex(mutex);
+}
+
+int sogl_texstream_request(const char* const src_path)
+{
+	if (ntextures >= SOGL_TEXSTREAM_MAX_TEXTURES) {
+		fprintf(stderr, "Texture stream limit reached\n");
+		return -1;
+	}
+
+	const int handle = ntextures++;
+	struct texture* const tex = &textures[handle];
+	memset(tex, 0, sizeof(*tex));
+	snprintf(tex->path, sizeof(tex->path), "%s", src_path);
+	glGenTextures(1, &tex->id);
+	queue(handle);
+
+	return handle;
+}
+
+static void allocate_texture(struct texture* const tex)
+{
+	// storage is allocated with no unpack buffer bound
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, tex->id);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tex->nlevels - 1);
+
+	for (int l = 0; l < tex->nlevels; ++l) {
+		const int w = tex->level_width[l], h = tex->level_height[l];
+		if (tex->format != GL_RGBA8) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, l, tex->format, w, h, 0,
+			                       sogl_bcn_size(tex->format, w, h), NULL);
+		} else {
+			glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, w, h, 0,
+			             GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+	}
+
+	tex->allocated = true;
+}
+
+/* the resource tracker hands resident textures back when over the
+ * VRAM budget, they're drawn with the placeholder from then on and
+ * streamed again once bound
+ * */
+static void evict_texture(void* const data, const GLuint name)
+{
+	((void)name);
+	struct texture* const tex = &textures[(intptr_t)data];
+
+	// the frames in flight may still sample it
+	sogl_defer_delete_texture(tex->id);
+	glGenTextures(1, &tex->id);
+	tex->allocated = false;
+	tex->resident = false;
+	tex->evicted = true;
+	printf("TEXTURE EVICTED: %s\n", tex->path);
+}
+
+static long upload_slot(struct slot* const slot, long frame_left)
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->pbo);
+
+	while (slot->next_chunk < slot->nchunks && frame_left > 0) {
+		const struct chunk* const chunk = &slot->chunks[slot->next_chunk++];
+		struct texture* const tex = &textures[chunk->tex];
+
+		if (!tex->allocated) {
+			allocate_texture(tex);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->pbo);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, tex->id);
+		if (tex->format != GL_RGBA8) {
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, chunk->level, 0, chunk->y,
+			                          chunk->width, chunk->rows, tex->format,
+			                          chunk->bytes, (const GLvoid*)(intptr_t)chunk->offset);
+		} else {
+			glTexSubImage2D(GL_TEXTURE_2D, chunk->level, 0, chunk->y,
+			                chunk->width, chunk->rows, GL_RGBA, GL_UNSIGNED_BYTE,
+			                (const GLvoid*)(intptr_t)chunk->offset);
+		}
+
+		frame_left -= chunk->bytes;
+		tex->bytes_left -= chunk->bytes;
+		if (tex->bytes_left == 0) {
+			tex->resident = true;
+			sogl_res_evictable(SOGL_RES_TEXTURE, tex->id, evict_texture,
+			                   (void*)(intptr_t)chunk->tex);
+			printf("TEXTURE RESIDENT: %s (%u MS)\n", tex->path,
+			       SDL_GetTicks() - tex->request_clk);
+		}
+	}
+
+	if (slot->next_chunk == slot->nchunks) {
+		slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot->state = SLOT_FENCED;
+	}
+
+	return frame_left;
+}
+
+void sogl_texstream_update(void)
+{
+	bool mapped_any = false;
+
+	for (int i = 0; i < SOGL_TEXSTREAM_PBOS; ++i) {
+		struct slot* const slot = &slots[i];
+
+		if (slot->state == SLOT_FENCED) {
+			const GLenum res = glClientWaitSync(slot->fence, 0, 0);
+			if (res != GL_ALREADY_SIGNALED && res != GL_CONDITION_SATISFIED)
+				continue;
+			glDeleteSync(slot->fence);
+			slot->fence = NULL;
+			slot->state = SLOT_FREE;
+		}
+
+		// FREE slots belong to the render thread, no lock needed to map
+		if (slot->state == SLOT_FREE) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->pbo);
+			slot->ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+			                             SOGL_TEXSTREAM_PBO_BYTES,
+			                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (slot->ptr == NULL)
+				continue;
+
+			SDL_LockMutex(mutex);
+			slot->state = SLOT_MAPPED;
+			SDL_UnlockMutex(mutex);
+			mapped_any = true;
+		}
+	}
+
+	if (mapped_any) {
+		SDL_LockMutex(mutex);
+		SDL_CondBroadcast(cond);
+		SDL_UnlockMutex(mutex);
+	}
+
+	long frame_left = budget;
+	for (int i = 0; i < SOGL_TEXSTREAM_PBOS && frame_left > 0; ++i) {
+		struct slot* const slot = &slots[i];
+
+		SDL_LockMutex(mutex);
+		const bool ready = slot->state == SLOT_READY;
+		SDL_UnlockMutex(mutex);
+
+		if (ready) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->pbo);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			slot->ptr = NULL;
+			slot->state = SLOT_UPLOADING;
+		}
+
+		if (slot->state == SLOT_UPLOADING)
+			frame_left = upload_slot(slot, frame_left);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void sogl_texstream_bind(const int handle)
+{
+	if (handle >= 0 && handle < ntextures && textures[handle].evicted) {
+		textures[handle].evicted = false;
+		queue(handle);
+	}
+
+	if (handle >= 0 && handle < ntextures && textures[handle].resident)
+		glBindTexture(GL_TEXTURE_2D, textures[handle].id);
+	else
+		glBindTexture(GL_TEXTURE_2D, placeholder);
+}
+
+bool sogl_texstream_resident(const int handle)
+{
+	return handle >= 0 && handle < ntextures && textures[handle].resident;
+}
+
+bool sogl_texstream_failed(const int handle)
+{
+	if (handle < 0 || handle >= ntextures)
+		return true;
+
+	SDL_LockMutex(mutex);
+	const bool failed = textures[handle].failed;
+	SDL_UnlockMutex(mutex);
+	return failed;
+}
@@ -0,0 +1,42 @@
+#ifndef SOGL_TEXSTREAM_H_
+#define SOGL_TEXSTREAM_H_
+#include <stdbool.h>
+#include <GL/glew.h>
+
+#define SOGL_TEXSTREAM_PBOS         (4)
+#define SOGL_TEXSTREAM_PBO_BYTES    (1024l * 1024l * 8l)  // 8MB per unpack buffer
+#define SOGL_TEXSTREAM_CHUNK_BYTES  (1024l * 256l)        // max bytes per glTexSubImage2D
+#define SOGL_TEXSTREAM_MAX_TEXTURES (1024)
+#define SOGL_TEXSTREAM_FRAME_BUDGET (1024l * 1024l * 4l)  // default upload bytes per frame
+
+
+/* Asynchronous texture streaming:
+ * a loader thread maps the texture caches (baking them if needed)
+ * and copies the mip levels into pixel unpack buffers, the render
+ * thread then uploads them with glTexSubImage2D (or its compressed
+ * variant for block compressed caches) at most frame_budget
+ * bytes per frame, and recycles the buffers once their fence signals.
+ * Textures are drawn with a placeholder until they are resident.
+ * Resident textures are evictable over the VRAM budget (see
+ * sogl_res.h), an evicted one is streamed again once bound.
+ * */
+extern bool sogl_texstream_init(long frame_budget);
+extern void sogl_texstream_term(void);
+
+/* queues src_path for loading, returns a handle or -1 */
+extern int sogl_texstream_request(const char* src_path);
+
+/* must be called once per frame on the render thread */
+extern void sogl_texstream_update(void);
+
+/* binds the texture to GL_TEXTURE_2D, or the placeholder if not resident */
+extern void sogl_texstream_bind(int handle);
+extern bool sogl_texstream_resident(int handle);
+
+/* true once the loader gave up on the texture (a missing or broken
+ * source, or one too wide to stream), it's drawn with the placeholder
+ * for good and the reason was printed when it happened
+ * */
+extern bool sogl_texstream_failed(int handle);
+
+#endif
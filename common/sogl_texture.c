@@ -0,0 +1,632 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <GL/glew.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include "sogl_bcn.h"
+#include "sogl_texture.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+#define KAISER_WIDTH (3.0f)  // filter radius in destination pixels
+#define KAISER_ALPHA (4.0f)
+
+
+/*
+ * sRGB <-> linear
+ * */
+static float srgb_to_linear_lut[256];
+static bool lut_ready = false;
+
+static void init_lut(void)
+{
+	for (int i = 0; i < 256; ++i) {
+		const float c = i / 255.0f;
+		srgb_to_linear_lut[i] = c <= 0.04045f ? c / 12.92f
+		                        : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+	lut_ready = true;
+}
+
+static unsigned char linear_to_srgb(const float l)
+{
+	float c;
+	if (l <= 0.0f)
+		return 0;
+	else if (l >= 1.0f)
+		return 255;
+	else if (l <= 0.0031308f)
+		c = l * 12.92f;
+	else
+		c = 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+	return (unsigned char)(c * 255.0f + 0.5f);
+}
+
+static unsigned char unorm8(const float v)
+{
+	if (v <= 0.0f)
+		return 0;
+	if (v >= 1.0f)
+		return 255;
+	return (unsigned char)(v * 255.0f + 0.5f);
+}
+
+
+/*
+ * Mip generation, the levels are filtered in linear space
+ * from the previous level
+ * */
+
+/* source texels and weights of dst texel d along an axis halved from
+ * slen to dlen = slen / 2. Odd lengths take the 3 texels under the
+ * footprint of the destination texel, weighted by their coverage, so
+ * the last row or column isn't dropped and the level doesn't shift
+ * */
+static int box_taps(const int d, const int slen, const int dlen,
+                    int* const taps, float* const weights)
+{
+	if (slen == 1) {
+		taps[0] = 0;
+		weights[0] = 1.0f;
+		return 1;
+	}
+
+	if ((slen & 1) == 0) {
+		taps[0] = d * 2;
+		taps[1] = d * 2 + 1;
+		weights[0] = weights[1] = 0.5f;
+		return 2;
+	}
+
+	const float n = (float)slen;
+	taps[0] = d * 2;
+	taps[1] = d * 2 + 1;
+	taps[2] = d * 2 + 2;
+	weights[0] = (dlen - d) / n;
+	weights[1] = dlen / n;
+	weights[2] = (d + 1) / n;
+	return 3;
+}
+
+static void downsample_box(const float* const src, const int sw, const int sh,
+                           float* const dst, const int dw, const int dh)
+{
+	for (int y = 0; y < dh; ++y) {
+		int ty[3];
+		float wy[3];
+		const int ny = box_taps(y, sh, dh, ty, wy);
+
+		for (int x = 0; x < dw; ++x) {
+			int tx[3];
+			float wx[3];
+			const int nx = box_taps(x, sw, dw, tx, wx);
+
+			float acc[4] = { 0, 0, 0, 0 };
+			for (int j = 0; j < ny; ++j) {
+				for (int i = 0; i < nx; ++i) {
+					const float* const texel = &src[((long)ty[j] * sw + tx[i]) * 4];
+					const float w = wy[j] * wx[i];
+					for (int c = 0; c < 4; ++c)
+						acc[c] += texel[c] * w;
+				}
+			}
+
+			for (int c = 0; c < 4; ++c)
+				dst[((long)y * dw + x) * 4 + c] = acc[c];
+		}
+	}
+}
+
+static float bessel_i0(const float x)
+{
+	float sum = 1.0f, term = 1.0f;
+	for (int k = 1; k < 32; ++k) {
+		const float f = x / (2.0f * k);
+		term *= f * f;
+		sum += term;
+		if (term < sum * 1e-8f)
+			break;
+	}
+	return sum;
+}
+
+static float kaiser_weight(const float t)
+{
+	const float at = fabsf(t);
+	if (at >= KAISER_WIDTH)
+		return 0.0f;
+
+	const float sinc = at < 1e-6f ? 1.0f : sinf((float)M_PI * at) / ((float)M_PI * at);
+	const float r = at / KAISER_WIDTH;
+	const float window = bessel_i0(KAISER_ALPHA * sqrtf(1.0f - r * r)) / bessel_i0(KAISER_ALPHA);
+	return sinc * window;
+}
+
+// 1D kaiser windowed sinc 2:1 reduction along a strided line
+static void kaiser_line(const float* const src, const int slen, const int sstride,
+                        float* const dst, const int dlen, const int dstride)
+{
+	const int radius = (int)ceilf(KAISER_WIDTH * 2.0f);
+
+	for (int x = 0; x < dlen; ++x) {
+		const float center = x * 2.0f + 1.0f;
+		float acc[4] = { 0, 0, 0, 0 };
+		float wsum = 0.0f;
+
+		for (int i = (int)center - radius; i <= (int)center + radius; ++i) {
+			const float w = kaiser_weight((i + 0.5f - center) * 0.5f);
+			if (w == 0.0f)
+				continue;
+			const int si = i < 0 ? 0 : i >= slen ? slen - 1 : i;
+			for (int c = 0; c < 4; ++c)
+				acc[c] += src[si * sstride + c] * w;
+			wsum += w;
+		}
+
+		for (int c = 0; c < 4; ++c)
+			dst[x * dstride + c] = acc[c] / wsum;
+	}
+}
+
+static bool downsample_kaiser(const float* const src, const int sw, const int sh,
+                              float* const dst, const int dw, const int dh)
+{
+	float* const tmp = malloc(sizeof(float) * 4 * dw * sh);
+	if (tmp == NULL)
+		return false;
+
+	for (int y = 0; y < sh; ++y) {
+		if (sw > 1)
+			kaiser_line(&src[y * sw * 4], sw, 4, &tmp[y * dw * 4], dw, 4);
+		else
+			memcpy(&tmp[y * dw * 4], &src[y * sw * 4], sizeof(float) * 4);
+	}
+
+	for (int x = 0; x < dw; ++x) {
+		if (sh > 1)
+			kaiser_line(&tmp[x * 4], sh, dw * 4, &dst[x * 4], dh, dw * 4);
+		else
+			memcpy(&dst[x * 4], &tmp[x * 4], sizeof(float) * 4);
+	}
+
+	free(tmp);
+	return true;
+}
+
+static void encode_level(const float* const src, const int w, const int h,
+                         unsigned char* const dst)
+{
+	for (long i = 0; i < (long)w * h; ++i) {
+		dst[i * 4 + 0] = linear_to_srgb(src[i * 4 + 0]);
+		dst[i * 4 + 1] = linear_to_srgb(src[i * 4 + 1]);
+		dst[i * 4 + 2] = linear_to_srgb(src[i * 4 + 2]);
+		dst[i * 4 + 3] = unorm8(src[i * 4 + 3]);
+	}
+}
+
+void sogl_texture_halve(const unsigned char* const src, const int sw, const int sh,
+                        unsigned char* const dst)
+{
+	if (!lut_ready)
+		init_lut();
+
+	const int dw = (sw + 1) / 2, dh = (sh + 1) / 2;
+	for (int y = 0; y < dh; ++y) {
+		const int y0 = y * 2, y1 = y * 2 + 1 < sh ? y * 2 + 1 : sh - 1;
+		for (int x = 0; x < dw; ++x) {
+			const int x0 = x * 2, x1 = x * 2 + 1 < sw ? x * 2 + 1 : sw - 1;
+			const unsigned char* const p[4] = {
+				&src[((long)y0 * sw + x0) * 4], &src[((long)y0 * sw + x1) * 4],
+				&src[((long)y1 * sw + x0) * 4], &src[((long)y1 * sw + x1) * 4]
+			};
+			unsigned char* const out = &dst[((long)y * dw + x) * 4];
+
+			for (int c = 0; c < 3; ++c) {
+				out[c] = linear_to_srgb((srgb_to_linear_lut[p[0][c]] + srgb_to_linear_lut[p[1][c]] +
+				                         srgb_to_linear_lut[p[2][c]] + srgb_to_linear_lut[p[3][c]]) * 0.25f);
+			}
+			out[3] = (p[0][3] + p[1][3] + p[2][3] + p[3][3] + 2) / 4;
+		}
+	}
+}
+
+
+/*
+ * Baking
+ * */
+static uint64_t align_up(const uint64_t value)
+{
+	return (value + SOGL_TEXCACHE_ALIGN - 1) & ~(uint64_t)(SOGL_TEXCACHE_ALIGN - 1);
+}
+
+void sogl_texture_cache_path(const char* const src_path,
+                             char* const cache_path, const size_t size)
+{
+	snprintf(cache_path, size, "%s%s", src_path, SOGL_TEXCACHE_EXT);
+}
+
+static GLenum auto_format(const unsigned char* const pixels, const long npixels)
+{
+	for (long i = 0; i < npixels; ++i) {
+		if (pixels[i * 4 + 3] != 0xFF)
+			return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+	return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+// encodes level 0 and reports how far the encoding is from the source
+static bool encode_base_level(const unsigned char* const pixels,
+                              const int width, const int height,
+                              const GLenum format, void* const dst)
+{
+	sogl_bcn_encode(format, pixels, width, height, dst);
+	if (format == GL_RGBA8)
+		return true;
+
+	unsigned char* const decoded = malloc((long)width * height * 4);
+	if (decoded == NULL)
+		return false;
+
+	sogl_bcn_decode(format, dst, width, height, decoded);
+	const int channels = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 3 : 4;
+	printf("TEXTURE %s: %dx%d PSNR %.2f DB, %ld -> %ld BYTES\n",
+	       sogl_bcn_name(format), width, height,
+	       sogl_bcn_psnr(pixels, decoded, width, height, channels),
+	       (long)width * height * 4, sogl_bcn_size(format, width, height));
+
+	free(decoded);
+	return true;
+}
+
+bool sogl_texture_bake(const char* const src_path,
+                       const char* const cache_path,
+                       const enum sogl_mip_filter filter,
+                       GLenum format)
+{
+	struct stat st;
+	if (stat(src_path, &st) != 0) {
+		fprintf(stderr, "Couldn't stat texture image %s\n", src_path);
+		return false;
+	}
+
+	stbi_set_flip_vertically_on_load(true);
+
+	int width, height, channels;
+	unsigned char* const pixels = stbi_load(src_path, &width, &height, &channels, 4);
+	if (pixels == NULL) {
+		fprintf(stderr, "Couldn't load texture image %s\n", src_path);
+		return false;
+	}
+
+	if (!lut_ready)
+		init_lut();
+
+	if (format == SOGL_TEXTURE_AUTO_FORMAT)
+		format = auto_format(pixels, (long)width * height);
+
+	if (format != GL_RGBA8 && sogl_bcn_block_bytes(format) == 0) {
+		fprintf(stderr, "Couldn't bake %s, unknown format 0x%X\n", src_path, format);
+		stbi_image_free(pixels);
+		return false;
+	}
+
+	if (width > SOGL_TEXCACHE_MAX_SIZE || height > SOGL_TEXCACHE_MAX_SIZE) {
+		fprintf(stderr, "Couldn't bake %s, larger than %d texels\n",
+		        src_path, SOGL_TEXCACHE_MAX_SIZE);
+		stbi_image_free(pixels);
+		return false;
+	}
+
+	struct sogl_texcache_header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = SOGL_TEXCACHE_MAGIC;
+	header.version = SOGL_TEXCACHE_VERSION;
+	header.width = width;
+	header.height = height;
+	header.format = format;
+	header.filter = filter;
+	header.src_size = st.st_size;
+	header.src_mtime_sec = st.st_mtim.tv_sec;
+	header.src_mtime_nsec = st.st_mtim.tv_nsec;
+
+	uint64_t offset = align_up(sizeof(header));
+	for (int w = width, h = height; header.nlevels < SOGL_TEXCACHE_MAX_LEVELS; ) {
+		struct sogl_texcache_level* const level = &header.levels[header.nlevels++];
+		level->width = w;
+		level->height = h;
+		level->offset = offset;
+		level->bytes = sogl_bcn_size(format, w, h);
+		offset = align_up(offset + level->bytes);
+
+		if (w == 1 && h == 1)
+			break;
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+
+	const size_t file_size = offset;
+	unsigned char* const data = calloc(1, file_size);
+	float* linear = malloc(sizeof(float) * 4 * width * height);
+	float* next = malloc(sizeof(float) * 4 * (width / 2 + 1) * (height / 2 + 1));
+	unsigned char* const rgba = malloc(4l * (width / 2 + 1) * (height / 2 + 1));
+	bool ok = data != NULL && linear != NULL && next != NULL && rgba != NULL;
+
+	if (ok) {
+		for (long i = 0; i < (long)width * height; ++i) {
+			linear[i * 4 + 0] = srgb_to_linear_lut[pixels[i * 4 + 0]];
+			linear[i * 4 + 1] = srgb_to_linear_lut[pixels[i * 4 + 1]];
+			linear[i * 4 + 2] = srgb_to_linear_lut[pixels[i * 4 + 2]];
+			linear[i * 4 + 3] = pixels[i * 4 + 3] / 255.0f;
+		}
+
+		memcpy(data, &header, sizeof(header));
+		ok = encode_base_level(pixels, width, height, format,
+		                       data + header.levels[0].offset);
+
+		for (uint32_t l = 1; l < header.nlevels && ok; ++l) {
+			const struct sogl_texcache_level* const prev = &header.levels[l - 1];
+			const struct sogl_texcache_level* const level = &header.levels[l];
+
+			if (filter == SOGL_MIP_KAISER) {
+				ok = downsample_kaiser(linear, prev->width, prev->height,
+				                       next, level->width, level->height);
+			} else {
+				downsample_box(linear, prev->width, prev->height,
+				               next, level->width, level->height);
+			}
+
+			encode_level(next, level->width, level->height, rgba);
+			sogl_bcn_encode(format, rgba, level->width, level->height,
+			                data + level->offset);
+
+			float* const tmp = linear;
+			linear = next;
+			next = tmp;
+		}
+	}
+
+	stbi_image_free(pixels);
+	free(linear);
+	free(next);
+	free(rgba);
+
+	if (!ok) {
+		fprintf(stderr, "Couldn't allocate texture mip chain\n");
+		free(data);
+		return false;
+	}
+
+	// write to a temporary and rename it so readers never see a partial cache
+	char tmp_path[4096];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", cache_path, (int)getpid());
+
+	FILE* const file = fopen(tmp_path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Couldn't open %s for writing\n", tmp_path);
+		free(data);
+		return false;
+	}
+
+	ok = fwrite(data, 1, file_size, file) == file_size;
+	ok = fclose(file) == 0 && ok;
+	free(data);
+
+	if (!ok || rename(tmp_path, cache_path) != 0) {
+		fprintf(stderr, "Couldn't write texture cache %s\n", cache_path);
+		remove(tmp_path);
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * Loading
+ * */
+
+/* true when [offset, offset + bytes) lies inside a file of size bytes,
+ * without overflowing on hostile headers
+ * */
+static bool blob_fits(const uint64_t offset, const uint64_t bytes, const uint64_t size)
+{
+	return offset <= size && bytes <= size - offset;
+}
+
+/* returns why the header can't be trusted, NULL when it can, the
+ * levels must be the chain sogl_texture_bake writes so the readers
+ * can size them from the header alone
+ * */
+static const char* check_header(const struct sogl_texcache_header* const header,
+                                const uint64_t file_size)
+{
+	if (header->magic != SOGL_TEXCACHE_MAGIC || header->version != SOGL_TEXCACHE_VERSION)
+		return "not a texture cache of this version";
+
+	if (header->format != GL_RGBA8 && sogl_bcn_block_bytes(header->format) == 0)
+		return "unknown format";
+
+	if (header->width == 0 || header->width > SOGL_TEXCACHE_MAX_SIZE ||
+	    header->height == 0 || header->height > SOGL_TEXCACHE_MAX_SIZE)
+		return "bad size";
+
+	if (header->nlevels == 0 || header->nlevels > SOGL_TEXCACHE_MAX_LEVELS)
+		return "bad level count";
+
+	uint32_t w = header->width, h = header->height;
+	for (uint32_t l = 0; l < header->nlevels; ++l) {
+		const struct sogl_texcache_level* const level = &header->levels[l];
+		if (level->width != w || level->height != h ||
+		    level->bytes != (uint64_t)sogl_bcn_size(header->format, w, h))
+			return "levels aren't a mip chain";
+
+		if (!blob_fits(level->offset, level->bytes, file_size))
+			return "levels run past the end of the file";
+
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+
+	return NULL;
+}
+
+static bool map_cache(const char* const cache_path, struct sogl_texcache* const tc)
+{
+	memset(tc, 0, sizeof(*tc));
+
+	const int fd = open(cache_path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct sogl_texcache_header)) {
+		close(fd);
+		return false;
+	}
+
+	void* const map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	tc->map = map;
+	tc->map_size = st.st_size;
+	tc->header = map;
+
+	const char* const error = check_header(tc->header, tc->map_size);
+	if (error != NULL) {
+		fprintf(stderr, "Couldn't read texture cache %s: %s\n", cache_path, error);
+		sogl_texcache_close(tc);
+		return false;
+	}
+
+	return true;
+}
+
+static bool is_stale(const struct sogl_texcache_header* const header,
+                     const char* const src_path)
+{
+	struct stat st;
+
+	// a cache shipped without its source image is always good
+	if (stat(src_path, &st) != 0)
+		return false;
+
+	return header->src_size != (uint64_t)st.st_size ||
+	       header->src_mtime_sec != st.st_mtim.tv_sec ||
+	       header->src_mtime_nsec != st.st_mtim.tv_nsec;
+}
+
+bool sogl_texcache_open(const char* const src_path, struct sogl_texcache* const tc)
+{
+	char cache_path[4096];
+	sogl_texture_cache_path(src_path, cache_path, sizeof(cache_path));
+
+	// a stale cache is rebaked the way it was baked before
+	enum sogl_mip_filter filter = SOGL_MIP_BOX;
+	GLenum format = SOGL_TEXTURE_AUTO_FORMAT;
+
+	if (map_cache(cache_path, tc)) {
+		if (!is_stale(tc->header, src_path))
+			return true;
+		filter = tc->header->filter;
+		format = tc->header->format;
+		sogl_texcache_close(tc);
+	}
+
+	printf("BAKING TEXTURE CACHE %s\n", cache_path);
+	if (!sogl_texture_bake(src_path, cache_path, filter, format))
+		return false;
+
+	if (!map_cache(cache_path, tc)) {
+		fprintf(stderr, "Couldn't map texture cache %s\n", cache_path);
+		return false;
+	}
+
+	return true;
+}
+
+void sogl_texcache_close(struct sogl_texcache* const tc)
+{
+	if (tc->map != NULL)
+		munmap(tc->map, tc->map_size);
+	memset(tc, 0, sizeof(*tc));
+}
+
+const void* sogl_texcache_level(const struct sogl_texcache* const tc, const int level)
+{
+	return (const unsigned char*)tc->map + tc->header->levels[level].offset;
+}
+
+void sogl_texcache_upload(const struct sogl_texcache* const tc)
+{
+	const struct sogl_texcache_header* const header = tc->header;
+
+	const bool compressed = sogl_bcn_block_bytes(header->format) != 0;
+	const bool decode = compressed && !sogl_bcn_supported(header->format);
+	unsigned char* rgba = NULL;
+
+	if (decode) {
+		rgba = malloc((long)header->width * header->height * 4);
+		if (rgba == NULL) {
+			fprintf(stderr, "Couldn't allocate texture decode buffer\n");
+			return;
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->nlevels - 1);
+
+	for (uint32_t l = 0; l < header->nlevels; ++l) {
+		const struct sogl_texcache_level* const level = &header->levels[l];
+		const void* const pixels = sogl_texcache_level(tc, l);
+
+		if (decode) {
+			sogl_bcn_decode(header->format, pixels, level->width, level->height, rgba);
+			glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, level->width, level->height,
+			             0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+		} else if (compressed) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, l, header->format,
+			                       level->width, level->height, 0,
+			                       level->bytes, pixels);
+		} else {
+			glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, level->width, level->height,
+			             0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		}
+	}
+
+	free(rgba);
+}
+
+
+GLuint sogl_texture_load(const char* const src_path)
+{
+	struct sogl_texcache tc;
+	if (!sogl_texcache_open(src_path, &tc)) {
+		fprintf(stderr, "Couldn't load texture %s\n", src_path);
+		return 0;
+	}
+
+	GLuint gl_tex_id;
+
+	glGenTextures(1, &gl_tex_id);
+	glBindTexture(GL_TEXTURE_2D, gl_tex_id);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	sogl_texcache_upload(&tc);
+	sogl_texcache_close(&tc);
+
+	return gl_tex_id;
+}
@@ -0,0 +1,93 @@
+#ifndef SOGL_TEXTURE_H_
+#define SOGL_TEXTURE_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <GL/glew.h>
+
+#define SOGL_TEXCACHE_MAGIC      (0x58544C53u) // "SLTX"
+#define SOGL_TEXCACHE_VERSION    (1)
+#define SOGL_TEXCACHE_ALIGN      (64)          // level data alignment
+#define SOGL_TEXCACHE_MAX_LEVELS (16)
+#define SOGL_TEXCACHE_MAX_SIZE   (1 << (SOGL_TEXCACHE_MAX_LEVELS - 1)) // widest and tallest level 0
+#define SOGL_TEXCACHE_EXT        ".stex"
+#define SOGL_TEXTURE_AUTO_FORMAT (0)           // BC1 when opaque, BC3 otherwise
+
+
+enum sogl_mip_filter {
+	SOGL_MIP_BOX,
+	SOGL_MIP_KAISER
+};
+
+
+/* the cache file is the header followed by every mip level,
+ * either RGBA8 with rows tightly packed (always 4 byte aligned)
+ * or BC1/BC3/BC7 blocks (see sogl_bcn.h), bottom row first as GL expects
+ * */
+struct sogl_texcache_level {
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;
+	uint64_t bytes;
+};
+
+struct sogl_texcache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t nlevels;
+	uint32_t format;      // GL internal format of the level data
+	uint32_t filter;      // enum sogl_mip_filter
+	uint32_t reserved;
+	// source image stamp, the cache is stale when it doesn't match
+	uint64_t src_size;
+	int64_t src_mtime_sec;
+	int64_t src_mtime_nsec;
+	struct sogl_texcache_level levels[SOGL_TEXCACHE_MAX_LEVELS];
+};
+
+
+struct sogl_texcache {
+	const struct sogl_texcache_header* header;
+	void* map;
+	size_t map_size;
+};
+
+
+/* decodes src_path, builds the full mip chain in linear space,
+ * encodes it to format (GL_RGBA8, a sogl_bcn format or
+ * SOGL_TEXTURE_AUTO_FORMAT) and writes the cache file to cache_path
+ * */
+extern bool sogl_texture_bake(const char* src_path,
+                              const char* cache_path,
+                              enum sogl_mip_filter filter,
+                              GLenum format);
+
+/* loads src_path through its cache file (src_path + SOGL_TEXCACHE_EXT),
+ * rebaking it when missing or stale. the texture is left bound to
+ * GL_TEXTURE_2D on the active texture unit. returns 0 on failure
+ * */
+extern GLuint sogl_texture_load(const char* src_path);
+
+/* maps the cache file of src_path, rebaking it first when missing or stale */
+extern bool sogl_texcache_open(const char* src_path, struct sogl_texcache* tc);
+extern void sogl_texcache_close(struct sogl_texcache* tc);
+extern const void* sogl_texcache_level(const struct sogl_texcache* tc, int level);
+
+/* uploads every level straight from the mapping to the bound GL_TEXTURE_2D,
+ * compressed levels the context can't sample are decoded to RGBA8 first
+ * */
+extern void sogl_texcache_upload(const struct sogl_texcache* tc);
+
+/* halves an sRGB RGBA8 image in linear space with a box filter, the
+ * (sw + 1) / 2 x (sh + 1) / 2 result repeats the last row and column
+ * of odd sizes
+ * */
+extern void sogl_texture_halve(const unsigned char* src, int sw, int sh,
+                               unsigned char* dst);
+
+extern void sogl_texture_cache_path(const char* src_path,
+                                    char* cache_path, size_t size);
+
+#endif
@@ -0,0 +1,1031 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+#include <stb_image.h>
+#include "sogl_bcn.h"
+#include "sogl_texture.h"
+#include "sogl_vt.h"
+#include "sogl_arena.h"
+#define SOGL_RES_SHIM
+#include "sogl_res.h"
+
+#define PAGE       (SOGL_VT_PAGE_SIZE)
+#define STRIDE     (SOGL_VT_PAGE_STRIDE)
+#define NO_SLOT    (-1)
+#define QUEUE_SIZE (SOGL_VT_STAGING_PAGES + 1)
+
+
+#define GLSL_COMMON \
+"#version 150\n" \
+"in vec2 vt_uv;\n" \
+"uniform vec2 vt_size;\n" \
+"uniform float vt_max_level;\n" \
+"uniform float vt_lod_bias;\n" \
+"uniform vec3 vt_page;\n" \
+"float vt_level()\n" \
+"{\n" \
+"	vec2 texels = vt_uv * vt_size;\n" \
+"	vec2 dx = dFdx(texels), dy = dFdy(texels);\n" \
+"	float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + vt_lod_bias;\n" \
+"	return clamp(floor(lod), 0.0, vt_max_level);\n" \
+"}\n" \
+"vec2 vt_texels()\n" \
+"{\n" \
+"	return clamp(vt_uv, 0.0, 0.999999) * vt_size;\n" \
+"}\n"
+
+/* the table entry of a page is the cache slot and the level of the
+ * page drawn for it, the texel inside follows from the virtual uv
+ * */
+const GLchar* const sogl_vt_fs_src =
+GLSL_COMMON
+"uniform usampler2D vt_table;\n"
+"uniform sampler2D vt_cache;\n"
+"uniform vec2 vt_cache_size;\n"
+"out vec4 outcolor;\n"
+"void main()\n"
+"{\n"
+"	float level = vt_level();\n"
+"	vec2 texels = vt_texels();\n"
+"	ivec2 page = ivec2(texels / exp2(level) / vt_page.x);\n"
+"	uvec4 entry = texelFetch(vt_table, page, int(level));\n"
+"	vec2 mapped = texels / exp2(float(entry.b));\n"
+"	vec2 cached = vec2(entry.rg) * vt_page.z + vt_page.y + mod(mapped, vt_page.x);\n"
+"	outcolor = textureLod(vt_cache, cached / vt_cache_size, 0.0);\n"
+"}\n";
+
+const GLchar* const sogl_vt_feedback_fs_src =
+GLSL_COMMON
+"out uvec4 vt_request;\n"
+"void main()\n"
+"{\n"
+"	float level = vt_level();\n"
+"	uvec2 page = uvec2(vt_texels() / exp2(level) / vt_page.x);\n"
+"	vt_request = uvec4(page, uint(level), 1u);\n"
+"}\n";
+
+
+enum page_state {
+	PAGE_ABSENT,
+	PAGE_LOADING,
+	PAGE_RESIDENT
+};
+
+/* staging pages go around this cycle:
+ * FREE -> QUEUED (render thread hands it a page to load)
+ * QUEUED -> READY (loader thread copied the tile into it)
+ * READY -> FREE (render thread uploaded it, or dropped it)
+ * */
+enum staging_state {
+	STAGING_FREE,
+	STAGING_QUEUED,
+	STAGING_READY
+};
+
+// a page of the cache texture
+struct slot {
+	int32_t page;        // NO_SLOT when free
+	uint32_t last_use;   // frame of the last feedback that asked for it
+};
+
+struct staging {
+	int32_t page;
+	enum staging_state state;
+	unsigned char* texels;
+};
+
+struct readback {
+	GLuint pbo;
+	GLsync fence;
+};
+
+
+static const struct sogl_vt_header* header;
+static void* map;
+static size_t map_size;
+
+// the page table, a page per tile of the file
+static int npages;
+static uint8_t* page_state;
+static int32_t* page_slot;
+static uint32_t* page_stamp;  // frame of the last feedback it was seen in
+static int64_t* wanted;       // level << 32 | page, the pages the feedback missed
+static int nwanted;
+static uint8_t* table;        // indirection entries, at 4 * first_page for each level
+static bool table_dirty;
+
+static GLuint cache_tex, table_tex;
+static GLenum cache_format;
+static bool decode;           // the context can't sample the tile format
+static int cache_side, frame_pages;
+static struct slot* slots;
+static int nresident;
+
+static struct staging staging[SOGL_VT_STAGING_PAGES];
+static unsigned char* staging_texels;
+static int queue[QUEUE_SIZE];  // staging pages for the loader thread
+static int queue_head, queue_tail;
+
+static GLuint fbo, request_rb, depth_rb;
+static int feedback_w, feedback_h;
+static GLint saved_viewport[4];
+static struct readback readbacks[SOGL_VT_READBACKS];
+static int next_write, next_read;
+
+static uint32_t frame, feedback_frame;
+static struct sogl_vt_stats counters;
+
+static SDL_Thread* worker;
+static SDL_mutex* mutex;
+static SDL_cond* cond;
+static bool quit;
+
+
+/*
+ * Baking
+ * */
+static uint64_t align_up(const uint64_t value)
+{
+	return (value + SOGL_VT_TILE_ALIGN - 1) & ~(uint64_t)(SOGL_VT_TILE_ALIGN - 1);
+}
+
+void sogl_vt_path(const char* const src_path, char* const vt_path, const size_t size)
+{
+	snprintf(vt_path, size, "%s%s", src_path, SOGL_VT_EXT);
+}
+
+static bool opaque(const unsigned char* const pixels, const long npixels)
+{
+	for (long i = 0; i < npixels; ++i) {
+		if (pixels[i * 4 + 3] != 0xFF)
+			return false;
+	}
+	return true;
+}
+
+// the page and its border, repeating the edges of the level
+static void cut_tile(const unsigned char* const src, const int width, const int height,
+                     const int px, const int py, unsigned char* const tile)
+{
+	for (int ty = 0; ty < STRIDE; ++ty) {
+		int sy = py * PAGE - SOGL_VT_BORDER + ty;
+		sy = sy < 0 ? 0 : sy >= height ? height - 1 : sy;
+
+		for (int tx = 0; tx < STRIDE; ++tx) {
+			int sx = px * PAGE - SOGL_VT_BORDER + tx;
+			sx = sx < 0 ? 0 : sx >= width ? width - 1 : sx;
+			memcpy(&tile[(ty * STRIDE + tx) * 4], &src[((long)sy * width + sx) * 4], 4);
+		}
+	}
+}
+
+bool sogl_vt_bake(const char* const src_path, const char* const vt_path, GLenum format)
+{
+	struct stat st;
+	if (stat(src_path, &st) != 0) {
+		fprintf(stderr, "Couldn't stat virtual texture image %s\n", src_path);
+		return false;
+	}
+
+	stbi_set_flip_vertically_on_load(true);
+
+	int width, height, channels;
+	unsigned char* const pixels = stbi_load(src_path, &width, &height, &channels, 4);
+	if (pixels == NULL) {
+		fprintf(stderr, "Couldn't load virtual texture image %s\n", src_path);
+		return false;
+	}
+
+	bool ok = false;
+	unsigned char* halves[2] = { NULL, NULL };
+	unsigned char* tile = NULL;
+
+	if (format == SOGL_TEXTURE_AUTO_FORMAT) {
+		format = opaque(pixels, (long)width * height) ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+		                                              : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+
+	if (format != GL_RGBA8 && sogl_bcn_block_bytes(format) == 0) {
+		fprintf(stderr, "Couldn't bake %s, unknown format 0x%X\n", src_path, format);
+		goto Lfree_pixels;
+	}
+
+	struct sogl_vt_header h;
+	memset(&h, 0, sizeof(h));
+	h.magic = SOGL_VT_MAGIC;
+	h.version = SOGL_VT_VERSION;
+	h.width = width;
+	h.height = height;
+	h.format = format;
+	h.page_size = PAGE;
+	h.border = SOGL_VT_BORDER;
+	h.src_size = st.st_size;
+	h.src_mtime_sec = st.st_mtim.tv_sec;
+	h.src_mtime_nsec = st.st_mtim.tv_nsec;
+
+	uint64_t ntiles = 0;
+	for (uint32_t w = width, hh = height; ; w = (w + 1) / 2, hh = (hh + 1) / 2) {
+		if (h.nlevels == SOGL_VT_MAX_LEVELS) {
+			fprintf(stderr, "Couldn't bake %s, too many levels\n", src_path);
+			goto Lfree_pixels;
+		}
+
+		struct sogl_vt_level* const level = &h.levels[h.nlevels++];
+		level->width = w;
+		level->height = hh;
+		level->pages_x = (w + PAGE - 1) / PAGE;
+		level->pages_y = (hh + PAGE - 1) / PAGE;
+		level->first_page = ntiles;
+		ntiles += (uint64_t)level->pages_x * level->pages_y;
+
+		if (level->pages_x == 1 && level->pages_y == 1)
+			break;
+	}
+
+	h.tile_bytes = align_up(sogl_bcn_size(format, STRIDE, STRIDE));
+	h.tiles_offset = align_up(sizeof(h));
+	const uint64_t file_size = h.tiles_offset + ntiles * h.tile_bytes;
+
+	const long half_bytes = 4l * ((width + 1) / 2) * ((height + 1) / 2);
+	halves[0] = malloc(half_bytes);
+	halves[1] = malloc(half_bytes);
+	tile = malloc(4l * STRIDE * STRIDE);
+	if (halves[0] == NULL || halves[1] == NULL || tile == NULL) {
+		fprintf(stderr, "Couldn't allocate virtual texture levels\n");
+		goto Lfree_pixels;
+	}
+
+	// written to a temporary and renamed so readers never see partial tiles
+	char tmp_path[4096];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", vt_path, (int)getpid());
+
+	const int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Couldn't open %s for writing\n", tmp_path);
+		goto Lfree_pixels;
+	}
+
+	unsigned char* out = MAP_FAILED;
+	if (ftruncate(fd, file_size) == 0)
+		out = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (out == MAP_FAILED) {
+		fprintf(stderr, "Couldn't map %s for writing\n", tmp_path);
+		goto Lremove_tmp;
+	}
+
+	memcpy(out, &h, sizeof(h));
+
+	// a level is made from the previous one, the source is let go after the first
+	const unsigned char* src = pixels;
+	for (uint32_t l = 0; l < h.nlevels; ++l) {
+		const struct sogl_vt_level* const level = &h.levels[l];
+		printf("VIRTUAL TEXTURE LEVEL %u: %ux%u, %ux%u PAGES\n", l,
+		       level->width, level->height, level->pages_x, level->pages_y);
+
+		for (uint32_t py = 0; py < level->pages_y; ++py) {
+			for (uint32_t px = 0; px < level->pages_x; ++px) {
+				const uint64_t page = level->first_page + (uint64_t)py * level->pages_x + px;
+				cut_tile(src, level->width, level->height, px, py, tile);
+				sogl_bcn_encode(format, tile, STRIDE, STRIDE,
+				                out + h.tiles_offset + page * h.tile_bytes);
+			}
+		}
+
+		if (l + 1 < h.nlevels) {
+			unsigned char* const dst = src == halves[0] ? halves[1] : halves[0];
+			sogl_texture_halve(src, level->width, level->height, dst);
+			src = dst;
+		}
+	}
+
+	ok = munmap(out, file_size) == 0;
+	if (!ok || rename(tmp_path, vt_path) != 0) {
+		fprintf(stderr, "Couldn't write virtual texture %s\n", vt_path);
+		ok = false;
+		goto Lremove_tmp;
+	}
+
+	printf("VIRTUAL TEXTURE %s: %dx%d %s, %u LEVELS, %llu PAGES, %llu MB\n",
+	       vt_path, width, height, sogl_bcn_name(format), h.nlevels,
+	       (unsigned long long)ntiles, (unsigned long long)(file_size >> 20));
+	goto Lfree_pixels;
+
+Lremove_tmp:
+	remove(tmp_path);
+Lfree_pixels:
+	free(tile);
+	free(halves[0]);
+	free(halves[1]);
+	stbi_image_free(pixels);
+	return ok;
+}
+
+
+/*
+ * Tile file
+ * */
+static void unmap_tiles(void)
+{
+	if (map != NULL)
+		munmap(map, map_size);
+	map = NULL;
+	map_size = 0;
+	header = NULL;
+}
+
+static bool map_tiles(const char* const vt_path)
+{
+	const int fd = open(vt_path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct sogl_vt_header)) {
+		close(fd);
+		return false;
+	}
+
+	void* const m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (m == MAP_FAILED)
+		return false;
+
+	map = m;
+	map_size = st.st_size;
+	header = m;
+
+	bool valid = header->magic == SOGL_VT_MAGIC &&
+	             header->version == SOGL_VT_VERSION &&
+	             header->page_size == PAGE &&
+	             header->border == SOGL_VT_BORDER &&
+	             header->nlevels > 0 &&
+	             header->nlevels <= SOGL_VT_MAX_LEVELS &&
+	             (header->format == GL_RGBA8 || sogl_bcn_block_bytes(header->format) != 0);
+
+	if (valid) {
+		const struct sogl_vt_level* const last = &header->levels[header->nlevels - 1];
+		const uint64_t ntiles = last->first_page + 1;
+		valid = last->pages_x == 1 && last->pages_y == 1 && ntiles < INT32_MAX &&
+		        header->tile_bytes >= (uint64_t)sogl_bcn_size(header->format, STRIDE, STRIDE) &&
+		        header->tiles_offset + ntiles * header->tile_bytes <= map_size;
+	}
+
+	if (!valid) {
+		unmap_tiles();
+		return false;
+	}
+
+	// tiles are read where the feedback asks for them, readahead only wastes I/O
+	madvise(map, map_size, MADV_RANDOM);
+	return true;
+}
+
+static bool is_stale(const char* const src_path)
+{
+	struct stat st;
+
+	// tiles shipped without their source image are always good
+	if (stat(src_path, &st) != 0)
+		return false;
+
+	return header->src_size != (uint64_t)st.st_size ||
+	       header->src_mtime_sec != st.st_mtim.tv_sec ||
+	       header->src_mtime_nsec != st.st_mtim.tv_nsec;
+}
+
+static bool open_tiles(const char* const src_path)
+{
+	char vt_path[4096];
+	sogl_vt_path(src_path, vt_path, sizeof(vt_path));
+
+	// stale tiles are baked again in the format they had
+	GLenum format = SOGL_TEXTURE_AUTO_FORMAT;
+
+	if (map_tiles(vt_path)) {
+		if (!is_stale(src_path))
+			return true;
+		format = header->format;
+		unmap_tiles();
+	}
+
+	printf("BAKING VIRTUAL TEXTURE %s\n", vt_path);
+	if (!sogl_vt_bake(src_path, vt_path, format))
+		return false;
+
+	if (!map_tiles(vt_path)) {
+		fprintf(stderr, "Couldn't map virtual texture %s\n", vt_path);
+		return false;
+	}
+
+	return true;
+}
+
+static const unsigned char* tile_data(const int page)
+{
+	return (const unsigned char*)map + header->tiles_offset + (uint64_t)page * header->tile_bytes;
+}
+
+// the copy out of the mapping is where the tile is read from disk
+static void read_tile(const int page, unsigned char* const texels)
+{
+	if (decode) {
+		sogl_bcn_decode(header->format, tile_data(page), STRIDE, STRIDE, texels);
+	} else {
+		memcpy(texels, tile_data(page), sogl_bcn_size(header->format, STRIDE, STRIDE));
+	}
+}
+
+
+/*
+ * Loader thread
+ * */
+static int worker_main(void* const unused)
+{
+	((void)unused);
+
+	for (;;) {
+		SDL_LockMutex(mutex);
+		while (!quit && queue_head == queue_tail)
+			SDL_CondWait(cond, mutex);
+
+		if (quit) {
+			SDL_UnlockMutex(mutex);
+			break;
+		}
+
+		struct staging* const s = &staging[queue[queue_head]];
+		queue_head = (queue_head + 1) % QUEUE_SIZE;
+		SDL_UnlockMutex(mutex);
+
+		read_tile(s->page, s->texels);
+
+		SDL_LockMutex(mutex);
+		s->state = STAGING_READY;
+		SDL_UnlockMutex(mutex);
+	}
+
+	return 0;
+}
+
+
+/*
+ * Cache
+ * */
+static int page_index(const int level, const int x, const int y)
+{
+	const struct sogl_vt_level* const l = &header->levels[level];
+	return (int)l->first_page + y * (int)l->pages_x + x;
+}
+
+// a free slot, else the least recently seen one the last feedback didn't ask for
+static int find_slot(void)
+{
+	int best = NO_SLOT;
+
+	for (int s = 0; s < cache_side * cache_side; ++s) {
+		if (slots[s].page == NO_SLOT)
+			return s;
+
+		// the last level stands in for everything, it stays
+		if (slots[s].last_use == feedback_frame || slots[s].page == npages - 1)
+			continue;
+
+		if (best == NO_SLOT || slots[s].last_use < slots[best].last_use)
+			best = s;
+	}
+
+	return best;
+}
+
+static void upload_page(const int slot, const unsigned char* const texels)
+{
+	const int x = (slot % cache_side) * STRIDE;
+	const int y = (slot / cache_side) * STRIDE;
+
+	glActiveTexture(GL_TEXTURE0 + SOGL_VT_CACHE_UNIT);
+	if (cache_format != GL_RGBA8) {
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, x, y, STRIDE, STRIDE, cache_format,
+		                          sogl_bcn_size(cache_format, STRIDE, STRIDE), texels);
+	} else {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, STRIDE, STRIDE,
+		                GL_RGBA, GL_UNSIGNED_BYTE, texels);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+static void make_resident(const int page, const unsigned char* const texels)
+{
+	const int s = find_slot();
+	if (s == NO_SLOT) {
+		page_state[page] = PAGE_ABSENT;
+		++counters.dropped;
+		return;
+	}
+
+	if (slots[s].page != NO_SLOT) {
+		page_state[slots[s].page] = PAGE_ABSENT;
+		page_slot[slots[s].page] = NO_SLOT;
+		--nresident;
+		++counters.evicted;
+	}
+
+	upload_page(s, texels);
+	slots[s] = (struct slot) { page, frame };
+	page_state[page] = PAGE_RESIDENT;
+	page_slot[page] = s;
+	++nresident;
+	++counters.uploaded;
+	table_dirty = true;
+}
+
+/* every page points at its own slot or takes the entry of its
+ * parent, from the last level down so the parents are done first
+ * */
+static void update_table(void)
+{
+	glActiveTexture(GL_TEXTURE0 + SOGL_VT_TABLE_UNIT);
+
+	for (int l = header->nlevels - 1; l >= 0; --l) {
+		const struct sogl_vt_level* const level = &header->levels[l];
+		uint8_t* const entries = &table[level->first_page * 4];
+
+		for (uint32_t y = 0; y < level->pages_y; ++y) {
+			for (uint32_t x = 0; x < level->pages_x; ++x) {
+				uint8_t* const entry = &entries[(y * level->pages_x + x) * 4];
+				const int s = page_slot[level->first_page + y * level->pages_x + x];
+
+				if (s != NO_SLOT) {
+					entry[0] = s % cache_side;
+					entry[1] = s / cache_side;
+					entry[2] = l;
+					entry[3] = 0xFF;
+				} else {
+					const struct sogl_vt_level* const parent = &header->levels[l + 1];
+					memcpy(entry, &table[(parent->first_page +
+					                      (y / 2) * parent->pages_x + x / 2) * 4], 4);
+				}
+			}
+		}
+
+		glTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, level->pages_x, level->pages_y,
+		                GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, entries);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	table_dirty = false;
+}
+
+
+/*
+ * Feedback
+ * */
+static void want(int level, int x, int y)
+{
+	for (; level < (int)header->nlevels; ++level, x /= 2, y /= 2) {
+		const int page = page_index(level, x, y);
+
+		// its ancestors are done already
+		if (page_stamp[page] == frame)
+			return;
+		page_stamp[page] = frame;
+
+		// the page, or the ancestor drawn in its place meanwhile
+		if (page_state[page] == PAGE_RESIDENT) {
+			slots[page_slot[page]].last_use = frame;
+			return;
+		}
+
+		if (page_state[page] == PAGE_ABSENT)
+			wanted[nwanted++] = (int64_t)level << 32 | page;
+	}
+}
+
+static int coarser_first(const void* const a, const void* const b)
+{
+	const int64_t ka = *(const int64_t*)a, kb = *(const int64_t*)b;
+	return ka < kb ? 1 : ka > kb ? -1 : 0;
+}
+
+/* no more than the slots the feedback left free of its pages, a
+ * working set bigger than the cache is drawn coarser instead of
+ * reading tiles that would be thrown away
+ * */
+static void queue_loads(void)
+{
+	int room = 0;
+	for (int s = 0; s < cache_side * cache_side; ++s) {
+		room += slots[s].page == NO_SLOT ||
+		        (slots[s].last_use != feedback_frame && slots[s].page != npages - 1);
+	}
+
+	int next = 0;
+
+	SDL_LockMutex(mutex);
+	for (int s = 0; s < SOGL_VT_STAGING_PAGES; ++s)
+		room -= staging[s].state != STAGING_FREE;
+
+	for (int s = 0; s < SOGL_VT_STAGING_PAGES && next < nwanted && next < room; ++s) {
+		if (staging[s].state != STAGING_FREE)
+			continue;
+
+		const int page = (int)(wanted[next++] & 0xFFFFFFFF);
+		staging[s].page = page;
+		staging[s].state = STAGING_QUEUED;
+		page_state[page] = PAGE_LOADING;
+
+		queue[queue_tail] = s;
+		queue_tail = (queue_tail + 1) % QUEUE_SIZE;
+		++counters.requested;
+	}
+	SDL_CondBroadcast(cond);
+	SDL_UnlockMutex(mutex);
+}
+
+static void process_feedback(const GLushort* const requests)
+{
+	nwanted = 0;
+
+	for (long i = 0; i < (long)feedback_w * feedback_h; ++i) {
+		const GLushort* const r = &requests[i * 4];
+		if (r[3] == 0)
+			continue;
+
+		const int level = r[2] < header->nlevels ? r[2] : (int)header->nlevels - 1;
+		const struct sogl_vt_level* const l = &header->levels[level];
+		want(level, r[0] < l->pages_x ? r[0] : (int)l->pages_x - 1,
+		            r[1] < l->pages_y ? r[1] : (int)l->pages_y - 1);
+	}
+
+	feedback_frame = frame;
+
+	// coarser levels first, they stand in for the finer ones
+	qsort(wanted, nwanted, sizeof(*wanted), coarser_first);
+	queue_loads();
+}
+
+// the oldest feedback if the GPU is done with it, never waits
+static void collect_feedback(void)
+{
+	struct readback* const rb = &readbacks[next_read];
+	if (rb->fence == NULL)
+		return;
+
+	const GLenum res = glClientWaitSync(rb->fence, 0, 0);
+	if (res != GL_ALREADY_SIGNALED && res != GL_CONDITION_SATISFIED)
+		return;
+
+	glDeleteSync(rb->fence);
+	rb->fence = NULL;
+	next_read = (next_read + 1) % SOGL_VT_READBACKS;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+	const GLushort* const requests = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+	                                                  8l * feedback_w * feedback_h,
+	                                                  GL_MAP_READ_BIT);
+	if (requests != NULL) {
+		process_feedback(requests);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void sogl_vt_begin_feedback(void)
+{
+	static const GLuint nothing[4] = { 0, 0, 0, 0 };
+	static const GLfloat far = 1.0f;
+
+	glGetIntegerv(GL_VIEWPORT, saved_viewport);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, feedback_w, feedback_h);
+	glClearBufferuiv(GL_COLOR, 0, nothing);
+	glClearBufferfv(GL_DEPTH, 0, &far);
+}
+
+void sogl_vt_end_feedback(void)
+{
+	struct readback* const rb = &readbacks[next_write];
+
+	// with every readback in flight this feedback is left out
+	if (rb->fence == NULL) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glReadPixels(0, 0, feedback_w, feedback_h, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, NULL);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		rb->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		next_write = (next_write + 1) % SOGL_VT_READBACKS;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(saved_viewport[0], saved_viewport[1], saved_viewport[2], saved_viewport[3]);
+}
+
+
+/*
+ * Render thread
+ * */
+static bool create_textures(void)
+{
+	const int cache_texels = cache_side * STRIDE;
+
+	GLint max_size;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	if (cache_texels > max_size)
+		return false;
+
+	glGenTextures(1, &cache_tex);
+	glActiveTexture(GL_TEXTURE0 + SOGL_VT_CACHE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, cache_tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	if (cache_format != GL_RGBA8) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, 0, cache_format, cache_texels, cache_texels, 0,
+		                       sogl_bcn_size(cache_format, cache_texels, cache_texels), NULL);
+	} else {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cache_texels, cache_texels, 0,
+		             GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+
+	/* the table levels are the power of two at or above the level 0
+	 * pages halved, so every level of the virtual texture fits in
+	 * the table level of the same number
+	 * */
+	int table_w = 1, table_h = 1;
+	while (table_w < (int)header->levels[0].pages_x)
+		table_w *= 2;
+	while (table_h < (int)header->levels[0].pages_y)
+		table_h *= 2;
+
+	glGenTextures(1, &table_tex);
+	glActiveTexture(GL_TEXTURE0 + SOGL_VT_TABLE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, table_tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->nlevels - 1);
+	for (uint32_t l = 0; l < header->nlevels; ++l) {
+		glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8UI,
+		             table_w >> l > 0 ? table_w >> l : 1, table_h >> l > 0 ? table_h >> l : 1,
+		             0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, NULL);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	return true;
+}
+
+static bool create_feedback(const int width, const int height)
+{
+	feedback_w = width / SOGL_VT_FEEDBACK_SCALE > 0 ? width / SOGL_VT_FEEDBACK_SCALE : 1;
+	feedback_h = height / SOGL_VT_FEEDBACK_SCALE > 0 ? height / SOGL_VT_FEEDBACK_SCALE : 1;
+
+	glGenRenderbuffers(1, &request_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, request_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA16UI, feedback_w, feedback_h);
+	glGenRenderbuffers(1, &depth_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, feedback_w, feedback_h);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, request_rb);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_rb);
+	const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (!complete)
+		return false;
+
+	for (int i = 0; i < SOGL_VT_READBACKS; ++i) {
+		glGenBuffers(1, &readbacks[i].pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readbacks[i].pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, 8l * feedback_w * feedback_h, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	return true;
+}
+
+bool sogl_vt_init(const char* const src_path, const int side, const int pages_per_frame,
+                  const int width, const int height)
+{
+	if (side < 1 || side > SOGL_VT_MAX_CACHE_SIDE) {
+		fprintf(stderr, "Couldn't create a virtual texture cache of %d pages per side\n", side);
+		return false;
+	}
+
+	cache_side = side;
+	frame_pages = pages_per_frame > 0 ? pages_per_frame : SOGL_VT_FRAME_PAGES;
+	frame = 1;
+	feedback_frame = 0;
+	nresident = nwanted = 0;
+	queue_head = queue_tail = 0;
+	next_write = next_read = 0;
+	table_dirty = false;
+	quit = false;
+	memset(&counters, 0, sizeof(counters));
+
+	if (!open_tiles(src_path)) {
+		fprintf(stderr, "Couldn't open virtual texture %s\n", src_path);
+		return false;
+	}
+
+	cache_format = header->format;
+	decode = sogl_bcn_block_bytes(cache_format) != 0 && !sogl_bcn_supported(cache_format);
+	if (decode)
+		cache_format = GL_RGBA8;
+
+	npages = header->levels[header->nlevels - 1].first_page + 1;
+	page_state = calloc(npages, sizeof(*page_state));
+	page_slot = malloc(sizeof(*page_slot) * npages);
+	page_stamp = calloc(npages, sizeof(*page_stamp));
+	wanted = malloc(sizeof(*wanted) * npages);
+	table = calloc(npages, 4);
+	slots = malloc(sizeof(*slots) * side * side);
+
+	const long staging_bytes = sogl_bcn_size(cache_format, STRIDE, STRIDE);
+	staging_texels = malloc(staging_bytes * SOGL_VT_STAGING_PAGES);
+
+	if (page_state == NULL || page_slot == NULL || page_stamp == NULL ||
+	    wanted == NULL || table == NULL || slots == NULL || staging_texels == NULL) {
+		fprintf(stderr, "Couldn't allocate the virtual texture page table\n");
+		goto Lfailed;
+	}
+
+	for (int p = 0; p < npages; ++p)
+		page_slot[p] = NO_SLOT;
+	for (int s = 0; s < side * side; ++s)
+		slots[s] = (struct slot) { NO_SLOT, 0 };
+	for (int s = 0; s < SOGL_VT_STAGING_PAGES; ++s)
+		staging[s] = (struct staging) { NO_SLOT, STAGING_FREE, staging_texels + staging_bytes * s };
+
+	if (!create_textures()) {
+		fprintf(stderr, "Couldn't create the virtual texture cache\n");
+		goto Lfailed;
+	}
+
+	// the last level is there from the start, whatever the feedback says
+	read_tile(npages - 1, staging[0].texels);
+	make_resident(npages - 1, staging[0].texels);
+	update_table();
+
+	if (!create_feedback(width, height)) {
+		fprintf(stderr, "Couldn't create the virtual texture feedback framebuffer\n");
+		goto Lfailed;
+	}
+
+	mutex = SDL_CreateMutex();
+	cond = SDL_CreateCond();
+	if (mutex == NULL || cond == NULL) {
+		fprintf(stderr, "Couldn't create virtual texture sync: %s\n", SDL_GetError());
+		goto Lfailed;
+	}
+
+	worker = SDL_CreateThread(worker_main, "sogl_vt", NULL);
+	if (worker == NULL) {
+		fprintf(stderr, "Couldn't create virtual texture thread: %s\n", SDL_GetError());
+		goto Lfailed;
+	}
+
+	printf("VIRTUAL TEXTURE %s: %ux%u, %u LEVELS, %d PAGES, CACHE %d PAGES (%ld KB)\n",
+	       src_path, header->width, header->height, header->nlevels, npages, side * side,
+	       sogl_bcn_size(cache_format, side * STRIDE, side * STRIDE) / 1024);
+	return true;
+
+Lfailed:
+	sogl_vt_term();
+	return false;
+}
+
+void sogl_vt_term(void)
+{
+	if (worker != NULL) {
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondBroadcast(cond);
+		SDL_UnlockMutex(mutex);
+		SDL_WaitThread(worker, NULL);
+		worker = NULL;
+	}
+
+	for (int i = 0; i < SOGL_VT_READBACKS; ++i) {
+		if (readbacks[i].fence != NULL)
+			glDeleteSync(readbacks[i].fence);
+		if (readbacks[i].pbo != 0)
+			sogl_defer_delete_buffer(readbacks[i].pbo);
+		memset(&readbacks[i], 0, sizeof(readbacks[i]));
+	}
+
+	if (fbo != 0)
+		glDeleteFramebuffers(1, &fbo);
+	if (request_rb != 0)
+		glDeleteRenderbuffers(1, &request_rb);
+	if (depth_rb != 0)
+		glDeleteRenderbuffers(1, &depth_rb);
+	// the page pool and table are sampled by the frames still in flight
+	if (cache_tex != 0)
+		sogl_defer_delete_texture(cache_tex);
+	if (table_tex != 0)
+		sogl_defer_delete_texture(table_tex);
+	fbo = request_rb = depth_rb = cache_tex = table_tex = 0;
+
+	free(page_state);
+	free(page_slot);
+	free(page_stamp);
+	free(wanted);
+	free(table);
+	free(slots);
+	free(staging_texels);
+	page_state = NULL;
+	page_slot = NULL;
+	page_stamp = NULL;
+	wanted = NULL;
+	table = NULL;
+	slots = NULL;
+	staging_texels = NULL;
+	npages = 0;
+
+	if (cond != NULL) {
+		SDL_DestroyCond(cond);
+		cond = NULL;
+	}
+
+	if (mutex != NULL) {
+		SDL_DestroyMutex(mutex);
+		mutex = NULL;
+	}
+
+	unmap_tiles();
+}
+
+void sogl_vt_setup_program(const GLuint program, const bool feedback)
+{
+	GLint prev_program;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &prev_program);
+	glUseProgram(program);
+
+	const GLfloat cache_texels = cache_side * STRIDE;
+	glUniform1i(glGetUniformLocation(program, "vt_cache"), SOGL_VT_CACHE_UNIT);
+	glUniform1i(glGetUniformLocation(program, "vt_table"), SOGL_VT_TABLE_UNIT);
+	glUniform2f(glGetUniformLocation(program, "vt_size"), header->width, header->height);
+	glUniform1f(glGetUniformLocation(program, "vt_max_level"), header->nlevels - 1);
+	glUniform3f(glGetUniformLocation(program, "vt_page"), PAGE, SOGL_VT_BORDER, STRIDE);
+	glUniform2f(glGetUniformLocation(program, "vt_cache_size"), cache_texels, cache_texels);
+
+	// the feedback pass is smaller, its derivatives bigger by as much
+	glUniform1f(glGetUniformLocation(program, "vt_lod_bias"),
+	            feedback ? -log2f(SOGL_VT_FEEDBACK_SCALE) : 0.0f);
+
+	glUseProgram(prev_program);
+}
+
+void sogl_vt_update(void)
+{
+	++frame;
+	collect_feedback();
+
+	int ready[SOGL_VT_STAGING_PAGES];
+	int nready = 0;
+
+	SDL_LockMutex(mutex);
+	for (int s = 0; s < SOGL_VT_STAGING_PAGES && nready < frame_pages; ++s) {
+		if (staging[s].state == STAGING_READY)
+			ready[nready++] = s;
+	}
+	SDL_UnlockMutex(mutex);
+
+	for (int i = 0; i < nready; ++i)
+		make_resident(staging[ready[i]].page, staging[ready[i]].texels);
+
+	SDL_LockMutex(mutex);
+	for (int i = 0; i < nready; ++i)
+		staging[ready[i]].state = STAGING_FREE;
+	SDL_UnlockMutex(mutex);
+
+	if (table_dirty)
+		update_table();
+}
+
+void sogl_vt_stats(struct sogl_vt_stats* const stats)
+{
+	*stats = counters;
+	stats->resident = nresident;
+	stats->capacity = cache_side * cache_side;
+	stats->pending = 0;
+
+	SDL_LockMutex(mutex);
+	for (int s = 0; s < SOGL_VT_STAGING_PAGES; ++s)
+		stats->pending += staging[s].state != STAGING_FREE;
+	SDL_UnlockMutex(mutex);
+}
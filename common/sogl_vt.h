@@ -0,0 +1,139 @@
+#ifndef SOGL_VT_H_
+#define SOGL_VT_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <GL/glew.h>
+
+#define SOGL_VT_MAGIC          (0x54564C53u) // "SLVT"
+#define SOGL_VT_VERSION        (1)
+#define SOGL_VT_EXT            ".svt"
+#define SOGL_VT_PAGE_SIZE      (128)         // texels of a page side, its border aside
+#define SOGL_VT_BORDER         (4)           // texels of the neighbour pages around it
+#define SOGL_VT_PAGE_STRIDE    (SOGL_VT_PAGE_SIZE + 2 * SOGL_VT_BORDER)
+#define SOGL_VT_TILE_ALIGN     (4096)        // tiles start on a page of the file
+#define SOGL_VT_MAX_LEVELS     (24)
+#define SOGL_VT_CACHE_SIDE     (16)          // default cache pages per side, 18MB in RGBA8
+#define SOGL_VT_MAX_CACHE_SIDE (256)         // the indirection table has 8 bit slot coordinates
+#define SOGL_VT_FRAME_PAGES    (16)          // default page uploads per frame
+#define SOGL_VT_STAGING_PAGES  (64)          // pages loaded ahead of their upload
+#define SOGL_VT_FEEDBACK_SCALE (8)           // the feedback pass is this much smaller than the frame
+#define SOGL_VT_READBACKS      (3)           // feedback frames in flight
+#define SOGL_VT_CACHE_UNIT     (9)           // texture units the cache and the table stay bound to
+#define SOGL_VT_TABLE_UNIT     (10)
+
+
+/* the tile file is the header followed by every page of every level,
+ * level 0 first, then row by row from the bottom one. A tile is the
+ * page and its border, SOGL_VT_PAGE_STRIDE texels per side, in RGBA8
+ * or a sogl_bcn format. Level l has ceil(width / 2^l) x
+ * ceil(height / 2^l) texels, so its pages are the parents of 2x2
+ * pages of level l - 1, the last level is a single page.
+ * */
+struct sogl_vt_level {
+	uint32_t width;
+	uint32_t height;
+	uint32_t pages_x;
+	uint32_t pages_y;
+	uint64_t first_page;  // tile index of its bottom left page
+};
+
+struct sogl_vt_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t nlevels;
+	uint32_t format;      // GL internal format of the tiles
+	uint32_t page_size;
+	uint32_t border;
+	uint64_t tile_bytes;  // distance between two tiles
+	uint64_t tiles_offset;
+	// source image stamp, the tiles are stale when it doesn't match
+	uint64_t src_size;
+	int64_t src_mtime_sec;
+	int64_t src_mtime_nsec;
+	struct sogl_vt_level levels[SOGL_VT_MAX_LEVELS];
+};
+
+struct sogl_vt_stats {
+	int resident;         // pages in the cache
+	int capacity;
+	int pending;          // loading or waiting for their upload
+	long requested;       // pages queued for loading since init
+	long uploaded;
+	long evicted;
+	long dropped;         // loaded but no slot was free of the last feedback
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Virtual texturing:
+ * an image of any size drawn through a fixed size cache texture of
+ * pages. A feedback pass renders the pages the frame samples at a
+ * fraction of its resolution, it's read back a few frames later
+ * without stalling. Missing pages are read from the mapped tile file
+ * by a loader thread, coarser levels first, and at most frame_pages
+ * are uploaded per frame into the least recently seen cache slots.
+ * An indirection table with a level per virtual level points every
+ * page at its cache slot, or at its closest resident ancestor until
+ * it's there. The last level is loaded at init and never evicted, so
+ * everything can be drawn from the first frame.
+ *
+ * Memory is the cache, the staging pages and the page table, which
+ * takes about 10 bytes per page of the virtual texture. The file is
+ * read one tile at a time, SOGL_VT_TILE_ALIGN aligned, with readahead
+ * off.
+ *
+ * Pages are sampled bilinearly from the level the derivatives ask
+ * for, rounded to the finer one, there's no filtering between levels.
+ * */
+
+/* cuts src_path into the tile file vt_path, format is GL_RGBA8, a
+ * sogl_bcn format or SOGL_TEXTURE_AUTO_FORMAT. The source image is
+ * decoded whole, the tiles of a level are made from the previous one
+ * */
+extern bool sogl_vt_bake(const char* src_path, const char* vt_path, GLenum format);
+
+extern void sogl_vt_path(const char* src_path, char* vt_path, size_t size);
+
+/* maps the tile file of src_path (src_path + SOGL_VT_EXT), baking it
+ * when missing or stale. width x height is the framebuffer the
+ * feedback pass stands for
+ * */
+extern bool sogl_vt_init(const char* src_path, int cache_side, int frame_pages,
+                         int width, int height);
+extern void sogl_vt_term(void);
+
+/* fragment shaders drawing the virtual texture and writing the
+ * feedback, the vertex shader outputs the virtual uv as vt_uv
+ * */
+extern const GLchar* const sogl_vt_fs_src;
+extern const GLchar* const sogl_vt_feedback_fs_src;
+
+/* sets the uniforms of a program built with one of them, after init */
+extern void sogl_vt_setup_program(GLuint program, bool feedback);
+
+/* the draws in between go to the feedback framebuffer, made with the
+ * feedback program. The viewport is restored on end
+ * */
+extern void sogl_vt_begin_feedback(void);
+extern void sogl_vt_end_feedback(void);
+
+/* must be called once per frame: reads the feedback back, queues the
+ * missing pages and uploads the loaded ones
+ * */
+extern void sogl_vt_update(void);
+
+extern void sogl_vt_stats(struct sogl_vt_stats* stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,11 +5,17 @@
 #include <time.h>
 #include <stdint.h>
 #include <sogl.h>
+#include <sogl_sim.h>
+#include <sogl_buffer.h>
+#include <sogl_hud.h>
+#define SOGL_APITRACE_SHIM
+#include <sogl_apitrace.h>
 
 #define WIN_WIDTH     (1280)
 #define WIN_HEIGHT    (720)
-#define RECT_SIZE     ((long)(sizeof(struct vertex) * 4ll))
 #define MAX_RECTS     (1000000ll)
+#define SIM_STEP_MS   (1000.0 / 60.0)  // the velocities are per step
+#define BUDGET_MS     (16.0)           // frame time the load controller aims at
 
 struct color {
 	GLfloat r, g, b;
@@ -19,15 +25,15 @@ struct vec2f {
 	GLfloat x, y;
 };
 
-struct vertex {
-	struct vec2f pos;
-	struct color color;
-};
-
 
-static struct vertex vertexs[MAX_RECTS * 4];
+/* positions change every frame, colors only when a rect is pushed,
+ * they live in buffers of their own so the colors are sent once
+ * */
+static struct sogl_buffer pos_buffer;
+static struct sogl_buffer color_buffer;
 static struct vec2f vels[MAX_RECTS];
 static struct vec2f poss[MAX_RECTS];
+static struct vec2f prev_poss[MAX_RECTS];  // before the last step, for interpolation
 static GLfloat sizes[MAX_RECTS];
 static long long nrects = 0;
 
@@ -49,7 +55,7 @@ static void randf_arr(const GLfloat* const intervals, GLfloat* const result, con
 
 static void init_random_engine(void)
 {
-	srand(time(NULL));
+	srand(sogl_seed());
 }
 
 
@@ -71,7 +77,7 @@ static void push_rect(void)
 		0.0009, 0.0022     // size
 	};
 
-	static GLfloat result[(sizeof(intervals) / sizeof(GLfloat)) / 2];
+	GLfloat result[(sizeof(intervals) / sizeof(GLfloat)) / 2];
 
 	randf_arr(&intervals[0], &result[0], sizeof(result) / sizeof(GLfloat));
 
@@ -86,46 +92,58 @@ static void push_rect(void)
 
 	poss[nrects].x = posx;
 	poss[nrects].y = posy;
+	prev_poss[nrects] = poss[nrects];
 	vels[nrects].x = velx;
 	vels[nrects].y = vely;
 	sizes[nrects] = size;
 
-	vertexs[nrects * 4].pos.x = posx - size;
-	vertexs[nrects * 4].pos.y = posy - size;
-	vertexs[nrects * 4].color.r = r;
-	vertexs[nrects * 4].color.g = g;
-	vertexs[nrects * 4].color.b = b;
-
-	vertexs[nrects * 4 + 1].pos.x = posx + size;
-	vertexs[nrects * 4 + 1].pos.y = posy - size;
-	vertexs[nrects * 4 + 1].color.r = r;
-	vertexs[nrects * 4 + 1].color.g = g;
-	vertexs[nrects * 4 + 1].color.b = b;
-
-	vertexs[nrects * 4 + 2].pos.x = posx + size;
-	vertexs[nrects * 4 + 2].pos.y = posy + size;
-	vertexs[nrects * 4 + 2].color.r = r;
-	vertexs[nrects * 4 + 2].color.g = g;
-	vertexs[nrects * 4 + 2].color.b = b;
-
-	vertexs[nrects * 4 + 3].pos.x = posx - size;
-	vertexs[nrects * 4 + 3].pos.y = posy + size;
-	vertexs[nrects * 4 + 3].color.r = r;
-	vertexs[nrects * 4 + 3].color.g = g;
-	vertexs[nrects * 4 + 3].color.b = b;
+	struct color* const colors = sogl_buffer_modify(&color_buffer,
+	                                                sizeof(struct color) * nrects * 4,
+	                                                sizeof(struct color) * 4);
+	for (int v = 0; v < 4; ++v)
+		colors[v] = (struct color) { r, g, b };
 
 	++nrects;
 }
 
+static void resize_rects(const long long count)
+{
+	while (nrects < count && nrects < MAX_RECTS)
+		push_rect();
+	if (nrects > count)
+		nrects = count;
+}
+
+static void step_rects(void)
+{
+	for (long long i = 0; i < nrects; ++i) {
+		if (poss[i].x < -1.0 || poss[i].x > 1.0)
+			vels[i].x = -vels[i].x;
+		if (poss[i].y < -1.0 || poss[i].y > 1.0)
+			vels[i].y = -vels[i].y;
+
+		prev_poss[i] = poss[i];
+		poss[i].x += vels[i].x;
+		poss[i].y += vels[i].y;
+	}
+}
+
 
 
 int main(int argc, char** argv)
 {
-	((void)argc);
-	((void)argv);
+	/* the load controller finds how many rects fit in BUDGET_MS,
+	 * a count runs that many instead, so runs with SOGL_FIXED_DT
+	 * are reproducible
+	 * */
+	const long long fixed_count = argc > 1 ? atoll(argv[1]) : 0;
+	if (fixed_count < 0 || fixed_count > MAX_RECTS) {
+		fprintf(stderr, "usage: %s [rects, up to %lld]\n", argv[0], MAX_RECTS);
+		return EXIT_FAILURE;
+	}
 
 	const GLchar* const vs_src =
-	"#version 130\n"
+	"#version 150\n"
 	"in vec2 pos;\n"
 	"in vec3 rgb;\n"
 	"out vec4 frag_color;\n"
@@ -137,7 +155,7 @@ int main(int argc, char** argv)
 
 
 	const GLchar* const fs_src =
-	"#version 130\n"
+	"#version 150\n"
 	"in vec4 frag_color;\n"
 	"out vec4 outcolor;\n"
 	"void main()\n"
@@ -150,78 +168,91 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 
 
-	sogl_vattrp("pos", 2, GL_FLOAT, GL_TRUE,
-	                   sizeof(struct vertex), NULL);
-	sogl_vattrp("rgb", 3, GL_FLOAT, GL_TRUE,
-	                   sizeof(struct vertex),
-	                   (void*)(sizeof(GLfloat) * 2));
+	int retval = EXIT_FAILURE;
 
+	// the attributes point at the buffer bound when they're set
+	if (!sogl_buffer_init(&pos_buffer, GL_ARRAY_BUFFER,
+	                      sizeof(struct vec2f) * 4 * MAX_RECTS, GL_STREAM_DRAW))
+		goto Lpos_buffer_failed;
+	sogl_vattrp("pos", 2, GL_FLOAT, GL_TRUE, sizeof(struct vec2f), NULL);
+
+	if (!sogl_buffer_init(&color_buffer, GL_ARRAY_BUFFER,
+	                      sizeof(struct color) * 4 * MAX_RECTS, GL_STATIC_DRAW))
+		goto Lcolor_buffer_failed;
+	sogl_vattrp("rgb", 3, GL_FLOAT, GL_TRUE, sizeof(struct color), NULL);
+
+
+	// the stats go on screen, a printf per frame costs more than some of the frames
+	if (!sogl_hud_init(WIN_WIDTH, WIN_HEIGHT, SOGL_HUD_REFRESH_MS))
+		fprintf(stderr, "Couldn't create the HUD, running without it\n");
 
 	SDL_GL_SetSwapInterval(0);
 	init_random_engine();
 
+	struct sogl_sim sim;
+	struct sogl_loadctl ctl;
+	sogl_sim_init(&sim, SIM_STEP_MS, sogl_fixed_dt());
+	sogl_loadctl_init(&ctl, BUDGET_MS, 0, MAX_RECTS);
+	resize_rects(fixed_count);
+
 	while (sogl_handle_events()) {
 		sogl_begin_frame();
 		
 		glClearColor(0x00, 0x00, 0x00, 0xFF);
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		for (long long i = 0; i < nrects; ++i) {
-			if (poss[i].x < -1.0 || poss[i].x > 1.0)
-				vels[i].x = -vels[i].x;
-			if (poss[i].y < -1.0 || poss[i].y > 1.0)
-				vels[i].y = -vels[i].y;
-
-			poss[i].x += vels[i].x;
-			poss[i].y += vels[i].y;
+		const int steps = sogl_sim_advance(&sim);
+		for (int s = 0; s < steps; ++s)
+			step_rects();
 
-			const GLfloat posx = poss[i].x;
-			const GLfloat posy = poss[i].y;
+		const GLfloat alpha = sogl_sim_alpha(&sim);
+		struct vec2f* const verts = sogl_buffer_modify(&pos_buffer, 0,
+		                                               sizeof(struct vec2f) * 4 * nrects);
+		for (long long i = 0; i < nrects; ++i) {
+			const GLfloat posx = prev_poss[i].x + (poss[i].x - prev_poss[i].x) * alpha;
+			const GLfloat posy = prev_poss[i].y + (poss[i].y - prev_poss[i].y) * alpha;
 
-			vertexs[i * 4].pos.x = posx - sizes[i];
-			vertexs[i * 4].pos.y = posy - sizes[i];
+			verts[i * 4].x = posx - sizes[i];
+			verts[i * 4].y = posy - sizes[i];
 
-			vertexs[i * 4 + 1].pos.x = posx + sizes[i];
-			vertexs[i * 4 + 1].pos.y = posy - sizes[i];
+			verts[i * 4 + 1].x = posx + sizes[i];
+			verts[i * 4 + 1].y = posy - sizes[i];
 
-			vertexs[i * 4 + 2].pos.x = posx + sizes[i];
-			vertexs[i * 4 + 2].pos.y = posy + sizes[i];
+			verts[i * 4 + 2].x = posx + sizes[i];
+			verts[i * 4 + 2].y = posy + sizes[i];
 
-			vertexs[i * 4 + 3].pos.x = posx - sizes[i];
-			vertexs[i * 4 + 3].pos.y = posy + sizes[i];
+			verts[i * 4 + 3].x = posx - sizes[i];
+			verts[i * 4 + 3].y = posy + sizes[i];
 		}
 
-		const long long max_rects_per_pack = MAX_VBO_BYTES / (RECT_SIZE);
-
-		if (nrects < max_rects_per_pack) {
-			glBufferSubData(GL_ARRAY_BUFFER, 0, RECT_SIZE * nrects, vertexs);
-			glDrawArrays(GL_QUADS, 0, nrects * 4);
-		} else {
-			const long long packs = nrects / max_rects_per_pack;
-			for (long long i = 0; i < packs; ++i) {
-				glBufferSubData(GL_ARRAY_BUFFER, 0,
-				                RECT_SIZE * max_rects_per_pack,
-				                &vertexs[i * 4 * max_rects_per_pack]);
-				glDrawArrays(GL_QUADS, 0, max_rects_per_pack * 4);
-			}
-			const long long remaining = nrects - (packs * max_rects_per_pack);
-			glBufferSubData(GL_ARRAY_BUFFER, 0,
-			                RECT_SIZE * remaining,
-			                &vertexs[packs * max_rects_per_pack * 4]);
-			glDrawArrays(GL_QUADS, 0, remaining * 4);
-		}
+		// only the colors of the rects pushed since the last frame are sent
+		const GLsizeiptr uploaded = sogl_buffer_flush(&pos_buffer) +
+		                            sogl_buffer_flush(&color_buffer);
+		sogl_draw_quads(0, nrects * 4);
 
-		const Uint32 frame_time = sogl_end_frame();
+		sogl_hud_draw();
+		sogl_end_frame();
 
-		if (frame_time < 16) {
-			for (int i = 0; i < 50; ++i)
-				push_rect();
-		}
+		// sim.frame_ms is the whole frame, swap and events included
+		if (fixed_count == 0)
+			resize_rects(sogl_loadctl_update(&ctl, sim.frame_ms));
 
-		printf("RECTS: %lld\n", nrects);
+		sogl_hud_set("RECTS", nrects);
+		sogl_hud_set("UPLOADED KB", uploaded / 1024.0);
+		sogl_hud_set("RANGES", pos_buffer.ranges + color_buffer.ranges);
+		sogl_hud_frame(sim.frame_ms);
 	}
 
+	if (fixed_count == 0)
+		sogl_loadctl_report(&ctl, "RECTS");
+	retval = EXIT_SUCCESS;
+
+	sogl_hud_term();
+	sogl_buffer_free(&color_buffer);
+Lcolor_buffer_failed:
+	sogl_buffer_free(&pos_buffer);
+Lpos_buffer_failed:
 	sogl_term();
-	return EXIT_SUCCESS;
+	return retval;
 }
 
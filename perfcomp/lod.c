@@ -0,0 +1,290 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <stdint.h>
+#include <sogl.h>
+#include <sogl_sim.h>
+#include <sogl_lod.h>
+#include <sogl_hud.h>
+
+#define WIN_WIDTH     (1280)
+#define WIN_HEIGHT    (720)
+#define RECT_SIZE     ((long)(sizeof(struct vertex) * 4ll))
+#define POINT_SIZE    ((long)(sizeof(GLfloat) * 3 + sizeof(uint32_t)))
+#define DENSITY_SIZE  ((long)(WIN_WIDTH / SOGL_LOD_DENSITY_DIV) * (WIN_HEIGHT / SOGL_LOD_DENSITY_DIV) * 4)
+#define MAX_RECTS     (1000000ll)
+#define SIM_STEP_MS   (1000.0 / 60.0)  // the velocities are per step
+#define BUDGET_MS     (16.0)           // frame time the load controller aims at
+
+struct color {
+	GLfloat r, g, b;
+};
+
+struct vec2f {
+	GLfloat x, y;
+};
+
+struct vertex {
+	struct vec2f pos;
+	struct color color;
+};
+
+
+/* same rects as dod.c, but only the ones big enough to be
+ * seen as quads are written to vertexs, packed at the front
+ * */
+static struct vertex vertexs[MAX_RECTS * 4];
+static struct vec2f vels[MAX_RECTS];
+static struct vec2f poss[MAX_RECTS];
+static struct vec2f prev_poss[MAX_RECTS];  // before the last step, for interpolation
+static GLfloat sizes[MAX_RECTS];
+static struct color colors[MAX_RECTS];
+static uint32_t packed_colors[MAX_RECTS];
+static long long nrects = 0;
+static GLfloat size_scale = 1.0f;
+
+
+static GLfloat randf(GLfloat min, GLfloat max)
+{
+	GLfloat retval;
+	do {
+		retval = 1.0f*rand()/RAND_MAX*(max -  min) + min;
+	} while (!(retval > min && retval < max));
+	return retval;
+}
+
+static void randf_arr(const GLfloat* const intervals, GLfloat* const result, const int count)
+{
+	for (int i = 0; i < count; ++i)
+		result[i] = randf(intervals[i * 2], intervals[i * 2 + 1]);
+}
+
+static void init_random_engine(void)
+{
+	srand(sogl_seed());
+}
+
+static uint32_t pack_channel(const GLfloat c)
+{
+	return c <= 0.0f ? 0 : c >= 1.0f ? 255 : (uint32_t)(c * 255.0f);
+}
+
+
+static void push_rect(void)
+{
+	if (nrects >= MAX_RECTS) {
+		printf("MAX RECTS LIMIT\n");
+		return;
+	}
+
+	static const GLfloat intervals[] = {
+		-0.00005, 0.00005, // posx
+		-0.00005, 0.00005, // posy
+		-0.0015, 0.0015,   // velx
+		-0.0015, 0.0015,   // vely
+		-0.1, 1.0,         // r
+		-0.1, 1.0,         // g
+		-0.1, 1.0,         // b
+		0.0009, 0.0022     // size
+	};
+
+	static GLfloat result[(sizeof(intervals) / sizeof(GLfloat)) / 2];
+
+	randf_arr(&intervals[0], &result[0], sizeof(result) / sizeof(GLfloat));
+
+	poss[nrects].x = result[0];
+	poss[nrects].y = result[1];
+	prev_poss[nrects] = poss[nrects];
+	vels[nrects].x = result[2];
+	vels[nrects].y = result[3];
+	colors[nrects] = (struct color) { result[4], result[5], result[6] };
+	packed_colors[nrects] = 0xFF000000u |
+	                        (pack_channel(result[6]) << 16) |
+	                        (pack_channel(result[5]) << 8) |
+	                        pack_channel(result[4]);
+	sizes[nrects] = result[7] * size_scale;
+
+	++nrects;
+}
+
+static void resize_rects(const long long count)
+{
+	while (nrects < count && nrects < MAX_RECTS)
+		push_rect();
+	if (nrects > count)
+		nrects = count;
+}
+
+static void step_rects(void)
+{
+	for (long long i = 0; i < nrects; ++i) {
+		if (poss[i].x < -1.0 || poss[i].x > 1.0)
+			vels[i].x = -vels[i].x;
+		if (poss[i].y < -1.0 || poss[i].y > 1.0)
+			vels[i].y = -vels[i].y;
+
+		prev_poss[i] = poss[i];
+		poss[i].x += vels[i].x;
+		poss[i].y += vels[i].y;
+	}
+}
+
+static void write_quad(struct vertex* const v, const GLfloat posx, const GLfloat posy,
+                       const GLfloat size, const struct color* const color)
+{
+	v[0].pos = (struct vec2f) { posx - size, posy - size };
+	v[1].pos = (struct vec2f) { posx + size, posy - size };
+	v[2].pos = (struct vec2f) { posx + size, posy + size };
+	v[3].pos = (struct vec2f) { posx - size, posy + size };
+	for (int k = 0; k < 4; ++k)
+		v[k].color = *color;
+}
+
+static void draw_quads(const long long nquads)
+{
+	const long long max_rects_per_pack = MAX_VBO_BYTES / (RECT_SIZE);
+
+	for (long long first = 0; first < nquads; first += max_rects_per_pack) {
+		const long long n = nquads - first < max_rects_per_pack
+		                    ? nquads - first : max_rects_per_pack;
+		glBufferSubData(GL_ARRAY_BUFFER, 0, RECT_SIZE * n, &vertexs[first * 4]);
+		sogl_draw_quads(0, n * 4);
+	}
+}
+
+
+
+int main(int argc, char** argv)
+{
+	/* the rects are one or two pixels wide like in dod.c,
+	 * a scale makes them big enough to exercise every tier,
+	 * a count runs that many instead of the controller's
+	 * */
+	if (argc > 1)
+		size_scale = atof(argv[1]);
+	const long long fixed_count = argc > 2 ? atoll(argv[2]) : 0;
+	if (size_scale <= 0 || fixed_count < 0 || fixed_count > MAX_RECTS) {
+		fprintf(stderr, "usage: %s [size scale] [rects, up to %lld]\n", argv[0], MAX_RECTS);
+		return EXIT_FAILURE;
+	}
+
+	const GLchar* const vs_src =
+	"#version 150\n"
+	"in vec2 pos;\n"
+	"in vec3 rgb;\n"
+	"out vec4 frag_color;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4(pos, 0.0, 1.0);\n"
+	"	frag_color = vec4(rgb, 1.0);\n"
+	"}\n";
+
+
+	const GLchar* const fs_src =
+	"#version 150\n"
+	"in vec4 frag_color;\n"
+	"out vec4 outcolor;\n"
+	"void main()\n"
+	"{\n"
+	"	outcolor = frag_color;\n"
+	"}\n";
+
+
+	if (!sogl_init("LOD", WIN_WIDTH, WIN_HEIGHT, vs_src, fs_src))
+		return EXIT_FAILURE;
+
+	if (!sogl_lod_init(WIN_WIDTH, WIN_HEIGHT)) {
+		sogl_term();
+		return EXIT_FAILURE;
+	}
+
+
+	sogl_vattrp("pos", 2, GL_FLOAT, GL_TRUE,
+	                   sizeof(struct vertex), NULL);
+	sogl_vattrp("rgb", 3, GL_FLOAT, GL_TRUE,
+	                   sizeof(struct vertex),
+	                   (void*)(sizeof(GLfloat) * 2));
+
+
+	// the counters go on screen, a printf per frame costs more than some of the frames
+	if (!sogl_hud_init(WIN_WIDTH, WIN_HEIGHT, SOGL_HUD_REFRESH_MS))
+		fprintf(stderr, "Couldn't create the HUD, running without it\n");
+
+	SDL_GL_SetSwapInterval(0);
+	init_random_engine();
+
+	const struct sogl_lod_tiers tiers = SOGL_LOD_TIERS_DEFAULT;
+
+	struct sogl_sim sim;
+	struct sogl_loadctl ctl;
+	sogl_sim_init(&sim, SIM_STEP_MS, sogl_fixed_dt());
+	sogl_loadctl_init(&ctl, BUDGET_MS, 0, MAX_RECTS);
+	resize_rects(fixed_count);
+
+	while (sogl_handle_events()) {
+		sogl_begin_frame();
+
+		glClearColor(0x00, 0x00, 0x00, 0xFF);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		const int steps = sogl_sim_advance(&sim);
+		for (int s = 0; s < steps; ++s)
+			step_rects();
+
+		const GLfloat alpha = sogl_sim_alpha(&sim);
+		long long nfull = 0, npoints = 0, nsplats = 0;
+		sogl_lod_begin();
+
+		for (long long i = 0; i < nrects; ++i) {
+			const GLfloat posx = prev_poss[i].x + (poss[i].x - prev_poss[i].x) * alpha;
+			const GLfloat posy = prev_poss[i].y + (poss[i].y - prev_poss[i].y) * alpha;
+
+			// the shorter side of the viewport, so tiers are conservative
+			const GLfloat pixels = sogl_lod_ndc_pixels(sizes[i] * 2.0f, WIN_HEIGHT);
+
+			switch (sogl_lod_pick(pixels, &tiers)) {
+			case SOGL_LOD_FULL:
+				write_quad(&vertexs[nfull * 4], posx, posy, sizes[i], &colors[i]);
+				++nfull;
+				break;
+			case SOGL_LOD_POINT:
+				sogl_lod_point(posx, posy, pixels, packed_colors[i]);
+				++npoints;
+				break;
+			case SOGL_LOD_DENSITY:
+				sogl_lod_splat(posx, posy, pixels, packed_colors[i]);
+				++nsplats;
+				break;
+			}
+		}
+
+		sogl_lod_end();
+		draw_quads(nfull);
+
+		sogl_hud_draw();
+		sogl_end_frame();
+
+		const long long uploaded = RECT_SIZE * nfull + POINT_SIZE * npoints +
+		                           (nsplats > 0 ? DENSITY_SIZE : 0);
+		sogl_hud_set("RECTS", nrects);
+		sogl_hud_set("FULL", nfull);
+		sogl_hud_set("POINTS", npoints);
+		sogl_hud_set("DENSITY", nsplats);
+		sogl_hud_set("UPLOADED KB", uploaded / 1024.0);
+
+		// sim.frame_ms is the whole frame, swap and events included
+		if (fixed_count == 0)
+			resize_rects(sogl_loadctl_update(&ctl, sim.frame_ms));
+		sogl_hud_frame(sim.frame_ms);
+	}
+
+	if (fixed_count == 0)
+		sogl_loadctl_report(&ctl, "RECTS");
+	sogl_hud_term();
+
+	sogl_lod_term();
+	sogl_term();
+	return EXIT_SUCCESS;
+}
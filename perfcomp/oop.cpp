@@ -9,10 +9,15 @@
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include <sdl2_opengl.hpp>
+#include <sogl_sim.h>
+#include <sogl_hud.h>
 
 
-#define WIN_WIDTH  (1280)
-#define WIN_HEIGHT (720)
+#define WIN_WIDTH   (1280)
+#define WIN_HEIGHT  (720)
+#define MAX_RECTS   (1000000ll)
+#define SIM_STEP_MS (1000.0 / 60.0)  // the velocities are per step
+#define BUDGET_MS   (16.0)           // frame time the load controller aims at
 
 
 class Game final : public Window, public Renderer {
@@ -74,31 +79,37 @@ private:
 class Rectangle {
 public:
 	Rectangle(const Vec2f vel, const Vec2f pos, const Vec2f size, const Color color) :
-		m_vel(vel), m_pos(pos), m_size(size), m_color(color)
+		m_vel(vel), m_pos(pos), m_prevPos(pos), m_size(size), m_color(color)
 	{
 	
 	}
 
-	void Draw(Renderer& render)
+	// alpha: between the previous step and the current one
+	void Draw(Renderer& render, const GLfloat alpha)
 	{
+		const Vec2f pos {
+			m_prevPos.x + (m_pos.x - m_prevPos.x) * alpha,
+			m_prevPos.y + (m_pos.y - m_prevPos.y) * alpha
+		};
+
 		struct Vertex {
 			Vec2f pos;
 			Color color;
 		} verts[4] = {
 			{
-				{m_pos.x - m_size.x, m_pos.y - m_size.y},
+				{pos.x - m_size.x, pos.y - m_size.y},
 				m_color
 			},
 			{
-				{m_pos.x + m_size.x, m_pos.y - m_size.y},
+				{pos.x + m_size.x, pos.y - m_size.y},
 				m_color.r, m_color.g, m_color.b 
 			},
 			{
-				{m_pos.x + m_size.x, m_pos.y + m_size.y},
+				{pos.x + m_size.x, pos.y + m_size.y},
 				m_color
 			},
 			{
-				{m_pos.x - m_size.x, m_pos.y + m_size.y},
+				{pos.x - m_size.x, pos.y + m_size.y},
 				m_color
 			},
 		};
@@ -107,6 +118,7 @@ public:
 
 	void Update()
 	{
+		m_prevPos = m_pos;
 		m_pos.x += m_vel.x;
 		m_pos.y += m_vel.y;
 	}
@@ -134,6 +146,7 @@ public:
 private:
 	Vec2f m_vel;
 	Vec2f m_pos;
+	Vec2f m_prevPos;
 	Vec2f m_size;
 	Color m_color;
 };
@@ -186,38 +199,63 @@ int main(int, char**)
 		std::vector<Rectangle> rects;
 		RandomRectangleFactory rrf;
 
+		sogl_sim sim;
+		sogl_loadctl ctl;
+		sogl_sim_init(&sim, SIM_STEP_MS, 0);
+		sogl_loadctl_init(&ctl, BUDGET_MS, 0, MAX_RECTS);
+
+		// the stats go on screen instead of two stream writes per frame
+		if (!sogl_hud_init(WIN_WIDTH, WIN_HEIGHT, SOGL_HUD_REFRESH_MS))
+			std::cerr << "Couldn't create the HUD, running without it\n";
+
+		// the renderer keeps its objects bound, read once so the HUD puts them back
+		GLint program = 0, vao = 0, vbo = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+		glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &vbo);
+		const bool depth_test = glIsEnabled(GL_DEPTH_TEST);
+
 		while (game->HandleEvents()) {
 			game->BeginFrame({0x00, 0x00, 0x00});
-			
-			for (auto& rect : rects) {
-				const Vec2f pos = rect.GetPos();
-				Vec2f vel = rect.GetVel();
-				if ((pos.x < -1 && vel.x < 0) || (pos.x > 1 && vel.x > 0))
-					vel.x = -vel.x;
-				if ((pos.y < -1 && vel.y < 0) || (pos.y > 1 && vel.y > 0))
-					vel.y = -vel.y;
 
-				rect.SetVel(vel);
+			const int steps = sogl_sim_advance(&sim);
+			for (int s = 0; s < steps; ++s) {
+				for (auto& rect : rects) {
+					const Vec2f pos = rect.GetPos();
+					Vec2f vel = rect.GetVel();
+					if ((pos.x < -1 && vel.x < 0) || (pos.x > 1 && vel.x > 0))
+						vel.x = -vel.x;
+					if ((pos.y < -1 && vel.y < 0) || (pos.y > 1 && vel.y > 0))
+						vel.y = -vel.y;
 
-				rect.Update();
+					rect.SetVel(vel);
 
-				rect.Draw(game->GetRenderer());
+					rect.Update();
+				}
 			}
-			
-			
+
+			const GLfloat alpha = sogl_sim_alpha(&sim);
+			for (auto& rect : rects)
+				rect.Draw(game->GetRenderer(), alpha);
+
+			sogl_hud_draw_then_bind(program, vao, vbo, depth_test);
 			game->EndFrame();
 
-			if (game->GetFps() > 60) {
-				for (int i = 0; i < 50; ++i)
-					rects.push_back(rrf.Make());
-			} else if (game->GetFps() < 59 && rects.size() > 0) {
-				rects.pop_back();
-			}
+			// same controller as dod.c, on the whole frame time
+			const std::size_t target = sogl_loadctl_update(&ctl, sim.frame_ms);
+			while (rects.size() < target)
+				rects.push_back(rrf.Make());
+			if (rects.size() > target)
+				rects.erase(rects.begin() + target, rects.end());
 
-			std::cout << "FPS: " << game->GetFps() << '\n';
-			std::cout << "RECTS: " << rects.size() << '\n';
+			sogl_hud_set("RECTS", rects.size());
+			sogl_hud_set("GAME FPS", game->GetFps());
+			sogl_hud_frame(sim.frame_ms);
 		}
 
+		sogl_loadctl_report(&ctl, "RECTS");
+		sogl_hud_term();
+
 	} catch(std::exception& except) {
 		std::cout << "Fatal Exception: " << except.what() << std::endl;
 		return EXIT_FAILURE;
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <stdint.h>
+#include <sogl.h>
+#include <sogl_sim.h>
+#include <sogl_sprite.h>
+#include <sogl_hud.h>
+
+#define WIN_WIDTH     (1280)
+#define WIN_HEIGHT    (720)
+#define MAX_SPRITES   (1000000ll)
+#define NIMAGES       (512)
+#define SIM_STEP_MS   (1000.0 / 60.0)  // the velocities are per step
+#define BUDGET_MS     (16.0)           // frame time the load controller aims at
+
+struct vec2f {
+	GLfloat x, y;
+};
+
+
+static struct vec2f vels[MAX_SPRITES];
+static struct vec2f poss[MAX_SPRITES];
+static struct vec2f prev_poss[MAX_SPRITES];  // before the last step, for interpolation
+static GLfloat sizes[MAX_SPRITES];
+static int imgs[MAX_SPRITES];
+static uint32_t tints[MAX_SPRITES];
+static long long nsprites = 0;
+
+static int image_ids[NIMAGES];
+
+
+static GLfloat randf(GLfloat min, GLfloat max)
+{
+	GLfloat retval;
+	do {
+		retval = 1.0f*rand()/RAND_MAX*(max -  min) + min;
+	} while (!(retval > min && retval < max));
+	return retval;
+}
+
+static void init_random_engine(void)
+{
+	srand(sogl_seed());
+}
+
+
+/* every source image is a different size with its own ring pattern,
+ * standing in for the hundreds of small images of a sprite workload
+ * */
+static bool make_images(void)
+{
+	static unsigned char pixels[64 * 64 * 4];
+
+	for (int i = 0; i < NIMAGES; ++i) {
+		const int w = 8 + rand() % 57;
+		const int h = 8 + rand() % 57;
+		const unsigned char r = rand() & 0xFF;
+		const unsigned char g = rand() & 0xFF;
+		const unsigned char b = rand() & 0xFF;
+
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				const int dx = x - w / 2, dy = y - h / 2;
+				const bool ring = ((dx * dx + dy * dy) / 16) & 1;
+				unsigned char* const p = &pixels[(y * w + x) * 4];
+				p[0] = ring ? r : 0xFF - r;
+				p[1] = ring ? g : 0xFF - g;
+				p[2] = ring ? b : 0xFF - b;
+				p[3] = 0xFF;
+			}
+		}
+
+		image_ids[i] = sogl_sprite_add_image(pixels, w, h);
+		if (image_ids[i] < 0)
+			return false;
+	}
+
+	return sogl_sprite_build();
+}
+
+
+static void push_sprite(void)
+{
+	if (nsprites >= MAX_SPRITES) {
+		printf("MAX SPRITES LIMIT\n");
+		return;
+	}
+
+	poss[nsprites].x = randf(-0.00005, 0.00005);
+	poss[nsprites].y = randf(-0.00005, 0.00005);
+	prev_poss[nsprites] = poss[nsprites];
+	vels[nsprites].x = randf(-0.0015, 0.0015);
+	vels[nsprites].y = randf(-0.0015, 0.0015);
+	sizes[nsprites] = randf(0.0009, 0.0022);
+	imgs[nsprites] = image_ids[rand() % NIMAGES];
+	tints[nsprites] = 0xFF000000u | ((uint32_t)rand() & 0x00FFFFFFu);
+
+	++nsprites;
+}
+
+static void resize_sprites(const long long count)
+{
+	while (nsprites < count && nsprites < MAX_SPRITES)
+		push_sprite();
+	if (nsprites > count)
+		nsprites = count;
+}
+
+static void step_sprites(void)
+{
+	for (long long i = 0; i < nsprites; ++i) {
+		if (poss[i].x < -1.0 || poss[i].x > 1.0)
+			vels[i].x = -vels[i].x;
+		if (poss[i].y < -1.0 || poss[i].y > 1.0)
+			vels[i].y = -vels[i].y;
+
+		prev_poss[i] = poss[i];
+		poss[i].x += vels[i].x;
+		poss[i].y += vels[i].y;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	// same as dod.c, a count runs that many instead of the controller's
+	const long long fixed_count = argc > 1 ? atoll(argv[1]) : 0;
+	if (fixed_count < 0 || fixed_count > MAX_SPRITES) {
+		fprintf(stderr, "usage: %s [sprites, up to %lld]\n", argv[0], MAX_SPRITES);
+		return EXIT_FAILURE;
+	}
+
+	const GLchar* const vs_src =
+	"#version 150\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4(0.0);\n"
+	"}\n";
+
+	const GLchar* const fs_src =
+	"#version 150\n"
+	"out vec4 outcolor;\n"
+	"void main()\n"
+	"{\n"
+	"	outcolor = vec4(1.0);\n"
+	"}\n";
+
+
+	if (!sogl_init("SPRITES", WIN_WIDTH, WIN_HEIGHT, vs_src, fs_src))
+		return EXIT_FAILURE;
+
+	init_random_engine();
+
+	if (!sogl_sprite_init())
+		goto Lsprite_init_failed;
+
+	if (!make_images())
+		goto Lmake_images_failed;
+
+	// the counters go on screen, a printf per frame costs more than some of the frames
+	if (!sogl_hud_init(WIN_WIDTH, WIN_HEIGHT, SOGL_HUD_REFRESH_MS))
+		fprintf(stderr, "Couldn't create the HUD, running without it\n");
+
+	SDL_GL_SetSwapInterval(0);
+
+	struct sogl_sim sim;
+	struct sogl_loadctl ctl;
+	sogl_sim_init(&sim, SIM_STEP_MS, sogl_fixed_dt());
+	sogl_loadctl_init(&ctl, BUDGET_MS, 0, MAX_SPRITES);
+	resize_sprites(fixed_count);
+
+	while (sogl_handle_events()) {
+		sogl_begin_frame();
+
+		glClearColor(0x00, 0x00, 0x00, 0xFF);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		const int steps = sogl_sim_advance(&sim);
+		for (int s = 0; s < steps; ++s)
+			step_sprites();
+
+		const GLfloat alpha = sogl_sim_alpha(&sim);
+		sogl_sprite_begin();
+
+		for (long long i = 0; i < nsprites; ++i) {
+			const GLfloat posx = prev_poss[i].x + (poss[i].x - prev_poss[i].x) * alpha;
+			const GLfloat posy = prev_poss[i].y + (poss[i].y - prev_poss[i].y) * alpha;
+			sogl_sprite_draw(imgs[i], posx, posy, sizes[i], sizes[i], tints[i]);
+		}
+
+		sogl_sprite_end();
+
+		sogl_hud_draw();
+		sogl_end_frame();
+
+		sogl_hud_set("SPRITES", nsprites);
+		sogl_hud_set("IMAGES", NIMAGES);
+		sogl_hud_set("DRAWS", sogl_sprite_draw_calls());
+
+		// sim.frame_ms is the whole frame, swap and events included
+		if (fixed_count == 0)
+			resize_sprites(sogl_loadctl_update(&ctl, sim.frame_ms));
+		sogl_hud_frame(sim.frame_ms);
+	}
+
+	if (fixed_count == 0)
+		sogl_loadctl_report(&ctl, "SPRITES");
+	sogl_hud_term();
+
+Lmake_images_failed:
+	sogl_sprite_term();
+Lsprite_init_failed:
+	sogl_term();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,378 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <stdint.h>
+#include <sogl.h>
+#include <sogl_sim.h>
+#include <sogl_hud.h>
+#define SOGL_RES_SHIM
+#include <sogl_res.h>
+
+#define WIN_WIDTH     (1280)
+#define WIN_HEIGHT    (720)
+#define MAX_RECTS     (1000000ll)
+#define STAGING_RECTS (4096)           // spawned rects uploaded at once
+#define SIM_STEP_MS   (1000.0 / 60.0)  // the velocities are per step
+#define BUDGET_MS     (16.0)           // frame time the load controller aims at
+
+/* same workload as dod.c, but positions and velocities never leave
+ * the GPU: a vertex shader advances them a step with transform
+ * feedback from one buffer into the other, and the rects are drawn
+ * as instances between the two buffers, the latest and the one
+ * before it. The CPU only uploads the rects it spawns
+ * */
+struct color {
+	GLfloat r, g, b;
+};
+
+struct vec2f {
+	GLfloat x, y;
+};
+
+struct particle {
+	struct vec2f pos;
+	struct vec2f vel;
+};
+
+struct look {
+	struct color color;
+	GLfloat size;
+};
+
+
+static struct particle new_particles[STAGING_RECTS];
+static struct look new_looks[STAGING_RECTS];
+static int nnew = 0;
+static long long nrects = 0;
+static long uploaded = 0;  // bytes since the last frame
+
+static GLuint sim_program, draw_program;
+static GLint alpha_loc;
+static GLuint state_vbos[2], look_vbo;
+static GLuint sim_vaos[2], draw_vaos[2];
+static int cur = 0; // state_vbos[cur] holds the latest state
+
+
+static GLfloat randf(GLfloat min, GLfloat max)
+{
+	GLfloat retval;
+	do {
+		retval = 1.0f*rand()/RAND_MAX*(max -  min) + min;
+	} while (!(retval > min && retval < max));
+	return retval;
+}
+
+static void randf_arr(const GLfloat* const intervals, GLfloat* const result, const int count)
+{
+	for (int i = 0; i < count; ++i)
+		result[i] = randf(intervals[i * 2], intervals[i * 2 + 1]);
+}
+
+static void init_random_engine(void)
+{
+	srand(sogl_seed());
+}
+
+
+static void push_rect(void)
+{
+	if (nrects + nnew >= MAX_RECTS) {
+		printf("MAX RECTS LIMIT\n");
+		return;
+	}
+
+	static const GLfloat intervals[] = {
+		-0.00005, 0.00005, // posx
+		-0.00005, 0.00005, // posy
+		-0.0015, 0.0015,   // velx
+		-0.0015, 0.0015,   // vely
+		-0.1, 1.0,         // r
+		-0.1, 1.0,         // g
+		-0.1, 1.0,         // b
+		0.0009, 0.0022     // size
+	};
+
+	static GLfloat result[(sizeof(intervals) / sizeof(GLfloat)) / 2];
+
+	randf_arr(&intervals[0], &result[0], sizeof(result) / sizeof(GLfloat));
+
+	new_particles[nnew].pos.x = result[0];
+	new_particles[nnew].pos.y = result[1];
+	new_particles[nnew].vel.x = result[2];
+	new_particles[nnew].vel.y = result[3];
+	new_looks[nnew].color.r = result[4];
+	new_looks[nnew].color.g = result[5];
+	new_looks[nnew].color.b = result[6];
+	new_looks[nnew].size = result[7];
+
+	++nnew;
+}
+
+/* appends the spawned rects to both states, so they're drawn still
+ * until their first step, like the new rects of dod.c
+ * */
+static void flush_new_rects(void)
+{
+	if (nnew == 0)
+		return;
+
+	for (int i = 0; i < 2; ++i) {
+		glBindBuffer(GL_ARRAY_BUFFER, state_vbos[i]);
+		glBufferSubData(GL_ARRAY_BUFFER, sizeof(struct particle) * nrects,
+		                sizeof(struct particle) * nnew, new_particles);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, look_vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(struct look) * nrects,
+	                sizeof(struct look) * nnew, new_looks);
+
+	sogl_bind();
+
+	uploaded += (2 * sizeof(struct particle) + sizeof(struct look)) * nnew;
+	nrects += nnew;
+	nnew = 0;
+}
+
+static void resize_rects(const long long count)
+{
+	while (nrects + nnew < count && nrects + nnew < MAX_RECTS) {
+		push_rect();
+		if (nnew == STAGING_RECTS)
+			flush_new_rects();
+	}
+	flush_new_rects();
+	if (nrects > count)
+		nrects = count;
+}
+
+
+static void vattr(const GLuint program, const GLchar* const name,
+                  const GLint size, const GLsizei stride,
+                  const size_t offset, const GLuint divisor)
+{
+	const GLint index = glGetAttribLocation(program, name);
+	if (index < 0)
+		return;
+
+	glEnableVertexAttribArray(index);
+	glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE,
+	                      stride, (const GLvoid*)offset);
+	glVertexAttribDivisor(index, divisor);
+}
+
+static bool init_buffers(void)
+{
+	const GLchar* const sim_vs_src =
+	"#version 150\n"
+	"in vec2 pos;\n"
+	"in vec2 vel;\n"
+	"out vec2 out_pos;\n"
+	"out vec2 out_vel;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 v = vel;\n"
+	"	if (pos.x < -1.0 || pos.x > 1.0)\n"
+	"		v.x = -v.x;\n"
+	"	if (pos.y < -1.0 || pos.y > 1.0)\n"
+	"		v.y = -v.y;\n"
+	"	out_pos = pos + v;\n"
+	"	out_vel = v;\n"
+	"}\n";
+
+	// corners of a triangle strip quad from the vertex id
+	const GLchar* const draw_vs_src =
+	"#version 150\n"
+	"in vec2 pos;\n"
+	"in vec2 prev_pos;\n"
+	"in vec3 rgb;\n"
+	"in float size;\n"
+	"uniform float alpha;\n"
+	"out vec4 frag_color;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;\n"
+	"	gl_Position = vec4(mix(prev_pos, pos, alpha) + corner * size, 0.0, 1.0);\n"
+	"	frag_color = vec4(rgb, 1.0);\n"
+	"}\n";
+
+	const GLchar* const draw_fs_src =
+	"#version 150\n"
+	"in vec4 frag_color;\n"
+	"out vec4 outcolor;\n"
+	"void main()\n"
+	"{\n"
+	"	outcolor = frag_color;\n"
+	"}\n";
+
+	static const GLchar* const varyings[] = { "out_pos", "out_vel" };
+
+	sim_program = sogl_create_feedback_program(sim_vs_src, varyings, 2);
+	if (sim_program == 0)
+		return false;
+
+	draw_program = sogl_create_program(draw_vs_src, draw_fs_src);
+	if (draw_program == 0)
+		return false;
+	alpha_loc = glGetUniformLocation(draw_program, "alpha");
+
+	glGenBuffers(2, state_vbos);
+	glGenBuffers(1, &look_vbo);
+	glGenVertexArrays(2, sim_vaos);
+	glGenVertexArrays(2, draw_vaos);
+
+	glBindBuffer(GL_ARRAY_BUFFER, look_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(struct look) * MAX_RECTS,
+	             NULL, GL_STATIC_DRAW);
+
+	for (int i = 0; i < 2; ++i) {
+		glBindBuffer(GL_ARRAY_BUFFER, state_vbos[i]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(struct particle) * MAX_RECTS,
+		             NULL, GL_DYNAMIC_COPY);
+	}
+
+	// draw_vaos[i] draws from state_vbos[1 - i] to state_vbos[i]
+	for (int i = 0; i < 2; ++i) {
+		glBindBuffer(GL_ARRAY_BUFFER, state_vbos[i]);
+		glBindVertexArray(sim_vaos[i]);
+		vattr(sim_program, "pos", 2, sizeof(struct particle),
+		      offsetof(struct particle, pos), 0);
+		vattr(sim_program, "vel", 2, sizeof(struct particle),
+		      offsetof(struct particle, vel), 0);
+
+		glBindVertexArray(draw_vaos[i]);
+		vattr(draw_program, "pos", 2, sizeof(struct particle),
+		      offsetof(struct particle, pos), 1);
+		glBindBuffer(GL_ARRAY_BUFFER, state_vbos[1 - i]);
+		vattr(draw_program, "prev_pos", 2, sizeof(struct particle),
+		      offsetof(struct particle, pos), 1);
+		glBindBuffer(GL_ARRAY_BUFFER, look_vbo);
+		vattr(draw_program, "rgb", 3, sizeof(struct look),
+		      offsetof(struct look, color), 1);
+		vattr(draw_program, "size", 1, sizeof(struct look),
+		      offsetof(struct look, size), 1);
+	}
+
+	sogl_bind();
+	return true;
+}
+
+static void term_buffers(void)
+{
+	glDeleteVertexArrays(2, draw_vaos);
+	glDeleteVertexArrays(2, sim_vaos);
+	glDeleteBuffers(1, &look_vbo);
+	glDeleteBuffers(2, state_vbos);
+	glDeleteProgram(draw_program);
+	glDeleteProgram(sim_program);
+}
+
+
+static void simulate(void)
+{
+	const int next = 1 - cur;
+
+	glUseProgram(sim_program);
+	glBindVertexArray(sim_vaos[cur]);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, state_vbos[next]);
+
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, nrects);
+	glEndTransformFeedback();
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	cur = next;
+}
+
+static void draw(const GLfloat alpha)
+{
+	glUseProgram(draw_program);
+	glUniform1f(alpha_loc, alpha);
+	glBindVertexArray(draw_vaos[cur]);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, nrects);
+}
+
+
+int main(int argc, char** argv)
+{
+	// same as dod.c, a count runs that many instead of the controller's
+	const long long fixed_count = argc > 1 ? atoll(argv[1]) : 0;
+	if (fixed_count < 0 || fixed_count > MAX_RECTS) {
+		fprintf(stderr, "usage: %s [rects, up to %lld]\n", argv[0], MAX_RECTS);
+		return EXIT_FAILURE;
+	}
+
+	const GLchar* const vs_src =
+	"#version 150\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4(0.0);\n"
+	"}\n";
+
+	const GLchar* const fs_src =
+	"#version 150\n"
+	"out vec4 outcolor;\n"
+	"void main()\n"
+	"{\n"
+	"	outcolor = vec4(1.0);\n"
+	"}\n";
+
+
+	if (!sogl_init("TFB", WIN_WIDTH, WIN_HEIGHT, vs_src, fs_src))
+		return EXIT_FAILURE;
+
+	if (!init_buffers())
+		goto Linit_buffers_failed;
+
+	// the same counters as dod.c, on screen instead of a printf per frame
+	if (!sogl_hud_init(WIN_WIDTH, WIN_HEIGHT, SOGL_HUD_REFRESH_MS))
+		fprintf(stderr, "Couldn't create the HUD, running without it\n");
+
+	SDL_GL_SetSwapInterval(0);
+	init_random_engine();
+
+	struct sogl_sim sim;
+	struct sogl_loadctl ctl;
+	sogl_sim_init(&sim, SIM_STEP_MS, sogl_fixed_dt());
+	sogl_loadctl_init(&ctl, BUDGET_MS, 0, MAX_RECTS);
+	resize_rects(fixed_count);
+
+	while (sogl_handle_events()) {
+		sogl_begin_frame();
+
+		glClearColor(0x00, 0x00, 0x00, 0xFF);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		const int steps = sogl_sim_advance(&sim);
+		if (nrects > 0) {
+			for (int s = 0; s < steps; ++s)
+				simulate();
+			draw(sogl_sim_alpha(&sim));
+		}
+
+		sogl_hud_draw();
+		sogl_end_frame();
+
+		// uploaded: the rects spawned at the end of the previous frame
+		sogl_hud_set("RECTS", nrects);
+		sogl_hud_set("UPLOADED KB", uploaded / 1024.0);
+		uploaded = 0;
+
+		// sim.frame_ms is the whole frame, swap and events included
+		if (fixed_count == 0)
+			resize_rects(sogl_loadctl_update(&ctl, sim.frame_ms));
+		sogl_hud_frame(sim.frame_ms);
+	}
+
+	if (fixed_count == 0)
+		sogl_loadctl_report(&ctl, "RECTS");
+	sogl_hud_term();
+
+Linit_buffers_failed:
+	term_buffers();
+	sogl_term();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stb_image.h>
+#include <stb_image_write.h>
+#include <sogl_bcn.h>
+
+/* imgdiff: compares a rendered image against a golden one
+ * usage: imgdiff [-p min_psnr] [-d diff.png] golden.png image.png
+ *  -p: lowest RGB PSNR in dB still accepted, defaults to 45
+ *      (identical images have an infinite PSNR)
+ *  -d: writes the absolute difference, scaled by 16, to diff.png
+ * prints the PSNR, the largest channel difference and the pixels
+ * differing by more than 2 in any channel, fails when the sizes
+ * differ or the PSNR is below the threshold
+ * */
+
+#define DEFAULT_MIN_PSNR (45.0)
+#define PIXEL_TOLERANCE  (2)
+
+int main(int argc, char** argv)
+{
+	double min_psnr = DEFAULT_MIN_PSNR;
+	const char* diff_path = NULL;
+	int argi = 1;
+
+	for (; argi + 1 < argc && argv[argi][0] == '-'; argi += 2) {
+		if (strcmp(argv[argi], "-p") == 0)
+			min_psnr = atof(argv[argi + 1]);
+		else if (strcmp(argv[argi], "-d") == 0)
+			diff_path = argv[argi + 1];
+		else
+			break;
+	}
+
+	if (argc - argi != 2) {
+		fprintf(stderr, "usage: %s [-p min_psnr] [-d diff.png] golden.png image.png\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int retval = EXIT_FAILURE;
+	int gw, gh, iw, ih, channels;
+	unsigned char* const golden = stbi_load(argv[argi], &gw, &gh, &channels, 4);
+	unsigned char* const image = stbi_load(argv[argi + 1], &iw, &ih, &channels, 4);
+	if (golden == NULL || image == NULL) {
+		fprintf(stderr, "Couldn't load %s\n", golden == NULL ? argv[argi] : argv[argi + 1]);
+		goto Lfree;
+	}
+
+	if (gw != iw || gh != ih) {
+		printf("SIZE MISMATCH: %dx%d != %dx%d\n", gw, gh, iw, ih);
+		goto Lfree;
+	}
+
+	int max_diff = 0;
+	long bad_pixels = 0;
+	for (long i = 0; i < (long)gw * gh; ++i) {
+		int pixel_diff = 0;
+		for (int c = 0; c < 3; ++c) {
+			const int d = abs((int)golden[i * 4 + c] - image[i * 4 + c]);
+			pixel_diff = d > pixel_diff ? d : pixel_diff;
+		}
+		max_diff = pixel_diff > max_diff ? pixel_diff : max_diff;
+		bad_pixels += pixel_diff > PIXEL_TOLERANCE;
+	}
+
+	const double psnr = sogl_bcn_psnr(golden, image, gw, gh, 3);
+	printf("PSNR: %.2f DB MAX DIFF: %d PIXELS OFF: %ld OF %ld\n",
+	       psnr, max_diff, bad_pixels, (long)gw * gh);
+
+	if (diff_path != NULL && max_diff > 0) {
+		// reuses the golden buffer, it isn't needed anymore
+		for (long i = 0; i < (long)gw * gh; ++i) {
+			for (int c = 0; c < 3; ++c) {
+				const int d = abs((int)golden[i * 4 + c] - image[i * 4 + c]) * 16;
+				golden[i * 4 + c] = d > 255 ? 255 : d;
+			}
+			golden[i * 4 + 3] = 255;
+		}
+		if (!stbi_write_png(diff_path, gw, gh, 4, golden, gw * 4))
+			fprintf(stderr, "Couldn't write %s\n", diff_path);
+	}
+
+	retval = psnr >= min_psnr ? EXIT_SUCCESS : EXIT_FAILURE;
+
+Lfree:
+	stbi_image_free(image);
+	stbi_image_free(golden);
+	return retval;
+}
@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <float.h>
+#include <sogl_mesh.h>
+#include <sogl_meshfile.h>
+
+/* obj2mesh: converts a Wavefront OBJ into the sogl binary mesh format
+ * usage: obj2mesh [-n] input.obj output.smesh
+ *  -n: normalize the positions into the [-0.5, 0.5] cube
+ * */
+
+#define MAX_LINE (4096)
+
+struct corner {
+	long v, t, n;
+};
+
+struct array {
+	void* data;
+	long count;
+	long capacity;
+	size_t elem_size;
+};
+
+
+static void* array_push(struct array* const arr)
+{
+	if (arr->count == arr->capacity) {
+		const long newcap = arr->capacity ? arr->capacity * 2 : 1024;
+		void* const newdata = realloc(arr->data, newcap * arr->elem_size);
+		if (newdata == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+		arr->data = newdata;
+		arr->capacity = newcap;
+	}
+	return (char*)arr->data + arr->elem_size * arr->count++;
+}
+
+static const char* parse_floats(const char* str, float* const out, const int count)
+{
+	for (int i = 0; i < count; ++i) {
+		char* end;
+		out[i] = strtof(str, &end);
+		str = end;
+	}
+	return str;
+}
+
+// resolves 1-based and negative (relative) OBJ indices to 0-based, -1 if absent
+static long resolve_index(const long idx, const long count)
+{
+	if (idx > 0)
+		return idx - 1;
+	if (idx < 0)
+		return count + idx;
+	return -1;
+}
+
+static bool parse_face(const char* str,
+                       struct array* const corners,
+                       const long npos, const long nuv, const long nnorm)
+{
+	struct corner poly[64];
+	int npoly = 0;
+
+	for (;;) {
+		while (isspace((unsigned char)*str))
+			++str;
+		if (*str == '\0' || *str == '#')
+			break;
+
+		if (npoly == (int)(sizeof(poly) / sizeof(poly[0]))) {
+			fprintf(stderr, "Face with too many vertices\n");
+			return false;
+		}
+
+		char* end;
+		struct corner c = { -1, -1, -1 };
+		c.v = resolve_index(strtol(str, &end, 10), npos);
+		str = end;
+		if (*str == '/') {
+			++str;
+			if (*str != '/') {
+				c.t = resolve_index(strtol(str, &end, 10), nuv);
+				str = end;
+			}
+			if (*str == '/') {
+				++str;
+				c.n = resolve_index(strtol(str, &end, 10), nnorm);
+				str = end;
+			}
+		}
+
+		if (c.v < 0 || c.v >= npos || c.t >= nuv || c.n >= nnorm) {
+			fprintf(stderr, "Invalid face index\n");
+			return false;
+		}
+
+		poly[npoly++] = c;
+		while (*str != '\0' && !isspace((unsigned char)*str))
+			++str;
+	}
+
+	// triangulate as a fan
+	for (int i = 2; i < npoly; ++i) {
+		*(struct corner*)array_push(corners) = poly[0];
+		*(struct corner*)array_push(corners) = poly[i - 1];
+		*(struct corner*)array_push(corners) = poly[i];
+	}
+
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	bool normalize = false;
+	int argi = 1;
+
+	if (argi < argc && strcmp(argv[argi], "-n") == 0) {
+		normalize = true;
+		++argi;
+	}
+
+	if (argc - argi != 2) {
+		fprintf(stderr, "usage: %s [-n] input.obj output.smesh\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	FILE* const file = fopen(argv[argi], "r");
+	if (file == NULL) {
+		fprintf(stderr, "Couldn't open %s\n", argv[argi]);
+		return EXIT_FAILURE;
+	}
+
+	struct array positions = { .elem_size = sizeof(float) * 3 };
+	struct array uvs = { .elem_size = sizeof(float) * 2 };
+	struct array normals = { .elem_size = sizeof(float) * 3 };
+	struct array corners = { .elem_size = sizeof(struct corner) };
+
+	static char line[MAX_LINE];
+	long lineno = 0;
+	while (fgets(line, sizeof(line), file) != NULL) {
+		++lineno;
+		if (line[0] == 'v' && line[1] == ' ') {
+			parse_floats(line + 2, array_push(&positions), 3);
+		} else if (line[0] == 'v' && line[1] == 't' && line[2] == ' ') {
+			parse_floats(line + 3, array_push(&uvs), 2);
+		} else if (line[0] == 'v' && line[1] == 'n' && line[2] == ' ') {
+			parse_floats(line + 3, array_push(&normals), 3);
+		} else if (line[0] == 'f' && line[1] == ' ') {
+			if (!parse_face(line + 2, &corners, positions.count, uvs.count, normals.count)) {
+				fprintf(stderr, "%s:%ld: bad face\n", argv[argi], lineno);
+				fclose(file);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	fclose(file);
+
+	const struct corner* const cs = corners.data;
+	bool has_uv = uvs.count > 0, has_normal = normals.count > 0;
+	for (long i = 0; i < corners.count; ++i) {
+		has_uv = has_uv && cs[i].t >= 0;
+		has_normal = has_normal && cs[i].n >= 0;
+	}
+
+	struct sogl_meshfile_attrib attribs[3];
+	int nattribs = 0;
+	GLsizei vertex_size = 0;
+
+	attribs[nattribs++] = (struct sogl_meshfile_attrib) { "pos", 3, GL_FLOAT, GL_FALSE, vertex_size };
+	vertex_size += sizeof(float) * 3;
+	if (has_normal) {
+		attribs[nattribs++] = (struct sogl_meshfile_attrib) { "normal", 3, GL_FLOAT, GL_FALSE, vertex_size };
+		vertex_size += sizeof(float) * 3;
+	}
+	if (has_uv) {
+		attribs[nattribs++] = (struct sogl_meshfile_attrib) { "uv", 2, GL_FLOAT, GL_FALSE, vertex_size };
+		vertex_size += sizeof(float) * 2;
+	}
+
+	float center[3] = { 0, 0, 0 };
+	float scale = 1.0f;
+	if (normalize && positions.count > 0) {
+		float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		const float* const p = positions.data;
+		for (long i = 0; i < positions.count; ++i) {
+			for (int k = 0; k < 3; ++k) {
+				if (p[i * 3 + k] < min[k]) min[k] = p[i * 3 + k];
+				if (p[i * 3 + k] > max[k]) max[k] = p[i * 3 + k];
+			}
+		}
+		float extent = 0;
+		for (int k = 0; k < 3; ++k) {
+			center[k] = (min[k] + max[k]) * 0.5f;
+			if (max[k] - min[k] > extent)
+				extent = max[k] - min[k];
+		}
+		scale = extent > 0 ? 1.0f / extent : 1.0f;
+	}
+
+	float* const verts = malloc((size_t)corners.count * vertex_size);
+	if (verts == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	const int stride = vertex_size / sizeof(float);
+	for (long i = 0; i < corners.count; ++i) {
+		float* dst = &verts[i * stride];
+		const float* const p = (const float*)positions.data + cs[i].v * 3;
+		for (int k = 0; k < 3; ++k)
+			*dst++ = (p[k] - center[k]) * scale;
+		if (has_normal) {
+			memcpy(dst, (const float*)normals.data + cs[i].n * 3, sizeof(float) * 3);
+			dst += 3;
+		}
+		if (has_uv)
+			memcpy(dst, (const float*)uvs.data + cs[i].t * 2, sizeof(float) * 2);
+	}
+
+	free(positions.data);
+	free(uvs.data);
+	free(normals.data);
+	free(corners.data);
+
+	struct sogl_mesh mesh;
+	if (!sogl_mesh_build(verts, corners.count, vertex_size, 0, &mesh)) {
+		free(verts);
+		return EXIT_FAILURE;
+	}
+	free(verts);
+
+	if (!sogl_meshfile_write(argv[argi + 1], &mesh, attribs, nattribs, 0)) {
+		sogl_mesh_free(&mesh);
+		return EXIT_FAILURE;
+	}
+
+	printf("WROTE %s: %ld VERTICES, %ld INDICES (%s)\n",
+	       argv[argi + 1], mesh.nverts, mesh.nindices,
+	       mesh.index_type == GL_UNSIGNED_SHORT ? "16 bit" : "32 bit");
+
+	sogl_mesh_free(&mesh);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,546 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sogl.h>
+#include <sogl_apitrace.h>
+#define SOGL_RES_SHIM
+#include <sogl_res.h>
+
+/* replay: re-issues an API trace written with SOGL_TRACE
+ * usage: replay [-t] trace
+ *  -t: waits for each frame's original start time instead of
+ *      replaying as fast as possible
+ * the whole trace is loaded first so the disk isn't measured,
+ * prints the calls, total and mean CPU time of every kind of
+ * call, and the frame times. Traces of shaders older than
+ * #version 150 replay with SOGL_GL_COMPAT=1, see sogl.h
+ * */
+
+#define MAX_NAMES   (64)
+#define MIN_BLOBS   (1024)
+#define MAX_SHADOWS (64)
+
+
+struct cursor {
+	const uint8_t* p;
+	const uint8_t* end;
+	bool ok;
+};
+
+struct blob {
+	uint64_t hash;
+	const void* data;
+};
+
+// a sogl_buffer of the trace, recreated under a name of our own
+struct shadow {
+	GLuint key;
+	GLuint name;
+	GLenum target;
+};
+
+
+static struct blob* blobs;
+static size_t blobs_size, nblobs;
+
+// attribute and uniform names, interned so sogl_set_uniform caches them
+static char* names[MAX_NAMES];
+static int nnames;
+
+static struct shadow shadows[MAX_SHADOWS];
+static int nshadows;
+
+static long long calls[SOGL_APITRACE_NOPS];
+static Uint64 call_ticks[SOGL_APITRACE_NOPS];
+
+
+static void get(struct cursor* const c, void* const dst, const size_t size)
+{
+	if (!c->ok || (size_t)(c->end - c->p) < size) {
+		c->ok = false;
+		memset(dst, 0, size);
+		return;
+	}
+	memcpy(dst, c->p, size);
+	c->p += size;
+}
+
+static uint32_t get_u32(struct cursor* const c)
+{
+	uint32_t v;
+	get(c, &v, sizeof(v));
+	return v;
+}
+
+static int64_t get_i64(struct cursor* const c)
+{
+	int64_t v;
+	get(c, &v, sizeof(v));
+	return v;
+}
+
+static uint64_t get_u64(struct cursor* const c)
+{
+	uint64_t v;
+	get(c, &v, sizeof(v));
+	return v;
+}
+
+/* returns a NUL terminated copy to free */
+static char* get_str(struct cursor* const c)
+{
+	const uint32_t len = get_u32(c);
+	if (!c->ok || (size_t)(c->end - c->p) < len) {
+		c->ok = false;
+		return NULL;
+	}
+	char* const str = malloc(len + 1);
+	if (str == NULL) {
+		c->ok = false;
+		return NULL;
+	}
+	memcpy(str, c->p, len);
+	str[len] = '\0';
+	c->p += len;
+	return str;
+}
+
+static const char* get_name(struct cursor* const c)
+{
+	char* const name = get_str(c);
+	if (name == NULL)
+		return "";
+
+	for (int i = 0; i < nnames; ++i) {
+		if (strcmp(names[i], name) == 0) {
+			free(name);
+			return names[i];
+		}
+	}
+
+	if (nnames == MAX_NAMES) {
+		fprintf(stderr, "Couldn't intern %s, too many names\n", name);
+		free(name);
+		c->ok = false;
+		return "";
+	}
+	names[nnames] = name;
+	return names[nnames++];
+}
+
+
+static bool add_blob(const uint64_t hash, const void* const data)
+{
+	if ((nblobs + 1) * 2 > blobs_size) {
+		const size_t new_size = blobs_size > 0 ? blobs_size * 2 : MIN_BLOBS;
+		struct blob* const new_blobs = calloc(new_size, sizeof(*new_blobs));
+		if (new_blobs == NULL) {
+			fprintf(stderr, "Couldn't grow blob table\n");
+			return false;
+		}
+		for (size_t i = 0; i < blobs_size; ++i) {
+			if (blobs[i].hash == 0)
+				continue;
+			size_t j = blobs[i].hash & (new_size - 1);
+			while (new_blobs[j].hash != 0)
+				j = (j + 1) & (new_size - 1);
+			new_blobs[j] = blobs[i];
+		}
+		free(blobs);
+		blobs = new_blobs;
+		blobs_size = new_size;
+	}
+
+	size_t i = hash & (blobs_size - 1);
+	while (blobs[i].hash != 0 && blobs[i].hash != hash)
+		i = (i + 1) & (blobs_size - 1);
+	if (blobs[i].hash == 0)
+		++nblobs;
+	blobs[i] = (struct blob) { hash, data };
+	return true;
+}
+
+/* NULL for hash 0 and for unknown hashes, c is failed on the latter */
+static const void* find_blob(struct cursor* const c, const uint64_t hash)
+{
+	if (hash == 0 || blobs_size == 0) {
+		c->ok = c->ok && hash == 0;
+		return NULL;
+	}
+
+	size_t i = hash & (blobs_size - 1);
+	while (blobs[i].hash != 0) {
+		if (blobs[i].hash == hash)
+			return blobs[i].data;
+		i = (i + 1) & (blobs_size - 1);
+	}
+	fprintf(stderr, "Couldn't find blob %016llx\n", (unsigned long long)hash);
+	c->ok = false;
+	return NULL;
+}
+
+
+/* c is failed when the trace never created key */
+static struct shadow* find_shadow(struct cursor* const c, const GLuint key)
+{
+	for (int i = 0; i < nshadows; ++i) {
+		if (shadows[i].key == key)
+			return &shadows[i];
+	}
+	if (c->ok)
+		fprintf(stderr, "Couldn't find shadowed buffer %u\n", key);
+	c->ok = false;
+	return NULL;
+}
+
+
+static uint8_t* load_file(const char* const path, size_t* const size)
+{
+	FILE* const file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Couldn't open %s\n", path);
+		return NULL;
+	}
+
+	uint8_t* data = NULL;
+	if (fseek(file, 0, SEEK_END) != 0)
+		goto Lclose;
+	const long len = ftell(file);
+	if (len < 0 || fseek(file, 0, SEEK_SET) != 0)
+		goto Lclose;
+
+	data = malloc(len > 0 ? len : 1);
+	if (data == NULL) {
+		fprintf(stderr, "Couldn't allocate %ld bytes for %s\n", len, path);
+		goto Lclose;
+	}
+	if (fread(data, 1, len, file) != (size_t)len) {
+		fprintf(stderr, "Couldn't read %s\n", path);
+		free(data);
+		data = NULL;
+		goto Lclose;
+	}
+	*size = len;
+
+Lclose:
+	fclose(file);
+	return data;
+}
+
+
+int main(int argc, char** argv)
+{
+	bool timed = false;
+	int argi = 1;
+	if (argi < argc && strcmp(argv[argi], "-t") == 0) {
+		timed = true;
+		++argi;
+	}
+
+	if (argc - argi != 1) {
+		fprintf(stderr, "usage: %s [-t] trace\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	size_t size;
+	uint8_t* const trace = load_file(argv[argi], &size);
+	if (trace == NULL)
+		return EXIT_FAILURE;
+
+	int retval = EXIT_FAILURE;
+	bool initialized = false;
+	struct cursor c = { trace, trace + size, true };
+
+	char magic[SOGL_APITRACE_MAGIC_LEN];
+	get(&c, magic, sizeof(magic));
+	if (!c.ok || memcmp(magic, SOGL_APITRACE_MAGIC, sizeof(magic)) != 0) {
+		fprintf(stderr, "Couldn't replay %s, not a sogl trace\n", argv[argi]);
+		goto Lfree;
+	}
+
+	const double freq = SDL_GetPerformanceFrequency();
+	Uint64 start_clk = 0, frame_clk = 0;
+	long long nframes = 0;
+	double frame_ms_sum = 0, frame_ms_min = 1e30, frame_ms_max = 0;
+	bool done = false;
+
+	while (!done && c.ok && c.p < c.end) {
+		uint8_t op;
+		get(&c, &op, 1);
+		if (op >= SOGL_APITRACE_NOPS) {
+			fprintf(stderr, "Couldn't replay unknown op %d\n", op);
+			goto Lterm;
+		}
+		if (!initialized && op != SOGL_APITRACE_INIT) {
+			fprintf(stderr, "Couldn't replay %s before sogl_init\n", sogl_apitrace_op_names[op]);
+			goto Lterm;
+		}
+
+		Uint64 clk = SDL_GetPerformanceCounter();
+
+		switch (op) {
+		case SOGL_APITRACE_INIT: {
+			if (initialized) {
+				fprintf(stderr, "Couldn't replay a second sogl_init\n");
+				goto Lterm;
+			}
+			char* const winname = get_str(&c);
+			const int width = get_u32(&c);
+			const int height = get_u32(&c);
+			char* const vs_src = get_str(&c);
+			char* const fs_src = get_str(&c);
+			clk = SDL_GetPerformanceCounter();
+			initialized = c.ok && sogl_init(winname, width, height, vs_src, fs_src);
+			free(winname);
+			free(vs_src);
+			free(fs_src);
+			if (!initialized)
+				goto Lterm;
+			SDL_GL_SetSwapInterval(0);
+			start_clk = SDL_GetPerformanceCounter();
+			break;
+		}
+		case SOGL_APITRACE_TERM:
+			done = true;
+			break;
+		case SOGL_APITRACE_VATTRP: {
+			const char* const name = get_name(&c);
+			const GLint n = get_u32(&c);
+			const GLenum type = get_u32(&c);
+			const GLboolean normalized = get_u32(&c);
+			const GLsizei stride = get_u32(&c);
+			const uint64_t offset = get_u64(&c);
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			sogl_vattrp(name, n, type, normalized, stride, (const GLvoid*)(uintptr_t)offset);
+			break;
+		}
+		case SOGL_APITRACE_UNIFORM: {
+			const char* const name = get_name(&c);
+			GLfloat mat[16];
+			get(&c, mat, sizeof(mat));
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			sogl_set_uniform(name, mat);
+			break;
+		}
+		case SOGL_APITRACE_BEGIN_FRAME: {
+			const uint64_t ns = get_u64(&c);
+			if (!c.ok)
+				break;
+			if (!sogl_handle_events()) {
+				done = true;
+				break;
+			}
+			if (timed) {
+				const Uint64 due = start_clk + (Uint64)(ns * freq / 1e9);
+				while (SDL_GetPerformanceCounter() < due)
+					continue;
+			}
+			clk = frame_clk = SDL_GetPerformanceCounter();
+			sogl_begin_frame();
+			break;
+		}
+		case SOGL_APITRACE_END_FRAME: {
+			get_u64(&c);
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			sogl_end_frame();
+			const double ms = (SDL_GetPerformanceCounter() - frame_clk) * 1000.0 / freq;
+			frame_ms_sum += ms;
+			frame_ms_min = ms < frame_ms_min ? ms : frame_ms_min;
+			frame_ms_max = ms > frame_ms_max ? ms : frame_ms_max;
+			++nframes;
+			break;
+		}
+		case SOGL_APITRACE_BLOB: {
+			const uint64_t hash = get_u64(&c);
+			const uint64_t len = get_u64(&c);
+			if (!c.ok || (uint64_t)(c.end - c.p) < len || !add_blob(hash, c.p)) {
+				c.ok = false;
+				break;
+			}
+			c.p += len;
+			break;
+		}
+		case SOGL_APITRACE_CLEAR_COLOR: {
+			GLfloat rgba[4];
+			get(&c, rgba, sizeof(rgba));
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			glClearColor(rgba[0], rgba[1], rgba[2], rgba[3]);
+			break;
+		}
+		case SOGL_APITRACE_CLEAR: {
+			const GLbitfield mask = get_u32(&c);
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			glClear(mask);
+			break;
+		}
+		case SOGL_APITRACE_BUFFER_DATA: {
+			const GLenum target = get_u32(&c);
+			const GLsizeiptr len = get_i64(&c);
+			const void* const data = find_blob(&c, get_u64(&c));
+			const GLenum usage = get_u32(&c);
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			glBufferData(target, len, data, usage);
+			break;
+		}
+		case SOGL_APITRACE_BUFFER_SUB: {
+			const GLenum target = get_u32(&c);
+			const GLintptr offset = get_i64(&c);
+			const GLsizeiptr len = get_i64(&c);
+			const void* const data = find_blob(&c, get_u64(&c));
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			glBufferSubData(target, offset, len, data);
+			break;
+		}
+		case SOGL_APITRACE_DRAW_ARRAYS: {
+			const GLenum mode = get_u32(&c);
+			const GLint first = get_u32(&c);
+			const GLsizei count = get_u32(&c);
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			glDrawArrays(mode, first, count);
+			break;
+		}
+		case SOGL_APITRACE_ENABLE:
+		case SOGL_APITRACE_DISABLE: {
+			const GLenum cap = get_u32(&c);
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			if (op == SOGL_APITRACE_ENABLE)
+				glEnable(cap);
+			else
+				glDisable(cap);
+			break;
+		}
+		case SOGL_APITRACE_POLYGON_MODE: {
+			const GLenum face = get_u32(&c);
+			const GLenum mode = get_u32(&c);
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			glPolygonMode(face, mode);
+			break;
+		}
+		case SOGL_APITRACE_DRAW_QUADS:
+		case SOGL_APITRACE_DRAW_QUADS_INSTANCED: {
+			const GLint first = get_u32(&c);
+			const GLsizei count = get_u32(&c);
+			const GLsizei instances = op == SOGL_APITRACE_DRAW_QUADS_INSTANCED
+			                          ? (GLsizei)get_u32(&c) : 0;
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			if (op == SOGL_APITRACE_DRAW_QUADS)
+				sogl_draw_quads(first, count);
+			else
+				sogl_draw_quads_instanced(first, count, instances);
+			break;
+		}
+		// the sogl_buffer calls, as sogl_buffer.c issues them
+		case SOGL_APITRACE_SHADOW_CREATE: {
+			const GLuint key = get_u32(&c);
+			const GLenum target = get_u32(&c);
+			const GLsizeiptr len = get_i64(&c);
+			const GLenum usage = get_u32(&c);
+			if (!c.ok)
+				break;
+			if (nshadows == MAX_SHADOWS) {
+				fprintf(stderr, "Couldn't create shadowed buffer %u, too many\n", key);
+				c.ok = false;
+				break;
+			}
+			struct shadow* const shadow = &shadows[nshadows++];
+			shadow->key = key;
+			shadow->target = target;
+			clk = SDL_GetPerformanceCounter();
+			glGenBuffers(1, &shadow->name);
+			glBindBuffer(target, shadow->name);
+			glBufferData(target, len, NULL, usage);
+			break;
+		}
+		case SOGL_APITRACE_SHADOW_FLUSH: {
+			const struct shadow* const shadow = find_shadow(&c, get_u32(&c));
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			if (!sogl_dsa())
+				glBindBuffer(shadow->target, shadow->name);
+			break;
+		}
+		case SOGL_APITRACE_SHADOW_RANGE: {
+			const struct shadow* const shadow = find_shadow(&c, get_u32(&c));
+			const GLintptr offset = get_i64(&c);
+			const GLsizeiptr len = get_i64(&c);
+			const void* const data = find_blob(&c, get_u64(&c));
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			if (sogl_dsa())
+				glNamedBufferSubData(shadow->name, offset, len, data);
+			else
+				glBufferSubData(shadow->target, offset, len, data);
+			break;
+		}
+		case SOGL_APITRACE_SHADOW_DELETE: {
+			struct shadow* const shadow = find_shadow(&c, get_u32(&c));
+			if (!c.ok)
+				break;
+			clk = SDL_GetPerformanceCounter();
+			glDeleteBuffers(1, &shadow->name);
+			*shadow = shadows[--nshadows];
+			break;
+		}
+		}
+
+		++calls[op];
+		call_ticks[op] += SDL_GetPerformanceCounter() - clk;
+	}
+
+	if (!c.ok) {
+		fprintf(stderr, "Couldn't replay %s, truncated or corrupted at byte %ld\n",
+		        argv[argi], (long)(c.p - trace));
+		goto Lterm;
+	}
+
+	printf("%-26s %12s %12s %12s\n", "CALL", "COUNT", "TOTAL MS", "MEAN US");
+	for (int op = 0; op < SOGL_APITRACE_NOPS; ++op) {
+		if (calls[op] == 0 || op == SOGL_APITRACE_BLOB)
+			continue;
+		const double ms = call_ticks[op] * 1000.0 / freq;
+		printf("%-26s %12lld %12.3f %12.3f\n", sogl_apitrace_op_names[op],
+		       calls[op], ms, ms * 1000.0 / calls[op]);
+	}
+	printf("FRAMES: %lld MEAN: %.3f MS MIN: %.3f MS MAX: %.3f MS BLOBS: %zu\n",
+	       nframes, nframes > 0 ? frame_ms_sum / nframes : 0.0,
+	       nframes > 0 ? frame_ms_min : 0.0, frame_ms_max, nblobs);
+
+	retval = EXIT_SUCCESS;
+
+Lterm:
+	for (int i = 0; i < nshadows; ++i)
+		glDeleteBuffers(1, &shadows[i].name);
+	if (initialized)
+		sogl_term();
+Lfree:
+	for (int i = 0; i < nnames; ++i)
+		free(names[i]);
+	free(blobs);
+	free(trace);
+	return retval;
+}
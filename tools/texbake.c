@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sogl_jobs.h>
+#include <sogl_texture.h>
+#include <sogl_vt.h>
+
+/* texbake: bakes the texture cache of an image ahead of time
+ * usage: texbake [-k] [-v] [-f format] image.png [output]
+ *  -k: use a kaiser filter for the mip chain instead of a box filter
+ *  -v: cut the image into the pages of a virtual texture instead,
+ *      box filtered, see sogl_vt.h
+ *  -f: rgba, bc1, bc3 or bc7, defaults to bc1 for opaque images
+ *      and bc3 for images with alpha
+ *  output defaults to image.png + SOGL_TEXCACHE_EXT, or SOGL_VT_EXT
+ * */
+
+static bool parse_format(const char* const name, GLenum* const format)
+{
+	if (strcmp(name, "rgba") == 0)
+		*format = GL_RGBA8;
+	else if (strcmp(name, "bc1") == 0)
+		*format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	else if (strcmp(name, "bc3") == 0)
+		*format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	else if (strcmp(name, "bc7") == 0)
+		*format = GL_COMPRESSED_RGBA_BPTC_UNORM;
+	else
+		return false;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	enum sogl_mip_filter filter = SOGL_MIP_BOX;
+	GLenum format = SOGL_TEXTURE_AUTO_FORMAT;
+	bool vt = false;
+	int argi = 1;
+
+	for (; argi < argc && argv[argi][0] == '-'; ++argi) {
+		if (strcmp(argv[argi], "-k") == 0) {
+			filter = SOGL_MIP_KAISER;
+		} else if (strcmp(argv[argi], "-v") == 0) {
+			vt = true;
+		} else if (strcmp(argv[argi], "-f") == 0 && argi + 1 < argc &&
+		           parse_format(argv[argi + 1], &format)) {
+			++argi;
+		} else {
+			break;
+		}
+	}
+
+	if (argc - argi < 1 || argc - argi > 2 || argv[argi][0] == '-') {
+		fprintf(stderr, "usage: %s [-k] [-v] [-f rgba|bc1|bc3|bc7] image.png [output]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	char cache_path[4096];
+	if (argc - argi == 2)
+		snprintf(cache_path, sizeof(cache_path), "%s", argv[argi + 1]);
+	else if (vt)
+		sogl_vt_path(argv[argi], cache_path, sizeof(cache_path));
+	else
+		sogl_texture_cache_path(argv[argi], cache_path, sizeof(cache_path));
+
+	if (!sogl_jobs_init(0))
+		return EXIT_FAILURE;
+
+	const bool ok = vt ? sogl_vt_bake(argv[argi], cache_path, format)
+	                   : sogl_texture_bake(argv[argi], cache_path, filter, format);
+	sogl_jobs_term();
+	if (!ok)
+		return EXIT_FAILURE;
+
+	printf("WROTE %s\n", cache_path);
+	return EXIT_SUCCESS;
+}